@@ -0,0 +1,106 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_ASYNC_RESULT_H_
+#define MAIDSAFE_NFS_CLIENT_ASYNC_RESULT_H_
+
+#include <chrono>
+#include <functional>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "boost/asio/async_result.hpp"
+#include "boost/asio/detail/bind_handler.hpp"
+#include "boost/asio/handler_type.hpp"
+#include "boost/asio/io_service.hpp"
+#include "boost/expected/expected.hpp"
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+#include "maidsafe/nfs/client/client_utils.h"
+#include "maidsafe/nfs/client/messages.h"
+#include "maidsafe/nfs/client/slab_future.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// The completion-token overloads of the client calls follow the boost::asio AsyncResult model
+// (as does the draft Posix API in docs/posix_api.md): the token may be a callback taking an
+// AsyncExpected<T>, a boost::asio::yield_context, or boost::asio::use_future, and determines the
+// return type (void, AsyncExpected<T> and std::future<AsyncExpected<T>> respectively).  Handlers
+// are copied, so must be copyable.
+template <typename T>
+using AsyncExpected = boost::expected<T, std::error_code>;
+
+// Durations and SlabFutureTag are excluded, so calls passing them still pick the existing
+// overloads.
+template <typename CompletionToken>
+struct IsCompletionToken
+    : std::integral_constant<
+          bool, !std::is_convertible<typename std::decay<CompletionToken>::type,
+                                     std::chrono::steady_clock::duration>::value &&
+                    !std::is_same<typename std::decay<CompletionToken>::type,
+                                  SlabFutureTag>::value> {};
+
+template <typename CompletionToken, typename T>
+using AsyncHandler =
+    typename boost::asio::handler_type<CompletionToken, void(AsyncExpected<T>)>::type;
+
+template <typename CompletionToken, typename T>
+using AsyncResult = typename std::enable_if<
+    IsCompletionToken<CompletionToken>::value,
+    typename boost::asio::async_result<AsyncHandler<CompletionToken, T>>::type>::type;
+
+AsyncExpected<void> GetAsyncExpectedSuccess(const ReturnCode& result);
+
+AsyncExpected<std::vector<StructuredDataVersions::VersionName>> GetAsyncExpectedVersionNames(
+    const StructuredDataNameAndContentOrReturnCode& result);
+
+// The value is the tip of the tree, if the response carried one.
+AsyncExpected<boost::optional<StructuredDataVersions::VersionName>> GetAsyncExpectedTipOfTree(
+    const TipOfTreeAndReturnCode& result);
+
+template <typename Data>
+AsyncExpected<Data> GetAsyncExpectedData(const DataNameAndContentOrReturnCode& result) {
+  auto data(GetDataOrError<Data>(result));
+  if (!data.valid())
+    return boost::make_unexpected(data.error().code());
+  return std::move(*data);
+}
+
+// Returns a response functor which converts the response using 'to_expected' and dispatches
+// 'handler' with the outcome on 'io_service': inline if already running there, otherwise posted.
+// Either way the handler's own invocation hooks are honoured, so a coroutine started by
+// boost::asio::spawn, for example, resumes on its strand.
+template <typename Contents, typename Handler, typename ToExpected>
+std::function<void(Contents)> DispatchToHandler(boost::asio::io_service& io_service,
+                                                Handler handler, ToExpected to_expected) {
+  return [&io_service, handler, to_expected](Contents contents) {
+    io_service.dispatch(boost::asio::detail::bind_handler(handler, to_expected(contents)));
+  };
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_ASYNC_RESULT_H_
@@ -0,0 +1,78 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_CLIENT_ROUTING_H_
+#define MAIDSAFE_NFS_CLIENT_CLIENT_ROUTING_H_
+
+#include <memory>
+#include <vector>
+
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/routing_api.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// The part of routing::Routing the clients use.  Every request a client sends goes from it to a
+// group, so there is only the one kind of message to send; responses come back through the functors
+// given to Join.  NetworkRouting passes everything to the real network, while
+// nfs::SimulatedNetwork provides an in-process stand-in for tests and benchmarks.
+class ClientRouting {
+ public:
+  virtual ~ClientRouting();
+
+  virtual NodeId kNodeId() const = 0;
+  virtual void Join(const routing::Functors& functors) = 0;
+  virtual void Send(const routing::SingleToGroupMessage& message) = 0;
+  // The vaults a message to 'group_id' reaches, in order of closeness, if known without asking the
+  // network; otherwise empty.  This lets a client send one request per close group for a batch of
+  // names.  Returns nothing by default.
+  virtual std::vector<NodeId> CloseGroup(const NodeId& group_id) const;
+};
+
+class NetworkRouting : public ClientRouting {
+ public:
+  // Creates and owns a routing::Routing for 'keys' (a passport::Maid or Mpid, say).
+  template <typename Keys>
+  explicit NetworkRouting(const Keys& keys)
+      : owned_routing_(maidsafe::make_unique<routing::Routing>(keys)), routing_(*owned_routing_) {}
+  // Uses 'routing', which must outlive this.
+  explicit NetworkRouting(routing::Routing& routing);
+
+  virtual NodeId kNodeId() const;
+  virtual void Join(const routing::Functors& functors);
+  virtual void Send(const routing::SingleToGroupMessage& message);
+
+ private:
+  NetworkRouting();
+  NetworkRouting(const NetworkRouting&);
+  NetworkRouting(NetworkRouting&&);
+  NetworkRouting& operator=(NetworkRouting);
+
+  std::unique_ptr<routing::Routing> owned_routing_;
+  routing::Routing& routing_;
+};
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_CLIENT_ROUTING_H_
@@ -19,17 +19,27 @@
 #ifndef MAIDSAFE_NFS_CLIENT_CLIENT_UTILS_H_
 #define MAIDSAFE_NFS_CLIENT_CLIENT_UTILS_H_
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 
 #include "boost/exception/all.hpp"
+#include "boost/expected/expected.hpp"
 #include "boost/thread/future.hpp"
 
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/data_types/immutable_data.h"
 #include "maidsafe/common/data_types/structured_data_versions.h"
 
 #include "maidsafe/routing/timer.h"
 
 #include "maidsafe/nfs/utils.h"
+#include "maidsafe/nfs/client/client_routing.h"
 #include "maidsafe/nfs/client/messages.h"
 #include "maidsafe/nfs/client/maid_node_dispatcher.h"
 
@@ -37,6 +47,42 @@ namespace maidsafe {
 
 namespace nfs_client {
 
+// Number of threads in the BoostAsioService a client creates for itself when it isn't given one.
+const int kDefaultClientThreadCount(2);
+// Number of threads in the BoostAsioService on which a client resolves its futures when it isn't
+// given one.
+const int kDefaultCompletionThreadCount(1);
+// Network health (percentage of a full routing table) at which a client made by MakeSharedAsync
+// starts sending requests.
+const int kDefaultReadyNetworkHealth(50);
+// Upper bound on the number of names carried by a single GetVersionsBatch message.
+const size_t kMaxNamesPerGetVersionsRequest(1000);
+
+// Response functors are invoked on the threads which handle routing messages and timers.  This
+// returns a functor which instead posts 'functor' to 'completion_service', so the promise it sets,
+// and any continuation attached to the corresponding future, can't hold those threads up.  If
+// 'completion_service' is null, 'functor' is returned unchanged.
+template <typename Contents>
+std::function<void(Contents)> OnCompletionService(
+    const std::shared_ptr<BoostAsioService>& completion_service,
+    std::function<void(Contents)> functor) {
+  if (!completion_service)
+    return functor;
+  std::weak_ptr<BoostAsioService> weak_completion_service(completion_service);
+  return [weak_completion_service, functor](Contents contents) {
+    auto completion_service(weak_completion_service.lock());
+    if (!completion_service)
+      return functor(std::move(contents));
+    completion_service->service().post([functor, contents] { functor(contents); });
+  };
+}
+
+typedef boost::expected<std::vector<StructuredDataVersions::VersionName>, maidsafe_error>
+    VersionNamesOrError;
+
+template <typename DataName>
+using VersionNamesByName = std::map<DataName, VersionNamesOrError>;
+
 template <typename Data>
 struct HandleGetResult {
   explicit HandleGetResult(std::shared_ptr<boost::promise<Data>> promise_in)
@@ -70,33 +116,191 @@ void HandlePutVersionResult(
 void HandleRegisterPmidResult(const ReturnCode& result,
                               std::shared_ptr<boost::promise<void>> promise);
 
+// Sets 'promise' with one ReturnCode per entry in 'data_names', in the same order.  Names which the
+// response doesn't mention are left as CommonErrors::defaulted.
+void HandleReferenceCountsResult(const DataNamesAndReturnCodes& result,
+                                 const std::vector<ImmutableData::Name>& data_names,
+                                 std::shared_ptr<boost::promise<std::vector<ReturnCode>>> promise);
+
+void HandleReferenceCountResult(const DataNamesAndReturnCodes& result,
+                                const ImmutableData::Name& data_name,
+                                std::shared_ptr<boost::promise<void>> promise);
+
+void HandleDeleteResult(const ReturnCode& result, std::shared_ptr<boost::promise<void>> promise);
+
+// The time left until 'deadline', or zero once it has passed.  Used to give a request held by a
+// ReadinessGate only what remains of the timeout it was made with.
+std::chrono::steady_clock::duration TimeRemaining(
+    const std::chrono::steady_clock::time_point& deadline);
+
+// Gathers the responses to a Delete which was split over several DeleteBatch messages.  Each
+// response covers the names in [first_index, last_index) of the original request.
+class HandleDeleteBatchResult {
+ public:
+  HandleDeleteBatchResult(std::shared_ptr<boost::promise<std::vector<ReturnCode>>> promise,
+                          std::vector<nfs_vault::DataName> data_names, size_t part_count);
+  void operator()(size_t first_index, size_t last_index, const DataNamesAndReturnCodes& result);
+
+ private:
+  HandleDeleteBatchResult(const HandleDeleteBatchResult&);
+  HandleDeleteBatchResult(HandleDeleteBatchResult&&);
+  HandleDeleteBatchResult& operator=(HandleDeleteBatchResult);
+
+  std::mutex mutex_;
+  std::shared_ptr<boost::promise<std::vector<ReturnCode>>> promise_;
+  const std::vector<nfs_vault::DataName> kDataNames_;
+  std::vector<ReturnCode> return_codes_;
+  size_t outstanding_count_;
+};
+
+// Splits 'data_names' into the batches for a multi-name GetVersions: one per close group that
+// 'routing' reports, each of at most kMaxNamesPerGetVersionsRequest names.  A name whose close
+// group 'routing' can't tell is a batch of its own.
+template <typename DataName>
+std::vector<std::vector<DataName>> BatchByCloseGroup(const ClientRouting& routing,
+                                                     const std::set<DataName>& data_names);
+
+// Gathers the responses to a multi-name GetVersions, one per batch of names, and sets the promise
+// once every name has either its versions or an error.
+template <typename DataName>
+class HandleMultipleGetVersionsResult {
+ public:
+  HandleMultipleGetVersionsResult(
+      std::shared_ptr<boost::promise<VersionNamesByName<DataName>>> promise,
+      size_t expected_count);
+  // A name the response doesn't mention is given the error for the batch as a whole, or
+  // CommonErrors::uninitialised if the batch succeeded.
+  void operator()(const std::vector<DataName>& data_names,
+                  const StructuredDataNamesAndContentsOrReturnCodes& result);
+
+ private:
+  HandleMultipleGetVersionsResult(const HandleMultipleGetVersionsResult&);
+  HandleMultipleGetVersionsResult(HandleMultipleGetVersionsResult&&);
+  HandleMultipleGetVersionsResult& operator=(HandleMultipleGetVersionsResult);
+
+  std::mutex mutex_;
+  std::shared_ptr<boost::promise<VersionNamesByName<DataName>>> promise_;
+  VersionNamesByName<DataName> results_;
+  size_t outstanding_count_;
+};
+
+VersionNamesOrError GetVersionNamesOrError(const StructuredDataNameAndContentOrReturnCode& result);
+
+// The data held in 'result', or the error it carries.
+template <typename Data>
+boost::expected<Data, maidsafe_error> GetDataOrError(const DataNameAndContentOrReturnCode& result);
+
+// Outcome of an operation whose response is a bare ReturnCode, in the form OperationSlab expects.
+boost::expected<bool, maidsafe_error> GetSuccessOrError(const ReturnCode& result);
+
 // ==================== Implementation =============================================================
+template <typename DataName>
+std::vector<std::vector<DataName>> BatchByCloseGroup(const ClientRouting& routing,
+                                                     const std::set<DataName>& data_names) {
+  std::map<std::vector<NodeId>, std::vector<DataName>> by_close_group;
+  std::vector<std::vector<DataName>> batches;
+  for (const auto& data_name : data_names) {
+    auto close_group(routing.CloseGroup(NodeId(data_name->string())));
+    if (close_group.empty()) {
+      batches.push_back(std::vector<DataName>(1, data_name));
+      continue;
+    }
+    // The order of closeness differs between names in one group, so it's no part of the key.
+    std::sort(std::begin(close_group), std::end(close_group));
+    by_close_group[close_group].push_back(data_name);
+  }
+  for (const auto& group : by_close_group) {
+    for (size_t first(0); first < group.second.size(); first += kMaxNamesPerGetVersionsRequest) {
+      auto last(std::min(first + kMaxNamesPerGetVersionsRequest, group.second.size()));
+      batches.emplace_back(std::begin(group.second) + first, std::begin(group.second) + last);
+    }
+  }
+  return batches;
+}
+
+template <typename DataName>
+HandleMultipleGetVersionsResult<DataName>::HandleMultipleGetVersionsResult(
+    std::shared_ptr<boost::promise<VersionNamesByName<DataName>>> promise,
+    size_t expected_count)
+    : mutex_(), promise_(std::move(promise)), results_(), outstanding_count_(expected_count) {
+  if (outstanding_count_ == 0)
+    promise_->set_value(results_);
+}
+
+template <typename DataName>
+void HandleMultipleGetVersionsResult<DataName>::operator()(
+    const std::vector<DataName>& data_names,
+    const StructuredDataNamesAndContentsOrReturnCodes& result) {
+  std::map<nfs_vault::DataName, VersionNamesOrError> results_by_name;
+  if (nfs::IsSuccess(result)) {
+    for (const auto& name_and_result : result.results) {
+      results_by_name.insert(std::make_pair(name_and_result.first,
+                                            GetVersionNamesOrError(name_and_result.second)));
+    }
+  }
+  const maidsafe_error kMissing(nfs::IsSuccess(result) ? MakeError(CommonErrors::uninitialised)
+                                                       : result.return_code.value);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (outstanding_count_ == 0)
+      return;
+    for (const auto& data_name : data_names) {
+      auto itr(results_by_name.find(nfs_vault::DataName(data_name)));
+      if (itr != std::end(results_by_name))
+        results_.insert(std::make_pair(data_name, itr->second));
+      else
+        results_.insert(std::make_pair(data_name,
+                                       VersionNamesOrError(boost::make_unexpected(kMissing))));
+    }
+    if (--outstanding_count_ != 0)
+      return;
+  }
+  LOG(kVerbose) << "HandleMultipleGetVersionsResult all " << results_.size() << " names resolved";
+  promise_->set_value(std::move(results_));
+}
+
+template <typename Data>
+boost::expected<Data, maidsafe_error> GetDataOrError(const DataNameAndContentOrReturnCode& result) {
+  if (result.content) {
+    if (result.name.type != Data::Tag::kValue) {
+      LOG(kError) << "GetDataOrError incorrect returned data";
+      return boost::make_unexpected(MakeError(CommonErrors::invalid_parameter));
+    }
+    LOG(kInfo) << "GetDataOrError fetched chunk has name : "
+               << HexSubstr(result.name.raw_name) << " and content : "
+               << HexSubstr(result.content->data);
+    try {
+      return Data(typename Data::Name(result.name.raw_name),
+                  typename Data::serialised_type(NonEmptyString(result.content->data)));
+    }
+    catch (const maidsafe_error& error) {
+      LOG(kError) << "processing error when try to parsing the result of get";
+      return boost::make_unexpected(error);
+    }
+    catch (const std::exception&) {
+      LOG(kError) << "processing error when try to parsing the result of get";
+      return boost::make_unexpected(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  if (result.return_code) {
+    LOG(kWarning) << "GetDataOrError don't have a result but having a return code "
+                  << result.return_code->value.what();
+    return boost::make_unexpected(result.return_code->value);
+  }
+  LOG(kError) << "GetDataOrError result uninitialised";
+  return boost::make_unexpected(MakeError(CommonErrors::uninitialised));
+}
+
 template <typename Data>
 void HandleGetResult<Data>::operator()(const DataNameAndContentOrReturnCode& result) const {
   LOG(kVerbose) << "HandleGetResult<Data>::operator()";
+  auto data(GetDataOrError<Data>(result));
   try {
-    if (result.content) {
-      if (result.name.type != Data::Tag::kValue) {
-        LOG(kError) << "HandleGetResult incorrect returned data";
-        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-      }
-      LOG(kInfo) << "HandleGetResult fetched chunk has name : "
-                 << HexSubstr(result.name.raw_name) << " and content : "
-                 << HexSubstr(result.content->data);
-      Data data(typename Data::Name(result.name.raw_name),
-                typename Data::serialised_type(NonEmptyString(result.content->data)));
-      promise->set_value(data);
-    } else if (result.return_code) {
-      LOG(kWarning) << "HandleGetResult don't have a result but having a return code "
-                    << result.return_code->value.what();
-      BOOST_THROW_EXCEPTION(result.return_code->value);
-    } else {
-      LOG(kError) << "HandleGetResult result uninitialised";
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
-    }
+    if (!data.valid())
+      BOOST_THROW_EXCEPTION(data.error());
+    promise->set_value(std::move(*data));
   }
   catch (...) {
-    LOG(kError) << "processing error when try to parsing the result of get";
     promise->set_exception(boost::current_exception());
   }
 }
@@ -0,0 +1,161 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_CONGESTION_CONTROL_H_
+#define MAIDSAFE_NFS_CLIENT_CONGESTION_CONTROL_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/nfs/types.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// Queued requests are released in proportion to the weight of their class (see
+// CongestionControl::kPriorityWeights), chosen across all destination groups, so bulk transfers
+// can't hold up interactive requests for long, yet are never starved.
+enum class Priority : int { kInteractive = 0, kNormal = 1, kBulk = 2 };
+
+// Limits the number of requests outstanding to each destination group using an additive-increase /
+// multiplicative-decrease window.  The window grows by one request per window's worth of timely
+// responses, and halves (at most once per round trip) on a timeout or when a response takes more
+// than kLatencyThresholdFactor times the fastest round trip seen for that group.  The windows also
+// share a client-wide budget of outstanding requests.  Requests which don't fit in their window or
+// in the budget are queued here rather than on the network.
+class CongestionControl {
+ public:
+  typedef std::function<void()> SendFunctor;
+
+  struct Metrics {
+    Metrics() : window_size(0), in_flight(0), queue_depth(0) {}
+    size_t window_size;
+    size_t in_flight;
+    size_t queue_depth;
+  };
+
+  static const std::array<int, 3> kPriorityWeights;
+  static const double kInitialWindowSize;
+  static const double kMaxWindowSize;
+  static const int kLatencyThresholdFactor;
+  static const size_t kDefaultMaxInFlight;
+
+  // No more than 'max_in_flight' requests are outstanding at once, whatever their groups.
+  explicit CongestionControl(BoostAsioService& asio_service,
+                             size_t max_in_flight = kDefaultMaxInFlight);
+  // Waits for a sweep already running; any still to run then does nothing.
+  ~CongestionControl();
+
+  // Runs 'send' immediately if the window for 'group' and the client-wide budget have room and
+  // nothing is queued for the group, otherwise queues it under 'priority'.  The request is treated
+  // as lost if still unanswered 'timeout' after it's sent, which should be the caller's own timeout
+  // for it.
+  void Send(const NodeId& group, nfs::MessageAction action, nfs::MessageId message_id,
+            Priority priority, const std::chrono::steady_clock::duration& timeout,
+            SendFunctor send);
+
+  // Completes the request identified by 'group', 'action' and 'message_id'.  Only the first
+  // response to a request has any effect.
+  void OnResponse(const NodeId& group, nfs::MessageAction action, nfs::MessageId message_id);
+
+  // Drops all queued requests and stops tracking outstanding ones.
+  void Stop();
+
+  std::map<NodeId, Metrics> GetMetrics() const;
+
+ private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+  typedef std::pair<nfs::MessageAction, int32_t> RequestKey;
+
+  struct QueuedRequest {
+    RequestKey key;
+    // Order of queueing across all groups, so a class is served oldest first.
+    uint64_t sequence;
+    std::chrono::steady_clock::duration timeout;
+    SendFunctor send;
+  };
+
+  struct InFlightRequest {
+    TimePoint sent, deadline;
+  };
+
+  // Shared with the sweep's handlers, which may run after the CongestionControl is destroyed if its
+  // asio_service outlives it.
+  struct Liveness {
+    Liveness() : mutex(), alive(true) {}
+    std::mutex mutex;
+    bool alive;
+  };
+
+  struct Window {
+    Window();
+    double size;
+    std::chrono::steady_clock::duration min_latency;
+    TimePoint last_decrease, last_active;
+    std::map<RequestKey, InFlightRequest> in_flight;
+    std::array<std::deque<QueuedRequest>, 3> queues;
+  };
+
+  CongestionControl(const CongestionControl&);
+  CongestionControl(CongestionControl&&);
+  CongestionControl& operator=(CongestionControl);
+
+  void Increase(Window& window) const;
+  void Decrease(Window& window, const TimePoint& now) const;
+  size_t QueueDepth(const Window& window) const;
+  bool HasRoom(const Window& window) const;
+  void Track(Window& window, const RequestKey& key, const TimePoint& now,
+             const std::chrono::steady_clock::duration& timeout);
+  void Untrack(Window& window, std::map<RequestKey, InFlightRequest>::iterator request_itr);
+  // Releases queued requests, highest weighted class first, while the budget and their windows
+  // have room.
+  void TakeSendable(const TimePoint& now, std::vector<SendFunctor>& sendable);
+  void ArmTimer();
+  void OnTimer(const boost::system::error_code& error);
+
+  mutable std::mutex mutex_;
+  const size_t kMaxInFlight_;
+  std::shared_ptr<Liveness> liveness_;
+  boost::asio::steady_timer timer_;
+  std::map<NodeId, Window> windows_;
+  size_t in_flight_count_;
+  uint64_t next_sequence_;
+  // Running credit of each class for the smooth weighted round robin in TakeSendable.
+  std::array<int, 3> credits_;
+  bool timer_armed_, running_;
+};
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_CONGESTION_CONTROL_H_
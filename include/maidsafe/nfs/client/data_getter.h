@@ -21,6 +21,7 @@
 
 #include <functional>
 #include <memory>
+#include <set>
 #include <vector>
 #include <mutex>
 
@@ -36,10 +37,14 @@
 #include "maidsafe/nfs/message_wrapper.h"
 #include "maidsafe/nfs/service.h"
 #include "maidsafe/nfs/utils.h"
+#include "maidsafe/nfs/client/async_result.h"
+#include "maidsafe/nfs/client/client_routing.h"
 #include "maidsafe/nfs/client/client_utils.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/data_getter_dispatcher.h"
 #include "maidsafe/nfs/client/data_getter_service.h"
 #include "maidsafe/nfs/client/get_handler.h"
+#include "maidsafe/nfs/client/slab_future.h"
 
 namespace maidsafe {
 
@@ -50,7 +55,15 @@ class DataGetter {
   typedef boost::future<std::vector<StructuredDataVersions::VersionName>> VersionNamesFuture;
 
   // all_pmids_from_file should only be non-empty if TESTING is defined
-  DataGetter(BoostAsioService& asio_service, routing::Routing& routing);
+  // If 'completion_service' is given, futures are resolved on it rather than on 'asio_service'; see
+  // OnCompletionService.
+  DataGetter(BoostAsioService& asio_service, routing::Routing& routing,
+             std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  // As above, but sending through 'routing', which must outlive this.  If 'congestion_control' is
+  // given (it too must outlive this), requests pass through it; see DataGetterDispatcher.
+  DataGetter(BoostAsioService& asio_service, ClientRouting& routing,
+             std::shared_ptr<BoostAsioService> completion_service = nullptr,
+             CongestionControl* congestion_control = nullptr);
 
   // This call only cancels the rpc timers. As routing object is not owned by data getter,
   // it doesn't stop routing.
@@ -61,11 +74,41 @@ class DataGetter {
       const DataName& data_name,
       const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
+  // Completion-token forms; see AsyncResult.  Handlers run on the completion service if there is
+  // one, otherwise on 'asio_service'.
+  template <typename DataName, typename CompletionToken>
+  AsyncResult<CompletionToken, typename DataName::data_type> Get(
+      const DataName& data_name, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
+  template <typename DataName, typename CompletionToken>
+  AsyncResult<CompletionToken, std::vector<StructuredDataVersions::VersionName>> GetVersions(
+      const DataName& data_name, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
+  // Does the work of the completion-token Get for a handler whose async_result is already owned by
+  // the caller.
+  template <typename DataName, typename Handler>
+  void AsyncGet(const DataName& data_name, Handler handler,
+                const std::chrono::steady_clock::duration& timeout);
+
   template <typename DataName>
   VersionNamesFuture GetVersions(const DataName& data_name,
                                  const std::chrono::steady_clock::duration& timeout =
                                      std::chrono::seconds(120));
 
+  // Resolved through a slab owned by the DataGetter; see MaidClient::Put(Data, SlabFutureTag).
+  template <typename DataName>
+  SlabFuture<std::vector<StructuredDataVersions::VersionName>> GetVersions(
+      const DataName& data_name, SlabFutureTag,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
+  // See MaidClient::GetVersionsBatch.
+  template <typename DataName>
+  boost::future<VersionNamesByName<DataName>> GetVersionsBatch(
+      const std::vector<DataName>& data_names,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
   template <typename DataName>
   VersionNamesFuture GetBranch(const DataName& data_name,
                                const StructuredDataVersions::VersionName& branch_tip,
@@ -84,14 +127,35 @@ class DataGetter {
   typedef std::function<void(const StructuredDataNameAndContentOrReturnCode&)> GetVersionsFunctor;
   typedef std::function<void(const StructuredDataNameAndContentOrReturnCode&)> GetBranchFunctor;
   typedef boost::promise<std::vector<StructuredDataVersions::VersionName>> VersionNamesPromise;
+  typedef OperationSlab<std::vector<StructuredDataVersions::VersionName>,
+                        StructuredDataNameAndContentOrReturnCode> VersionNamesSlab;
 
+  // Sends through 'routing' if given, otherwise through 'network_routing'.
+  DataGetter(BoostAsioService& asio_service, std::unique_ptr<ClientRouting> network_routing,
+             ClientRouting* routing, std::shared_ptr<BoostAsioService> completion_service,
+             CongestionControl* congestion_control);
   DataGetter(const DataGetter&);
   DataGetter(DataGetter&&);
   DataGetter& operator=(DataGetter);
 
+  template <typename DataName>
+  void DoGetVersions(const DataName& data_name,
+                     const std::chrono::steady_clock::duration& timeout,
+                     const GetVersionsFunctor& response_functor);
+
+  boost::asio::io_service& completion_io_service();
+
+  BoostAsioService& asio_service_;
+  std::shared_ptr<BoostAsioService> completion_service_;
+  // Set only when constructed over a routing::Routing, for the dispatcher and service to use.
+  std::unique_ptr<ClientRouting> network_routing_;
+  // The routing given, or else network_routing_.
+  ClientRouting& routing_;
+  VersionNamesSlab version_names_slab_;
   routing::Timer<DataGetterService::GetResponse::Contents> get_timer_;
   routing::Timer<DataGetterService::GetVersionsResponse::Contents> get_versions_timer_;
   routing::Timer<DataGetterService::GetBranchResponse::Contents> get_branch_timer_;
+  routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents> get_versions_batch_timer_;
   DataGetterDispatcher dispatcher_;
   GetHandler<DataGetterDispatcher> get_handler_;
   nfs::Service<DataGetterService> service_;
@@ -108,14 +172,104 @@ boost::future<typename DataName::data_type> DataGetter::Get(
   return promise->get_future();
 }
 
+template <typename DataName, typename CompletionToken>
+AsyncResult<CompletionToken, typename DataName::data_type> DataGetter::Get(
+    const DataName& data_name, CompletionToken&& token,
+    const std::chrono::steady_clock::duration& timeout) {
+  typedef typename DataName::data_type Data;
+  AsyncHandler<CompletionToken, Data> handler(std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  AsyncGet(data_name, handler, timeout);
+  return result.get();
+}
+
+template <typename DataName, typename Handler>
+void DataGetter::AsyncGet(const DataName& data_name, Handler handler,
+                          const std::chrono::steady_clock::duration& timeout) {
+  get_handler_.Get(data_name,
+                   DispatchToHandler<const DataNameAndContentOrReturnCode&>(
+                       completion_io_service(), handler,
+                       &GetAsyncExpectedData<typename DataName::data_type>),
+                   timeout);
+}
+
+template <typename DataName, typename CompletionToken>
+AsyncResult<CompletionToken, std::vector<StructuredDataVersions::VersionName>>
+    DataGetter::GetVersions(const DataName& data_name, CompletionToken&& token,
+                            const std::chrono::steady_clock::duration& timeout) {
+  AsyncHandler<CompletionToken, std::vector<StructuredDataVersions::VersionName>> handler(
+      std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  DoGetVersions(data_name, timeout,
+                DispatchToHandler<const StructuredDataNameAndContentOrReturnCode&>(
+                    completion_io_service(), handler, &GetAsyncExpectedVersionNames));
+  return result.get();
+}
+
 template <typename DataName>
 DataGetter::VersionNamesFuture DataGetter::GetVersions(
     const DataName& data_name, const std::chrono::steady_clock::duration& timeout) {
-  typedef DataGetterService::GetVersionsResponse::Contents ResponseContents;
   auto promise(std::make_shared<VersionNamesPromise>());
-  auto response_functor([promise](const StructuredDataNameAndContentOrReturnCode&
-                                  result) { HandleGetVersionsOrBranchResult(result, promise); });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  DoGetVersions(data_name, timeout,
+                [promise](const StructuredDataNameAndContentOrReturnCode& result) {
+                  HandleGetVersionsOrBranchResult(result, promise);
+                });
+  return promise->get_future();
+}
+
+template <typename DataName>
+SlabFuture<std::vector<StructuredDataVersions::VersionName>> DataGetter::GetVersions(
+    const DataName& data_name, SlabFutureTag,
+    const std::chrono::steady_clock::duration& timeout) {
+  typedef DataGetterService::GetVersionsResponse::Contents ResponseContents;
+  VersionNamesSlab::Handle handle;
+  auto future(version_names_slab_.Acquire(1, &GetVersionNamesOrError, handle));
+  auto task_id(get_versions_timer_.NewTaskId());
+  get_versions_timer_.AddTask(
+      timeout, [handle](ResponseContents get_versions_response) {
+                 VersionNamesSlab::HandleResponseContents(handle,
+                                                          std::move(get_versions_response));
+               },
+      // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
+      routing::Parameters::group_size * 2, task_id);
+  dispatcher_.SendGetVersionsRequest(task_id, data_name, timeout);
+  return future;
+}
+
+template <typename DataName>
+boost::future<VersionNamesByName<DataName>> DataGetter::GetVersionsBatch(
+    const std::vector<DataName>& data_names, const std::chrono::steady_clock::duration& timeout) {
+  typedef DataGetterService::GetVersionsBatchResponse::Contents ResponseContents;
+  auto batches(BatchByCloseGroup(routing_,
+                                 std::set<DataName>(std::begin(data_names), std::end(data_names))));
+  auto promise(std::make_shared<boost::promise<VersionNamesByName<DataName>>>());
+  auto handler(std::make_shared<HandleMultipleGetVersionsResult<DataName>>(promise,
+                                                                           batches.size()));
+  for (auto& batch : batches) {
+    auto batch_names(std::make_shared<std::vector<DataName>>(std::move(batch)));
+    auto response_functor([handler, batch_names](const ResponseContents& result) {
+      (*handler)(*batch_names, result);
+    });
+    auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+        1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+    auto task_id(get_versions_batch_timer_.NewTaskId());
+    get_versions_batch_timer_.AddTask(
+        timeout, [op_data](ResponseContents get_versions_response) {
+                   op_data->HandleResponseContents(std::move(get_versions_response));
+                 },
+        routing::Parameters::group_size * 2, task_id);
+    dispatcher_.SendGetVersionsBatchRequest(task_id, nfs_vault::DataNames(*batch_names), timeout);
+  }
+  return promise->get_future();
+}
+
+template <typename DataName>
+void DataGetter::DoGetVersions(const DataName& data_name,
+                               const std::chrono::steady_clock::duration& timeout,
+                               const GetVersionsFunctor& response_functor) {
+  typedef DataGetterService::GetVersionsResponse::Contents ResponseContents;
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(get_versions_timer_.NewTaskId());
   get_versions_timer_.AddTask(
       timeout, [op_data](ResponseContents get_versions_response) {
@@ -123,8 +277,7 @@ DataGetter::VersionNamesFuture DataGetter::GetVersions(
                },
       // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
       routing::Parameters::group_size * 2, task_id);
-  dispatcher_.SendGetVersionsRequest(task_id, data_name);
-  return promise->get_future();
+  dispatcher_.SendGetVersionsRequest(task_id, data_name, timeout);
 }
 
 template <typename DataName>
@@ -135,14 +288,15 @@ DataGetter::VersionNamesFuture DataGetter::GetBranch(
   auto promise(std::make_shared<VersionNamesPromise>());
   auto response_functor([promise](const StructuredDataNameAndContentOrReturnCode &
                                   result) { HandleGetVersionsOrBranchResult(result, promise); });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(get_branch_timer_.AddTask(timeout, [op_data](ResponseContents get_branch_response) {
                                                     op_data->HandleResponseContents(
                                                         std::move(get_branch_response));
                                                   },
                                          // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
                                          routing::Parameters::group_size * 2));
-  dispatcher_.SendGetBranchRequest(task_id, data_name, branch_tip);
+  dispatcher_.SendGetBranchRequest(task_id, data_name, branch_tip, timeout);
   return promise->get_future();
 }
 
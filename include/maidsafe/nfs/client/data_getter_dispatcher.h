@@ -19,6 +19,8 @@
 #ifndef MAIDSAFE_NFS_CLIENT_DATA_GETTER_DISPATCHER_H_
 #define MAIDSAFE_NFS_CLIENT_DATA_GETTER_DISPATCHER_H_
 
+#include <chrono>
+#include <memory>
 #include <string>
 
 #include "maidsafe/common/data_types/structured_data_versions.h"
@@ -26,8 +28,11 @@
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/timer.h"
 
+#include "maidsafe/nfs/hot_path_log.h"
 #include "maidsafe/nfs/message_types.h"
 #include "maidsafe/nfs/types.h"
+#include "maidsafe/nfs/client/client_routing.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/messages.h"
 #include "maidsafe/nfs/vault/messages.h"
 
@@ -37,17 +42,31 @@ namespace nfs_client {
 
 class DataGetterDispatcher {
  public:
-  explicit DataGetterDispatcher(routing::Routing& routing);
-
+  // If 'congestion_control' is given, requests are sent through it as interactive ones, so they go
+  // ahead of its owner's queued bulk requests but count against the same client-wide budget.
+  explicit DataGetterDispatcher(ClientRouting& routing,
+                                CongestionControl* congestion_control = nullptr);
+  // As above, sending through 'routing' (which must outlive this) wrapped in a NetworkRouting.
+  explicit DataGetterDispatcher(routing::Routing& routing,
+                                CongestionControl* congestion_control = nullptr);
+
+  // 'timeout' is the caller's own for the request, after which congestion control counts it lost.
   template <typename DataName>
-  void SendGetRequest(routing::TaskId task_id, const DataName& data_name);
+  void SendGetRequest(routing::TaskId task_id, const DataName& data_name,
+                      const std::chrono::steady_clock::duration& timeout);
 
   template <typename DataName>
-  void SendGetVersionsRequest(routing::TaskId task_id, const DataName& data_name);
+  void SendGetVersionsRequest(routing::TaskId task_id, const DataName& data_name,
+                              const std::chrono::steady_clock::duration& timeout);
 
   template <typename DataName>
   void SendGetBranchRequest(routing::TaskId task_id, const DataName& data_name,
-                            const StructuredDataVersions::VersionName& branch_tip);
+                            const StructuredDataVersions::VersionName& branch_tip,
+                            const std::chrono::steady_clock::duration& timeout);
+
+  // 'data_names' must be non-empty and share a close group; the request goes to the first's.
+  void SendGetVersionsBatchRequest(routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+                                   const std::chrono::steady_clock::duration& timeout);
 
  private:
   DataGetterDispatcher();
@@ -58,15 +77,23 @@ class DataGetterDispatcher {
   template <typename Message>
   void CheckSourcePersonaType() const;
 
-  routing::Routing& routing_;
+  template <typename NfsMessage, typename RoutingMessage>
+  void RoutingSend(const NfsMessage& nfs_message, const RoutingMessage& routing_message,
+                   const std::chrono::steady_clock::duration& timeout);
+
+  // Set only when constructed from a routing::Routing, which it then wraps.
+  std::unique_ptr<ClientRouting> owned_routing_;
+  ClientRouting& routing_;
+  CongestionControl* const congestion_control_;
   const routing::SingleSource kThisNodeAsSender_;
 };
 
 // ==================== Implementation =============================================================
 template <typename DataName>
-void DataGetterDispatcher::SendGetRequest(routing::TaskId task_id, const DataName& data_name) {
-  LOG(kVerbose) << "DataGetterDispatcher::SendGetRequest " << HexSubstr(data_name.value)
-                << " with task_id : " << task_id;
+void DataGetterDispatcher::SendGetRequest(routing::TaskId task_id, const DataName& data_name,
+                                          const std::chrono::steady_clock::duration& timeout) {
+  NFS_VERBOSE_LOG << "DataGetterDispatcher::SendGetRequest " << HexSubstr(data_name.value)
+                  << " with task_id : " << task_id;
   typedef nfs::GetRequestFromDataGetterToDataManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
   typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
@@ -77,14 +104,15 @@ void DataGetterDispatcher::SendGetRequest(routing::TaskId task_id, const DataNam
   NfsMessage nfs_message(message_id, content);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
   RoutingMessage routing_message(nfs_message.Serialise(), kThisNodeAsSender_, receiver, kCacheable);
-  routing_.Send(routing_message);
-  LOG(kVerbose) << "DataGetterDispatcher::SendGetRequest " << HexSubstr(data_name.value)
-                << " routing message sent";
+  RoutingSend(nfs_message, routing_message, timeout);
+  NFS_VERBOSE_LOG << "DataGetterDispatcher::SendGetRequest " << HexSubstr(data_name.value)
+                  << " routing message sent";
 }
 
 template <typename DataName>
-void DataGetterDispatcher::SendGetVersionsRequest(routing::TaskId task_id,
-                                                  const DataName& data_name) {
+void DataGetterDispatcher::SendGetVersionsRequest(
+    routing::TaskId task_id, const DataName& data_name,
+    const std::chrono::steady_clock::duration& timeout) {
   typedef nfs::GetVersionsRequestFromDataGetterToVersionHandler NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
   typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
@@ -93,15 +121,17 @@ void DataGetterDispatcher::SendGetVersionsRequest(routing::TaskId task_id,
   NfsMessage::Contents content(data_name);
   NfsMessage nfs_message(message_id, content);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
-  routing_.Send(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver));
-  LOG(kVerbose) << "DataGetterDispatcher::SendGetVersionsRequest " << HexSubstr(data_name.value)
-                << " routing message sent";
+  RoutingSend(nfs_message, RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver),
+              timeout);
+  NFS_VERBOSE_LOG << "DataGetterDispatcher::SendGetVersionsRequest " << HexSubstr(data_name.value)
+                  << " routing message sent";
 }
 
 template <typename DataName>
 void DataGetterDispatcher::SendGetBranchRequest(
     routing::TaskId task_id, const DataName& data_name,
-    const StructuredDataVersions::VersionName& branch_tip) {
+    const StructuredDataVersions::VersionName& branch_tip,
+    const std::chrono::steady_clock::duration& timeout) {
   typedef nfs::GetBranchRequestFromDataGetterToVersionHandler NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
   typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
@@ -111,7 +141,8 @@ void DataGetterDispatcher::SendGetBranchRequest(
   contents.version_name = branch_tip;
   NfsMessage nfs_message(nfs::MessageId(task_id), contents);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
-  routing_.Send(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver));
+  RoutingSend(nfs_message, RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver),
+              timeout);
 }
 
 template <typename Message>
@@ -120,6 +151,19 @@ void DataGetterDispatcher::CheckSourcePersonaType() const {
                 "The source Persona must be kDataGetter.");
 }
 
+template <typename NfsMessage, typename RoutingMessage>
+void DataGetterDispatcher::RoutingSend(const NfsMessage& nfs_message,
+                                       const RoutingMessage& routing_message,
+                                       const std::chrono::steady_clock::duration& timeout) {
+  if (!congestion_control_) {
+    routing_.Send(routing_message);
+    return;
+  }
+  congestion_control_->Send(routing_message.receiver.data, NfsMessage::kAction, nfs_message.id,
+                            Priority::kInteractive, timeout,
+                            [this, routing_message] { routing_.Send(routing_message); });
+}
+
 }  // namespace nfs_client
 
 }  // namespace maidsafe
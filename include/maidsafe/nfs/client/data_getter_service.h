@@ -19,10 +19,14 @@
 #ifndef MAIDSAFE_NFS_CLIENT_DATA_GETTER_SERVICE_H_
 #define MAIDSAFE_NFS_CLIENT_DATA_GETTER_SERVICE_H_
 
+#include <memory>
+
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/timer.h"
 
 #include "maidsafe/nfs/message_types.h"
+#include "maidsafe/nfs/client/client_routing.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/messages.h"
 #include "maidsafe/nfs/vault/messages.h"
 #include "maidsafe/nfs/client/get_handler.h"
@@ -42,12 +46,25 @@ class DataGetterService {
   typedef nfs::GetCachedResponseFromCacheHandlerToDataGetter GetCachedResponse;
   typedef nfs::GetVersionsResponseFromVersionHandlerToDataGetter GetVersionsResponse;
   typedef nfs::GetBranchResponseFromVersionHandlerToDataGetter GetBranchResponse;
+  typedef nfs::GetVersionsBatchResponseFromVersionHandlerToDataGetter GetVersionsBatchResponse;
 
+  DataGetterService(
+      ClientRouting& routing,
+      GetHandler<DataGetterDispatcher>& get_handler,
+      routing::Timer<DataGetterService::GetVersionsResponse::Contents>& get_versions_timer,
+      routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer,
+      CongestionControl* congestion_control = nullptr,
+      routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents>*
+          get_versions_batch_timer = nullptr);
+  // As above, with 'routing' (which must outlive this) wrapped in a NetworkRouting.
   DataGetterService(
       routing::Routing& routing,
       GetHandler<DataGetterDispatcher>& get_handler,
       routing::Timer<DataGetterService::GetVersionsResponse::Contents>& get_versions_timer,
-      routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer);
+      routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer,
+      CongestionControl* congestion_control = nullptr,
+      routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents>*
+          get_versions_batch_timer = nullptr);
 
   void HandleMessage(const GetResponse& message, const GetResponse::Sender& sender,
                      const GetResponse::Receiver& receiver);
@@ -61,11 +78,22 @@ class DataGetterService {
   void HandleMessage(const GetBranchResponse& message, const GetBranchResponse::Sender& sender,
                      const GetBranchResponse::Receiver& receiver);
 
+  void HandleMessage(const GetVersionsBatchResponse& message,
+                     const GetVersionsBatchResponse::Sender& sender,
+                     const GetVersionsBatchResponse::Receiver& receiver);
+
  private:
-  routing::Routing& routing_;
+  // Set only when constructed from a routing::Routing, which it then wraps.
+  std::unique_ptr<ClientRouting> owned_routing_;
+  ClientRouting& routing_;
   GetHandler<DataGetterDispatcher>& get_handler_;
   routing::Timer<DataGetterService::GetVersionsResponse::Contents>& get_versions_timer_;
   routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer_;
+  // Released as each response arrives, when requests were sent through it.
+  CongestionControl* const congestion_control_;
+  // Null if batched GetVersions aren't sent, in which case their responses are dropped.
+  routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents>* const
+      get_versions_batch_timer_;
 };
 
 
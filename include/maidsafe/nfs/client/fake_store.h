@@ -19,9 +19,14 @@
 #ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_H_
 #define MAIDSAFE_NFS_CLIENT_FAKE_STORE_H_
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -42,6 +47,15 @@
 #include "maidsafe/common/data_types/structured_data_versions.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/nfs/hot_path_log.h"
+#include "maidsafe/nfs/client/fake_store_access_tracker.h"
+#include "maidsafe/nfs/client/fake_store_backend.h"
+#include "maidsafe/nfs/client/fake_store_index.h"
+#include "maidsafe/nfs/client/fake_store_name_filter.h"
+#include "maidsafe/nfs/client/fake_store_sharded_backend.h"
+#include "maidsafe/nfs/client/fake_store_versions.h"
+#include "maidsafe/nfs/client/fake_store_write_behind.h"
+
 namespace maidsafe {
 
 namespace nfs {
@@ -50,7 +64,66 @@ class FakeStore {
  public:
   typedef boost::future<std::vector<StructuredDataVersions::VersionName>> VersionNamesFuture;
 
-  FakeStore(const boost::filesystem::path& disk_path, DiskUsage max_disk_usage);
+  // How chunk contents are laid out on disk: a file each (suits few, large chunks), or appended to
+  // segment files (suits many small ones; see FakeStoreSegmentBackend).  A store must be reopened
+  // with the layout it was created with.
+  enum class Layout { kFilePerChunk, kSegments };
+
+  // When a Put or Delete completes relative to its chunk reaching the disk; see
+  // FakeStoreWriteBehind.  Anything but kUnsynced buffers changes and syncs them in batches.
+  typedef FakeStoreWriteBehind::Durability Durability;
+
+  // How the file-per-chunk layout's batched writes and syncs are issued: a blocking call each, or
+  // all submitted at once through io_uring (see FakeStoreUringBackend).  Where io_uring isn't
+  // available, the store falls back to blocking calls.
+  enum class IoEngine { kBlocking, kIoUring };
+
+  // What a Put which would exceed the maximum disk usage does: fail with cannot_exceed_limit, or
+  // (for a store used as a cache) first evict the least recently, or least frequently, used chunks
+  // with a reference count of 1.  Version trees are never evicted, and don't evict chunks.
+  enum class Eviction { kNone, kLeastRecentlyUsed, kLeastFrequentlyUsed };
+
+  struct EvictionStats {
+    EvictionStats() : passes(0), evicted_chunks(0), evicted_bytes(0), refused_puts(0) {}
+    uint64_t passes, evicted_chunks, evicted_bytes;
+    // Puts which failed for lack of space even after evicting.
+    uint64_t refused_puts;
+  };
+
+  // Each eviction pass frees this fraction of the maximum disk usage beyond what the Put needs, so
+  // that a full cache doesn't need a pass for every Put.
+  static const double kEvictionHeadroom;
+
+  // Operations queued or running beyond this many block the caller until one completes, so the
+  // asynchronous operations mustn't be called from continuations run on the store's own threads.
+  static const size_t kMaxQueuedOperations;
+
+  // Half the hardware threads, but at least one.
+  static int DefaultThreadCount();
+
+  // How a store is run.  The defaults are the original store: a file per chunk, written through
+  // unsynced with blocking calls, and never evicting.
+  struct Options {
+    Options();
+    // Threads to run all the disk operations; these mostly block on IO.
+    int thread_count;
+    Layout layout;
+    Durability durability;
+    IoEngine io_engine;
+    Eviction eviction;
+  };
+
+  FakeStore(const boost::filesystem::path& disk_path, DiskUsage max_disk_usage,
+            const Options& options = Options());
+  // Spreads chunks over 'disk_paths', a directory on each device, by consistent hashing (see
+  // FakeStoreShardedBackend).  The index and version trees are kept on the first, which must stay
+  // first; devices can be added on a later open, and are filled in the background.
+  FakeStore(const std::vector<boost::filesystem::path>& disk_paths, DiskUsage max_disk_usage,
+            const Options& options = Options());
+  // Holds everything in memory, so nothing touches the disk and nothing outlives the store.  Quota
+  // and reference counting behave as they do on disk, with version trees charged their serialised
+  // size.  Only the options' thread count and eviction apply.
+  explicit FakeStore(DiskUsage max_disk_usage, const Options& options = Options());
   ~FakeStore();
 
   template <typename DataName>
@@ -99,8 +172,24 @@ class FakeStore {
   void SetMaxDiskUsage(DiskUsage max_disk_usage);
 
   DiskUsage GetMaxDiskUsage() const;
+  // Kept in the index, so it's known as soon as the store is open.
   DiskUsage GetCurrentDiskUsage() const;
 
+  // Measures disk usage afresh from the files themselves, in parallel and off the calling thread,
+  // as a check on the figure kept in the index: a mismatch is logged.  Changes made while the
+  // rescan runs may or may not be counted.  The store must outlive the returned future.  An
+  // in-memory store has nothing to rescan, so just gives the current usage.
+  boost::future<DiskUsage> RescanDiskUsage();
+
+  // All zero for a store without eviction.
+  EvictionStats GetEvictionStats() const;
+
+  // Disk usage charged to each device, in the order the devices joined the store; the version trees
+  // are charged to the first.
+  std::vector<DiskUsage> GetDeviceUsage() const;
+  // Chunks yet to be moved to devices added on this open.
+  size_t GetPendingMigrations() const;
+
  private:
   typedef DataNameVariant KeyType;
   typedef boost::promise<std::vector<StructuredDataVersions::VersionName>> VersionNamesPromise;
@@ -109,63 +198,145 @@ class FakeStore {
   FakeStore(FakeStore&&);
   FakeStore& operator=(FakeStore);
 
+  // Runs 'operation', which mustn't throw, on asio_service_ once fewer than kMaxQueuedOperations
+  // are queued or running; until then the caller is blocked.
+  template <typename Operation>
+  void Post(Operation operation);
+  void OperationDone();
+
   NonEmptyString DoGet(const KeyType& key) const;
   void DoPut(const KeyType& key, const NonEmptyString& value);
   void DoDelete(const KeyType& key);
   void DoIncrement(const std::vector<ImmutableData::Name>& data_names);
   void DoDecrement(const std::vector<ImmutableData::Name>& data_names);
 
+  bool in_memory() const { return kDiskPath_.empty(); }
+  // Throws filesystem_io_error if the store's directory has gone.
+  void CheckDiskRoot() const;
   boost::filesystem::path GetFilePath(const KeyType& key) const;
-  bool HasDiskSpace(uint64_t required_space) const;
+  // Adds 'size' to the disk usage, or throws cannot_exceed_limit if there isn't room.  If the
+  // caller is putting the chunk 'held_name' (and so holds its key's mutex), a store with eviction
+  // first tries to make room.
+  void ReserveDiskSpace(uint64_t size, const std::string& held_name = std::string());
+  bool TryReserveDiskSpace(uint64_t size);
+  void ReleaseDiskSpace(uint64_t size);
+  // Runs 'write', which replaces something of 'old_size' bytes with 'new_size', adjusting the disk
+  // usage to match.  The usage is left unchanged if 'write' throws.
+  void ReplaceDiskSpace(uint64_t old_size, uint64_t new_size, const std::function<void()>& write,
+                        const std::string& held_name = std::string());
+  // Evicts chunks until 'size' more bytes, and kEvictionHeadroom, fit.  Chunks whose keys are in
+  // use by other operations are passed over.
+  void Evict(uint64_t size, const std::string& held_name);
+  // All operations on a key (including its versions) hold its mutex, so operations on different
+  // keys can run concurrently.
+  std::mutex& KeyMutex(const std::string& name) const;
+  std::mutex& KeyMutex(const KeyType& key) const;
+  // index_ accessors, which hold index_mutex_ only for the in-memory update and journal append.
+  // FindEntry answers most misses from name_filter_, without taking the mutex.
+  bool FindEntry(const std::string& name, FakeStoreIndex::Entry& entry) const;
+  void PutEntry(const std::string& name, const FakeStoreIndex::Entry& entry);
+  void EraseEntry(const std::string& name);
+  // Syncs index_'s journal; the write-behind backend calls this as part of each group commit.
+  void SyncIndex();
+  // For changes which only touch the index (reference counts), and so aren't part of a group
+  // commit: syncs the journal at once if the durability level promises that.
+  void SyncIndexIfDurable();
+  // Refills name_filter_ from index_, under index_mutex_ once the store is in use.
+  void RebuildNameFilter();
+  // The device whose usage an index entry is charged to.
+  size_t EntryDevice(const std::string& name) const;
   boost::filesystem::path KeyToFilePath(const KeyType& key, bool create_if_missing) const;
-  uint32_t GetReferenceCount(const boost::filesystem::path& path) const;
-  void Write(const boost::filesystem::path& path, const NonEmptyString& value,
-             const uintmax_t& size);
-  uintmax_t Remove(const boost::filesystem::path& path);
-  uintmax_t Rename(const boost::filesystem::path& old_path,
-                   const boost::filesystem::path& new_path);
-
-  std::unique_ptr<StructuredDataVersions> ReadVersions(const KeyType& key) const;
+  std::string IndexName(const KeyType& key) const;
+  std::string VersionsIndexName(const KeyType& key) const;
+  std::unique_ptr<FakeStoreBackend> MakeBackend(
+      const std::vector<boost::filesystem::path>& disk_paths, Layout layout, Durability durability,
+      IoEngine io_engine);
+  // The backend for one device's directory, with 'io_queue' for its background work.
+  std::unique_ptr<FakeStoreBackend> MakeDeviceBackend(const boost::filesystem::path& root,
+                                                      Layout layout, IoEngine io_engine,
+                                                      BoostAsioService& io_queue);
+  // Fills 'index' from what's on disk, for a store without an index journal (or for a rescan).
+  void RebuildIndex(FakeStoreIndex& index);
+
+  // Null if there's no version tree for 'key'.  The tree may be shared with later operations, so
+  // is only valid while the key's mutex is held.
+  std::shared_ptr<const StructuredDataVersions> ReadVersions(const KeyType& key) const;
   void WriteVersions(const KeyType& key, const StructuredDataVersions& versions);
-
+  void DoPutVersion(const KeyType& key, const StructuredDataVersions::VersionName& old_version_name,
+                    const StructuredDataVersions::VersionName& new_version_name);
+  void DoDeleteBranchUntilFork(const KeyType& key,
+                               const StructuredDataVersions::VersionName& branch_tip);
+
+  std::mutex queue_mutex_;
+  std::condition_variable queue_condition_;
+  size_t queued_operations_;
   BoostAsioService asio_service_;
   const boost::filesystem::path kDiskPath_;
-  DiskUsage max_disk_usage_, current_disk_usage_;
+  // Raw byte counts, so space can be reserved without a lock.
+  std::atomic<uint64_t> max_disk_usage_, current_disk_usage_;
   const uint32_t kDepth_;
-  mutable std::mutex mutex_;
+  const Durability kDurability_;
+  // Striped by hash of the key's name.
+  mutable std::array<std::mutex, 64> key_mutexes_;
+  mutable std::mutex index_mutex_;
+  // Reference count and size of each chunk held, so no operation needs to search the disk.
+  FakeStoreIndex index_;
+  // Every name in index_, and updated with it.
+  FakeStoreNameFilter name_filter_;
+  // Null unless the store spans several devices, otherwise within backend_.
+  FakeStoreShardedBackend* sharded_backend_;
+  std::unique_ptr<FakeStoreBackend> backend_;
+  mutable FakeStoreVersions versions_;
+  // Null without eviction.
+  std::unique_ptr<FakeStoreAccessTracker> access_tracker_;
+  // Held for a whole eviction pass, so only one runs at a time.
+  std::mutex eviction_mutex_;
+  std::atomic<uint64_t> eviction_passes_, evicted_chunks_, evicted_bytes_, refused_puts_;
   GetIdentityVisitor get_identity_visitor_;
 };
 
 // ==================== Implementation =============================================================
+template <typename Operation>
+void FakeStore::Post(Operation operation) {
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_condition_.wait(lock, [this] { return queued_operations_ < kMaxQueuedOperations; });
+    ++queued_operations_;
+  }
+  asio_service_.service().post([this, operation] {
+    operation();
+    OperationDone();
+  });
+}
+
 template <typename DataName>
 boost::future<typename DataName::data_type> FakeStore::Get(
     const DataName& data_name,
     const std::chrono::steady_clock::duration& /*timeout*/) {
-  LOG(kVerbose) << "Getting: " << HexSubstr(data_name.value);
+  NFS_VERBOSE_LOG << "Getting: " << HexSubstr(data_name.value);
   auto promise(std::make_shared<boost::promise<typename DataName::data_type>>());
-  auto async_future(boost::async([=] {
+  Post([this, data_name, promise] {
     try {
       auto result(this->DoGet(KeyType(data_name)));
       typename DataName::data_type data(data_name,
                                         typename DataName::data_type::serialised_type(result));
-      LOG(kVerbose) << "Got: " << HexSubstr(data_name.value) << "  " << HexSubstr(result);
+      NFS_VERBOSE_LOG << "Got: " << HexSubstr(data_name.value) << "  " << HexSubstr(result);
       promise->set_value(data);
     }
     catch (const std::exception& e) {
       LOG(kError) << boost::diagnostic_information(e);
       promise->set_exception(boost::current_exception());
     }
-  }));
-  static_cast<void>(async_future);
+  });
   return promise->get_future();
 }
 
 template <typename Data>
 boost::future<void> FakeStore::Put(const Data& data) {
-  LOG(kVerbose) << "Putting: " << HexSubstr(data.name().value) << "  "
-                << HexSubstr(data.Serialise().data);
+  NFS_VERBOSE_LOG << "Putting: " << HexSubstr(data.name().value) << "  "
+                  << HexSubstr(data.Serialise().data);
   const auto promise(std::make_shared<boost::promise<void>>());
-  asio_service_.service().post([this, data, promise] {
+  Post([this, data, promise] {
     try {
       DoPut(KeyType(data.name()), data.Serialise());
       promise->set_value();
@@ -180,9 +351,9 @@ boost::future<void> FakeStore::Put(const Data& data) {
 
 template <typename DataName>
 boost::future<void> FakeStore::Delete(const DataName& data_name) {
-  LOG(kVerbose) << "Deleting: " << HexSubstr(data_name.value);
+  NFS_VERBOSE_LOG << "Deleting: " << HexSubstr(data_name.value);
   const auto promise(std::make_shared<boost::promise<void>>());
-  asio_service_.service().post([this, data_name, promise] {
+  Post([this, data_name, promise] {
     try {
       DoDelete(KeyType(data_name));
       promise->set_value();
@@ -201,32 +372,34 @@ boost::future<void> FakeStore::CreateVersionTree(const DataName& data_name,
                        const StructuredDataVersions::VersionName& version_name,
                        uint32_t max_versions, uint32_t max_branches,
                        const std::chrono::steady_clock::duration& /*timeout*/) {
-  LOG(kVerbose) << "Create Version " << HexSubstr(data_name.value);
+  NFS_VERBOSE_LOG << "Create Version " << HexSubstr(data_name.value);
   auto promise(std::make_shared<boost::promise<void>>());
-  try {
-    KeyType key(data_name);
-    StructuredDataVersions versions(max_versions, max_branches);
-    std::lock_guard<std::mutex> lock(this->mutex_);
-    versions.Put(StructuredDataVersions::VersionName(), version_name);
-    WriteVersions(key, versions);
-    promise->set_value();
-  }
-  catch (const std::exception& e) {
-    LOG(kError) << "Failed creating versions: " << e.what();
-    promise->set_exception(boost::current_exception());
-  }
+  Post([=] {
+    try {
+      KeyType key(data_name);
+      StructuredDataVersions versions(max_versions, max_branches);
+      std::lock_guard<std::mutex> lock(this->KeyMutex(key));
+      versions.Put(StructuredDataVersions::VersionName(), version_name);
+      this->WriteVersions(key, versions);
+      promise->set_value();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed creating versions: " << e.what();
+      promise->set_exception(boost::current_exception());
+    }
+  });
   return promise->get_future();
 }
 
 template <typename DataName>
 FakeStore::VersionNamesFuture FakeStore::GetVersions(
     const DataName& data_name, const std::chrono::steady_clock::duration& /*timeout*/) {
-  LOG(kVerbose) << "Getting versions: " << HexSubstr(data_name.value);
+  NFS_VERBOSE_LOG << "Getting versions: " << HexSubstr(data_name.value);
   auto promise(std::make_shared<VersionNamesPromise>());
-  auto async_future(boost::async([=] {
+  Post([=] {
     try {
       KeyType key(data_name);
-      std::lock_guard<std::mutex> lock(this->mutex_);
+      std::lock_guard<std::mutex> lock(this->KeyMutex(key));
       auto versions(this->ReadVersions(key));
       if (!versions)
         BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
@@ -236,8 +409,7 @@ FakeStore::VersionNamesFuture FakeStore::GetVersions(
       LOG(kError) << "Failed getting versions: " << boost::diagnostic_information(e);
       promise->set_exception(boost::current_exception());
     }
-  }));
-  static_cast<void>(async_future);
+  });
   return promise->get_future();
 }
 
@@ -245,13 +417,13 @@ template <typename DataName>
 FakeStore::VersionNamesFuture FakeStore::GetBranch(
     const DataName& data_name, const StructuredDataVersions::VersionName& branch_tip,
     const std::chrono::steady_clock::duration& /*timeout*/) {
-  LOG(kVerbose) << "Getting branch: " << HexSubstr(data_name.value) << ".  Tip: "
-                << branch_tip.index << "-" << HexSubstr(branch_tip.id.value);
+  NFS_VERBOSE_LOG << "Getting branch: " << HexSubstr(data_name.value) << ".  Tip: "
+                  << branch_tip.index << "-" << HexSubstr(branch_tip.id.value);
   auto promise(std::make_shared<VersionNamesPromise>());
-  auto async_future(boost::async([=] {
+  Post([=] {
     try {
       KeyType key(data_name);
-      std::lock_guard<std::mutex> lock(this->mutex_);
+      std::lock_guard<std::mutex> lock(this->KeyMutex(key));
       auto versions(this->ReadVersions(key));
       if (!versions)
         BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
@@ -261,8 +433,7 @@ FakeStore::VersionNamesFuture FakeStore::GetBranch(
       LOG(kError) << "Failed getting branch: " << boost::diagnostic_information(e);
       promise->set_exception(boost::current_exception());
     }
-  }));
-  static_cast<void>(async_future);
+  });
   return promise->get_future();
 }
 
@@ -271,52 +442,53 @@ boost::future<void> FakeStore::PutVersion(
     const DataName& data_name,
     const StructuredDataVersions::VersionName& old_version_name,
     const StructuredDataVersions::VersionName& new_version_name) {
-  LOG(kVerbose) << "Putting version: " << HexSubstr(data_name.value) << ".  Old: "
-                << (old_version_name.id.value.IsInitialised() ?
-                       (std::to_string(old_version_name.index) + "-" +
-                           HexSubstr(old_version_name.id.value)) : "N/A") << "  New: "
-                << new_version_name.index << "-" << HexSubstr(new_version_name.id.value);
-  try {
-    KeyType key(data_name);
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto versions(ReadVersions(key));
-    if (!versions) {
-      LOG(kError) << "Failed to read versions";
-      return boost::make_exceptional_future<void>(MakeError(CommonErrors::uninitialised));
+  NFS_VERBOSE_LOG << "Putting version: " << HexSubstr(data_name.value) << ".  Old: "
+                  << (old_version_name.id.value.IsInitialised() ?
+                         (std::to_string(old_version_name.index) + "-" +
+                             HexSubstr(old_version_name.id.value)) : "N/A") << "  New: "
+                  << new_version_name.index << "-" << HexSubstr(new_version_name.id.value);
+  auto promise(std::make_shared<boost::promise<void>>());
+  Post([=] {
+    try {
+      KeyType key(data_name);
+      std::lock_guard<std::mutex> lock(this->KeyMutex(key));
+      if (!this->ReadVersions(key)) {
+        LOG(kError) << "Failed to read versions";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+      }
+      this->DoPutVersion(key, old_version_name, new_version_name);
+      promise->set_value();
     }
-    versions->Put(old_version_name, new_version_name);
-    WriteVersions(key, *versions);
-  }
-  catch (const std::exception& e) {
-    LOG(kError) << "Failed putting version: " << boost::diagnostic_information(e);
-    return boost::make_exceptional_future<void>(e);
-  }
-
-  return boost::make_ready_future();
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed putting version: " << boost::diagnostic_information(e);
+      promise->set_exception(boost::current_exception());
+    }
+  });
+  return promise->get_future();
 }
 
 template <typename DataName>
 boost::future<void> FakeStore::DeleteBranchUntilFork(
     const DataName& data_name,
     const StructuredDataVersions::VersionName& branch_tip) {
-  LOG(kVerbose) << "Deleting branch: " << HexSubstr(data_name.value) << ".  Tip: "
-                << branch_tip.index << "-" << HexSubstr(branch_tip.id.value);
-  try {
-    KeyType key(data_name);
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto versions(ReadVersions(key));
-    if (!versions) {
-      return boost::make_exceptional_future<void>(MakeError(CommonErrors::no_such_element));
+  NFS_VERBOSE_LOG << "Deleting branch: " << HexSubstr(data_name.value) << ".  Tip: "
+                  << branch_tip.index << "-" << HexSubstr(branch_tip.id.value);
+  auto promise(std::make_shared<boost::promise<void>>());
+  Post([=] {
+    try {
+      KeyType key(data_name);
+      std::lock_guard<std::mutex> lock(this->KeyMutex(key));
+      if (!this->ReadVersions(key))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      this->DoDeleteBranchUntilFork(key, branch_tip);
+      promise->set_value();
     }
-    versions->DeleteBranchUntilFork(branch_tip);
-    WriteVersions(key, *versions);
-  }
-  catch (const std::exception& e) {
-    LOG(kError) << "Failed deleting branch: " << boost::diagnostic_information(e);
-    return boost::make_exceptional_future<void>(e);
-  }
-
-  return boost::make_ready_future();
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed deleting branch: " << boost::diagnostic_information(e);
+      promise->set_exception(boost::current_exception());
+    }
+  });
+  return promise->get_future();
 }
 
 }  // namespace nfs
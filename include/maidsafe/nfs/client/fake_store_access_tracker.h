@@ -0,0 +1,90 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_ACCESS_TRACKER_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_ACCESS_TRACKER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Records when, and how often, each of FakeStore's chunks is used, so that a store run as a cache
+// can choose which chunks to evict.  Recording a use locks only one of kShardCount shards, for a
+// hash lookup and two counter updates, so is cheap enough for every Get.
+class FakeStoreAccessTracker {
+ public:
+  enum class Policy { kLeastRecentlyUsed, kLeastFrequentlyUsed };
+
+  static const size_t kShardCount = 64;
+  // Use counts saturate here, and are halved on each call to Candidates, so that chunks which were
+  // popular once don't stay cached forever.
+  static const uint32_t kMaxFrequency;
+
+  explicit FakeStoreAccessTracker(Policy policy);
+
+  // Starts tracking 'name' as just used (once), or records a use if it's already tracked.
+  void Add(const std::string& name);
+  // Records a use of 'name' if it's tracked.
+  void Touch(const std::string& name);
+  void Remove(const std::string& name);
+
+  // Every tracked name, the best to evict first: the least recently used, or the least frequently
+  // used (least recently used among equals).
+  std::vector<std::string> Candidates();
+
+  size_t size() const;
+
+ private:
+  struct Access {
+    Access() : last_use(0), frequency(0) {}
+    uint64_t last_use;
+    uint32_t frequency;
+  };
+
+  struct Shard {
+    Shard() : mutex(), accesses() {}
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Access> accesses;
+  };
+
+  FakeStoreAccessTracker(const FakeStoreAccessTracker&);
+  FakeStoreAccessTracker(FakeStoreAccessTracker&&);
+  FakeStoreAccessTracker& operator=(FakeStoreAccessTracker);
+
+  Shard& GetShard(const std::string& name);
+  void Use(Access& access);
+
+  const Policy kPolicy_;
+  // A logical clock, ticking once per use.
+  std::atomic<uint64_t> clock_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_ACCESS_TRACKER_H_
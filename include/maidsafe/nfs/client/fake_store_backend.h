@@ -0,0 +1,139 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_BACKEND_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_BACKEND_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/nfs/client/fake_store_index.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Holds the contents of FakeStore's chunks, keyed by the name FakeStoreIndex uses.  Which chunks
+// are held, their sizes and reference counts are FakeStore's business; a backend only stores bytes.
+class FakeStoreBackend {
+ public:
+  virtual ~FakeStoreBackend() {}
+
+  // Throws no_such_element if 'name' isn't held.
+  virtual NonEmptyString Read(const std::string& name) const = 0;
+  // Replaces the contents if 'name' is already held.
+  virtual void Write(const std::string& name, const NonEmptyString& value) = 0;
+  // Writes each of 'chunks' as Write would; a backend which can have the writes in flight together
+  // does.  On failure, any of them may have been written.
+  virtual void WriteMany(const std::vector<std::pair<std::string, NonEmptyString>>& chunks);
+  // Removing a chunk which isn't held is logged, but not an error.
+  virtual void Remove(const std::string& name) = 0;
+  // Writes and removals reach the OS before returning, but are only durable once synced.  This
+  // syncs those made so far to the chunks in 'names' (and possibly others).
+  virtual void Sync(const std::vector<std::string>& names) = 0;
+
+  // Adds every chunk held to 'index' with a reference count of 1, for a store which has lost its
+  // index journal.
+  virtual void Rebuild(FakeStoreIndex& index) = 0;
+  // Calls 'functor' with the name of every chunk held.  By default, found by a Rebuild.
+  virtual void ForEachName(const std::function<void(const std::string& name)>& functor);
+};
+
+namespace detail {
+
+// The path under 'root' for 'name': the first 'depth' characters of the name are spread over that
+// many directories, and the rest is the file name.
+boost::filesystem::path NameToPath(const boost::filesystem::path& root, const std::string& name,
+                                   uint32_t depth, bool create_if_missing);
+
+typedef std::function<void(const boost::filesystem::path& path, const std::string& name,
+                           uint64_t size)> FileFunctor;
+
+// Calls 'functor' with the path, size and name (as mapped by NameToPath, but without extension)
+// of every regular file under 'root'.  Each top-level directory is walked on a thread of its own,
+// though 'functor' is never called concurrently.
+void ForEachFile(const boost::filesystem::path& root, const FileFunctor& functor);
+
+// Flushes the file (or on POSIX, directory) at 'path' to the device.  Throws filesystem_io_error.
+void SyncFile(const boost::filesystem::path& path);
+
+}  // namespace detail
+
+// The original FakeStore layout: one file per chunk, in a directory tree under the store's root.
+class FakeStoreFileBackend : public FakeStoreBackend {
+ public:
+  FakeStoreFileBackend(boost::filesystem::path root, uint32_t depth);
+
+  virtual NonEmptyString Read(const std::string& name) const;
+  virtual void Write(const std::string& name, const NonEmptyString& value);
+  virtual void Remove(const std::string& name);
+  // Syncs each of the chunks, and the directories leading to them.
+  virtual void Sync(const std::vector<std::string>& names);
+  // Also converts chunks stored with their reference count as the file extension.
+  virtual void Rebuild(FakeStoreIndex& index);
+  virtual void ForEachName(const std::function<void(const std::string& name)>& functor);
+
+ protected:
+  boost::filesystem::path ChunkPath(const std::string& name, bool create_if_missing) const;
+  // What Sync syncs for 'names': those of the chunks which still exist, then the directories
+  // leading to them, each once however many chunks share it.
+  std::vector<boost::filesystem::path> SyncPaths(const std::vector<std::string>& names) const;
+
+ private:
+  FakeStoreFileBackend(const FakeStoreFileBackend&);
+  FakeStoreFileBackend(FakeStoreFileBackend&&);
+  FakeStoreFileBackend& operator=(FakeStoreFileBackend);
+
+  const boost::filesystem::path kRoot_;
+  const uint32_t kDepth_;
+};
+
+// Holds chunks in memory only, for an in-memory FakeStore.  Nothing survives the backend.
+class FakeStoreMemoryBackend : public FakeStoreBackend {
+ public:
+  FakeStoreMemoryBackend();
+
+  virtual NonEmptyString Read(const std::string& name) const;
+  virtual void Write(const std::string& name, const NonEmptyString& value);
+  virtual void Remove(const std::string& name);
+  virtual void Sync(const std::vector<std::string>& /*names*/) {}
+  virtual void Rebuild(FakeStoreIndex& index);
+
+ private:
+  FakeStoreMemoryBackend(const FakeStoreMemoryBackend&);
+  FakeStoreMemoryBackend(FakeStoreMemoryBackend&&);
+  FakeStoreMemoryBackend& operator=(FakeStoreMemoryBackend);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, NonEmptyString> chunks_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_BACKEND_H_
@@ -0,0 +1,108 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_INDEX_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_INDEX_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// FakeStore's record of the chunks and version trees it holds, keyed by file name, kept in memory
+// and persisted as a journal of changes.  The total size it keeps is FakeStore's disk usage, so a
+// restart needn't measure the files.  Not thread-safe; FakeStore serialises access to it.
+class FakeStoreIndex {
+ public:
+  struct Entry {
+    Entry() : reference_count(0), size(0) {}
+    Entry(uint32_t reference_count_in, uint64_t size_in)
+        : reference_count(reference_count_in), size(size_in) {}
+    uint32_t reference_count;
+    uint64_t size;
+  };
+
+  // Replays the journal at 'journal_path' if there is one.  A record cut short by a crash ends the
+  // replay.  An empty 'journal_path' gives an index which is never persisted.
+  explicit FakeStoreIndex(boost::filesystem::path journal_path);
+
+  // False if there was no journal to load.
+  bool loaded() const { return loaded_; }
+
+  // Null if 'name' isn't held.
+  const Entry* Find(const std::string& name) const;
+
+  void Put(const std::string& name, const Entry& entry);
+  void Erase(const std::string& name);
+
+  // Rewrites the journal to hold only the current entries.  Changes are journalled from the first
+  // call onwards (so an index being rebuilt isn't journalled entry by entry), and the journal is
+  // compacted again whenever it has grown to kCompactionFactor times the number of entries (or
+  // times kMinCompactionSize_, for small indexes).
+  void Compact();
+
+  // Syncs the journal to the device, so the changes recorded so far survive the machine crashing,
+  // not just the process.  Throws filesystem_io_error.
+  void Sync();
+
+  size_t size() const { return entries_.size(); }
+  // Calls 'functor' with the name and entry of each entry.
+  template <typename Functor>
+  void ForEach(Functor functor) const {
+    for (const auto& name_and_entry : entries_)
+      functor(name_and_entry.first, name_and_entry.second);
+  }
+  // The sum of the entries' sizes, kept up to date as they change.
+  uint64_t total_size() const { return total_size_; }
+
+  static const size_t kCompactionFactor;
+
+ private:
+  enum class Operation : char { kPut = 'P', kErase = 'E' };
+
+  static const size_t kMinCompactionSize_;
+
+  FakeStoreIndex(const FakeStoreIndex&);
+  FakeStoreIndex(FakeStoreIndex&&);
+  FakeStoreIndex& operator=(FakeStoreIndex);
+
+  void Load();
+  void Apply(Operation operation, const std::string& name, const Entry& entry);
+  void Append(Operation operation, const std::string& name, const Entry& entry);
+  // Compacts the journal once it has grown enough; a failure is logged rather than thrown.
+  void CompactIfDue();
+
+  const boost::filesystem::path kJournalPath_;
+  std::unordered_map<std::string, Entry> entries_;
+  uint64_t total_size_;
+  std::ofstream journal_;
+  size_t journal_records_;
+  bool loaded_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_INDEX_H_
@@ -0,0 +1,105 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_NAME_FILTER_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_NAME_FILTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/make_unique.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// A counting Bloom filter over the names FakeStore holds, so a lookup of a name which isn't held
+// (a cache miss, for a store in front of the network) can usually be answered without taking any
+// lock.  Each name increments kHashCount of the counters, so names can be removed again; a counter
+// which saturates is never decremented, so stays conservative.
+//
+// MayContain may be called from any thread at any time.  Everything else must be serialised by the
+// caller (FakeStore does so under its index mutex).
+class FakeStoreNameFilter {
+ public:
+  // With these, about 1% of lookups of names not held get a false "maybe", while the filter holds
+  // no more names than it was sized for.
+  static const size_t kCountersPerName;
+  static const int kHashCount;
+  static const size_t kMinCapacity;
+
+  FakeStoreNameFilter();
+
+  // False only if 'name' is definitely not held.
+  bool MayContain(const std::string& name) const;
+
+  void Add(const std::string& name);
+  // 'name' must have been added.
+  void Remove(const std::string& name);
+
+  // Whether more names are held than the filter was sized for, so it should be rebuilt.
+  bool overfull() const { return count_ > capacity_; }
+
+  // Replaces the contents with the names 'for_each' passes to the functor it's given, sized for
+  // twice 'count' of them.  Lookups carry on against the old contents until the new are complete.
+  template <typename ForEach>
+  void Rebuild(size_t count, ForEach for_each);
+
+ private:
+  typedef std::vector<std::atomic<uint8_t>> Table;
+
+  FakeStoreNameFilter(const FakeStoreNameFilter&);
+  FakeStoreNameFilter(FakeStoreNameFilter&&);
+  FakeStoreNameFilter& operator=(FakeStoreNameFilter);
+
+  void Insert(Table& table, const std::string& name) const;
+  void Publish(std::unique_ptr<Table> table, size_t capacity, size_t count);
+
+  std::atomic<const Table*> table_;
+  // Tables replaced by a Rebuild are kept, as a lookup may still be using one.  Each is half the
+  // size of the next, so together they're smaller than the current table.
+  std::vector<std::unique_ptr<Table>> tables_;
+  size_t capacity_, count_;
+};
+
+// ==================== Implementation =============================================================
+template <typename ForEach>
+void FakeStoreNameFilter::Rebuild(size_t count, ForEach for_each) {
+  const size_t capacity(std::max(kMinCapacity, 2 * count));
+  size_t size(1);
+  while (size < capacity * kCountersPerName)
+    size *= 2;
+  auto table(maidsafe::make_unique<Table>(size));
+  size_t added(0);
+  for_each([&](const std::string& name) {
+    Insert(*table, name);
+    ++added;
+  });
+  Publish(std::move(table), capacity, added);
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_NAME_FILTER_H_
@@ -0,0 +1,139 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_SEGMENT_BACKEND_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_SEGMENT_BACKEND_H_
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Stores chunks as records appended to a sequence of segment files, so a Put is one sequential
+// write however many chunks the store holds, rather than a file (and directories) to create.
+// Overwrites and removals append too - a removal as a tombstone record - leaving dead records
+// behind.  Once less than kCompactionThreshold of a segment no longer being appended to is live,
+// compaction is posted to 'asio_service': the live records are copied to the end of the log and
+// the segment deleted.  The in-memory map of where each chunk lives is rebuilt by scanning the
+// segments' record headers on construction.
+class FakeStoreSegmentBackend : public FakeStoreBackend {
+ public:
+  static const uint64_t kDefaultSegmentSize;
+  static const double kCompactionThreshold;
+
+  // A new segment is started once the current one reaches 'segment_size' bytes.  'asio_service'
+  // must be stopped before the backend is destroyed.
+  FakeStoreSegmentBackend(boost::filesystem::path directory, BoostAsioService& asio_service,
+                          uint64_t segment_size = kDefaultSegmentSize);
+
+  virtual NonEmptyString Read(const std::string& name) const;
+  virtual void Write(const std::string& name, const NonEmptyString& value);
+  virtual void Remove(const std::string& name);
+  // Syncs each segment appended to since the last Sync (usually just the one, whatever 'names'),
+  // and the directory if segments have been created or deleted.  If this throws, the next Sync
+  // retries them.
+  virtual void Sync(const std::vector<std::string>& names);
+  virtual void Rebuild(FakeStoreIndex& index);
+
+  // Compacts every eligible segment now, rather than waiting for the background pass.
+  void Compact();
+
+  size_t segment_count() const;
+  // Bytes occupied by the segment files, live and dead records alike.
+  uint64_t SegmentBytes() const;
+
+ private:
+  enum class RecordType : char { kPut = 'P', kRemove = 'R' };
+
+  // Where a chunk's value starts.
+  struct Location {
+    Location() : segment(0), offset(0), size(0) {}
+    Location(uint32_t segment_in, uint64_t offset_in, uint32_t size_in)
+        : segment(segment_in), offset(offset_in), size(size_in) {}
+    bool operator==(const Location& other) const {
+      return segment == other.segment && offset == other.offset;
+    }
+    uint32_t segment;
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  struct Segment {
+    Segment() : size(0), live(0) {}
+    uint64_t size, live;
+  };
+
+  // Called for each complete record with the stream positioned at the start of its value.
+  typedef std::function<void(RecordType type, const std::string& name, const Location& location,
+                             std::istream& stream)> RecordFunctor;
+
+  FakeStoreSegmentBackend(const FakeStoreSegmentBackend&);
+  FakeStoreSegmentBackend(FakeStoreSegmentBackend&&);
+  FakeStoreSegmentBackend& operator=(FakeStoreSegmentBackend);
+
+  static uint64_t RecordSize(const std::string& name, uint32_t value_size);
+
+  void Load();
+  // Returns the length of the segment up to the end of its last complete record.
+  uint64_t Scan(uint32_t segment, const RecordFunctor& functor) const;
+  boost::filesystem::path SegmentPath(uint32_t segment) const;
+  void OpenActive();
+  Location Append(RecordType type, const std::string& name, const std::string& value);
+  void Release(const std::string& name, const Location& location);
+  bool Compactable(uint32_t segment) const;
+  void ScheduleCompaction(uint32_t segment);
+  void CompactSegment(uint32_t segment);
+
+  const boost::filesystem::path kDirectory_;
+  const uint64_t kSegmentSize_;
+  BoostAsioService& asio_service_;
+  mutable std::mutex mutex_;
+  // Held for the whole of a compaction pass, so only one runs at a time.
+  std::mutex compaction_mutex_;
+  // Held for the whole of a Sync, so none returns while another's fsyncs are still running.
+  std::mutex sync_mutex_;
+  std::unordered_map<std::string, Location> locations_;
+  std::map<uint32_t, Segment> segments_;
+  uint32_t active_segment_;
+  std::ofstream active_;
+  bool compaction_pending_;
+  std::set<uint32_t> unsynced_segments_;
+  bool directory_unsynced_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_SEGMENT_BACKEND_H_
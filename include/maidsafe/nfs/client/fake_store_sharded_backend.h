@@ -0,0 +1,149 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_SHARDED_BACKEND_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_SHARDED_BACKEND_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Spreads chunks over several devices (JBOD), each a directory with a backend of its own, placed
+// by consistent hashing of the chunk name.  Each device has its own IO queue: batched writes and
+// syncs are split by device and run on every device's queue at once, as are rebuilds.
+//
+// The devices are listed in a manifest in the first device's directory, in the order they joined
+// the store, which fixes their places on the ring; a store can't be reopened without any of them.
+// When devices are added, only the chunks now belonging to a new device have to move, and they do
+// so in the background, a batch at a time on the new device's queue.  Until a chunk has moved it's
+// read from where it was, so the store is usable throughout; an interrupted migration resumes on
+// the next open.
+class FakeStoreShardedBackend : public FakeStoreBackend {
+ public:
+  typedef std::function<std::unique_ptr<FakeStoreBackend>(
+      const boost::filesystem::path& root, BoostAsioService& io_queue)> MakeDevice;
+
+  // Points each device has on the ring; more give a more even spread.
+  static const int kVirtualNodes;
+  static const int kThreadsPerDevice;
+  // Chunks moved per step of a migration, between which other work on the device's queue runs.
+  static const size_t kMigrationBatch;
+
+  static boost::filesystem::path ManifestPath(const boost::filesystem::path& first_root);
+
+  // 'roots' are the devices' directories, created if need be, none inside another; the first is
+  // where the manifest lives, and must be the same on every open.  'make_device' creates the
+  // backend for one device.  Throws invalid_parameter if the directories overlap, if a device
+  // listed in the manifest is missing from 'roots', or if any but the first holds a manifest.
+  FakeStoreShardedBackend(const std::vector<boost::filesystem::path>& roots,
+                          const MakeDevice& make_device);
+  ~FakeStoreShardedBackend();
+
+  virtual NonEmptyString Read(const std::string& name) const;
+  virtual void Write(const std::string& name, const NonEmptyString& value);
+  virtual void WriteMany(const std::vector<std::pair<std::string, NonEmptyString>>& chunks);
+  virtual void Remove(const std::string& name);
+  virtual void Sync(const std::vector<std::string>& names);
+  virtual void Rebuild(FakeStoreIndex& index);
+
+  // Finds the chunks not on the device they belong on, if devices were added, and starts moving
+  // them.  To be called once, after any Rebuild of the store's index, and before other use.
+  void StartMigration();
+  // Chunks still to be moved.
+  size_t pending_migrations() const;
+
+  size_t device_count() const { return devices_.size(); }
+  // Where 'name' belongs: an index into the devices, in the order they joined the store.
+  size_t DeviceOf(const std::string& name) const;
+  // Adjusts the bytes charged to 'device' when something held there changes size.
+  void Account(size_t device, uint64_t old_size, uint64_t new_size);
+  // Bytes charged to each device.  A chunk is charged to the device it belongs on, even before
+  // migration has moved it there.
+  std::vector<uint64_t> DeviceUsage() const;
+
+ private:
+  struct Device {
+    explicit Device(boost::filesystem::path root_in);
+    const boost::filesystem::path root;
+    BoostAsioService io_queue;
+    std::unique_ptr<FakeStoreBackend> backend;
+    std::atomic<uint64_t> used_bytes;
+  };
+
+  // A chunk waiting to move to the device it belongs on.  Once copied, it's on both.
+  struct Pending {
+    Pending() : source(0), copied(false) {}
+    explicit Pending(size_t source_in) : source(source_in), copied(false) {}
+    size_t source;
+    bool copied;
+  };
+
+  FakeStoreShardedBackend(const FakeStoreShardedBackend&);
+  FakeStoreShardedBackend(FakeStoreShardedBackend&&);
+  FakeStoreShardedBackend& operator=(FakeStoreShardedBackend);
+
+  // Runs 'operation' for each of 'devices' on that device's queue (or, for just one, on the calling
+  // thread), and waits for them all.  The first exception thrown is rethrown.
+  void OnDevices(const std::vector<size_t>& devices,
+                 const std::function<void(size_t device)>& operation) const;
+  std::mutex& NameMutex(const std::string& name) const;
+  // Removes 'name' from pending_, returning whether it was there.
+  bool TakePending(size_t owner, const std::string& name, Pending& pending);
+  bool FindPending(size_t owner, const std::string& name, Pending& pending) const;
+  // Moves the next kMigrationBatch chunks belonging on 'target', and posts itself again to move
+  // the rest.
+  void MigrateBatch(size_t target);
+  void WriteManifest(bool migrating) const;
+
+  std::vector<std::unique_ptr<Device>> devices_;
+  // Ring position of each virtual node, and its device.
+  std::map<uint64_t, size_t> ring_;
+  // Whether the manifest lists devices with chunks yet to be moved to them.
+  bool migration_needed_;
+  // While set, every operation on a chunk holds its name's mutex, and looks in pending_ to see
+  // where the chunk is.  Cleared for good once pending_ empties.
+  std::atomic<bool> migrating_;
+  mutable std::array<std::mutex, 64> name_mutexes_;
+  mutable std::mutex pending_mutex_;
+  // Indexed by the device each chunk belongs on.
+  std::vector<std::map<std::string, Pending>> pending_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_SHARDED_BACKEND_H_
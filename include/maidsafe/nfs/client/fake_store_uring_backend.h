@@ -0,0 +1,72 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_URING_BACKEND_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_URING_BACKEND_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// The file-per-chunk layout, but with each batch of writes, and each batch of syncs, submitted to
+// the kernel together through an io_uring (on Linux), so the device has the whole batch in flight
+// at once rather than one operation per blocked thread.  Batches come from FakeStoreWriteBehind,
+// so this only pays off with a durability other than kUnsynced.  Reads and single writes are as for
+// FakeStoreFileBackend: there's nothing to overlap them with.
+class FakeStoreUringBackend : public FakeStoreFileBackend {
+ public:
+  // Operations in flight at once.  Larger batches are submitted this many at a time.
+  static const unsigned kRingEntries;
+
+  // Whether io_uring is built in and the kernel (or the process's seccomp policy) allows it.
+  static bool Available();
+
+  // Throws uninitialised if io_uring isn't available.
+  FakeStoreUringBackend(boost::filesystem::path root, uint32_t depth);
+  ~FakeStoreUringBackend();
+
+  virtual void WriteMany(const std::vector<std::pair<std::string, NonEmptyString>>& chunks);
+  virtual void Sync(const std::vector<std::string>& names);
+
+ private:
+  class Ring;
+
+  FakeStoreUringBackend(const FakeStoreUringBackend&);
+  FakeStoreUringBackend(FakeStoreUringBackend&&);
+  FakeStoreUringBackend& operator=(FakeStoreUringBackend);
+
+  std::unique_ptr<Ring> ring_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_URING_BACKEND_H_
@@ -0,0 +1,104 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_VERSIONS_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_VERSIONS_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/data_types/structured_data_versions.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// FakeStore's version trees.  Each is persisted as a snapshot (the serialised
+// StructuredDataVersions, in a ".ver" file) plus a log of the changes made since (a ".vlog" file),
+// so a PutVersion appends one small record however large the tree.  The log is folded into a new
+// snapshot once it's as large as the snapshot, keeping the I/O per change constant on average.
+// Trees are cached in memory once read.
+//
+// Operations on the same tree mustn't run concurrently (FakeStore holds the key's mutex);
+// operations on different trees may.
+class FakeStoreVersions {
+ public:
+  typedef StructuredDataVersions::VersionName VersionName;
+  // Runs 'write', which changes a tree's files from 'old_size' to 'new_size' bytes in all, charging
+  // the difference to the store's disk usage (or throwing if it can't be afforded).
+  typedef std::function<void(uint64_t old_size, uint64_t new_size,
+                             const std::function<void()>& write)> ReplaceFunctor;
+
+  static const size_t kMaxCachedTrees;
+
+  // Trees are stored where detail::NameToPath puts 'name' under 'root'.  With an empty 'root' they
+  // are only held in memory, though their (serialised) sizes are still charged by 'replace'.
+  FakeStoreVersions(boost::filesystem::path root, uint32_t depth, ReplaceFunctor replace);
+
+  // Null if there is no tree called 'name'.
+  std::shared_ptr<const StructuredDataVersions> Get(const std::string& name);
+
+  // Each returns the number of bytes the tree's files now occupy.  Creating a tree replaces any
+  // existing one of the same name.
+  uint64_t Create(const std::string& name, const StructuredDataVersions& versions);
+  uint64_t Put(const std::string& name, const VersionName& old_version_name,
+               const VersionName& new_version_name);
+  uint64_t DeleteBranchUntilFork(const std::string& name, const VersionName& branch_tip);
+
+ private:
+  enum class RecordType : char { kPut = 'P', kDeleteBranchUntilFork = 'D' };
+
+  struct Tree {
+    Tree() : versions(), snapshot_size(0), log_size(0) {}
+    std::shared_ptr<StructuredDataVersions> versions;
+    uint64_t snapshot_size, log_size;
+  };
+
+  FakeStoreVersions(const FakeStoreVersions&);
+  FakeStoreVersions(FakeStoreVersions&&);
+  FakeStoreVersions& operator=(FakeStoreVersions);
+
+  boost::filesystem::path SnapshotPath(const std::string& name, bool create_if_missing) const;
+  boost::filesystem::path LogPath(const std::string& name) const;
+  // Null if there is no tree called 'name'.
+  std::shared_ptr<Tree> Load(const std::string& name);
+  void Cache(const std::string& name, const std::shared_ptr<Tree>& tree);
+  void Uncache(const std::string& name);
+  // Applies a change to the tree via 'apply', and logs it as 'record', once the space is reserved.
+  uint64_t Append(const std::string& name, Tree& tree, const std::string& record,
+                  const std::function<void()>& apply);
+  void WriteSnapshot(const std::string& name, Tree& tree);
+
+  const boost::filesystem::path kRoot_;
+  const uint32_t kDepth_;
+  ReplaceFunctor replace_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Tree>> cache_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_VERSIONS_H_
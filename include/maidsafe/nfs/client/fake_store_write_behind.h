@@ -0,0 +1,119 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_FAKE_STORE_WRITE_BEHIND_H_
+#define MAIDSAFE_NFS_CLIENT_FAKE_STORE_WRITE_BEHIND_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Buffers the writes and removals for another backend, and passes them on in batches, each batch
+// followed by a single Sync (group commit).  Reads see buffered changes.  The buffer holds at most
+// 'max_buffered_bytes' of chunk contents; beyond that, writers wait for (or do) a flush.
+class FakeStoreWriteBehind : public FakeStoreBackend {
+ public:
+  // When a write or removal returns, and so when FakeStore's Put or Delete completes:
+  //   kUnsynced     - once written through to the OS, never synced (FakeStore doesn't use this
+  //                   class at all for it).
+  //   kAsynchronous - once buffered.  Batches are flushed and synced on 'asio_service', so a crash
+  //                   can lose the most recent changes.  A batch which fails to flush stays
+  //                   buffered, to be retried, and the error is thrown by the next Write, Remove or
+  //                   Sync instead.
+  //   kBatched      - once synced, in a batch with whatever else was buffered meanwhile.
+  //   kPerOperation - once written through and synced on its own.
+  // Each sync is followed by a call to 'on_synced' before anyone waiting is told, so that FakeStore
+  // can sync its index journal, which already records the changes, in the same commit.  Version
+  // trees reach the OS, no further.
+  enum class Durability { kUnsynced, kAsynchronous, kBatched, kPerOperation };
+
+  static const uint64_t kDefaultMaxBufferedBytes;
+
+  // 'asio_service' must be stopped before this is destroyed, which flushes anything still buffered.
+  FakeStoreWriteBehind(std::unique_ptr<FakeStoreBackend> backend, Durability durability,
+                       BoostAsioService& asio_service,
+                       uint64_t max_buffered_bytes = kDefaultMaxBufferedBytes,
+                       std::function<void()> on_synced = nullptr);
+  ~FakeStoreWriteBehind();
+
+  virtual NonEmptyString Read(const std::string& name) const;
+  virtual void Write(const std::string& name, const NonEmptyString& value);
+  virtual void Remove(const std::string& name);
+  // Flushes everything buffered, whatever 'names'.
+  virtual void Sync(const std::vector<std::string>& names);
+  virtual void Rebuild(FakeStoreIndex& index);
+
+  // Batches flushed successfully so far.
+  uint64_t batch_count() const;
+
+ private:
+  // A write, or a removal if 'value' is uninitialised, and the callers waiting for it to be synced.
+  struct Change {
+    Change() : value(), waiters() {}
+    NonEmptyString value;
+    std::vector<std::shared_ptr<std::promise<void>>> waiters;
+  };
+  typedef std::map<std::string, Change> Batch;
+
+  FakeStoreWriteBehind(const FakeStoreWriteBehind&);
+  FakeStoreWriteBehind(FakeStoreWriteBehind&&);
+  FakeStoreWriteBehind& operator=(FakeStoreWriteBehind);
+
+  void Buffer(const std::string& name, const NonEmptyString& value);
+  // Flushes batches until the buffer is empty or a flush fails, unless another thread already is.
+  void Flush();
+  // Throws, and forgets, the error of an asynchronous flush which failed since it was last thrown.
+  // Called with mutex_ held by 'lock', which is released if this throws.
+  void ThrowFlushError(std::unique_lock<std::mutex>& lock);
+
+  std::unique_ptr<FakeStoreBackend> backend_;
+  const Durability kDurability_;
+  const uint64_t kMaxBufferedBytes_;
+  BoostAsioService& asio_service_;
+  const std::function<void()> kOnSynced_;
+  mutable std::mutex mutex_;
+  std::condition_variable flushed_condition_;
+  // 'flushing_' is the batch being passed on; it's only changed by the flushing thread, and only
+  // while holding mutex_.
+  Batch buffered_, flushing_;
+  uint64_t buffered_bytes_, batch_count_;
+  std::exception_ptr flush_error_;
+  bool flush_running_, flush_posted_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_FAKE_STORE_WRITE_BEHIND_H_
@@ -19,7 +19,10 @@
 #ifndef MAIDSAFE_NFS_CLIENT_GET_HANDLER_H_
 #define MAIDSAFE_NFS_CLIENT_GET_HANDLER_H_
 
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
 #include <tuple>
 #include <string>
 #include <utility>
@@ -45,19 +48,21 @@ namespace nfs_client {
 template <typename DispatcherType>
 class GetHandlerVisitor : public boost::static_visitor<> {
  public:
-  GetHandlerVisitor(DispatcherType& dispatcher_in, routing::TaskId task_id)
-      : dispatcher_(dispatcher_in), kTaskId_(task_id) {}
+  GetHandlerVisitor(DispatcherType& dispatcher_in, routing::TaskId task_id,
+                    const std::chrono::steady_clock::duration& timeout)
+      : dispatcher_(dispatcher_in), kTaskId_(task_id), kTimeout_(timeout) {}
 
   template <typename Name>
   void operator()(const Name& data_name) {
     LOG(kVerbose) << "Get handler visitor sending get request for chunk "
                   << HexSubstr(data_name.value.string());
-    dispatcher_.SendGetRequest(kTaskId_, data_name);
+    dispatcher_.SendGetRequest(kTaskId_, data_name, kTimeout_);
   }
 
  private:
   DispatcherType& dispatcher_;
   const routing::TaskId kTaskId_;
+  const std::chrono::steady_clock::duration kTimeout_;
 };
 
 class ValidateDataVisitor : public boost::static_visitor<bool> {
@@ -77,7 +82,9 @@ class ValidateDataVisitor : public boost::static_visitor<bool> {
 
 template <typename DispatcherType>
 class GetHandler {
-  typedef std::tuple<size_t, routing::TaskId, DataNameVariant> GetInfo;
+  // Responses so far, the original task's ID, the name and the original timeout.
+  typedef std::tuple<size_t, routing::TaskId, DataNameVariant, std::chrono::steady_clock::duration>
+      GetInfo;
   enum class Operation : int {
     kNoOperation = 0,
     kAddResponse = 1,
@@ -86,21 +93,36 @@ class GetHandler {
   };
 
  public:
+  typedef std::function<void(const DataNameAndContentOrReturnCode&)> ResponseFunctor;
+
+  // Results are delivered on 'completion_service' if given; see OnCompletionService.
   GetHandler(routing::Timer<DataNameAndContentOrReturnCode>& get_timer,
-             DispatcherType& dispatcher)
-      : get_timer_(get_timer), dispatcher_(dispatcher), get_info_(), mutex_() {}
+             DispatcherType& dispatcher,
+             std::shared_ptr<BoostAsioService> completion_service = nullptr)
+      : get_timer_(get_timer),
+        dispatcher_(dispatcher),
+        completion_service_(std::move(completion_service)),
+        get_info_(),
+        mutex_() {}
 
   template <typename DataName>
   void Get(const DataName& data_name,
            std::shared_ptr<boost::promise<typename DataName::data_type>> promise,
            const std::chrono::steady_clock::duration& timeout);
 
+  // Calls 'response_functor' with the outcome, on whichever thread settles it; unlike the promise
+  // form, the completion service is not involved.
+  template <typename DataName>
+  void Get(const DataName& data_name, const ResponseFunctor& response_functor,
+           const std::chrono::steady_clock::duration& timeout);
+
   void AddResponse(routing::TaskId task_id, const DataNameAndContentOrReturnCode& response);
 
  private:
   bool ValidateData(const nfs_vault::Content& content, const DataNameVariant& data_name);
   routing::Timer<DataNameAndContentOrReturnCode>& get_timer_;
   DispatcherType& dispatcher_;
+  std::shared_ptr<BoostAsioService> completion_service_;
   std::map<routing::TaskId, GetInfo> get_info_;
   std::mutex mutex_;
 };
@@ -111,15 +133,25 @@ void GetHandler<DispatcherType>::Get(
     const DataName& data_name,
     std::shared_ptr<boost::promise<typename DataName::data_type>> promise,
     const std::chrono::steady_clock::duration& timeout) {
+  Get(data_name,
+      OnCompletionService<DataNameAndContentOrReturnCode>(
+          completion_service_, HandleGetResult<typename DataName::data_type>(promise)),
+      timeout);
+}
+
+template <typename DispatcherType>
+template <typename DataName>
+void GetHandler<DispatcherType>::Get(const DataName& data_name,
+                                     const ResponseFunctor& response_functor,
+                                     const std::chrono::steady_clock::duration& timeout) {
   auto task_id(get_timer_.NewTaskId());
-  HandleGetResult<typename DataName::data_type> response_functor(promise);
   auto op_data(
-           std::make_shared<nfs::OpData<DataNameAndContentOrReturnCode>>(1, response_functor));
+      std::make_shared<nfs::OpData<DataNameAndContentOrReturnCode>>(1, response_functor));
   {
     std::lock_guard<std::mutex> lock(mutex_);
     get_info_.insert(std::make_pair(task_id, std::make_tuple(0, task_id,
                                     GetDataNameVariant(DataName::data_type::Tag::kValue,
-                                                       data_name.value))));
+                                                       data_name.value), timeout)));
   }
   get_timer_.AddTask(timeout,
                      [op_data, data_name, task_id, this](
@@ -138,7 +170,7 @@ void GetHandler<DispatcherType>::Get(
                             get_info_.erase(iter);
                         }
                      }, 1, task_id);
-  dispatcher_.SendGetRequest(task_id, data_name);
+  dispatcher_.SendGetRequest(task_id, data_name, timeout);
 }
 
 template <typename DispatcherType>
@@ -168,7 +200,8 @@ void GetHandler<DispatcherType>::AddResponse(routing::TaskId task_id,
       new_task_id = get_timer_.NewTaskId();
       get_info_.insert(std::make_pair(new_task_id,
                                       std::make_tuple(0, std::get<1>(get_info_[task_id]),
-                                                      std::get<2>(get_info_[task_id]))));
+                                                      std::get<2>(get_info_[task_id]),
+                                                      std::get<3>(get_info_[task_id]))));
       get_info_.erase(task_id);
       operation = Operation::kSendRequest;
     } else if (response.return_code &&
@@ -186,7 +219,8 @@ void GetHandler<DispatcherType>::AddResponse(routing::TaskId task_id,
   if (operation == Operation::kAddResponse) {
     get_timer_.AddResponse(std::get<1>(get_info), response);
   } else if (operation == Operation::kSendRequest) {
-    GetHandlerVisitor<DispatcherType> get_handler_visitor(dispatcher_, new_task_id);
+    GetHandlerVisitor<DispatcherType> get_handler_visitor(dispatcher_, new_task_id,
+                                                          std::get<3>(get_info_[new_task_id]));
     boost::apply_visitor(get_handler_visitor, std::get<2>(get_info_[new_task_id]));
   } else if (operation == Operation::kCancelTask) {
     get_timer_.CancelTask(std::get<1>(get_info));
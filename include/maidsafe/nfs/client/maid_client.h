@@ -20,9 +20,12 @@
 #define MAIDSAFE_NFS_CLIENT_MAID_CLIENT_H_
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/signals2/signal.hpp"
@@ -47,9 +50,14 @@
 #include "maidsafe/nfs/message_wrapper.h"
 #include "maidsafe/nfs/service.h"
 #include "maidsafe/nfs/utils.h"
+#include "maidsafe/nfs/client/async_result.h"
+#include "maidsafe/nfs/client/client_routing.h"
 #include "maidsafe/nfs/client/client_utils.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/maid_node_dispatcher.h"
 #include "maidsafe/nfs/client/maid_node_service.h"
+#include "maidsafe/nfs/client/readiness_gate.h"
+#include "maidsafe/nfs/client/slab_future.h"
 #include "maidsafe/nfs/client/data_getter.h"
 
 namespace maidsafe {
@@ -58,42 +66,139 @@ namespace vault_manager { namespace tools { class PublicPmidStorer; } }
 
 namespace nfs_client {
 
+// Upper bound on the number of names carried by a single DeleteBatch message.
+const size_t kMaxNamesPerDeleteRequest(1000);
+
 class MaidClient : public std::enable_shared_from_this<MaidClient>  {
  public:
   typedef boost::future<std::vector<StructuredDataVersions::VersionName>> VersionNamesFuture;
   typedef boost::future<std::unique_ptr<StructuredDataVersions::VersionName>> PutVersionFuture;
+  typedef boost::future<std::vector<ReturnCode>> ReturnCodesFuture;
   typedef boost::signals2::signal<void(int32_t)> OnNetworkHealthChange;
 
+  // In each of the factory functions below, 'asio_service' runs response handling and timers.  It
+  // may be shared by several clients; if null, the client creates its own with
+  // kDefaultClientThreadCount threads.  'completion_service' is where the returned futures are
+  // resolved, and so where continuations attached to them run, keeping slow user code off
+  // 'asio_service'.  It too may be shared; if null, the client creates its own with
+  // kDefaultCompletionThreadCount threads.
+  //
   // Logging in for already existing maid accounts
-  static std::shared_ptr<MaidClient> MakeShared(const passport::Maid& maid);
+  static std::shared_ptr<MaidClient> MakeShared(
+      const passport::Maid& maid, std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
   // Creates maid account and logs in. Throws on failure to create account.
-  static std::shared_ptr<MaidClient> MakeShared(const passport::MaidAndSigner& maid_and_signer);
+  static std::shared_ptr<MaidClient> MakeShared(
+      const passport::MaidAndSigner& maid_and_signer,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+
+  // As MakeShared, but return as soon as joining the network has started rather than once the
+  // routing table is full.  The client accepts requests straight away, holding them until the
+  // network health first reaches 'ready_health' (their timeouts include the time held).  The future
+  // is then made ready, or, when creating an account, once the account has been created.  It holds
+  // the error if joining or account creation fails, in which case the held requests fail too.
+  static std::pair<std::shared_ptr<MaidClient>, boost::future<void>> MakeSharedAsync(
+      const passport::Maid& maid, int ready_health = kDefaultReadyNetworkHealth,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  static std::pair<std::shared_ptr<MaidClient>, boost::future<void>> MakeSharedAsync(
+      const passport::MaidAndSigner& maid_and_signer, int ready_health = kDefaultReadyNetworkHealth,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+
+  // As MakeShared, but connecting through 'routing' rather than to the live network; for example
+  // through an nfs::SimulatedNetwork, to run tests and benchmarks offline.
+  static std::shared_ptr<MaidClient> MakeSharedWithRouting(
+      const passport::Maid& maid, std::unique_ptr<ClientRouting> routing,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  static std::shared_ptr<MaidClient> MakeSharedWithRouting(
+      const passport::MaidAndSigner& maid_and_signer, std::unique_ptr<ClientRouting> routing,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
   // Disconnects from network and all unfinished tasks will be cancelled
   void Stop();
 
   OnNetworkHealthChange& network_health_change_signal();
 
+  // Congestion window size, outstanding requests and queued requests for each destination group.
+  std::map<NodeId, CongestionControl::Metrics> congestion_metrics() const;
+
   //========================== Data accessors and mutators =========================================
   template <typename DataName>
   boost::future<typename DataName::data_type> Get(
       const DataName& data_name,
       const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
+  // Completion-token forms of Get, Put, GetVersions and PutVersion; see AsyncResult.  Handlers run
+  // on the completion service.
+  template <typename DataName, typename CompletionToken>
+  AsyncResult<CompletionToken, typename DataName::data_type> Get(
+      const DataName& data_name, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
+  // Requests held back by congestion control are released according to 'priority'; see Priority.
+  template <typename Data>
+  boost::future<void> Put(
+      const Data& data,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360),
+      Priority priority = Priority::kNormal);
+
+  // The SlabFutureTag overloads keep the operation's state in a slab owned by the client instead of
+  // allocating a promise, an OpData and its callback for every call.
   template <typename Data>
-  boost::future<void> Put(const Data& data, const std::chrono::steady_clock::duration& timeout =
-                                                std::chrono::seconds(360));
+  SlabFuture<void> Put(
+      const Data& data, SlabFutureTag,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360),
+      Priority priority = Priority::kNormal);
+
+  template <typename Data, typename CompletionToken>
+  AsyncResult<CompletionToken, void> Put(
+      const Data& data, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360),
+      Priority priority = Priority::kNormal);
 
   template <typename DataName>
-  void Delete(const DataName& data_name);
+  boost::future<void> Delete(
+      const DataName& data_name,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kNormal);
 
-  void IncrementReferenceCount(const std::vector<ImmutableData::Name>& /*data_names*/) {}
-  void DecrementReferenceCount(const std::vector<ImmutableData::Name>& /*data_names*/) {}
+  template <typename DataName>
+  SlabFuture<void> Delete(
+      const DataName& data_name, SlabFutureTag,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kNormal);
+
+  // Sends the deletions in as few messages as kMaxNamesPerDeleteRequest allows.  The future holds
+  // one ReturnCode per name, in the order given; a message failing as a whole sets the code of each
+  // name it carried.
+  template <typename DataName>
+  ReturnCodesFuture Delete(
+      const std::vector<DataName>& data_names,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kBulk);
+
+  // The batched versions send all names in a single message.  The future holds one ReturnCode per
+  // name, in the order given.  It only throws if the batch as a whole failed.
+  ReturnCodesFuture IncrementReferenceCount(
+      const std::vector<ImmutableData::Name>& data_names,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
+  ReturnCodesFuture DecrementReferenceCount(
+      const std::vector<ImmutableData::Name>& data_names,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
   template <typename DataName>
-  void IncrementReferenceCount(const DataName& data_name);
+  boost::future<void> IncrementReferenceCount(
+      const DataName& data_name,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
   template <typename DataName>
-  void DecrementReferenceCount(const DataName& data_name);
+  boost::future<void> DecrementReferenceCount(
+      const DataName& data_name,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
   template <typename DataName>
   boost::future<void> CreateVersionTree(const DataName& data_name,
@@ -105,24 +210,59 @@ class MaidClient : public std::enable_shared_from_this<MaidClient>  {
   template <typename DataName>
   VersionNamesFuture GetVersions(const DataName& data_name,
                                  const std::chrono::steady_clock::duration& timeout =
-                                     std::chrono::seconds(120));
+                                     std::chrono::seconds(120),
+                                 Priority priority = Priority::kInteractive);
+
+  template <typename DataName>
+  SlabFuture<std::vector<StructuredDataVersions::VersionName>> GetVersions(
+      const DataName& data_name, SlabFutureTag,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kInteractive);
+
+  template <typename DataName, typename CompletionToken>
+  AsyncResult<CompletionToken, std::vector<StructuredDataVersions::VersionName>> GetVersions(
+      const DataName& data_name, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kInteractive);
+
+  // Sends one GetVersionsBatch per close group holding names in 'data_names', rather than one
+  // GetVersions per name.  Where routing can't tell a name's close group, that name is sent in a
+  // batch of its own.  The result holds an entry per distinct name: either its versions or the
+  // error for that name.
+  template <typename DataName>
+  boost::future<VersionNamesByName<DataName>> GetVersionsBatch(
+      const std::vector<DataName>& data_names,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120),
+      Priority priority = Priority::kNormal);
 
   template <typename DataName>
   VersionNamesFuture GetBranch(const DataName& data_name,
                                const StructuredDataVersions::VersionName& branch_tip,
                                const std::chrono::steady_clock::duration& timeout =
-                                   std::chrono::seconds(120));
+                                   std::chrono::seconds(120),
+                               Priority priority = Priority::kInteractive);
 
   template <typename DataName>
   PutVersionFuture PutVersion(const DataName& data_name,
                               const StructuredDataVersions::VersionName& old_version_name,
                               const StructuredDataVersions::VersionName& new_version_name,
                               const std::chrono::steady_clock::duration& timeout =
-                                  std::chrono::seconds(360));
+                                  std::chrono::seconds(360),
+                              Priority priority = Priority::kNormal);
+
+  // The value is the new tip of the tree, if the response carried one.
+  template <typename DataName, typename CompletionToken>
+  AsyncResult<CompletionToken, boost::optional<StructuredDataVersions::VersionName>> PutVersion(
+      const DataName& data_name, const StructuredDataVersions::VersionName& old_version_name,
+      const StructuredDataVersions::VersionName& new_version_name, CompletionToken&& token,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360),
+      Priority priority = Priority::kNormal);
 
   template <typename DataName>
-  void DeleteBranchUntilFork(const DataName& data_name,
-                             const StructuredDataVersions::VersionName& branch_tip);
+  boost::future<void> DeleteBranchUntilFork(
+      const DataName& data_name, const StructuredDataVersions::VersionName& branch_tip,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
+
   // TODO(Prakash): This can move to private section
   boost::future<void> CreateAccount(const nfs_vault::MaidAccountCreation& account_creation,
                                     const std::chrono::steady_clock::duration& timeout =
@@ -135,9 +275,16 @@ class MaidClient : public std::enable_shared_from_this<MaidClient>  {
   typedef std::function<void(const DataNameAndContentOrReturnCode&)> GetFunctor;
   typedef std::function<void(const StructuredDataNameAndContentOrReturnCode&)> GetVersionsFunctor;
   typedef std::function<void(const StructuredDataNameAndContentOrReturnCode&)> GetBranchFunctor;
+  typedef std::function<void(const DataNamesAndReturnCodes&)> ReferenceCountsFunctor;
   typedef boost::promise<std::vector<StructuredDataVersions::VersionName>> VersionNamesPromise;
+  typedef OperationSlab<void, ReturnCode> ReturnCodeSlab;
+  typedef OperationSlab<std::vector<StructuredDataVersions::VersionName>,
+                        StructuredDataNameAndContentOrReturnCode> VersionNamesSlab;
 
-  explicit MaidClient(const passport::Maid& maid);
+  // Connects to the live network if 'routing' is null.
+  MaidClient(const passport::Maid& maid, std::shared_ptr<BoostAsioService> asio_service,
+             std::shared_ptr<BoostAsioService> completion_service,
+             std::unique_ptr<ClientRouting> routing = nullptr);
 
   MaidClient(const MaidClient&);
   MaidClient(MaidClient&&);
@@ -153,15 +300,37 @@ class MaidClient : public std::enable_shared_from_this<MaidClient>  {
 
   void Init();
 
+  boost::future<void> InitAsync(int ready_health);
+
   void InitZeroState(const passport::MaidAndSigner& maid_and_signer,
                      const std::vector<passport::PublicPmid>& public_pmids);
 
   void CreateAccount(const passport::PublicMaid& public_maid,
                      const passport::PublicAnmaid& public_anmaid);
   void InitRouting(std::vector<passport::PublicPmid> = std::vector<passport::PublicPmid>());
+  void JoinRouting(const std::vector<passport::PublicPmid>& public_pmids);
 
   routing::Functors InitialiseRoutingCallbacks();
   void OnNetworkStatusChange(int updated_network_health);
+  // Opens readiness_gate_ once the network health reaches ready_health_, or closes it if joining
+  // has failed first.
+  void UpdateReadiness();
+
+  template <typename DataName>
+  void DoGetVersions(const DataName& data_name,
+                     const std::chrono::steady_clock::duration& timeout, Priority priority,
+                     const GetVersionsFunctor& response_functor);
+
+  ReturnCodesFuture DeleteBatch(const std::vector<nfs_vault::DataName>& data_names,
+                                const std::chrono::steady_clock::duration& timeout,
+                                Priority priority);
+
+  void DoIncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names,
+                                 const std::chrono::steady_clock::duration& timeout,
+                                 const ReferenceCountsFunctor& response_functor);
+  void DoDecrementReferenceCount(const std::vector<ImmutableData::Name>& data_names,
+                                 const std::chrono::steady_clock::duration& timeout,
+                                 const ReferenceCountsFunctor& response_functor);
 
   template <typename T>
   void OnMessageReceived(const T& routing_message);
@@ -171,13 +340,20 @@ class MaidClient : public std::enable_shared_from_this<MaidClient>  {
                      const Receiver& receiver);
 
   const passport::Maid kMaid_;
-  BoostAsioService asio_service_;
+  const bool kOwnsAsioService_, kOwnsCompletionService_;
+  std::shared_ptr<BoostAsioService> asio_service_, completion_service_;
+  // Declared before rpc_timers_, whose tasks refer to them.
+  ReturnCodeSlab return_code_slab_;
+  VersionNamesSlab version_names_slab_;
   MaidNodeService::RpcTimers rpc_timers_;
+  CongestionControl congestion_control_;
   std::mutex network_health_mutex_;
   std::condition_variable network_health_condition_variable_;
-  int network_health_;
+  int network_health_, ready_health_;
+  boost::promise<void> ready_promise_;
+  ReadinessGate readiness_gate_;
   OnNetworkHealthChange network_health_change_signal_;
-  std::unique_ptr<routing::Routing> routing_;
+  std::unique_ptr<ClientRouting> routing_;
   DataGetter data_getter_;
   nfs::detail::PublicPmidHelper public_pmid_helper_;
   MaidNodeDispatcher dispatcher_;
@@ -193,14 +369,43 @@ template <typename DataName>
 boost::future<typename DataName::data_type> MaidClient::Get(
     const DataName& data_name,
     const std::chrono::steady_clock::duration& timeout) {
-  return data_getter_.Get(data_name, timeout);
+  typedef typename DataName::data_type Data;
+  if (readiness_gate_.IsOpen())
+    return data_getter_.Get(data_name, timeout);
+  auto promise(std::make_shared<boost::promise<Data>>());
+  const auto deadline(std::chrono::steady_clock::now() + timeout);
+  readiness_gate_.Run([this, promise, data_name, deadline] {
+    data_getter_.AsyncGet(data_name, [promise](AsyncExpected<Data> result) {
+                                       if (result.valid())
+                                         promise->set_value(std::move(*result));
+                                       else
+                                         promise->set_exception(maidsafe_error(result.error()));
+                                     },
+                          TimeRemaining(deadline));
+  });
+  return promise->get_future();
+}
+
+template <typename DataName, typename CompletionToken>
+AsyncResult<CompletionToken, typename DataName::data_type> MaidClient::Get(
+    const DataName& data_name, CompletionToken&& token,
+    const std::chrono::steady_clock::duration& timeout) {
+  AsyncHandler<CompletionToken, typename DataName::data_type> handler(
+      std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  const auto deadline(std::chrono::steady_clock::now() + timeout);
+  readiness_gate_.Run([this, data_name, handler, deadline] {
+    data_getter_.AsyncGet(data_name, handler, TimeRemaining(deadline));
+  });
+  return result.get();
 }
 
 template <typename Data>
 boost::future<void> MaidClient::Put(const Data& data,
-                                     const std::chrono::steady_clock::duration& timeout) {
-  LOG(kVerbose) << "MaidClient put " << HexSubstr(data.name().value.string())
-                << " of size " << data.Serialise().data.string().size();
+                                     const std::chrono::steady_clock::duration& timeout,
+                                     Priority priority) {
+  NFS_VERBOSE_LOG << "MaidClient put " << HexSubstr(data.name().value.string())
+                  << " of size " << data.Serialise().data.string().size();
   typedef MaidNodeService::PutResponse::Contents ResponseContents;
   auto promise(std::make_shared<boost::promise<void>>());
   NodeId node_id;
@@ -208,33 +413,144 @@ boost::future<void> MaidClient::Put(const Data& data,
   auto response_functor([promise](const nfs_client::ReturnCode& result) {
                            HandlePutResponseResult(result, promise);
                         });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(routing::Parameters::group_size - 1,
-                                                               response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.put_timer.NewTaskId());
   rpc_timers_.put_timer.AddTask(
       timeout,
       [op_data, data](ResponseContents put_response) {
-        LOG(kVerbose) << "MaidClient Put HandleResponseContents for "
-                      << HexSubstr(data.name().value);
+        NFS_VERBOSE_LOG << "MaidClient Put HandleResponseContents for "
+                        << HexSubstr(data.name().value);
         op_data->HandleResponseContents(std::move(put_response));
       },
       routing::Parameters::group_size - 1, task_id);
-  rpc_timers_.put_timer.PrintTaskIds();
-  dispatcher_.SendPutRequest(task_id, data);
+  if (nfs::VerboseHotPathLogging())
+    rpc_timers_.put_timer.PrintTaskIds();
+  dispatcher_.SendPutRequest(task_id, data, timeout, priority);
+  return promise->get_future();
+}
+
+template <typename Data>
+SlabFuture<void> MaidClient::Put(const Data& data, SlabFutureTag,
+                                 const std::chrono::steady_clock::duration& timeout,
+                                 Priority priority) {
+  typedef MaidNodeService::PutResponse::Contents ResponseContents;
+  ReturnCodeSlab::Handle handle;
+  auto future(return_code_slab_.Acquire(routing::Parameters::group_size - 1, &GetSuccessOrError,
+                                        handle));
+  auto task_id(rpc_timers_.put_timer.NewTaskId());
+  rpc_timers_.put_timer.AddTask(
+      timeout, [handle](ResponseContents put_response) {
+                 ReturnCodeSlab::HandleResponseContents(handle, std::move(put_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendPutRequest(task_id, data, timeout, priority);
+  return future;
+}
+
+template <typename Data, typename CompletionToken>
+AsyncResult<CompletionToken, void> MaidClient::Put(
+    const Data& data, CompletionToken&& token, const std::chrono::steady_clock::duration& timeout,
+    Priority priority) {
+  typedef MaidNodeService::PutResponse::Contents ResponseContents;
+  AsyncHandler<CompletionToken, void> handler(std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      DispatchToHandler<ResponseContents>(completion_service_->service(), handler,
+                                          &GetAsyncExpectedSuccess)));
+  auto task_id(rpc_timers_.put_timer.NewTaskId());
+  rpc_timers_.put_timer.AddTask(
+      timeout, [op_data](ResponseContents put_response) {
+                 op_data->HandleResponseContents(std::move(put_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendPutRequest(task_id, data, timeout, priority);
+  return result.get();
+}
+
+template <typename DataName>
+boost::future<void> MaidClient::Delete(const DataName& data_name,
+                                       const std::chrono::steady_clock::duration& timeout,
+                                       Priority priority) {
+  NFS_VERBOSE_LOG << "MaidClient Delete " << HexSubstr(data_name.value);
+  typedef MaidNodeService::DeleteResponse::Contents ResponseContents;
+  auto promise(std::make_shared<boost::promise<void>>());
+  auto response_functor([promise](const nfs_client::ReturnCode& result) {
+                           HandleDeleteResult(result, promise);
+                        });
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+  auto task_id(rpc_timers_.delete_timer.NewTaskId());
+  rpc_timers_.delete_timer.AddTask(
+      timeout,
+      [op_data, data_name](ResponseContents delete_response) {
+        NFS_VERBOSE_LOG << "MaidClient Delete HandleResponseContents for "
+                        << HexSubstr(data_name.value);
+        op_data->HandleResponseContents(std::move(delete_response));
+      },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendDeleteRequest(task_id, data_name, timeout, priority);
   return promise->get_future();
 }
 
 template <typename DataName>
-void MaidClient::Delete(const DataName& data_name) {
-  dispatcher_.SendDeleteRequest(data_name);
+SlabFuture<void> MaidClient::Delete(const DataName& data_name, SlabFutureTag,
+                                    const std::chrono::steady_clock::duration& timeout,
+                                    Priority priority) {
+  typedef MaidNodeService::DeleteResponse::Contents ResponseContents;
+  ReturnCodeSlab::Handle handle;
+  auto future(return_code_slab_.Acquire(routing::Parameters::group_size - 1, &GetSuccessOrError,
+                                        handle));
+  auto task_id(rpc_timers_.delete_timer.NewTaskId());
+  rpc_timers_.delete_timer.AddTask(
+      timeout, [handle](ResponseContents delete_response) {
+                 ReturnCodeSlab::HandleResponseContents(handle, std::move(delete_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendDeleteRequest(task_id, data_name, timeout, priority);
+  return future;
+}
+
+template <typename DataName>
+MaidClient::ReturnCodesFuture MaidClient::Delete(
+    const std::vector<DataName>& data_names, const std::chrono::steady_clock::duration& timeout,
+    Priority priority) {
+  std::vector<nfs_vault::DataName> names;
+  names.reserve(data_names.size());
+  for (const auto& data_name : data_names)
+    names.emplace_back(data_name);
+  return DeleteBatch(names, timeout, priority);
 }
 
 template <typename DataName>
-void MaidClient::IncrementReferenceCount(const DataName& /*data_name*/) {
+boost::future<void> MaidClient::IncrementReferenceCount(
+    const DataName& data_name, const std::chrono::steady_clock::duration& timeout) {
+  static_assert(std::is_same<DataName, ImmutableData::Name>::value,
+                "Only ImmutableData is reference counted.");
+  NFS_VERBOSE_LOG << "MaidClient IncrementReferenceCount for " << HexSubstr(data_name.value);
+  auto promise(std::make_shared<boost::promise<void>>());
+  DoIncrementReferenceCount(std::vector<ImmutableData::Name>(1, data_name), timeout,
+                            [promise, data_name](const DataNamesAndReturnCodes& result) {
+                              HandleReferenceCountResult(result, data_name, promise);
+                            });
+  return promise->get_future();
 }
 
 template <typename DataName>
-void MaidClient::DecrementReferenceCount(const DataName& /*data_name*/) {
+boost::future<void> MaidClient::DecrementReferenceCount(
+    const DataName& data_name, const std::chrono::steady_clock::duration& timeout) {
+  static_assert(std::is_same<DataName, ImmutableData::Name>::value,
+                "Only ImmutableData is reference counted.");
+  NFS_VERBOSE_LOG << "MaidClient DecrementReferenceCount for " << HexSubstr(data_name.value);
+  auto promise(std::make_shared<boost::promise<void>>());
+  DoDecrementReferenceCount(std::vector<ImmutableData::Name>(1, data_name), timeout,
+                            [promise, data_name](const DataNamesAndReturnCodes& result) {
+                              HandleReferenceCountResult(result, data_name, promise);
+                            });
+  return promise->get_future();
 }
 
 template <typename DataName>
@@ -242,37 +558,114 @@ boost::future<void> MaidClient::CreateVersionTree(const DataName& data_name,
                        const StructuredDataVersions::VersionName& version_name,
                        uint32_t max_versions, uint32_t max_branches,
                        const std::chrono::steady_clock::duration& timeout) {
-  LOG(kVerbose) << "MaidClient Create Version " << HexSubstr(data_name.value);
+  NFS_VERBOSE_LOG << "MaidClient Create Version " << HexSubstr(data_name.value);
   typedef MaidNodeService::CreateVersionTreeResponse::Contents ResponseContents;
   auto promise(std::make_shared<boost::promise<void>>());
   auto response_functor([promise](const nfs_client::ReturnCode& result) {
                            HandleCreateVersionTreeResult(result, promise);
                         });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.create_version_tree_timer.NewTaskId());
   rpc_timers_.create_version_tree_timer.AddTask(
       timeout,
       [op_data, data_name](ResponseContents get_response) {
-        LOG(kVerbose) << "MaidClient CreateVersionTree HandleResponseContents for "
-                      << HexSubstr(data_name.value);
+        NFS_VERBOSE_LOG << "MaidClient CreateVersionTree HandleResponseContents for "
+                        << HexSubstr(data_name.value);
         op_data->HandleResponseContents(std::move(get_response));
       },
       routing::Parameters::group_size * 3, task_id);
-  rpc_timers_.create_version_tree_timer.PrintTaskIds();
+  if (nfs::VerboseHotPathLogging())
+    rpc_timers_.create_version_tree_timer.PrintTaskIds();
   dispatcher_.SendCreateVersionTreeRequest(task_id, data_name, version_name, max_versions,
-                                           max_branches);
+                                           max_branches, timeout);
   return promise->get_future();
 }
 
 template <typename DataName>
 MaidClient::VersionNamesFuture MaidClient::GetVersions(
-    const DataName& data_name, const std::chrono::steady_clock::duration& timeout) {
-  LOG(kVerbose) << "MaidClient Get Version for " << HexSubstr(data_name.value);
-  typedef MaidNodeService::GetVersionsResponse::Contents ResponseContents;
+    const DataName& data_name, const std::chrono::steady_clock::duration& timeout,
+    Priority priority) {
+  NFS_VERBOSE_LOG << "MaidClient Get Version for " << HexSubstr(data_name.value);
   auto promise(std::make_shared<VersionNamesPromise>());
-  auto response_functor([promise](const StructuredDataNameAndContentOrReturnCode&
-                                  result) { HandleGetVersionsOrBranchResult(result, promise); });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  DoGetVersions(data_name, timeout, priority,
+                [promise](const StructuredDataNameAndContentOrReturnCode& result) {
+                  HandleGetVersionsOrBranchResult(result, promise);
+                });
+  return promise->get_future();
+}
+
+template <typename DataName>
+SlabFuture<std::vector<StructuredDataVersions::VersionName>> MaidClient::GetVersions(
+    const DataName& data_name, SlabFutureTag, const std::chrono::steady_clock::duration& timeout,
+    Priority priority) {
+  typedef MaidNodeService::GetVersionsResponse::Contents ResponseContents;
+  VersionNamesSlab::Handle handle;
+  auto future(version_names_slab_.Acquire(1, &GetVersionNamesOrError, handle));
+  auto task_id(rpc_timers_.get_versions_timer.NewTaskId());
+  rpc_timers_.get_versions_timer.AddTask(
+      timeout, [handle](ResponseContents get_versions_response) {
+                 VersionNamesSlab::HandleResponseContents(handle,
+                                                          std::move(get_versions_response));
+               },
+      // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
+      routing::Parameters::group_size * 2, task_id);
+  dispatcher_.SendGetVersionsRequest(task_id, data_name, timeout, priority);
+  return future;
+}
+
+template <typename DataName, typename CompletionToken>
+AsyncResult<CompletionToken, std::vector<StructuredDataVersions::VersionName>>
+    MaidClient::GetVersions(const DataName& data_name, CompletionToken&& token,
+                            const std::chrono::steady_clock::duration& timeout,
+                            Priority priority) {
+  AsyncHandler<CompletionToken, std::vector<StructuredDataVersions::VersionName>> handler(
+      std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  DoGetVersions(data_name, timeout, priority,
+                DispatchToHandler<const StructuredDataNameAndContentOrReturnCode&>(
+                    completion_service_->service(), handler, &GetAsyncExpectedVersionNames));
+  return result.get();
+}
+
+template <typename DataName>
+boost::future<VersionNamesByName<DataName>> MaidClient::GetVersionsBatch(
+    const std::vector<DataName>& data_names, const std::chrono::steady_clock::duration& timeout,
+    Priority priority) {
+  typedef MaidNodeService::GetVersionsBatchResponse::Contents ResponseContents;
+  auto batches(BatchByCloseGroup(*routing_,
+                                 std::set<DataName>(std::begin(data_names), std::end(data_names))));
+  NFS_VERBOSE_LOG << "MaidClient Get Versions for " << data_names.size() << " names in "
+                  << batches.size() << " batches";
+  auto promise(std::make_shared<boost::promise<VersionNamesByName<DataName>>>());
+  auto handler(std::make_shared<HandleMultipleGetVersionsResult<DataName>>(promise,
+                                                                           batches.size()));
+  for (auto& batch : batches) {
+    auto batch_names(std::make_shared<std::vector<DataName>>(std::move(batch)));
+    auto response_functor([handler, batch_names](const ResponseContents& result) {
+      (*handler)(*batch_names, result);
+    });
+    auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+        1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+    auto task_id(rpc_timers_.get_versions_batch_timer.NewTaskId());
+    rpc_timers_.get_versions_batch_timer.AddTask(
+        timeout, [op_data](ResponseContents get_versions_response) {
+                   op_data->HandleResponseContents(std::move(get_versions_response));
+                 },
+        routing::Parameters::group_size * 2, task_id);
+    dispatcher_.SendGetVersionsBatchRequest(task_id, nfs_vault::DataNames(*batch_names), timeout,
+                                            priority);
+  }
+  return promise->get_future();
+}
+
+template <typename DataName>
+void MaidClient::DoGetVersions(const DataName& data_name,
+                               const std::chrono::steady_clock::duration& timeout,
+                               Priority priority, const GetVersionsFunctor& response_functor) {
+  typedef MaidNodeService::GetVersionsResponse::Contents ResponseContents;
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.get_versions_timer.NewTaskId());
   rpc_timers_.get_versions_timer.AddTask(
       timeout, [op_data](ResponseContents get_versions_response) {
@@ -280,20 +673,20 @@ MaidClient::VersionNamesFuture MaidClient::GetVersions(
                },
       // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
       routing::Parameters::group_size * 2, task_id);
-  dispatcher_.SendGetVersionsRequest(task_id, data_name);
-  return promise->get_future();
+  dispatcher_.SendGetVersionsRequest(task_id, data_name, timeout, priority);
 }
 
 template <typename DataName>
 MaidClient::VersionNamesFuture MaidClient::GetBranch(
     const DataName& data_name, const StructuredDataVersions::VersionName& branch_tip,
-    const std::chrono::steady_clock::duration& timeout) {
-  LOG(kVerbose) << "MaidClient Get Branch for " << HexSubstr(data_name.value);
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
+  NFS_VERBOSE_LOG << "MaidClient Get Branch for " << HexSubstr(data_name.value);
   typedef MaidNodeService::GetBranchResponse::Contents ResponseContents;
   auto promise(std::make_shared<VersionNamesPromise>());
   auto response_functor([promise](const StructuredDataNameAndContentOrReturnCode &
                                   result) { HandleGetVersionsOrBranchResult(result, promise); });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.get_branch_timer.NewTaskId());
   rpc_timers_.get_branch_timer.AddTask(timeout,
       [op_data](ResponseContents get_branch_response) {
@@ -301,7 +694,7 @@ MaidClient::VersionNamesFuture MaidClient::GetBranch(
       },
       // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
       routing::Parameters::group_size * 2, task_id);
-  dispatcher_.SendGetBranchRequest(task_id, data_name, branch_tip);
+  dispatcher_.SendGetBranchRequest(task_id, data_name, branch_tip, timeout, priority);
   return promise->get_future();
 }
 
@@ -309,36 +702,83 @@ template <typename DataName>
 MaidClient::PutVersionFuture MaidClient::PutVersion(
     const DataName& data_name, const StructuredDataVersions::VersionName& old_version_name,
     const StructuredDataVersions::VersionName& new_version_name,
-    const std::chrono::steady_clock::duration& timeout) {
-  LOG(kVerbose) << "MaidClient::PutVersion put new version "
-                << DebugId(new_version_name.id) << " after old version "
-                << DebugId(old_version_name.id) << " for " << HexSubstr(data_name.value);
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
+  NFS_VERBOSE_LOG << "MaidClient::PutVersion put new version "
+                  << DebugId(new_version_name.id) << " after old version "
+                  << DebugId(old_version_name.id) << " for " << HexSubstr(data_name.value);
   typedef MaidNodeService::PutVersionResponse::Contents ResponseContents;
   auto promise(
       std::make_shared<boost::promise<std::unique_ptr<StructuredDataVersions::VersionName>>>());
   auto response_functor([promise](const nfs_client::TipOfTreeAndReturnCode& result) {
                            HandlePutVersionResult(result, promise);
                         });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(1, response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.put_version_timer.NewTaskId());
   rpc_timers_.put_version_timer.AddTask(
       timeout,
       [op_data, data_name, new_version_name, old_version_name](ResponseContents get_response) {
-        LOG(kVerbose) << "MaidClient PutVersion HandleResponseContents put new version "
-                      << DebugId(new_version_name.id) << " after old version "
-                      << DebugId(old_version_name.id) << " for " << HexSubstr(data_name.value);
+        NFS_VERBOSE_LOG << "MaidClient PutVersion HandleResponseContents put new version "
+                        << DebugId(new_version_name.id) << " after old version "
+                        << DebugId(old_version_name.id) << " for " << HexSubstr(data_name.value);
         op_data->HandleResponseContents(std::move(get_response));
       },
       routing::Parameters::group_size * 3, task_id);
-  rpc_timers_.put_version_timer.PrintTaskIds();
-  dispatcher_.SendPutVersionRequest(task_id, data_name, old_version_name, new_version_name);
+  if (nfs::VerboseHotPathLogging())
+    rpc_timers_.put_version_timer.PrintTaskIds();
+  dispatcher_.SendPutVersionRequest(task_id, data_name, old_version_name, new_version_name,
+                                    timeout, priority);
   return promise->get_future();
 }
 
+template <typename DataName, typename CompletionToken>
+AsyncResult<CompletionToken, boost::optional<StructuredDataVersions::VersionName>>
+    MaidClient::PutVersion(const DataName& data_name,
+                           const StructuredDataVersions::VersionName& old_version_name,
+                           const StructuredDataVersions::VersionName& new_version_name,
+                           CompletionToken&& token,
+                           const std::chrono::steady_clock::duration& timeout,
+                           Priority priority) {
+  typedef MaidNodeService::PutVersionResponse::Contents ResponseContents;
+  AsyncHandler<CompletionToken, boost::optional<StructuredDataVersions::VersionName>> handler(
+      std::forward<CompletionToken>(token));
+  boost::asio::async_result<decltype(handler)> result(handler);
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      1, DispatchToHandler<ResponseContents>(completion_service_->service(), handler,
+                                             &GetAsyncExpectedTipOfTree)));
+  auto task_id(rpc_timers_.put_version_timer.NewTaskId());
+  rpc_timers_.put_version_timer.AddTask(
+      timeout, [op_data](ResponseContents put_version_response) {
+                 op_data->HandleResponseContents(std::move(put_version_response));
+               },
+      routing::Parameters::group_size * 3, task_id);
+  dispatcher_.SendPutVersionRequest(task_id, data_name, old_version_name, new_version_name,
+                                    timeout, priority);
+  return result.get();
+}
+
 template <typename DataName>
-void MaidClient::DeleteBranchUntilFork(const DataName& data_name,
-                                        const StructuredDataVersions::VersionName& branch_tip) {
-  dispatcher_.SendDeleteBranchUntilForkRequest(data_name, branch_tip);
+boost::future<void> MaidClient::DeleteBranchUntilFork(
+    const DataName& data_name, const StructuredDataVersions::VersionName& branch_tip,
+    const std::chrono::steady_clock::duration& timeout) {
+  NFS_VERBOSE_LOG << "MaidClient DeleteBranchUntilFork " << DebugId(branch_tip.id) << " for "
+                  << HexSubstr(data_name.value);
+  typedef MaidNodeService::DeleteBranchUntilForkResponse::Contents ResponseContents;
+  auto promise(std::make_shared<boost::promise<void>>());
+  auto response_functor([promise](const nfs_client::ReturnCode& result) {
+                           HandleDeleteResult(result, promise);
+                        });
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+  auto task_id(rpc_timers_.delete_branch_until_fork_timer.NewTaskId());
+  rpc_timers_.delete_branch_until_fork_timer.AddTask(
+      timeout, [op_data](ResponseContents delete_response) {
+                 op_data->HandleResponseContents(std::move(delete_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendDeleteBranchUntilForkRequest(task_id, data_name, branch_tip, timeout);
+  return promise->get_future();
 }
 
 template <typename T>
@@ -349,7 +789,7 @@ void MaidClient::OnMessageReceived(const T& routing_message) {
     return data_getter_.HandleMessage(routing_message);
 
   std::shared_ptr<MaidClient> this_ptr(shared_from_this());
-  asio_service_.service().post([=] {
+  asio_service_->service().post([=] {
     this_ptr->HandleMessage(wrapper_tuple, routing_message.sender, routing_message.receiver);
   });
 }
@@ -19,9 +19,12 @@
 #ifndef MAIDSAFE_NFS_CLIENT_MAID_NODE_DISPATCHER_H_
 #define MAIDSAFE_NFS_CLIENT_MAID_NODE_DISPATCHER_H_
 
+#include <chrono>
+#include <memory>
 #include <string>
 
 #include "maidsafe/common/error.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/data_types/data_type_values.h"
 #include "maidsafe/common/data_types/structured_data_versions.h"
@@ -30,9 +33,14 @@
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/timer.h"
 
+#include "maidsafe/nfs/hot_path_log.h"
 #include "maidsafe/nfs/message_types.h"
 #include "maidsafe/nfs/types.h"
+#include "maidsafe/nfs/client/client_routing.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/messages.h"
+#include "maidsafe/nfs/client/readiness_gate.h"
+#include "maidsafe/nfs/client/shutdown_gate.h"
 #include "maidsafe/nfs/vault/messages.h"
 
 namespace maidsafe {
@@ -41,7 +49,12 @@ namespace nfs_client {
 
 class MaidNodeDispatcher {
  public:
-  explicit MaidNodeDispatcher(routing::Routing& routing);
+  // Requests are held by 'readiness_gate' until it opens.
+  MaidNodeDispatcher(ClientRouting& routing, CongestionControl& congestion_control,
+                     ReadinessGate& readiness_gate);
+  // As above, sending through 'routing' (which must outlive this) wrapped in a NetworkRouting.
+  MaidNodeDispatcher(routing::Routing& routing, CongestionControl& congestion_control,
+                     ReadinessGate& readiness_gate);
 
   void Stop();
 
@@ -49,34 +62,64 @@ class MaidNodeDispatcher {
   void SendGetRequest(routing::TaskId task_id, const DataName& data_name);
 
   template <typename Data>
-  void SendPutRequest(routing::TaskId task_id, const Data& data);
+  void SendPutRequest(routing::TaskId task_id, const Data& data,
+                      const std::chrono::steady_clock::duration& timeout,
+                      Priority priority = Priority::kNormal);
 
   template <typename DataName>
-  void SendDeleteRequest(const DataName& data_name);
+  void SendDeleteRequest(routing::TaskId task_id, const DataName& data_name,
+                         const std::chrono::steady_clock::duration& timeout,
+                         Priority priority = Priority::kNormal);
+
+  void SendDeleteBatchRequest(routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+                              const std::chrono::steady_clock::duration& timeout,
+                              Priority priority = Priority::kNormal);
+
+  void SendIncrementReferenceCountsRequest(routing::TaskId task_id,
+                                           const nfs_vault::DataNames& data_names,
+                                           const std::chrono::steady_clock::duration& timeout);
+
+  void SendDecrementReferenceCountsRequest(routing::TaskId task_id,
+                                           const nfs_vault::DataNames& data_names,
+                                           const std::chrono::steady_clock::duration& timeout);
 
   template <typename DataName>
   void SendCreateVersionTreeRequest(routing::TaskId task_id, const DataName& data_name,
                                     const StructuredDataVersions::VersionName& version_name,
-                                    uint32_t max_versions, uint32_t max_branches);
+                                    uint32_t max_versions, uint32_t max_branches,
+                                    const std::chrono::steady_clock::duration& timeout);
 
   template <typename DataName>
-  void SendGetVersionsRequest(routing::TaskId task_id, const DataName& data_name);
+  void SendGetVersionsRequest(routing::TaskId task_id, const DataName& data_name,
+                              const std::chrono::steady_clock::duration& timeout,
+                              Priority priority = Priority::kNormal);
 
   template <typename DataName>
   void SendGetBranchRequest(routing::TaskId task_id, const DataName& data_name,
-                            const StructuredDataVersions::VersionName& branch_tip);
+                            const StructuredDataVersions::VersionName& branch_tip,
+                            const std::chrono::steady_clock::duration& timeout,
+                            Priority priority = Priority::kNormal);
+
+  // 'data_names' must be non-empty and share a close group; the request goes to the first's.
+  void SendGetVersionsBatchRequest(routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+                                   const std::chrono::steady_clock::duration& timeout,
+                                   Priority priority = Priority::kNormal);
 
   template <typename DataName>
   void SendPutVersionRequest(routing::TaskId task_id, const DataName& data_name,
                              const StructuredDataVersions::VersionName& old_version_name,
-                             const StructuredDataVersions::VersionName& new_version_name);
+                             const StructuredDataVersions::VersionName& new_version_name,
+                             const std::chrono::steady_clock::duration& timeout,
+                             Priority priority = Priority::kNormal);
 
   template <typename DataName>
-  void SendDeleteBranchUntilForkRequest(const DataName& data_name,
-                                        const StructuredDataVersions::VersionName& branch_tip);
+  void SendDeleteBranchUntilForkRequest(routing::TaskId task_id, const DataName& data_name,
+                                        const StructuredDataVersions::VersionName& branch_tip,
+                                        const std::chrono::steady_clock::duration& timeout);
 
   void SendCreateAccountRequest(routing::TaskId task_id,
-                                const nfs_vault::MaidAccountCreation& account_creation);
+                                const nfs_vault::MaidAccountCreation& account_creation,
+                                const std::chrono::steady_clock::duration& timeout);
 
   void SendRemoveAccountRequest(const nfs_vault::MaidAccountRemoval& account_removal);
 
@@ -89,12 +132,22 @@ class MaidNodeDispatcher {
   template <typename Message>
   void CheckSourcePersonaType() const;
 
+  // Hands the message to congestion_control_ once readiness_gate_ is open, which then sends it once
+  // the window for 'receiver' has room.
+  template <typename NfsMessage>
+  void RoutingSend(const NfsMessage& nfs_message, const typename NfsMessage::Receiver& receiver,
+                   const std::chrono::steady_clock::duration& timeout, Priority priority);
+
   template <typename RoutingMessage>
   void RoutingSend(const RoutingMessage& routing_message);
 
-  bool running_;
-  std::mutex running_mutex_;
-  routing::Routing& routing_;
+  // Lets sends run concurrently while still letting Stop wait for those in progress.
+  ShutdownGate send_gate_;
+  // Set only when constructed from a routing::Routing, which it then wraps.
+  std::unique_ptr<ClientRouting> owned_routing_;
+  ClientRouting& routing_;
+  CongestionControl& congestion_control_;
+  ReadinessGate& readiness_gate_;
   const routing::SingleSource kThisNodeAsSender_;
   const routing::GroupId kMaidManagerReceiver_;
 };
@@ -102,94 +155,91 @@ class MaidNodeDispatcher {
 // ==================== Implementation =============================================================
 
 template <typename Data>
-void MaidNodeDispatcher::SendPutRequest(routing::TaskId task_id, const Data& data) {
-  LOG(kVerbose) << "MaidNodeDispatcher::SendPutRequest for chunk "
-                << HexSubstr(data.name().value.string());
+void MaidNodeDispatcher::SendPutRequest(routing::TaskId task_id, const Data& data,
+                                        const std::chrono::steady_clock::duration& timeout,
+                                        Priority priority) {
+  NFS_VERBOSE_LOG << "MaidNodeDispatcher::SendPutRequest for chunk "
+                  << HexSubstr(data.name().value.string());
   typedef nfs::PutRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
   NfsMessage::Contents contents;
   contents = nfs_vault::DataNameAndContent(data);
   NfsMessage nfs_message(nfs::MessageId(task_id), contents);
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, priority);
 }
 
 template <typename DataName>
-void MaidNodeDispatcher::SendDeleteRequest(const DataName& data_name) {
+void MaidNodeDispatcher::SendDeleteRequest(routing::TaskId task_id, const DataName& data_name,
+                                           const std::chrono::steady_clock::duration& timeout,
+                                           Priority priority) {
   typedef nfs::DeleteRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
-  NfsMessage nfs_message((NfsMessage::Contents(data_name)));
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  NfsMessage nfs_message(nfs::MessageId(task_id), NfsMessage::Contents(data_name));
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, priority);
 }
 
 template <typename DataName>
 void MaidNodeDispatcher::SendGetVersionsRequest(routing::TaskId task_id,
-                                                const DataName& data_name) {
+                                                const DataName& data_name,
+                                                const std::chrono::steady_clock::duration& timeout,
+                                                Priority priority) {
   typedef nfs::GetVersionsRequestFromMaidNodeToVersionHandler NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
   nfs::MessageId message_id(task_id);
   NfsMessage::Contents content(data_name);
   NfsMessage nfs_message(message_id, content);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver));
+  RoutingSend(nfs_message, receiver, timeout, priority);
 }
 
 template <typename DataName>
 void MaidNodeDispatcher::SendGetBranchRequest(
     routing::TaskId task_id, const DataName& data_name,
-    const StructuredDataVersions::VersionName& branch_tip) {
+    const StructuredDataVersions::VersionName& branch_tip,
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
   typedef nfs::GetBranchRequestFromMaidNodeToVersionHandler NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
   NfsMessage::Contents contents(data_name, branch_tip);
   NfsMessage nfs_message(nfs::MessageId(task_id), contents);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver));
+  RoutingSend(nfs_message, receiver, timeout, priority);
 }
 
 template <typename DataName>
 void MaidNodeDispatcher::SendCreateVersionTreeRequest(
     routing::TaskId task_id, const DataName& data_name,
     const StructuredDataVersions::VersionName& version_name, uint32_t max_versions,
-    uint32_t max_branches) {
+    uint32_t max_branches, const std::chrono::steady_clock::duration& timeout) {
   typedef nfs::CreateVersionTreeRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
   NfsMessage::Contents contents(data_name, version_name, max_versions, max_branches);
   NfsMessage nfs_message(nfs::MessageId(task_id), contents);
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, Priority::kNormal);
 }
 
 template <typename DataName>
 void MaidNodeDispatcher::SendPutVersionRequest(routing::TaskId task_id,
     const DataName& data_name,
     const StructuredDataVersions::VersionName& old_version_name,
-    const StructuredDataVersions::VersionName& new_version_name) {
+    const StructuredDataVersions::VersionName& new_version_name,
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
   typedef nfs::PutVersionRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
   NfsMessage nfs_message(nfs::MessageId(task_id),
                          NfsMessage::Contents(data_name, old_version_name, new_version_name));
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, priority);
 }
 
 template <typename DataName>
 void MaidNodeDispatcher::SendDeleteBranchUntilForkRequest(
-    const DataName& data_name, const StructuredDataVersions::VersionName& branch_tip) {
+    routing::TaskId task_id, const DataName& data_name,
+    const StructuredDataVersions::VersionName& branch_tip,
+    const std::chrono::steady_clock::duration& timeout) {
   typedef nfs::DeleteBranchUntilForkRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
   NfsMessage::Contents contents(data_name, branch_tip);
-  NfsMessage nfs_message(contents);
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  NfsMessage nfs_message(nfs::MessageId(task_id), contents);
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, Priority::kNormal);
 }
 
 template <typename Message>
@@ -198,13 +248,30 @@ void MaidNodeDispatcher::CheckSourcePersonaType() const {
                 "The source Persona must be kMaidNode.");
 }
 
+template <typename NfsMessage>
+void MaidNodeDispatcher::RoutingSend(const NfsMessage& nfs_message,
+                                     const typename NfsMessage::Receiver& receiver,
+                                     const std::chrono::steady_clock::duration& timeout,
+                                     Priority priority) {
+  typedef routing::Message<typename NfsMessage::Sender, typename NfsMessage::Receiver>
+      RoutingMessage;
+  RoutingMessage routing_message(nfs_message.Serialise(), kThisNodeAsSender_, receiver);
+  const nfs::MessageId message_id(nfs_message.id);
+  // Held requests don't enter the congestion window until sent, so aren't mistaken for lost ones.
+  readiness_gate_.Run([this, routing_message, message_id, timeout, priority] {
+    congestion_control_.Send(routing_message.receiver.data, NfsMessage::kAction, message_id,
+                             priority, timeout,
+                             [this, routing_message] { RoutingSend(routing_message); });
+  });
+}
+
 template <typename RoutingMessage>
 void MaidNodeDispatcher::RoutingSend(const RoutingMessage& routing_message) {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  if (!running_) {
+  if (!send_gate_.Enter()) {
     LOG(kWarning) << " Shutting down. Send ignored !";
     return;
   }
+  on_scope_exit leave_gate([this] { send_gate_.Leave(); });
   routing_.Send(routing_message);
 }
 
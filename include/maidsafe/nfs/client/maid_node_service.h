@@ -23,6 +23,7 @@
 #include "maidsafe/routing/timer.h"
 
 #include "maidsafe/nfs/message_types.h"
+#include "maidsafe/nfs/client/congestion_control.h"
 #include "maidsafe/nfs/client/messages.h"
 #include "maidsafe/nfs/vault/messages.h"
 
@@ -42,10 +43,19 @@ class MaidNodeService {
   typedef nfs::PutResponseFromMaidManagerToMaidNode PutResponse;
   typedef nfs::PutFailureFromMaidManagerToMaidNode PutFailure;
   typedef nfs::GetVersionsResponseFromVersionHandlerToMaidNode GetVersionsResponse;
+  typedef nfs::GetVersionsBatchResponseFromVersionHandlerToMaidNode GetVersionsBatchResponse;
   typedef nfs::PutVersionResponseFromMaidManagerToMaidNode PutVersionResponse;
   typedef nfs::GetBranchResponseFromVersionHandlerToMaidNode GetBranchResponse;
   typedef nfs::CreateAccountResponseFromMaidManagerToMaidNode CreateAccountResponse;
   typedef nfs::CreateVersionTreeResponseFromMaidManagerToMaidNode CreateVersionTreeResponse;
+  typedef nfs::DeleteResponseFromMaidManagerToMaidNode DeleteResponse;
+  typedef nfs::DeleteBranchUntilForkResponseFromMaidManagerToMaidNode
+      DeleteBranchUntilForkResponse;
+  typedef nfs::DeleteBatchResponseFromMaidManagerToMaidNode DeleteBatchResponse;
+  typedef nfs::IncrementReferenceCountsResponseFromMaidManagerToMaidNode
+      IncrementReferenceCountsResponse;
+  typedef nfs::DecrementReferenceCountsResponseFromMaidManagerToMaidNode
+      DecrementReferenceCountsResponse;
 
   struct RpcTimers {
     explicit RpcTimers(BoostAsioService& asio_service_);
@@ -53,13 +63,20 @@ class MaidNodeService {
 
     routing::Timer<PutResponse::Contents> put_timer;
     routing::Timer<GetVersionsResponse::Contents> get_versions_timer;
+    routing::Timer<GetVersionsBatchResponse::Contents> get_versions_batch_timer;
     routing::Timer<GetBranchResponse::Contents> get_branch_timer;
     routing::Timer<CreateAccountResponse::Contents> create_account_timer;
     routing::Timer<CreateVersionTreeResponse::Contents> create_version_tree_timer;
     routing::Timer<PutVersionResponse::Contents> put_version_timer;
+    routing::Timer<DeleteResponse::Contents> delete_timer;
+    routing::Timer<DeleteBranchUntilForkResponse::Contents> delete_branch_until_fork_timer;
+    routing::Timer<DeleteBatchResponse::Contents> delete_batch_timer;
+    routing::Timer<IncrementReferenceCountsResponse::Contents> increment_reference_counts_timer;
+    routing::Timer<DecrementReferenceCountsResponse::Contents> decrement_reference_counts_timer;
   };
 
-  MaidNodeService(const routing::SingleId& receiver, RpcTimers& rpc_timers);
+  MaidNodeService(const routing::SingleId& receiver, RpcTimers& rpc_timers,
+                  CongestionControl& congestion_control);
 
   void HandleMessage(const PutResponse& message, const PutResponse::Sender& sender,
                      const PutResponse::Receiver& receiver);
@@ -70,6 +87,10 @@ class MaidNodeService {
   void HandleMessage(const GetVersionsResponse& message, const GetVersionsResponse::Sender& sender,
                      const GetVersionsResponse::Receiver& receiver);
 
+  void HandleMessage(const GetVersionsBatchResponse& message,
+                     const GetVersionsBatchResponse::Sender& sender,
+                     const GetVersionsBatchResponse::Receiver& receiver);
+
   void HandleMessage(const PutVersionResponse& message, const PutVersionResponse::Sender& sender,
                      const PutVersionResponse::Receiver& receiver);
 
@@ -84,6 +105,25 @@ class MaidNodeService {
                      const CreateVersionTreeResponse::Sender& sender,
                      const CreateVersionTreeResponse::Receiver& receiver);
 
+  void HandleMessage(const DeleteResponse& message, const DeleteResponse::Sender& sender,
+                     const DeleteResponse::Receiver& receiver);
+
+  void HandleMessage(const DeleteBranchUntilForkResponse& message,
+                     const DeleteBranchUntilForkResponse::Sender& sender,
+                     const DeleteBranchUntilForkResponse::Receiver& receiver);
+
+  void HandleMessage(const DeleteBatchResponse& message,
+                     const DeleteBatchResponse::Sender& sender,
+                     const DeleteBatchResponse::Receiver& receiver);
+
+  void HandleMessage(const IncrementReferenceCountsResponse& message,
+                     const IncrementReferenceCountsResponse::Sender& sender,
+                     const IncrementReferenceCountsResponse::Receiver& receiver);
+
+  void HandleMessage(const DecrementReferenceCountsResponse& message,
+                     const DecrementReferenceCountsResponse::Sender& sender,
+                     const DecrementReferenceCountsResponse::Receiver& receiver);
+
  private:
   template <typename Data>
   void HandlePutResponse(const nfs::PutRequestFromMaidNodeToMaidManager& message,
@@ -91,6 +131,7 @@ class MaidNodeService {
 
   const routing::SingleId kReceiver_;
   RpcTimers& rpc_timers_;
+  CongestionControl& congestion_control_;
 };
 
 }  // namespace nfs_client
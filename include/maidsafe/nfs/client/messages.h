@@ -157,6 +157,27 @@ struct DataNamesAndReturnCode {
 bool operator==(const DataNamesAndReturnCode& lhs, const DataNamesAndReturnCode& rhs);
 void swap(DataNamesAndReturnCode& lhs, DataNamesAndReturnCode& rhs) MAIDSAFE_NOEXCEPT;
 
+// ==================== DataNamesAndReturnCodes ====================================================
+// Response to a batched request.  'return_code' reports whether the batch as a whole was handled,
+// while each entry of 'results' carries the outcome for an individual name.
+struct DataNamesAndReturnCodes {
+  DataNamesAndReturnCodes();
+  explicit DataNamesAndReturnCodes(const ReturnCode& code);
+  DataNamesAndReturnCodes(std::vector<DataNameAndReturnCode> results_in, const ReturnCode& code);
+  DataNamesAndReturnCodes(const DataNamesAndReturnCodes& other);
+  DataNamesAndReturnCodes(DataNamesAndReturnCodes&& other);
+  DataNamesAndReturnCodes& operator=(DataNamesAndReturnCodes other);
+
+  explicit DataNamesAndReturnCodes(const std::string& serialised_copy);
+  std::string Serialise() const;
+
+  std::vector<DataNameAndReturnCode> results;
+  ReturnCode return_code;
+};
+
+bool operator==(const DataNamesAndReturnCodes& lhs, const DataNamesAndReturnCodes& rhs);
+void swap(DataNamesAndReturnCodes& lhs, DataNamesAndReturnCodes& rhs) MAIDSAFE_NOEXCEPT;
+
 // ==================== DataNameVersionAndReturnCode ===============================================
 struct DataNameVersionAndReturnCode {
   DataNameVersionAndReturnCode();
@@ -263,6 +284,34 @@ bool operator==(const StructuredDataNameAndContentOrReturnCode& lhs,
 void swap(StructuredDataNameAndContentOrReturnCode& lhs,
           StructuredDataNameAndContentOrReturnCode& rhs) MAIDSAFE_NOEXCEPT;
 
+// ==================== StructuredDataNamesAndContentsOrReturnCodes ================================
+// Response to a batched GetVersions.  'return_code' reports whether the batch as a whole was
+// handled, while each entry of 'results' pairs a name with its versions or the error for it.
+struct StructuredDataNamesAndContentsOrReturnCodes {
+  typedef std::pair<nfs_vault::DataName, StructuredDataNameAndContentOrReturnCode> Result;
+
+  StructuredDataNamesAndContentsOrReturnCodes();
+  explicit StructuredDataNamesAndContentsOrReturnCodes(const ReturnCode& code);
+  StructuredDataNamesAndContentsOrReturnCodes(std::vector<Result> results_in,
+                                              const ReturnCode& code);
+  StructuredDataNamesAndContentsOrReturnCodes(
+      const StructuredDataNamesAndContentsOrReturnCodes& other);
+  StructuredDataNamesAndContentsOrReturnCodes(StructuredDataNamesAndContentsOrReturnCodes&& other);
+  StructuredDataNamesAndContentsOrReturnCodes& operator=(
+      StructuredDataNamesAndContentsOrReturnCodes other);
+
+  explicit StructuredDataNamesAndContentsOrReturnCodes(const std::string& serialised_copy);
+  std::string Serialise() const;
+
+  std::vector<Result> results;
+  ReturnCode return_code;
+};
+
+bool operator==(const StructuredDataNamesAndContentsOrReturnCodes& lhs,
+                const StructuredDataNamesAndContentsOrReturnCodes& rhs);
+void swap(StructuredDataNamesAndContentsOrReturnCodes& lhs,
+          StructuredDataNamesAndContentsOrReturnCodes& rhs) MAIDSAFE_NOEXCEPT;
+
 // =============================== TipOfTreeAndReturnCode =======================================
 struct TipOfTreeAndReturnCode {
   TipOfTreeAndReturnCode();
@@ -23,6 +23,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/signals2/signal.hpp"
@@ -47,10 +48,13 @@
 #include "maidsafe/nfs/message_wrapper.h"
 #include "maidsafe/nfs/service.h"
 #include "maidsafe/nfs/utils.h"
+#include "maidsafe/nfs/client/client_routing.h"
 #include "maidsafe/nfs/client/client_utils.h"
 #include "maidsafe/nfs/client/mpid_node_dispatcher.h"
 #include "maidsafe/nfs/client/mpid_node_service.h"
 #include "maidsafe/nfs/client/get_handler.h"
+#include "maidsafe/nfs/client/readiness_gate.h"
+#include "maidsafe/nfs/client/slab_future.h"
 
 namespace maidsafe {
 
@@ -60,10 +64,39 @@ class MpidClient : public std::enable_shared_from_this<MpidClient>  {
  public:
   typedef boost::signals2::signal<void(int32_t)> OnNetworkHealthChange;
 
+  // In each of the factory functions below, 'asio_service' runs response handling and timers.  It
+  // may be shared by several clients; if null, the client creates its own with
+  // kDefaultClientThreadCount threads.  'completion_service' is where the returned futures are
+  // resolved; see MaidClient::MakeShared.
+  //
   // Logging in for already existing mpid accounts
-  static std::shared_ptr<MpidClient> MakeShared(const passport::Mpid& mpid);
+  static std::shared_ptr<MpidClient> MakeShared(
+      const passport::Mpid& mpid, std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
   // Creates mpid account and logs in. Throws on failure to create account.
-  static std::shared_ptr<MpidClient> MakeShared(const passport::MpidAndSigner& mpid_and_signer);
+  static std::shared_ptr<MpidClient> MakeShared(
+      const passport::MpidAndSigner& mpid_and_signer,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  // As MakeShared, but returning as soon as joining the network has started; the future and the
+  // requests made before it is ready behave as for MaidClient::MakeSharedAsync.
+  static std::pair<std::shared_ptr<MpidClient>, boost::future<void>> MakeSharedAsync(
+      const passport::Mpid& mpid, int ready_health = kDefaultReadyNetworkHealth,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  static std::pair<std::shared_ptr<MpidClient>, boost::future<void>> MakeSharedAsync(
+      const passport::MpidAndSigner& mpid_and_signer, int ready_health = kDefaultReadyNetworkHealth,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  // As MakeShared, but connecting through 'routing'; see MaidClient::MakeSharedWithRouting.
+  static std::shared_ptr<MpidClient> MakeSharedWithRouting(
+      const passport::Mpid& mpid, std::unique_ptr<ClientRouting> routing,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
+  static std::shared_ptr<MpidClient> MakeSharedWithRouting(
+      const passport::MpidAndSigner& mpid_and_signer, std::unique_ptr<ClientRouting> routing,
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr);
   // Disconnects from network and all unfinished tasks will be cancelled
 
   MpidClient(const MpidClient&) = delete;
@@ -77,6 +110,11 @@ class MpidClient : public std::enable_shared_from_this<MpidClient>  {
   boost::future<void> SendMessage(const nfs_vault::MpidMessage& mpid_message,
       const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360));
 
+  // Resolved through a slab owned by the client; see MaidClient::Put(Data, SlabFutureTag).
+  SlabFuture<void> SendMessage(
+      const nfs_vault::MpidMessage& mpid_message, SlabFutureTag,
+      const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(360));
+
   void DeleteMessage(const nfs_vault::MpidMessageAlert& mpid_message_alert);
 
   boost::future<typename nfs_vault::MpidMessage> GetMessage(
@@ -95,17 +133,27 @@ class MpidClient : public std::enable_shared_from_this<MpidClient>  {
       const std::chrono::steady_clock::duration& timeout = std::chrono::seconds(120));
 
  private:
-  explicit MpidClient(const passport::Mpid& mpid);
+  typedef OperationSlab<void, ReturnCode> ReturnCodeSlab;
+
+  // Connects to the live network if 'routing' is null.
+  MpidClient(const passport::Mpid& mpid, std::shared_ptr<BoostAsioService> asio_service,
+             std::shared_ptr<BoostAsioService> completion_service,
+             std::unique_ptr<ClientRouting> routing = nullptr);
 
   void Init(const passport::MpidAndSigner& mpid_and_signer);
   void Init();
+  boost::future<void> InitAsync(int ready_health);
   void InitRouting();
+  void JoinRouting();
 
   void CreateAccount(const passport::PublicMpid& public_mpid,
                      const passport::PublicAnmpid& public_anmpid);
 
   routing::Functors InitialiseRoutingCallbacks();
   void OnNetworkStatusChange(int updated_network_health);
+  // Opens readiness_gate_ once the network health reaches ready_health_, or closes it if joining
+  // has failed first.
+  void UpdateReadiness();
 
   template <typename T>
   void OnMessageReceived(const T& routing_message);
@@ -114,13 +162,18 @@ class MpidClient : public std::enable_shared_from_this<MpidClient>  {
   void HandleMessage(const T& routing_message);
 
   const passport::Mpid kMpid_;
-  BoostAsioService asio_service_;
+  const bool kOwnsAsioService_, kOwnsCompletionService_;
+  std::shared_ptr<BoostAsioService> asio_service_, completion_service_;
+  // Declared before rpc_timers_, whose tasks refer to it.
+  ReturnCodeSlab return_code_slab_;
   MpidNodeService::RpcTimers rpc_timers_;
   std::mutex network_health_mutex_;
   std::condition_variable network_health_condition_variable_;
-  int network_health_;
+  int network_health_, ready_health_;
+  boost::promise<void> ready_promise_;
+  ReadinessGate readiness_gate_;
   OnNetworkHealthChange network_health_change_signal_;
-  std::unique_ptr<routing::Routing> routing_;
+  std::unique_ptr<ClientRouting> routing_;
   nfs::detail::PublicPmidHelper public_pmid_helper_;
   MpidNodeDispatcher dispatcher_;
   GetHandler<MpidNodeDispatcher> get_handler_;
@@ -134,14 +187,21 @@ boost::future<typename DataName::data_type> MpidClient::Get(
     const DataName& data_name,
     const std::chrono::steady_clock::duration& timeout) {
   auto promise(std::make_shared<boost::promise<typename DataName::data_type>>());
-  get_handler_.Get(data_name, promise, timeout);
+  if (readiness_gate_.IsOpen()) {
+    get_handler_.Get(data_name, promise, timeout);
+    return promise->get_future();
+  }
+  const auto deadline(std::chrono::steady_clock::now() + timeout);
+  readiness_gate_.Run([this, promise, data_name, deadline] {
+    get_handler_.Get(data_name, promise, TimeRemaining(deadline));
+  });
   return promise->get_future();
 }
 
 template <typename T>
 void MpidClient::OnMessageReceived(const T& routing_message) {
   std::shared_ptr<MpidClient> this_ptr(shared_from_this());
-  asio_service_.service().post([=] {
+  asio_service_->service().post([=] {
       this_ptr->HandleMessage(routing_message);
   });
 }
@@ -19,9 +19,12 @@
 #ifndef MAIDSAFE_NFS_CLIENT_MPID_NODE_DISPATCHER_H_
 #define MAIDSAFE_NFS_CLIENT_MPID_NODE_DISPATCHER_H_
 
+#include <chrono>
+#include <memory>
 #include <string>
 
 #include "maidsafe/common/error.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/data_types/data_type_values.h"
 #include "maidsafe/common/data_types/structured_data_versions.h"
@@ -32,7 +35,10 @@
 
 #include "maidsafe/nfs/message_types.h"
 #include "maidsafe/nfs/types.h"
+#include "maidsafe/nfs/client/client_routing.h"
 #include "maidsafe/nfs/client/messages.h"
+#include "maidsafe/nfs/client/readiness_gate.h"
+#include "maidsafe/nfs/client/shutdown_gate.h"
 #include "maidsafe/nfs/vault/messages.h"
 
 namespace maidsafe {
@@ -41,7 +47,11 @@ namespace nfs_client {
 
 class MpidNodeDispatcher {
  public:
-  explicit MpidNodeDispatcher(routing::Routing& routing);
+  // Requests other than Gets are held by 'readiness_gate' until it opens.  Gets are sent straight
+  // away, since joining the network may depend on them; MpidClient::Get holds its own.
+  MpidNodeDispatcher(ClientRouting& routing, ReadinessGate& readiness_gate);
+  // As above, sending through 'routing' (which must outlive this) wrapped in a NetworkRouting.
+  MpidNodeDispatcher(routing::Routing& routing, ReadinessGate& readiness_gate);
 
   MpidNodeDispatcher() = delete;
   MpidNodeDispatcher(const MpidNodeDispatcher&) = delete;
@@ -60,19 +70,28 @@ class MpidNodeDispatcher {
 
   void SendRemoveAccountRequest(const nfs_vault::MpidAccountRemoval& account_removal);
 
+  // 'timeout' is unused, as MpidNode requests don't go through congestion control.
   template <typename DataName>
-  void SendGetRequest(routing::TaskId task_id, const DataName& data_name);
+  void SendGetRequest(routing::TaskId task_id, const DataName& data_name,
+                      const std::chrono::steady_clock::duration& timeout);
 
  private:
   template <typename Message>
   void CheckSourcePersonaType() const;
 
+  // Sends the message once readiness_gate_ is open.
   template <typename RoutingMessage>
   void RoutingSend(const RoutingMessage& routing_message);
 
-  bool running_;
-  std::mutex running_mutex_;
-  routing::Routing& routing_;
+  template <typename RoutingMessage>
+  void RoutingSendNow(const RoutingMessage& routing_message);
+
+  // Lets sends run concurrently while still letting Stop wait for those in progress.
+  ShutdownGate send_gate_;
+  // Set only when constructed from a routing::Routing, which it then wraps.
+  std::unique_ptr<ClientRouting> owned_routing_;
+  ClientRouting& routing_;
+  ReadinessGate& readiness_gate_;
   const routing::SingleSource kThisNodeAsSender_;
   const routing::GroupId kMpidManagerReceiver_;
 };
@@ -80,7 +99,8 @@ class MpidNodeDispatcher {
 // ==================== Implementation =============================================================
 
 template <typename DataName>
-void MpidNodeDispatcher::SendGetRequest(routing::TaskId task_id, const DataName& data_name) {
+void MpidNodeDispatcher::SendGetRequest(routing::TaskId task_id, const DataName& data_name,
+                                        const std::chrono::steady_clock::duration& /*timeout*/) {
   typedef nfs::GetRequestFromMpidNodeToDataManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
   typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
@@ -91,7 +111,7 @@ void MpidNodeDispatcher::SendGetRequest(routing::TaskId task_id, const DataName&
   NfsMessage nfs_message(message_id, content);
   NfsMessage::Receiver receiver(routing::GroupId(NodeId(data_name->string())));
   RoutingMessage routing_message(nfs_message.Serialise(), kThisNodeAsSender_, receiver, kCacheable);
-  RoutingSend(routing_message);
+  RoutingSendNow(routing_message);
 }
 
 template <typename Message>
@@ -102,11 +122,16 @@ void MpidNodeDispatcher::CheckSourcePersonaType() const {
 
 template <typename RoutingMessage>
 void MpidNodeDispatcher::RoutingSend(const RoutingMessage& routing_message) {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  if (!running_) {
+  readiness_gate_.Run([this, routing_message] { RoutingSendNow(routing_message); });
+}
+
+template <typename RoutingMessage>
+void MpidNodeDispatcher::RoutingSendNow(const RoutingMessage& routing_message) {
+  if (!send_gate_.Enter()) {
     LOG(kWarning) << " Shutting down. Send ignored !";
     return;
   }
+  on_scope_exit leave_gate([this] { send_gate_.Leave(); });
   routing_.Send(routing_message);
 }
 
@@ -0,0 +1,84 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_READINESS_GATE_H_
+#define MAIDSAFE_NFS_CLIENT_READINESS_GATE_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// Holds requests made while a client is still joining the network, and runs them in the order
+// they were made once it is ready.  Once open, Run costs a single atomic load on top of the call.
+class ReadinessGate {
+ public:
+  typedef std::function<void()> Functor;
+
+  ReadinessGate();
+
+  // Runs 'functor' immediately if the gate is open, holds it if not yet open and drops it if
+  // closed.
+  template <typename F>
+  void Run(F functor);
+
+  // Runs the held functors, then lets later ones straight through.  Returns true if this call
+  // opened the gate.
+  bool Open();
+
+  // Drops the held functors, as well as any passed to Run afterwards.  Returns true if this call
+  // closed a gate which had never been opened.
+  bool Close();
+
+  // As Close, but only if the gate has neither opened nor closed yet, i.e. for a failure to become
+  // ready.  A gate once open stays open, whatever happens to the network afterwards.
+  bool CloseIfHolding();
+
+  bool IsOpen() const;
+
+ private:
+  enum class State { kHolding, kDraining, kOpen, kClosed };
+
+  ReadinessGate(const ReadinessGate&);
+  ReadinessGate(ReadinessGate&&);
+  ReadinessGate& operator=(ReadinessGate);
+
+  // Returns false if the gate has opened since Run checked, in which case the caller runs 'functor'
+  // itself.
+  bool Hold(Functor functor);
+
+  std::atomic<State> state_;
+  std::mutex mutex_;
+  std::deque<Functor> held_;
+};
+
+template <typename F>
+void ReadinessGate::Run(F functor) {
+  if (state_.load() == State::kOpen || !Hold(functor))
+    functor();
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_READINESS_GATE_H_
@@ -0,0 +1,64 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_SHUTDOWN_GATE_H_
+#define MAIDSAFE_NFS_CLIENT_SHUTDOWN_GATE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// Lets any number of threads run an operation concurrently until the gate is closed, after which
+// Close waits for those still inside to leave.  Entering and leaving an open gate only touch a
+// single atomic counter; the mutex is used solely to wake a waiting Close.
+class ShutdownGate {
+ public:
+  ShutdownGate();
+
+  // Returns false if the gate has been closed.  Otherwise the caller is inside the gate and must
+  // call Leave once done.
+  bool Enter();
+  void Leave();
+
+  // Refuses all further entries and blocks until every caller inside the gate has left.  Must not
+  // be called from inside the gate.
+  void Close();
+
+ private:
+  ShutdownGate(const ShutdownGate&);
+  ShutdownGate(ShutdownGate&&);
+  ShutdownGate& operator=(ShutdownGate);
+
+  // The top bit of state_ is set once closed; the remaining bits count the callers inside.
+  static const uint32_t kClosed_;
+
+  std::atomic<uint32_t> state_;
+  std::mutex mutex_;
+  std::condition_variable drained_;
+};
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_SHUTDOWN_GATE_H_
@@ -0,0 +1,227 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_SIMULATED_NETWORK_H_
+#define MAIDSAFE_NFS_CLIENT_SIMULATED_NETWORK_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/structured_data_versions.h"
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/routing_api.h"
+
+#include "maidsafe/nfs/message_wrapper.h"
+#include "maidsafe/nfs/client/client_routing.h"
+#include "maidsafe/nfs/client/messages.h"
+#include "maidsafe/nfs/vault/messages.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// An in-process stand-in for the network, so that clients can be run offline: thousands of them
+// in one process for scale tests and benchmarks, without vaults.  Each client is given its own
+// ClientRouting by MakeRouting, for MaidClient::MakeSharedWithRouting and the like.
+//
+// The vault personas the clients talk to (MaidManager, DataManager, VersionHandler and
+// MpidManager) are simulated over shared in-memory state, rather than by running vaults.  Every
+// request is answered once by each of the routing::Parameters::group_size simulated vaults closest
+// to its destination, as on the real network, and each message (request or response) is delayed
+// by a random latency and may be lost.  Churn replaces some of the vaults from time to time: a
+// response from a vault which has left by the time it would arrive is lost, and requests which
+// follow go to the new close group.  The stored state itself survives churn, as the network's
+// re-replication would ensure.
+//
+// Must outlive every ClientRouting it makes.
+class SimulatedNetwork {
+ public:
+  struct Config {
+    Config();
+    // Simulated vaults; at least routing::Parameters::group_size.
+    size_t vault_count;
+    // Each message is delayed by a latency drawn uniformly from [min_latency, max_latency].
+    std::chrono::steady_clock::duration min_latency, max_latency;
+    // The probability of each message being lost, in [0, 1].
+    double loss_rate;
+    // Every 'churn_interval', 'churn_fraction' of the vaults leave and as many new ones join.  A
+    // zero interval disables churn (though Churn can still be called).
+    std::chrono::steady_clock::duration churn_interval;
+    double churn_fraction;
+    // Threads delivering messages.
+    uint32_t thread_count;
+    // For the latencies, losses and vault IDs, so that runs can be repeated.
+    uint32_t seed;
+  };
+
+  struct Stats {
+    Stats()
+        : requests(0), responses(0), lost(0), lost_to_churn(0), undeliverable(0),
+          churn_events(0) {}
+    uint64_t requests;
+    uint64_t responses;
+    // Messages dropped under 'loss_rate'.
+    uint64_t lost;
+    // Responses whose vault left the network before they arrived.
+    uint64_t lost_to_churn;
+    // Responses for clients no longer connected.
+    uint64_t undeliverable;
+    uint64_t churn_events;
+  };
+
+  // The MpidMessageAlert which the receiver of 'mpid_message' is sent when it's stored, and which
+  // retrieves it.
+  static nfs_vault::MpidMessageAlert AlertFor(const nfs_vault::MpidMessage& mpid_message);
+
+  // Throws invalid_parameter if 'config' is inconsistent.
+  explicit SimulatedNetwork(const Config& config = Config());
+  ~SimulatedNetwork();
+
+  // A connection for the client with 'node_id', which is usually the name of its Maid or Mpid.  It
+  // reports the current close group of any ID (see ClientRouting::CloseGroup).  Throws
+  // invalid_parameter if a client with that ID is already connected.
+  std::unique_ptr<nfs_client::ClientRouting> MakeRouting(const NodeId& node_id);
+  template <typename Fob>
+  std::unique_ptr<nfs_client::ClientRouting> MakeRouting(const Fob& fob) {
+    return MakeRouting(NodeId(fob.name()->string()));
+  }
+
+  // Replaces 'count' of the vaults with new ones.
+  void Churn(size_t count);
+  // Stops delivering messages; any still in flight are lost.
+  void Stop();
+  // Reports 'network_health' to the client with 'node_id', as its routing would, if it has joined.
+  void ReportNetworkHealth(const NodeId& node_id, int network_health);
+
+  Stats GetStats() const;
+  size_t connected_clients() const;
+
+ private:
+  class Endpoint;
+
+  // A response for 'receiver', to be sent by each vault in the close group of 'group'.
+  struct Reply {
+    Reply(const routing::GroupId& group_in, const routing::SingleId& receiver_in,
+          std::string contents_in)
+        : group(group_in), receiver(receiver_in), contents(std::move(contents_in)) {}
+    routing::GroupId group;
+    routing::SingleId receiver;
+    std::string contents;
+  };
+
+  struct Chunk {
+    Chunk() : content(), reference_count(0) {}
+    NonEmptyString content;
+    int reference_count;
+  };
+
+  struct ChunkShard {
+    ChunkShard() : mutex(), chunks() {}
+    std::mutex mutex;
+    std::map<nfs_vault::DataName, Chunk> chunks;
+  };
+
+  static const size_t kChunkShardCount = 64;
+
+  SimulatedNetwork(const SimulatedNetwork&);
+  SimulatedNetwork(SimulatedNetwork&&);
+  SimulatedNetwork& operator=(SimulatedNetwork);
+
+  void Register(const NodeId& node_id);
+  void Unregister(const NodeId& node_id);
+  void Join(const NodeId& node_id, const routing::Functors& functors);
+  void Send(const routing::SingleToGroupMessage& message);
+
+  void HandleRequest(const routing::SingleToGroupMessage& message);
+  std::vector<Reply> HandleMaidManager(const TypeErasedMessageWrapper& wrapper,
+                                       const routing::SingleToGroupMessage& message);
+  std::vector<Reply> HandleDataManager(const TypeErasedMessageWrapper& wrapper,
+                                       const routing::SingleToGroupMessage& message);
+  std::vector<Reply> HandleVersionHandler(const TypeErasedMessageWrapper& wrapper,
+                                          const routing::SingleToGroupMessage& message);
+  std::vector<Reply> HandleMpidManager(const TypeErasedMessageWrapper& wrapper,
+                                       const routing::SingleToGroupMessage& message);
+  void Respond(const Reply& reply);
+  void Deliver(const NodeId& vault, const Reply& reply);
+
+  // The vaults currently closest to 'target'.
+  std::vector<NodeId> CloseGroup(const NodeId& target) const;
+  bool IsVault(const NodeId& vault) const;
+  NodeId NewVaultId();
+  // Runs 'functor' on the delivery threads after a random latency.
+  void After(const std::function<void()>& functor);
+  bool Lost();
+  void ArmChurnTimer();
+
+  bool HasMaidAccount(const NodeId& maid) const;
+  ChunkShard& GetChunkShard(const nfs_vault::DataName& name);
+  nfs_client::ReturnCode PutChunk(const nfs_vault::DataNameAndContent& data);
+  nfs_client::ReturnCode ChangeReferenceCount(const nfs_vault::DataName& name, int change);
+  nfs_client::DataNamesAndReturnCodes ChangeReferenceCounts(const nfs_vault::DataNames& names,
+                                                            int change);
+  nfs_client::DataNameAndContentOrReturnCode GetChunk(const nfs_vault::DataName& name);
+  // Runs 'operation' on the version tree for 'name', returning the error it throws, if any.
+  nfs_client::ReturnCode OnVersions(
+      const nfs_vault::DataName& name,
+      const std::function<void(StructuredDataVersions& versions)>& operation);
+
+  const Config kConfig_;
+  mutable std::mutex random_mutex_;
+  std::mt19937 random_;
+  mutable std::mutex vaults_mutex_;
+  std::set<NodeId> vaults_;
+  mutable std::mutex endpoints_mutex_;
+  // Functors are null until the client joins.
+  std::map<NodeId, std::shared_ptr<const routing::Functors>> endpoints_;
+  mutable std::mutex accounts_mutex_;
+  std::set<NodeId> maid_accounts_, mpid_accounts_;
+  std::array<ChunkShard, kChunkShardCount> chunk_shards_;
+  std::mutex versions_mutex_;
+  std::map<nfs_vault::DataName, std::unique_ptr<StructuredDataVersions>> versions_;
+  std::mutex mpid_messages_mutex_;
+  // Keyed by the serialised alert.
+  std::map<std::string, nfs_vault::MpidMessage> mpid_messages_;
+  std::atomic<uint64_t> requests_, responses_, lost_, lost_to_churn_, undeliverable_,
+      churn_events_;
+  std::atomic<bool> running_;
+  std::mutex churn_timer_mutex_;
+  BoostAsioService asio_service_;
+  boost::asio::steady_timer churn_timer_;
+};
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_SIMULATED_NETWORK_H_
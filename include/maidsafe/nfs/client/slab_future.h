@@ -0,0 +1,373 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_CLIENT_SLAB_FUTURE_H_
+#define MAIDSAFE_NFS_CLIENT_SLAB_FUTURE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "boost/expected/expected.hpp"
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/nfs/utils.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+// Number of operation states an OperationSlab creates up front.
+const size_t kDefaultSlabCapacity(64);
+
+// Passed to the client calls which offer it in order to receive a SlabFuture rather than a
+// boost::future.
+struct SlabFutureTag {};
+const SlabFutureTag use_slab_future = SlabFutureTag();
+
+template <typename T, typename ResponseContents>
+class OperationSlab;
+
+namespace detail {
+
+template <typename T>
+struct SlabValue {
+  typedef T type;
+  static T Get(type&& value) { return std::move(value); }
+};
+
+template <>
+struct SlabValue<void> {
+  typedef bool type;
+  static void Get(type&& /*value*/) {}
+};
+
+template <typename T>
+class SlabState {
+ public:
+  typedef boost::expected<typename SlabValue<T>::type, maidsafe_error> Result;
+
+  SlabState() : mutex(), ready(), generation(0), future_attached(false), completed(false),
+                result() {}
+  virtual ~SlabState() {}
+  // Called with 'mutex' held once neither the operation nor its future needs the state any more.
+  virtual void Recycle() = 0;
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  uint32_t generation;
+  bool future_attached, completed;
+  boost::optional<Result> result;
+
+ private:
+  SlabState(const SlabState&);
+  SlabState(SlabState&&);
+  SlabState& operator=(SlabState);
+};
+
+}  // namespace detail
+
+// Move-only counterpart of boost::future whose shared state lives in an OperationSlab.  It doesn't
+// support continuations; the thread waiting in 'get' or 'wait' is woken directly.
+template <typename T>
+class SlabFuture {
+ public:
+  SlabFuture() : state_(nullptr) {}
+  SlabFuture(SlabFuture&& other) : state_(other.state_) { other.state_ = nullptr; }
+  SlabFuture& operator=(SlabFuture&& other) {
+    if (this != &other) {
+      Detach();
+      state_ = other.state_;
+      other.state_ = nullptr;
+    }
+    return *this;
+  }
+  ~SlabFuture() { Detach(); }
+
+  bool valid() const { return state_ != nullptr; }
+  bool is_ready() const;
+  void wait() const;
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& duration) const;
+  // Blocks until the operation completes, then returns its value or throws its error.  The future
+  // is no longer valid afterwards.
+  T get();
+
+ private:
+  template <typename U, typename ResponseContents>
+  friend class OperationSlab;
+
+  explicit SlabFuture(detail::SlabState<T>* state) : state_(state) {}
+  SlabFuture(const SlabFuture&);
+  SlabFuture& operator=(const SlabFuture&);
+
+  void Detach();
+
+  detail::SlabState<T>* state_;
+};
+
+// Pool of reusable operation states, each holding what a boost::future based call spreads over a
+// separately allocated promise, OpData and callback.  A state is reused once its operation has
+// completed and its future has gone, so once warmed up, starting an operation allocates nothing
+// here.  More states are created if more than the initial capacity are in use at once.  The slab
+// must outlive every timer task given a Handle from it, and every SlabFuture still to be waited on.
+template <typename T, typename ResponseContents>
+class OperationSlab {
+ public:
+  typedef typename detail::SlabState<T>::Result Result;
+  typedef Result (*ResultFunctor)(const ResponseContents&);
+
+ private:
+  struct Slot;
+
+ public:
+  // Identifies one use of a state.  It is two words and trivially copyable, so a timer lambda which
+  // captures nothing else is stored inside its std::function rather than on the heap.
+  class Handle {
+   public:
+    Handle() : slot_(nullptr), generation_(0) {}
+
+   private:
+    friend class OperationSlab;
+    Handle(Slot* slot, uint32_t generation) : slot_(slot), generation_(generation) {}
+    Slot* slot_;
+    uint32_t generation_;
+  };
+
+  explicit OperationSlab(size_t capacity = kDefaultSlabCapacity);
+
+  // Takes a free state for an operation which, like OpData, needs 'successes_required' successful
+  // responses.  'to_result' maps the response the operation settles on to its outcome.
+  SlabFuture<T> Acquire(int successes_required, ResultFunctor to_result, Handle& handle);
+
+  // Equivalent of OpData::HandleResponseContents.  A response carrying the timer's default
+  // (timed out) contents completes the operation at once.  Responses for a state which has since
+  // completed or been reused are ignored.
+  static void HandleResponseContents(const Handle& handle, ResponseContents&& response_contents);
+
+  // Fails every operation still outstanding, as a boost::future fails with broken_promise once its
+  // promise is gone.  For when the timer tasks holding their Handles have been dropped, e.g. by
+  // Timer::CancelAll, so that nothing waits on them forever.  Later responses are ignored.
+  void CancelAll();
+
+  // Number of states created so far.
+  size_t size() const;
+
+ private:
+  struct Slot : public detail::SlabState<T> {
+    explicit Slot(OperationSlab& owner_in);
+    virtual void Recycle();
+    OperationSlab& owner;
+    // Between Acquire and Recycle.
+    bool in_use;
+    int successes_required;
+    std::vector<ResponseContents> responses;
+    ResultFunctor to_result;
+  };
+
+  OperationSlab(const OperationSlab&);
+  OperationSlab(OperationSlab&&);
+  OperationSlab& operator=(OperationSlab);
+
+  mutable std::mutex mutex_;
+  std::deque<Slot> slots_;
+  std::vector<Slot*> free_slots_;
+};
+
+// ==================== Implementation =============================================================
+template <typename T>
+bool SlabFuture<T>::is_ready() const {
+  if (!state_)
+    return false;
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->completed;
+}
+
+template <typename T>
+void SlabFuture<T>::wait() const {
+  if (!state_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->ready.wait(lock, [this] { return state_->completed; });
+}
+
+template <typename T>
+template <typename Rep, typename Period>
+bool SlabFuture<T>::wait_for(const std::chrono::duration<Rep, Period>& duration) const {
+  if (!state_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  return state_->ready.wait_for(lock, duration, [this] { return state_->completed; });
+}
+
+template <typename T>
+T SlabFuture<T>::get() {
+  if (!state_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  boost::optional<typename detail::SlabState<T>::Result> result;
+  {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->ready.wait(lock, [this] { return state_->completed; });
+    result = std::move(state_->result);
+  }
+  Detach();
+  if (!result->valid())
+    BOOST_THROW_EXCEPTION(result->error());
+  return detail::SlabValue<T>::Get(std::move(**result));
+}
+
+template <typename T>
+void SlabFuture<T>::Detach() {
+  if (!state_)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->future_attached = false;
+    if (state_->completed)
+      state_->Recycle();
+  }
+  state_ = nullptr;
+}
+
+template <typename T, typename ResponseContents>
+OperationSlab<T, ResponseContents>::Slot::Slot(OperationSlab& owner_in)
+    : detail::SlabState<T>(),
+      owner(owner_in),
+      in_use(false),
+      successes_required(0),
+      responses(),
+      to_result(nullptr) {
+  responses.reserve(routing::Parameters::group_size);
+}
+
+template <typename T, typename ResponseContents>
+void OperationSlab<T, ResponseContents>::Slot::Recycle() {
+  ++this->generation;
+  in_use = false;
+  this->completed = false;
+  this->result = boost::none;
+  responses.clear();
+  std::lock_guard<std::mutex> lock(owner.mutex_);
+  owner.free_slots_.push_back(this);
+}
+
+template <typename T, typename ResponseContents>
+OperationSlab<T, ResponseContents>::OperationSlab(size_t capacity)
+    : mutex_(), slots_(), free_slots_() {
+  free_slots_.reserve(capacity);
+  for (size_t index(0); index != capacity; ++index) {
+    slots_.emplace_back(*this);
+    free_slots_.push_back(&slots_.back());
+  }
+}
+
+template <typename T, typename ResponseContents>
+SlabFuture<T> OperationSlab<T, ResponseContents>::Acquire(int successes_required,
+                                                          ResultFunctor to_result,
+                                                          Handle& handle) {
+  Slot* slot(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_slots_.empty()) {
+      slots_.emplace_back(*this);
+      slot = &slots_.back();
+      LOG(kVerbose) << "OperationSlab grown to " << slots_.size() << " states";
+    } else {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    }
+  }
+  std::lock_guard<std::mutex> lock(slot->mutex);
+  slot->successes_required = successes_required;
+  slot->to_result = to_result;
+  slot->in_use = true;
+  slot->future_attached = true;
+  handle = Handle(slot, slot->generation);
+  return SlabFuture<T>(slot);
+}
+
+template <typename T, typename ResponseContents>
+void OperationSlab<T, ResponseContents>::HandleResponseContents(
+    const Handle& handle, ResponseContents&& response_contents) {
+  Slot* slot(handle.slot_);
+  if (!slot)
+    return;
+  std::lock_guard<std::mutex> lock(slot->mutex);
+  if (slot->generation != handle.generation_ || slot->completed)
+    return;
+  auto error_code(nfs::ErrorCode(response_contents));
+  bool timed_out(!nfs::IsSuccess(response_contents) &&
+                 (error_code == std::error_code(CommonErrors::defaulted) ||
+                  error_code == std::error_code(NfsErrors::timed_out)));
+  slot->responses.push_back(std::move(response_contents));
+  auto result(nfs::GetSuccessOrMostFrequentResponse(slot->responses, slot->successes_required));
+  // TODO(Fraser#5#): 2013-08-18 - Confirm expected count (as for OpData)
+  if (result.first == std::end(slot->responses) ||
+      (!result.second && !timed_out &&
+       slot->responses.size() <= (routing::Parameters::group_size / 2U))) {
+    return;
+  }
+  slot->result = slot->to_result(*result.first);
+  slot->completed = true;
+  slot->ready.notify_all();
+  if (!slot->future_attached)
+    slot->Recycle();
+}
+
+template <typename T, typename ResponseContents>
+void OperationSlab<T, ResponseContents>::CancelAll() {
+  // Recycling a state takes mutex_, so it isn't held while the states are failed.
+  std::vector<Slot*> slots;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_)
+      slots.push_back(&slot);
+  }
+  const maidsafe_error kCancelled(MakeError(CommonErrors::unable_to_handle_request));
+  for (auto slot : slots) {
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    if (!slot->in_use || slot->completed)
+      continue;
+    slot->result = Result(boost::make_unexpected(kCancelled));
+    slot->completed = true;
+    slot->ready.notify_all();
+    if (!slot->future_attached)
+      slot->Recycle();
+  }
+}
+
+template <typename T, typename ResponseContents>
+size_t OperationSlab<T, ResponseContents>::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slots_.size();
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_CLIENT_SLAB_FUTURE_H_
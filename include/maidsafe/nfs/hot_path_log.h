@@ -0,0 +1,64 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_NFS_HOT_PATH_LOG_H_
+#define MAIDSAFE_NFS_HOT_PATH_LOG_H_
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+// Verbose logging on the per-request path.  Arguments streamed to LOG(kVerbose) are evaluated
+// (serialising data, hex-encoding names and so on) even when verbose messages are then filtered
+// out.  Those streamed to NFS_VERBOSE_LOG are only evaluated if verbose logging is configured for
+// nfs, which is checked once and cached, so otherwise cost no more than a relaxed atomic load.
+// Building with MAIDSAFE_NFS_NO_VERBOSE_LOGGING defined (see the NFS_VERBOSE_LOGGING CMake
+// option), or without USE_LOGGING, compiles them out altogether.
+#if defined(USE_LOGGING) && !defined(MAIDSAFE_NFS_NO_VERBOSE_LOGGING)
+
+bool VerboseHotPathLogging();
+// Overrides the configured log level until ResetVerboseHotPathLogging is called.
+void SetVerboseHotPathLogging(bool enabled);
+// Drops any override and the cached level, so the next check reads the log filter again; for use
+// once the filter has changed.
+void ResetVerboseHotPathLogging();
+
+#define NFS_VERBOSE_LOG                           \
+  if (!maidsafe::nfs::VerboseHotPathLogging()) { \
+  } else                                          \
+    LOG(kVerbose)
+
+#else
+
+inline bool VerboseHotPathLogging() { return false; }
+inline void SetVerboseHotPathLogging(bool /*enabled*/) {}
+inline void ResetVerboseHotPathLogging() {}
+
+#define NFS_VERBOSE_LOG \
+  while (false)         \
+  LOG(kVerbose)
+
+#endif
+
+}  // namespace nfs
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_NFS_HOT_PATH_LOG_H_
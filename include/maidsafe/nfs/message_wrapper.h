@@ -55,6 +55,7 @@ struct MessageWrapper {
   typedef DestinationPersonaType DestinationPersona;
   typedef RoutingReceiverType Receiver;
   typedef ContentsType Contents;
+  static const MessageAction kAction = action;
   struct Tag;
   typedef boost::error_info<Tag, MessageWrapper> ErrorInfo;
 
@@ -131,6 +132,12 @@ std::string SerialiseMessageWrapper(const TypeErasedMessageWrapper& message_tupl
 
 }  // namespace detail
 
+template <MessageAction action, typename SourcePersonaType, typename RoutingSenderType,
+          typename DestinationPersonaType, typename RoutingReceiverType, typename ContentsType>
+const MessageAction MessageWrapper<action, SourcePersonaType, RoutingSenderType,
+                                   DestinationPersonaType, RoutingReceiverType,
+                                   ContentsType>::kAction;
+
 template <MessageAction action, typename SourcePersonaType, typename RoutingSenderType,
           typename DestinationPersonaType, typename RoutingReceiverType, typename ContentsType>
 const detail::SourceTaggedValue MessageWrapper<
@@ -69,6 +69,15 @@ DEFINE_OSTREAMABLE_ENUM_VALUES(MessageAction, int32_t,
     (GetMessageResponse)
     (SendAlert)
     (DeleteAlert)
+    (IncrementReferenceCountsRequest)
+    (IncrementReferenceCountsResponse)
+    (DecrementReferenceCountsRequest)
+    (DecrementReferenceCountsResponse)
+    (DeleteResponse)
+    (DeleteBatchRequest)
+    (DeleteBatchResponse)
+    (GetVersionsBatchRequest)
+    (GetVersionsBatchResponse)
     (NoOperation))  // NoOperation is added to avoid re-definition of types error in
                     // vault::message_types.
 // Defines:
@@ -33,6 +33,7 @@
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/api_config.h"
 
+#include "maidsafe/nfs/hot_path_log.h"
 #include "maidsafe/nfs/public_pmid_helper.h"
 #include "maidsafe/nfs/public_mpid_helper.h"
 
@@ -80,7 +81,7 @@ bool CheckMutuallyExclusive(const A& a, const B& b) {
 
 template <typename MessageContents>
 bool IsSuccess(const MessageContents& response) {
-  LOG(kVerbose) << "IsSuccess return_code " << response.return_code.value.what();
+  NFS_VERBOSE_LOG << "IsSuccess return_code " << response.return_code.value.what();
   return response.return_code.value.code().value() == static_cast<int>(CommonErrors::success);
 }
 
@@ -122,23 +123,23 @@ template <typename MessageContents>
 std::pair<typename std::vector<MessageContents>::const_iterator, bool>
 GetSuccessOrMostFrequentResponse(const std::vector<MessageContents>& responses,
                                  int successes_required) {
-  LOG(kVerbose) << "GetSuccessOrMostFrequentResponse responses.size() : "
-                << responses.size() << " successes_required : " << successes_required;
+  NFS_VERBOSE_LOG << "GetSuccessOrMostFrequentResponse responses.size() : "
+                  << responses.size() << " successes_required : " << successes_required;
   auto most_frequent_itr(std::end(responses));
   int successes(0), most_frequent(0);
   typedef std::map<std::error_code, int> Count;
   Count count;
   for (auto itr(std::begin(responses)); itr != std::end(responses); ++itr) {
     int this_reply_count(++count[ErrorCode(*itr)]);
-    LOG(kVerbose) << "GetSuccessOrMostFrequentResponse this_reply_count : " << this_reply_count;
+    NFS_VERBOSE_LOG << "GetSuccessOrMostFrequentResponse this_reply_count : " << this_reply_count;
     if (IsSuccess(*itr)) {
-      LOG(kVerbose) << "GetSuccessOrMostFrequentResponse successes : " << successes;
+      NFS_VERBOSE_LOG << "GetSuccessOrMostFrequentResponse successes : " << successes;
       if (++successes >= successes_required) {
-        LOG(kVerbose) << "GetSuccessOrMostFrequentResponse return succeeded";
+        NFS_VERBOSE_LOG << "GetSuccessOrMostFrequentResponse return succeeded";
         return std::make_pair(itr, true);
       }
     } else {
-      LOG(kVerbose) << "GetSuccessOrMostFrequentResponse failed";
+      NFS_VERBOSE_LOG << "GetSuccessOrMostFrequentResponse failed";
       if (this_reply_count > most_frequent) {
         most_frequent = this_reply_count;
         most_frequent_itr = itr;
@@ -164,7 +165,7 @@ OpData<MessageContents>::OpData(int successes_required,
 
 template <typename MessageContents>
 void OpData<MessageContents>::HandleResponseContents(MessageContents&& response_contents) {
-  LOG(kVerbose) << "OpData<MessageContents>::HandleResponseContents";
+  NFS_VERBOSE_LOG << "OpData<MessageContents>::HandleResponseContents";
   std::function<void(MessageContents)> callback;
   std::unique_ptr<MessageContents> result_ptr;
   {
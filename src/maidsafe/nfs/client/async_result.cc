@@ -0,0 +1,48 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/async_result.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+AsyncExpected<void> GetAsyncExpectedSuccess(const ReturnCode& result) {
+  if (nfs::IsSuccess(result))
+    return AsyncExpected<void>();
+  return boost::make_unexpected(result.value.code());
+}
+
+AsyncExpected<std::vector<StructuredDataVersions::VersionName>> GetAsyncExpectedVersionNames(
+    const StructuredDataNameAndContentOrReturnCode& result) {
+  auto version_names(GetVersionNamesOrError(result));
+  if (!version_names.valid())
+    return boost::make_unexpected(version_names.error().code());
+  return std::move(*version_names);
+}
+
+AsyncExpected<boost::optional<StructuredDataVersions::VersionName>> GetAsyncExpectedTipOfTree(
+    const TipOfTreeAndReturnCode& result) {
+  if (!nfs::IsSuccess(result.return_code))
+    return boost::make_unexpected(result.return_code.value.code());
+  return result.tip_of_tree;
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
@@ -0,0 +1,41 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/client_routing.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+ClientRouting::~ClientRouting() {}
+
+std::vector<NodeId> ClientRouting::CloseGroup(const NodeId& /*group_id*/) const {
+  return std::vector<NodeId>();
+}
+
+NetworkRouting::NetworkRouting(routing::Routing& routing) : owned_routing_(), routing_(routing) {}
+
+NodeId NetworkRouting::kNodeId() const { return routing_.kNodeId(); }
+
+void NetworkRouting::Join(const routing::Functors& functors) { routing_.Join(functors); }
+
+void NetworkRouting::Send(const routing::SingleToGroupMessage& message) { routing_.Send(message); }
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
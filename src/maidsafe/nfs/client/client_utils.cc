@@ -18,10 +18,24 @@
 
 #include "maidsafe/nfs/client/client_utils.h"
 
+#include <map>
+
 namespace maidsafe {
 
 namespace nfs_client {
 
+namespace {
+
+std::map<nfs_vault::DataName, ReturnCode> ReturnCodesByName(
+    const DataNamesAndReturnCodes& result) {
+  std::map<nfs_vault::DataName, ReturnCode> return_codes;
+  for (const auto& name_and_return_code : result.results)
+    return_codes[name_and_return_code.name] = name_and_return_code.return_code;
+  return return_codes;
+}
+
+}  // unnamed namespace
+
 void HandleGetVersionsOrBranchResult(
     const StructuredDataNameAndContentOrReturnCode& result,
     std::shared_ptr<boost::promise<std::vector<StructuredDataVersions::VersionName>>> promise) {
@@ -46,6 +60,27 @@ void HandleGetVersionsOrBranchResult(
   }
 }
 
+VersionNamesOrError GetVersionNamesOrError(
+    const StructuredDataNameAndContentOrReturnCode& result) {
+  if (result.structured_data)
+    return result.structured_data->versions;
+  if (result.data_name_and_return_code)
+    return boost::make_unexpected(result.data_name_and_return_code->return_code.value);
+  return boost::make_unexpected(MakeError(CommonErrors::uninitialised));
+}
+
+boost::expected<bool, maidsafe_error> GetSuccessOrError(const ReturnCode& result) {
+  if (nfs::IsSuccess(result))
+    return true;
+  return boost::make_unexpected(result.value);
+}
+
+std::chrono::steady_clock::duration TimeRemaining(
+    const std::chrono::steady_clock::time_point& deadline) {
+  return std::max(deadline - std::chrono::steady_clock::now(),
+                  std::chrono::steady_clock::duration::zero());
+}
+
 void HandleCreateAccountResult(const ReturnCode& result,
                                std::shared_ptr<boost::promise<void>> promise) {
   LOG(kVerbose) << "nfs_client::HandleCreateAccountResult";
@@ -189,6 +224,108 @@ void HandleRegisterPmidResult(const ReturnCode& result,
   }
 }
 
+void HandleReferenceCountsResult(const DataNamesAndReturnCodes& result,
+                                 const std::vector<ImmutableData::Name>& data_names,
+                                 std::shared_ptr<boost::promise<std::vector<ReturnCode>>> promise) {
+  LOG(kVerbose) << "nfs_client::HandleReferenceCountsResult";
+  try {
+    if (!nfs::IsSuccess(result)) {
+      LOG(kWarning) << "nfs_client::HandleReferenceCountsResult error during batch update";
+      BOOST_THROW_EXCEPTION(result.return_code.value);
+    }
+    auto return_codes(ReturnCodesByName(result));
+    std::vector<ReturnCode> ordered_return_codes;
+    ordered_return_codes.reserve(data_names.size());
+    for (const auto& data_name : data_names) {
+      auto itr(return_codes.find(nfs_vault::DataName(data_name)));
+      ordered_return_codes.push_back(itr == std::end(return_codes) ? ReturnCode() : itr->second);
+    }
+    promise->set_value(std::move(ordered_return_codes));
+  }
+  catch (...) {
+    LOG(kError) << "nfs_client::HandleReferenceCountsResult exception during batch update";
+    promise->set_exception(boost::current_exception());
+  }
+}
+
+void HandleReferenceCountResult(const DataNamesAndReturnCodes& result,
+                                const ImmutableData::Name& data_name,
+                                std::shared_ptr<boost::promise<void>> promise) {
+  LOG(kVerbose) << "nfs_client::HandleReferenceCountResult";
+  try {
+    if (!nfs::IsSuccess(result)) {
+      LOG(kWarning) << "nfs_client::HandleReferenceCountResult error during update";
+      BOOST_THROW_EXCEPTION(result.return_code.value);
+    }
+    auto return_codes(ReturnCodesByName(result));
+    auto itr(return_codes.find(nfs_vault::DataName(data_name)));
+    if (itr == std::end(return_codes)) {
+      LOG(kWarning) << "nfs_client::HandleReferenceCountResult no result for "
+                    << HexSubstr(data_name.value);
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+    }
+    if (!nfs::IsSuccess(itr->second))
+      BOOST_THROW_EXCEPTION(itr->second.value);
+    promise->set_value();
+  }
+  catch (...) {
+    LOG(kError) << "nfs_client::HandleReferenceCountResult exception during update";
+    promise->set_exception(boost::current_exception());
+  }
+}
+
+void HandleDeleteResult(const ReturnCode& result, std::shared_ptr<boost::promise<void>> promise) {
+  LOG(kVerbose) << "nfs_client::HandleDeleteResult";
+  try {
+    if (nfs::IsSuccess(result)) {
+      promise->set_value();
+    } else {
+      LOG(kWarning) << "nfs_client::HandleDeleteResult error during delete";
+      BOOST_THROW_EXCEPTION(result.value);
+    }
+  }
+  catch (...) {
+    LOG(kError) << "nfs_client::HandleDeleteResult exception during delete";
+    promise->set_exception(boost::current_exception());
+  }
+}
+
+HandleDeleteBatchResult::HandleDeleteBatchResult(
+    std::shared_ptr<boost::promise<std::vector<ReturnCode>>> promise,
+    std::vector<nfs_vault::DataName> data_names, size_t part_count)
+    : mutex_(),
+      promise_(std::move(promise)),
+      kDataNames_(std::move(data_names)),
+      return_codes_(kDataNames_.size()),
+      outstanding_count_(part_count) {
+  if (outstanding_count_ == 0)
+    promise_->set_value(return_codes_);
+}
+
+void HandleDeleteBatchResult::operator()(size_t first_index, size_t last_index,
+                                         const DataNamesAndReturnCodes& result) {
+  assert(first_index <= last_index && last_index <= kDataNames_.size());
+  auto return_codes(ReturnCodesByName(result));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (outstanding_count_ == 0)
+      return;
+    for (size_t index(first_index); index < last_index; ++index) {
+      if (!nfs::IsSuccess(result)) {
+        return_codes_[index] = result.return_code;
+      } else {
+        auto itr(return_codes.find(kDataNames_[index]));
+        if (itr != std::end(return_codes))
+          return_codes_[index] = itr->second;
+      }
+    }
+    if (--outstanding_count_ != 0)
+      return;
+  }
+  LOG(kVerbose) << "HandleDeleteBatchResult all " << return_codes_.size() << " names resolved";
+  promise_->set_value(std::move(return_codes_));
+}
+
 }  // namespace nfs_client
 
 }  // namespace maidsafe
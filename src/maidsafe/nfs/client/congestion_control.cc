@@ -0,0 +1,298 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/congestion_control.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+namespace {
+
+const std::chrono::seconds kSweepInterval(1);
+// Windows for groups we haven't talked to for this long are forgotten (e.g. VersionHandler groups,
+// of which there is one per structured data name).
+const std::chrono::seconds kIdleWindowLifetime(60);
+
+}  // unnamed namespace
+
+const std::array<int, 3> CongestionControl::kPriorityWeights = {{ 16, 4, 1 }};
+const double CongestionControl::kInitialWindowSize(8.0);
+const double CongestionControl::kMaxWindowSize(256.0);
+const int CongestionControl::kLatencyThresholdFactor(4);
+const size_t CongestionControl::kDefaultMaxInFlight(256);
+
+CongestionControl::Window::Window()
+    : size(kInitialWindowSize),
+      min_latency(std::chrono::steady_clock::duration::max()),
+      last_decrease(),
+      last_active(std::chrono::steady_clock::now()),
+      in_flight(),
+      queues() {}
+
+CongestionControl::CongestionControl(BoostAsioService& asio_service, size_t max_in_flight)
+    : mutex_(),
+      kMaxInFlight_(std::max(size_t(1), max_in_flight)),
+      liveness_(std::make_shared<Liveness>()),
+      timer_(asio_service.service()),
+      windows_(),
+      in_flight_count_(0),
+      next_sequence_(0),
+      credits_(),
+      timer_armed_(false),
+      running_(true) {}
+
+CongestionControl::~CongestionControl() {
+  Stop();
+  std::lock_guard<std::mutex> lock(liveness_->mutex);
+  liveness_->alive = false;
+}
+
+void CongestionControl::Send(const NodeId& group, nfs::MessageAction action,
+                             nfs::MessageId message_id, Priority priority,
+                             const std::chrono::steady_clock::duration& timeout,
+                             SendFunctor send) {
+  std::vector<SendFunctor> sendable;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      LOG(kWarning) << "CongestionControl stopped. Send ignored !";
+      return;
+    }
+    auto now(std::chrono::steady_clock::now());
+    auto& window(windows_[group]);
+    window.last_active = now;
+    const RequestKey key(action, message_id.data);
+    // While the budget has room, anything queued is held by its own window, so can't be overtaken.
+    if (HasRoom(window) && QueueDepth(window) == 0 && in_flight_count_ < kMaxInFlight_) {
+      Track(window, key, now, timeout);
+      sendable.push_back(std::move(send));
+    } else {
+      LOG(kVerbose) << "CongestionControl queueing " << action << " to " << DebugId(group)
+                    << ", window " << static_cast<size_t>(window.size) << ", queued "
+                    << QueueDepth(window) << ", in flight " << in_flight_count_;
+      QueuedRequest request = { key, next_sequence_++, timeout, std::move(send) };
+      window.queues[static_cast<int>(priority)].push_back(std::move(request));
+    }
+    ArmTimer();
+  }
+  for (const auto& functor : sendable)
+    functor();
+}
+
+void CongestionControl::OnResponse(const NodeId& group, nfs::MessageAction action,
+                                   nfs::MessageId message_id) {
+  std::vector<SendFunctor> sendable;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto window_itr(windows_.find(group));
+    if (window_itr == std::end(windows_))
+      return;
+    auto& window(window_itr->second);
+    auto request_itr(window.in_flight.find(std::make_pair(action, message_id.data)));
+    if (request_itr == std::end(window.in_flight))
+      return;
+    auto now(std::chrono::steady_clock::now());
+    auto latency(now - request_itr->second.sent);
+    Untrack(window, request_itr);
+    window.last_active = now;
+    window.min_latency = std::min(window.min_latency, latency);
+    if (latency > window.min_latency * kLatencyThresholdFactor)
+      Decrease(window, now);
+    else
+      Increase(window);
+    TakeSendable(now, sendable);
+  }
+  for (const auto& functor : sendable)
+    functor();
+}
+
+void CongestionControl::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  windows_.clear();
+  in_flight_count_ = 0;
+  credits_.fill(0);
+  boost::system::error_code ignored;
+  timer_.cancel(ignored);
+}
+
+std::map<NodeId, CongestionControl::Metrics> CongestionControl::GetMetrics() const {
+  std::map<NodeId, Metrics> metrics;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& group_and_window : windows_) {
+    auto& group_metrics(metrics[group_and_window.first]);
+    group_metrics.window_size = static_cast<size_t>(group_and_window.second.size);
+    group_metrics.in_flight = group_and_window.second.in_flight.size();
+    group_metrics.queue_depth = QueueDepth(group_and_window.second);
+  }
+  return metrics;
+}
+
+void CongestionControl::Increase(Window& window) const {
+  window.size = std::min(kMaxWindowSize, window.size + 1.0 / window.size);
+}
+
+void CongestionControl::Decrease(Window& window, const TimePoint& now) const {
+  // Only back off once per round trip, otherwise a burst of late responses from a single congestion
+  // event would collapse the window.
+  if (window.min_latency != std::chrono::steady_clock::duration::max() &&
+      now - window.last_decrease < window.min_latency * kLatencyThresholdFactor) {
+    return;
+  }
+  window.size = std::max(1.0, window.size / 2.0);
+  window.last_decrease = now;
+  LOG(kInfo) << "CongestionControl window reduced to " << static_cast<size_t>(window.size);
+}
+
+size_t CongestionControl::QueueDepth(const Window& window) const {
+  size_t depth(0);
+  for (const auto& queue : window.queues)
+    depth += queue.size();
+  return depth;
+}
+
+bool CongestionControl::HasRoom(const Window& window) const {
+  return window.in_flight.size() < static_cast<size_t>(window.size);
+}
+
+void CongestionControl::Track(Window& window, const RequestKey& key, const TimePoint& now,
+                              const std::chrono::steady_clock::duration& timeout) {
+  const InFlightRequest request = { now, now + timeout };
+  auto result(window.in_flight.insert(std::make_pair(key, request)));
+  if (result.second)
+    ++in_flight_count_;
+  else
+    result.first->second = request;
+}
+
+void CongestionControl::Untrack(Window& window,
+                                std::map<RequestKey, InFlightRequest>::iterator request_itr) {
+  window.in_flight.erase(request_itr);
+  --in_flight_count_;
+}
+
+void CongestionControl::TakeSendable(const TimePoint& now, std::vector<SendFunctor>& sendable) {
+  while (in_flight_count_ < kMaxInFlight_) {
+    // The oldest request of each class whose window has room.
+    std::array<Window*, 3> candidates = {{ nullptr, nullptr, nullptr }};
+    for (auto& group_and_window : windows_) {
+      auto& window(group_and_window.second);
+      if (!HasRoom(window))
+        continue;
+      for (size_t index(0); index != window.queues.size(); ++index) {
+        const auto& queue(window.queues[index]);
+        if (queue.empty())
+          continue;
+        if (!candidates[index] ||
+            queue.front().sequence < candidates[index]->queues[index].front().sequence) {
+          candidates[index] = &window;
+        }
+      }
+    }
+    // Smooth weighted round robin: every class with a candidate earns its weight, the richest is
+    // served and pays back the total earned.  Over any stretch where all classes have work ready,
+    // they are served in proportion to their weights, interleaved rather than in bursts.
+    int total_weight(0), chosen(-1);
+    for (int index(0); index != static_cast<int>(candidates.size()); ++index) {
+      if (!candidates[index]) {
+        credits_[index] = 0;
+        continue;
+      }
+      credits_[index] += kPriorityWeights[index];
+      total_weight += kPriorityWeights[index];
+      if (chosen == -1 || credits_[index] > credits_[chosen])
+        chosen = index;
+    }
+    if (chosen == -1)
+      return;
+    credits_[chosen] -= total_weight;
+    auto& window(*candidates[chosen]);
+    auto request(std::move(window.queues[chosen].front()));
+    window.queues[chosen].pop_front();
+    // Counted from here, as it leaves the queue, so it holds its place until run.
+    Track(window, request.key, now, request.timeout);
+    window.last_active = now;
+    sendable.push_back(std::move(request.send));
+  }
+}
+
+void CongestionControl::ArmTimer() {
+  if (timer_armed_ || !running_)
+    return;
+  timer_armed_ = true;
+  timer_.expires_from_now(kSweepInterval);
+  std::shared_ptr<Liveness> liveness(liveness_);
+  timer_.async_wait([this, liveness](const boost::system::error_code& error) {
+    std::lock_guard<std::mutex> lock(liveness->mutex);
+    if (liveness->alive)
+      OnTimer(error);
+  });
+}
+
+void CongestionControl::OnTimer(const boost::system::error_code& error) {
+  if (error == boost::asio::error::operation_aborted)
+    return;
+  std::vector<SendFunctor> sendable;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer_armed_ = false;
+    if (!running_)
+      return;
+    auto now(std::chrono::steady_clock::now());
+    for (auto& group_and_window : windows_) {
+      auto& window(group_and_window.second);
+      bool timed_out(false);
+      for (auto request_itr(std::begin(window.in_flight));
+           request_itr != std::end(window.in_flight);) {
+        if (now > request_itr->second.deadline) {
+          LOG(kWarning) << "CongestionControl " << request_itr->first.first << " to "
+                        << DebugId(group_and_window.first) << " timed out";
+          Untrack(window, request_itr++);
+          timed_out = true;
+        } else {
+          ++request_itr;
+        }
+      }
+      if (timed_out)
+        Decrease(window, now);
+    }
+    TakeSendable(now, sendable);
+    for (auto window_itr(std::begin(windows_)); window_itr != std::end(windows_);) {
+      const auto& window(window_itr->second);
+      if (window.in_flight.empty() && QueueDepth(window) == 0 &&
+          now - window.last_active > kIdleWindowLifetime) {
+        window_itr = windows_.erase(window_itr);
+      } else {
+        ++window_itr;
+      }
+    }
+    if (!windows_.empty())
+      ArmTimer();
+  }
+  for (const auto& functor : sendable)
+    functor();
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
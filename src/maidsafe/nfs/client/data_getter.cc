@@ -20,28 +20,56 @@
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
 
 namespace maidsafe {
 
 namespace nfs_client {
 
-DataGetter::DataGetter(BoostAsioService& asio_service, routing::Routing& routing)
-    : get_timer_(asio_service),
+DataGetter::DataGetter(BoostAsioService& asio_service, routing::Routing& routing,
+                       std::shared_ptr<BoostAsioService> completion_service)
+    : DataGetter(asio_service, maidsafe::make_unique<NetworkRouting>(routing), nullptr,
+                 std::move(completion_service), nullptr) {}
+
+DataGetter::DataGetter(BoostAsioService& asio_service, ClientRouting& routing,
+                       std::shared_ptr<BoostAsioService> completion_service,
+                       CongestionControl* congestion_control)
+    : DataGetter(asio_service, nullptr, &routing, std::move(completion_service),
+                 congestion_control) {}
+
+DataGetter::DataGetter(BoostAsioService& asio_service,
+                       std::unique_ptr<ClientRouting> network_routing, ClientRouting* routing,
+                       std::shared_ptr<BoostAsioService> completion_service,
+                       CongestionControl* congestion_control)
+    : asio_service_(asio_service),
+      completion_service_(std::move(completion_service)),
+      network_routing_(std::move(network_routing)),
+      routing_(routing ? *routing : *network_routing_),
+      version_names_slab_(),
+      get_timer_(asio_service),
       get_versions_timer_(asio_service),
       get_branch_timer_(asio_service),
-      dispatcher_(routing),
-      get_handler_(get_timer_, dispatcher_),
+      get_versions_batch_timer_(asio_service),
+      dispatcher_(routing_, congestion_control),
+      get_handler_(get_timer_, dispatcher_, completion_service_),
       service_([&]()->std::unique_ptr<DataGetterService> {
                  std::unique_ptr<DataGetterService> service(
-                 new DataGetterService(routing, get_handler_, get_versions_timer_,
-                                       get_branch_timer_));
+                 new DataGetterService(routing_, get_handler_, get_versions_timer_,
+                                       get_branch_timer_, congestion_control,
+                                       &get_versions_batch_timer_));
                  return std::move(service);
                }()) {}
 
+boost::asio::io_service& DataGetter::completion_io_service() {
+  return completion_service_ ? completion_service_->service() : asio_service_.service();
+}
+
 void DataGetter::Stop() {
   get_timer_.CancelAll();
   get_versions_timer_.CancelAll();
   get_branch_timer_.CancelAll();
+  get_versions_batch_timer_.CancelAll();
+  version_names_slab_.CancelAll();
 }
 
 }  // namespace nfs_client
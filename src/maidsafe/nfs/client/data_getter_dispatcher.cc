@@ -22,8 +22,33 @@ namespace maidsafe {
 
 namespace nfs_client {
 
-DataGetterDispatcher::DataGetterDispatcher(routing::Routing& routing)
-    : routing_(routing), kThisNodeAsSender_(routing_.kNodeId()) {}
+DataGetterDispatcher::DataGetterDispatcher(ClientRouting& routing,
+                                           CongestionControl* congestion_control)
+    : owned_routing_(),
+      routing_(routing),
+      congestion_control_(congestion_control),
+      kThisNodeAsSender_(routing_.kNodeId()) {}
+
+DataGetterDispatcher::DataGetterDispatcher(routing::Routing& routing,
+                                           CongestionControl* congestion_control)
+    : owned_routing_(maidsafe::make_unique<NetworkRouting>(routing)),
+      routing_(*owned_routing_),
+      congestion_control_(congestion_control),
+      kThisNodeAsSender_(routing_.kNodeId()) {}
+
+void DataGetterDispatcher::SendGetVersionsBatchRequest(
+    routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+    const std::chrono::steady_clock::duration& timeout) {
+  typedef nfs::GetVersionsBatchRequestFromDataGetterToVersionHandler NfsMessage;
+  CheckSourcePersonaType<NfsMessage>();
+  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
+
+  NfsMessage nfs_message(nfs::MessageId(task_id), data_names);
+  NfsMessage::Receiver receiver(
+      routing::GroupId(NodeId(data_names.data_names_.front().raw_name.string())));
+  RoutingSend(nfs_message, RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, receiver),
+              timeout);
+}
 
 }  // namespace nfs_client
 
@@ -22,14 +22,33 @@ namespace maidsafe {
 
 namespace nfs_client {
 
+DataGetterService::DataGetterService(
+    ClientRouting& routing, GetHandler<DataGetterDispatcher>& get_handler,
+    routing::Timer<DataGetterService::GetVersionsResponse::Contents>& get_versions_timer,
+    routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer,
+    CongestionControl* congestion_control,
+    routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents>* get_versions_batch_timer)
+        : owned_routing_(),
+          routing_(routing),
+          get_handler_(get_handler),
+          get_versions_timer_(get_versions_timer),
+          get_branch_timer_(get_branch_timer),
+          congestion_control_(congestion_control),
+          get_versions_batch_timer_(get_versions_batch_timer) {}
+
 DataGetterService::DataGetterService(
     routing::Routing& routing, GetHandler<DataGetterDispatcher>& get_handler,
     routing::Timer<DataGetterService::GetVersionsResponse::Contents>& get_versions_timer,
-    routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer)
-        : routing_(routing),
+    routing::Timer<DataGetterService::GetBranchResponse::Contents>& get_branch_timer,
+    CongestionControl* congestion_control,
+    routing::Timer<DataGetterService::GetVersionsBatchResponse::Contents>* get_versions_batch_timer)
+        : owned_routing_(maidsafe::make_unique<NetworkRouting>(routing)),
+          routing_(*owned_routing_),
           get_handler_(get_handler),
           get_versions_timer_(get_versions_timer),
-          get_branch_timer_(get_branch_timer) {}
+          get_branch_timer_(get_branch_timer),
+          congestion_control_(congestion_control),
+          get_versions_batch_timer_(get_versions_batch_timer) {}
 
 void DataGetterService::HandleMessage(const GetResponse& message,
                                       const GetResponse::Sender& /*sender*/,
@@ -40,6 +59,11 @@ void DataGetterService::HandleMessage(const GetResponse& message,
   assert(receiver.data == routing_.kNodeId());
   static_cast<void>(receiver);
   static_cast<void>(routing_);
+  // A cached copy may come from outside the group asked, so the window is found by the data name.
+  if (congestion_control_) {
+    congestion_control_->OnResponse(NodeId(message.contents->name.raw_name.string()),
+                                    nfs::MessageAction::kGetRequest, message.id);
+  }
   try {
     get_handler_.AddResponse(message.id.data, *message.contents);
   }
@@ -60,6 +84,11 @@ void DataGetterService::HandleMessage(const GetCachedResponse& message,
   assert(receiver.data == routing_.kNodeId());
   static_cast<void>(receiver);
   static_cast<void>(routing_);
+  // A cached copy may come from outside the group asked, so the window is found by the data name.
+  if (congestion_control_) {
+    congestion_control_->OnResponse(NodeId(message.contents->name.raw_name.string()),
+                                    nfs::MessageAction::kGetRequest, message.id);
+  }
   try {
     get_handler_.AddResponse(message.id.data, *message.contents);
   }
@@ -72,10 +101,14 @@ void DataGetterService::HandleMessage(const GetCachedResponse& message,
 }
 
 void DataGetterService::HandleMessage(const GetVersionsResponse& message,
-                                      const GetVersionsResponse::Sender& /*sender*/,
+                                      const GetVersionsResponse::Sender& sender,
                                       const GetVersionsResponse::Receiver& receiver) {
   assert(receiver.data == routing_.kNodeId());
   static_cast<void>(receiver);
+  if (congestion_control_) {
+    congestion_control_->OnResponse(sender.group_id.data, nfs::MessageAction::kGetVersionsRequest,
+                                    message.id);
+  }
   try {
     get_versions_timer_.AddResponse(message.id.data, *message.contents);
   }
@@ -88,10 +121,14 @@ void DataGetterService::HandleMessage(const GetVersionsResponse& message,
 }
 
 void DataGetterService::HandleMessage(const GetBranchResponse& message,
-                                      const GetBranchResponse::Sender& /*sender*/,
+                                      const GetBranchResponse::Sender& sender,
                                       const GetBranchResponse::Receiver& receiver) {
   assert(receiver.data == routing_.kNodeId());
   static_cast<void>(receiver);
+  if (congestion_control_) {
+    congestion_control_->OnResponse(sender.group_id.data, nfs::MessageAction::kGetBranchRequest,
+                                    message.id);
+  }
   try {
     get_branch_timer_.AddResponse(message.id.data, *message.contents);
   }
@@ -103,6 +140,30 @@ void DataGetterService::HandleMessage(const GetBranchResponse& message,
   }
 }
 
+void DataGetterService::HandleMessage(const GetVersionsBatchResponse& message,
+                                      const GetVersionsBatchResponse::Sender& sender,
+                                      const GetVersionsBatchResponse::Receiver& receiver) {
+  assert(receiver.data == routing_.kNodeId());
+  static_cast<void>(receiver);
+  if (congestion_control_) {
+    congestion_control_->OnResponse(sender.group_id.data,
+                                    nfs::MessageAction::kGetVersionsBatchRequest, message.id);
+  }
+  if (!get_versions_batch_timer_) {
+    LOG(kWarning) << "Unexpected GetVersionsBatch response:" << message.id.data;
+    return;
+  }
+  try {
+    get_versions_batch_timer_->AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != make_error_code(CommonErrors::no_such_element))
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
 }  // namespace nfs_client
 
 }  // namespace maidsafe
@@ -18,7 +18,10 @@
 
 #include "maidsafe/nfs/client/fake_store.h"
 
+#include <algorithm>
+#include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/filesystem/convenience.hpp"
@@ -27,6 +30,9 @@
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/nfs/client/fake_store_segment_backend.h"
+#include "maidsafe/nfs/client/fake_store_uring_backend.h"
+
 namespace fs = boost::filesystem;
 
 namespace maidsafe {
@@ -35,157 +41,219 @@ namespace nfs {
 
 namespace {
 
-struct UsedSpace {
-  UsedSpace() {}
-  UsedSpace(UsedSpace&& other)
-      : directories(std::move(other.directories)), disk_usage(std::move(other.disk_usage)) {}
-
-  std::vector<fs::path> directories;
-  DiskUsage disk_usage;
-};
-
-/*
-UsedSpace GetUsedSpace(fs::path directory) {
-  UsedSpace used_space;
-  for (fs::directory_iterator it(directory); it != fs::directory_iterator(); ++it) {
-    if (fs::is_directory(*it))
-      used_space.directories.push_back(it->path());
-    else
-      used_space.disk_usage.data += fs::file_size(*it);
+const char kIndexJournalName[] = "index.journal";
+const char kSegmentDirectoryName[] = "segments";
+
+// A version tree is a snapshot and a log of changes since (see FakeStoreVersions), both charged to
+// the tree's index entry.
+const char kVersionsExtension[] = ".ver";
+const char kVersionLogExtension[] = ".vlog";
+
+bool IsVersionsName(const std::string& name) {
+  const std::string extension(kVersionsExtension);
+  return name.size() >= extension.size() &&
+         name.compare(name.size() - extension.size(), std::string::npos, extension) == 0;
+}
+
+const fs::path& FirstDiskPath(const std::vector<fs::path>& disk_paths) {
+  if (disk_paths.empty()) {
+    LOG(kError) << "No disk paths given.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  return used_space;
+  return disk_paths.front();
 }
-*/
 
-DiskUsage InitialiseDiskRoot(const fs::path& disk_root) {
+fs::path InitialiseDiskRoot(const fs::path& disk_root) {
   boost::system::error_code error_code;
-  DiskUsage disk_usage(0);
-  if (!fs::exists(disk_root, error_code)) {
+  if (!disk_root.empty() && !fs::exists(disk_root, error_code)) {
     if (!fs::create_directories(disk_root, error_code)) {
       LOG(kError) << "Can't create disk root at " << disk_root << ": " << error_code.message();
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
     }
   }
-  // TODO(Fraser#5#): 2014-01-30 - BEFORE_RELEASE re-enable this functionality using a different
-  //                               (much faster) method.
-/*
-  } else {
-    std::vector<fs::path> dirs_to_do;
-    dirs_to_do.push_back(disk_root);
-    while (!dirs_to_do.empty()) {
-      std::vector<std::future<UsedSpace>> futures;
-      for (uint32_t i = 0; i < 16 && !dirs_to_do.empty(); ++i) {
-        auto future = std::async(&GetUsedSpace, dirs_to_do.back());
-        dirs_to_do.pop_back();
-        futures.push_back(std::move(future));
-      }
-      try {
-        while (!futures.empty()) {
-          auto future = std::move(futures.back());
-          futures.pop_back();
-          UsedSpace result = future.get();
-          disk_usage.data += result.disk_usage.data;
-          std::copy(result.directories.begin(), result.directories.end(),
-                    std::back_inserter(dirs_to_do));
-        }
-      }
-      catch (const std::system_error& exception) {
-        LOG(kError) << boost::diagnostic_information(exception);
-        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
-      }
-      catch (...) {
-        LOG(kError) << "exception during InitialiseDiskRoot";
-        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-      }
-    }
-  }
-*/
-  return disk_usage;
+  return disk_root;
 }
 
 }  // unnamed namespace
 
-FakeStore::FakeStore(const fs::path& disk_path, DiskUsage max_disk_usage)
-    : asio_service_(Concurrency() / 2),  // TODO(Fraser#5#): 2013-09-06 - determine best value.
-      kDiskPath_(disk_path),
-      max_disk_usage_(std::move(max_disk_usage)),
-      current_disk_usage_(InitialiseDiskRoot(kDiskPath_)),
+const size_t FakeStore::kMaxQueuedOperations(1024);
+const double FakeStore::kEvictionHeadroom(0.05);
+
+int FakeStore::DefaultThreadCount() {
+  return std::max(1, static_cast<int>(Concurrency()) / 2);
+}
+
+FakeStore::Options::Options()
+    : thread_count(DefaultThreadCount()),
+      layout(Layout::kFilePerChunk),
+      durability(Durability::kUnsynced),
+      io_engine(IoEngine::kBlocking),
+      eviction(Eviction::kNone) {}
+
+FakeStore::FakeStore(const fs::path& disk_path, DiskUsage max_disk_usage, const Options& options)
+    : FakeStore(std::vector<fs::path>(1, disk_path), max_disk_usage, options) {}
+
+FakeStore::FakeStore(const std::vector<fs::path>& disk_paths, DiskUsage max_disk_usage,
+                     const Options& options)
+    : queue_mutex_(),
+      queue_condition_(),
+      queued_operations_(0),
+      asio_service_(options.thread_count),
+      kDiskPath_(InitialiseDiskRoot(FirstDiskPath(disk_paths))),
+      max_disk_usage_(max_disk_usage.data),
+      current_disk_usage_(0),
       kDepth_(5),
+      kDurability_(in_memory() ? Durability::kUnsynced : options.durability),
+      key_mutexes_(),
+      index_mutex_(),
+      index_(in_memory() ? fs::path() : kDiskPath_ / kIndexJournalName),
+      name_filter_(),
+      sharded_backend_(nullptr),
+      backend_(MakeBackend(disk_paths, options.layout, options.durability, options.io_engine)),
+      versions_(kDiskPath_, kDepth_,
+                [this](uint64_t old_size, uint64_t new_size, const std::function<void()>& write) {
+                  ReplaceDiskSpace(old_size, new_size, write);
+                }),
+      access_tracker_(),
+      eviction_mutex_(),
+      eviction_passes_(0),
+      evicted_chunks_(0),
+      evicted_bytes_(0),
+      refused_puts_(0),
       get_identity_visitor_() {
-  if (current_disk_usage_ > max_disk_usage_)
+  if (!index_.loaded() && !in_memory())
+    RebuildIndex(index_);
+  index_.Compact();
+  RebuildNameFilter();
+  if (options.eviction != Eviction::kNone) {
+    access_tracker_ = maidsafe::make_unique<FakeStoreAccessTracker>(
+        options.eviction == Eviction::kLeastFrequentlyUsed ?
+            FakeStoreAccessTracker::Policy::kLeastFrequentlyUsed :
+            FakeStoreAccessTracker::Policy::kLeastRecentlyUsed);
+    // Nothing is known of how chunks were used before the store opened, so they start out equal.
+    index_.ForEach([&](const std::string& name, const FakeStoreIndex::Entry&) {
+      if (!IsVersionsName(name))
+        access_tracker_->Add(name);
+    });
+  }
+  if (sharded_backend_) {
+    index_.ForEach([&](const std::string& name, const FakeStoreIndex::Entry& entry) {
+      sharded_backend_->Account(EntryDevice(name), 0, entry.size);
+    });
+    sharded_backend_->StartMigration();
+  }
+  current_disk_usage_ = index_.total_size();
+  if (current_disk_usage_.load() > max_disk_usage_.load())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::cannot_exceed_limit));
 }
 
+FakeStore::FakeStore(DiskUsage max_disk_usage, const Options& options)
+    : FakeStore(fs::path(), max_disk_usage, options) {}
+
 FakeStore::~FakeStore() { asio_service_.Stop(); }
 
+void FakeStore::OperationDone() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    --queued_operations_;
+  }
+  queue_condition_.notify_one();
+}
+
 NonEmptyString FakeStore::DoGet(const KeyType& key) const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  fs::path file_path(KeyToFilePath(key, false));
-  uint32_t reference_count(GetReferenceCount(file_path));
-  file_path.replace_extension("." + std::to_string(reference_count));
-  return ReadFile(file_path);
+  const std::string name(IndexName(key));
+  // A name the filter rules out needn't wait for its key's mutex.
+  std::unique_lock<std::mutex> lock(KeyMutex(name), std::defer_lock);
+  if (name_filter_.MayContain(name))
+    lock.lock();
+  FakeStoreIndex::Entry entry;
+  if (!lock.owns_lock() || !FindEntry(name, entry)) {
+    LOG(kWarning) << HexSubstr(boost::apply_visitor(GetTagValueAndIdentityVisitor(), key).second)
+                  << " doesn't exist.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  if (access_tracker_)
+    access_tracker_->Touch(name);
+  return backend_->Read(name);
 }
 
 void FakeStore::DoPut(const KeyType& key, const NonEmptyString& value) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (!fs::exists(kDiskPath_))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  CheckDiskRoot();
 
-  fs::path file_path(KeyToFilePath(key, true));
+  const std::string name(IndexName(key));
+  std::lock_guard<std::mutex> lock(KeyMutex(name));
+  FakeStoreIndex::Entry entry;
+  const bool held(FindEntry(name, entry));
   uint32_t value_size(static_cast<uint32_t>(value.string().size()));
-  uintmax_t file_size(0);
-  uint32_t reference_count(GetReferenceCount(file_path));
   DataTagValue data_tag_value(boost::apply_visitor(GetTagValueVisitor(), key));
 
-  if (reference_count == 0) {
-    file_path.replace_extension(".1");
-    Write(file_path, value, value_size);
-    current_disk_usage_.data += value_size;
+  // The index is changed before the backend, so that the journal record is synced in the same
+  // group commit as the chunk, and is undone if the write fails.
+  if (!held) {
+    ReserveDiskSpace(value_size, name);
+    try {
+      PutEntry(name, FakeStoreIndex::Entry(1, value_size));
+      backend_->Write(name, value);
+    }
+    catch (const std::exception&) {
+      ReleaseDiskSpace(value_size);
+      // Does nothing if it was PutEntry that failed.
+      EraseEntry(name);
+      throw;
+    }
   } else if (data_tag_value == DataTagValue::kImmutableDataValue) {
-    fs::path old_path(file_path), new_path(file_path);
-    old_path.replace_extension("." + std::to_string(reference_count));
-    ++reference_count;
-    new_path.replace_extension("." + std::to_string(reference_count));
-    file_size = Rename(old_path, new_path);
-    assert(file_size == value_size);
+    assert(entry.size == value_size);
+    PutEntry(name, FakeStoreIndex::Entry(entry.reference_count + 1, entry.size));
+    SyncIndexIfDurable();
   } else {
-    assert(reference_count == 1);
-    file_path.replace_extension(".1");
-    file_size = Remove(file_path);
-    current_disk_usage_.data -= file_size;
-    Write(file_path, value, value_size);
-    current_disk_usage_.data += value_size;
+    assert(entry.reference_count == 1);
+    PutEntry(name, FakeStoreIndex::Entry(1, value_size));
+    try {
+      ReplaceDiskSpace(entry.size, value_size, [&] { backend_->Write(name, value); }, name);
+    }
+    catch (const std::exception&) {
+      PutEntry(name, entry);
+      throw;
+    }
   }
+  if (access_tracker_)
+    access_tracker_->Add(name);
 }
 
 void FakeStore::DoDelete(const KeyType& key) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  fs::path file_path(KeyToFilePath(key, false));
-  uintmax_t file_size(0);
-  uint32_t reference_count(GetReferenceCount(file_path));
+  const std::string name(IndexName(key));
+  std::unique_lock<std::mutex> lock(KeyMutex(name), std::defer_lock);
+  if (name_filter_.MayContain(name))
+    lock.lock();
+  FakeStoreIndex::Entry entry;
 
-  if (reference_count == 0) {
+  if (!lock.owns_lock() || !FindEntry(name, entry)) {
     LOG(kWarning) << HexSubstr(boost::apply_visitor(GetTagValueAndIdentityVisitor(), key).second)
                   << " already deleted.";
     return;
   }
 
-  if (reference_count == 1) {
-    file_path.replace_extension(".1");
-    file_size = Remove(file_path);
-    current_disk_usage_.data -= file_size;
+  if (entry.reference_count == 1) {
+    // As in DoPut, the index is changed first.
+    EraseEntry(name);
+    try {
+      backend_->Remove(name);
+    }
+    catch (const std::exception&) {
+      PutEntry(name, entry);
+      throw;
+    }
+    ReleaseDiskSpace(entry.size);
+    if (access_tracker_)
+      access_tracker_->Remove(name);
   } else {
-    fs::path new_path(file_path);
-    file_path.replace_extension("." + std::to_string(reference_count));
-    --reference_count;
-    new_path.replace_extension("." + std::to_string(reference_count));
-    file_size = Rename(file_path, new_path);
-    assert(file_size != 0);
+    PutEntry(name, FakeStoreIndex::Entry(entry.reference_count - 1, entry.size));
+    SyncIndexIfDurable();
   }
 }
 
 void FakeStore::IncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
-  asio_service_.service().post([this, data_names] {
+  Post([this, data_names] {
     try {
       DoIncrement(data_names);
     }
@@ -196,7 +264,7 @@ void FakeStore::IncrementReferenceCount(const std::vector<ImmutableData::Name>&
 }
 
 void FakeStore::DecrementReferenceCount(const std::vector<ImmutableData::Name>& data_names) {
-  asio_service_.service().post([this, data_names] {
+  Post([this, data_names] {
     try {
       DoDecrement(data_names);
     }
@@ -207,23 +275,19 @@ void FakeStore::DecrementReferenceCount(const std::vector<ImmutableData::Name>&
 }
 
 void FakeStore::DoIncrement(const std::vector<ImmutableData::Name>& data_names) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (!fs::exists(kDiskPath_))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  CheckDiskRoot();
 
   for (const auto& data_name : data_names) {
-    fs::path file_path(KeyToFilePath(data_name, false));
-    uint32_t reference_count(GetReferenceCount(file_path));
-    assert(reference_count != 0);
-
-    fs::path old_path(file_path), new_path(file_path);
-    old_path.replace_extension("." + std::to_string(reference_count));
-    ++reference_count;
-    new_path.replace_extension("." + std::to_string(reference_count));
-    auto file_size(Rename(old_path, new_path));
-    assert(file_size != 0);
-    static_cast<void>(file_size);
+    const std::string name(IndexName(KeyType(data_name)));
+    std::lock_guard<std::mutex> lock(KeyMutex(name));
+    FakeStoreIndex::Entry entry;
+    if (!FindEntry(name, entry)) {
+      LOG(kWarning) << HexSubstr(data_name.value) << " doesn't exist.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+    }
+    PutEntry(name, FakeStoreIndex::Entry(entry.reference_count + 1, entry.size));
   }
+  SyncIndexIfDurable();
 }
 
 void FakeStore::DoDecrement(const std::vector<ImmutableData::Name>& data_names) {
@@ -232,136 +296,304 @@ void FakeStore::DoDecrement(const std::vector<ImmutableData::Name>& data_names)
 }
 
 void FakeStore::SetMaxDiskUsage(DiskUsage max_disk_usage) {
-  if (current_disk_usage_ > max_disk_usage) {
-    LOG(kError) << "current_disk_usage_ " << current_disk_usage_.data
+  if (current_disk_usage_.load() > max_disk_usage.data) {
+    LOG(kError) << "current_disk_usage_ " << current_disk_usage_.load()
                 << " exceeds target max_disk_usage " << max_disk_usage.data;
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  max_disk_usage_ = max_disk_usage;
+  max_disk_usage_ = max_disk_usage.data;
 }
 
-DiskUsage FakeStore::GetMaxDiskUsage() const { return max_disk_usage_; }
+DiskUsage FakeStore::GetMaxDiskUsage() const { return DiskUsage(max_disk_usage_.load()); }
 
 DiskUsage FakeStore::GetCurrentDiskUsage() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return current_disk_usage_;
+  return DiskUsage(current_disk_usage_.load());
 }
 
-fs::path FakeStore::GetFilePath(const KeyType& key) const {
-  return kDiskPath_ / detail::GetFileName(key);
+boost::future<DiskUsage> FakeStore::RescanDiskUsage() {
+  if (in_memory())
+    return boost::make_ready_future(GetCurrentDiskUsage());
+  return boost::async(boost::launch::async, [this]() -> DiskUsage {
+    FakeStoreIndex rescanned((fs::path()));
+    RebuildIndex(rescanned);
+    DiskUsage disk_usage(rescanned.total_size());
+    DiskUsage current_disk_usage(GetCurrentDiskUsage());
+    if (disk_usage.data != current_disk_usage.data) {
+      LOG(kWarning) << "Rescan of " << kDiskPath_ << " found " << disk_usage.data
+                    << " bytes in use, but the index records " << current_disk_usage.data;
+    }
+    return disk_usage;
+  });
 }
 
-bool FakeStore::HasDiskSpace(uint64_t required_space) const {
-  return current_disk_usage_ + required_space <= max_disk_usage_;
+FakeStore::EvictionStats FakeStore::GetEvictionStats() const {
+  EvictionStats stats;
+  stats.passes = eviction_passes_.load();
+  stats.evicted_chunks = evicted_chunks_.load();
+  stats.evicted_bytes = evicted_bytes_.load();
+  stats.refused_puts = refused_puts_.load();
+  return stats;
 }
 
-fs::path FakeStore::KeyToFilePath(const KeyType& key, bool create_if_missing) const {
-  NonEmptyString file_name(GetFilePath(key).filename().string());
+std::vector<DiskUsage> FakeStore::GetDeviceUsage() const {
+  if (!sharded_backend_)
+    return std::vector<DiskUsage>(1, GetCurrentDiskUsage());
+  std::vector<DiskUsage> device_usage;
+  for (uint64_t used_bytes : sharded_backend_->DeviceUsage())
+    device_usage.emplace_back(used_bytes);
+  return device_usage;
+}
 
-  uint32_t directory_depth = kDepth_;
-  if (file_name.string().length() < directory_depth)
-    directory_depth = static_cast<uint32_t>(file_name.string().length() - 1);
+size_t FakeStore::GetPendingMigrations() const {
+  return sharded_backend_ ? sharded_backend_->pending_migrations() : 0;
+}
 
-  fs::path disk_path(kDiskPath_);
-  for (uint32_t i = 0; i < directory_depth; ++i)
-    disk_path /= file_name.string().substr(i, 1);
+fs::path FakeStore::GetFilePath(const KeyType& key) const {
+  return kDiskPath_ / detail::GetFileName(key);
+}
+
+void FakeStore::CheckDiskRoot() const {
+  if (!in_memory() && !fs::exists(kDiskPath_))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
 
-  if (create_if_missing) {
-    boost::system::error_code ec;
-    fs::create_directories(disk_path, ec);
+void FakeStore::ReserveDiskSpace(uint64_t size, const std::string& held_name) {
+  if (TryReserveDiskSpace(size))
+    return;
+  if (access_tracker_ && !held_name.empty()) {
+    Evict(size, held_name);
+    if (TryReserveDiskSpace(size))
+      return;
+    ++refused_puts_;
   }
+  LOG(kError) << "Out of space.";
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::cannot_exceed_limit));
+}
 
-  return fs::path(disk_path / file_name.string().substr(directory_depth));
+bool FakeStore::TryReserveDiskSpace(uint64_t size) {
+  uint64_t current_disk_usage(current_disk_usage_.load());
+  do {
+    if (current_disk_usage + size > max_disk_usage_.load())
+      return false;
+  } while (!current_disk_usage_.compare_exchange_weak(current_disk_usage,
+                                                      current_disk_usage + size));
+  return true;
 }
 
-uint32_t FakeStore::GetReferenceCount(const fs::path& path) const {
-  boost::system::error_code error_code;
-  if (!fs::exists(path.parent_path(), error_code)) {
-    LOG(kWarning) << path << " doesn't exist.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  }
+void FakeStore::ReleaseDiskSpace(uint64_t size) { current_disk_usage_ -= size; }
 
+void FakeStore::ReplaceDiskSpace(uint64_t old_size, uint64_t new_size,
+                                 const std::function<void()>& write, const std::string& held_name) {
+  if (new_size > old_size)
+    ReserveDiskSpace(new_size - old_size, held_name);
   try {
-    std::string file_name(path.filename().string());
-    fs::directory_iterator end;
-    for (fs::directory_iterator it(path.parent_path()); it != end; ++it) {
-      if (it->path().stem().string() == file_name && fs::is_regular_file(it->status()))
-        return std::stoul(it->path().extension().string().substr(1));
-    }
+    write();
   }
-  catch (const std::exception& e) {
-    LOG(kError) << "Exception: " << boost::diagnostic_information(e);
+  catch (const std::exception&) {
+    if (new_size > old_size)
+      ReleaseDiskSpace(new_size - old_size);
+    throw;
   }
-
-  return 0;
+  if (new_size < old_size)
+    ReleaseDiskSpace(old_size - new_size);
 }
 
-void FakeStore::Write(const boost::filesystem::path& path, const NonEmptyString& value,
-                          const uintmax_t& size) {
-  if (!HasDiskSpace(size)) {
-    LOG(kError) << "Out of space.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::cannot_exceed_limit));
-  }
-  if (!WriteFile(path, value.string())) {
-    LOG(kError) << "Write failed.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+void FakeStore::Evict(uint64_t size, const std::string& held_name) {
+  std::lock_guard<std::mutex> eviction_lock(eviction_mutex_);
+  const uint64_t max_disk_usage(max_disk_usage_.load());
+  // Nothing would make room for a chunk larger than the store; and a pass which finished while this
+  // one waited may have made room already.
+  if (size > max_disk_usage || current_disk_usage_.load() + size <= max_disk_usage)
+    return;
+  ++eviction_passes_;
+  const uint64_t wanted(size + static_cast<uint64_t>(max_disk_usage * kEvictionHeadroom));
+  const uint64_t target(max_disk_usage - std::min(max_disk_usage, wanted));
+  std::mutex& held_mutex(KeyMutex(held_name));
+  for (const auto& name : access_tracker_->Candidates()) {
+    if (current_disk_usage_.load() <= target)
+      break;
+    if (name == held_name)
+      continue;
+    // The caller already holds its own key's mutex, which may also be this chunk's.
+    std::mutex& key_mutex(KeyMutex(name));
+    std::unique_lock<std::mutex> key_lock(key_mutex, std::defer_lock);
+    if (&key_mutex != &held_mutex && !key_lock.try_lock())
+      continue;
+    FakeStoreIndex::Entry entry;
+    if (!FindEntry(name, entry)) {
+      access_tracker_->Remove(name);
+      continue;
+    }
+    if (entry.reference_count != 1)
+      continue;
+    EraseEntry(name);
+    try {
+      backend_->Remove(name);
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Failed to evict " << name << ": " << boost::diagnostic_information(e);
+      PutEntry(name, entry);
+      continue;
+    }
+    ReleaseDiskSpace(entry.size);
+    access_tracker_->Remove(name);
+    ++evicted_chunks_;
+    evicted_bytes_ += entry.size;
   }
 }
 
-uintmax_t FakeStore::Remove(const fs::path& path) {
-  boost::system::error_code error_code;
-  uintmax_t file_size = fs::file_size(path, error_code);
-  if (error_code) {
-    LOG(kError) << "Error getting file size of " << path << ": " << error_code.message();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
-  }
-  if (!fs::remove(path, error_code) || error_code) {
-    LOG(kError) << "Error removing file " << path << ": " << error_code.message();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
-  }
-  return file_size;
+std::mutex& FakeStore::KeyMutex(const std::string& name) const {
+  return key_mutexes_[std::hash<std::string>()(name) % key_mutexes_.size()];
 }
 
-uintmax_t FakeStore::Rename(const fs::path& old_path, const fs::path& new_path) {
-  boost::system::error_code error_code;
-  uintmax_t file_size = fs::file_size(old_path, error_code);
-  if (error_code) {
-    LOG(kError) << "Error getting file size of " << old_path << ": " << error_code.message();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+std::mutex& FakeStore::KeyMutex(const KeyType& key) const { return KeyMutex(IndexName(key)); }
+
+bool FakeStore::FindEntry(const std::string& name, FakeStoreIndex::Entry& entry) const {
+  if (!name_filter_.MayContain(name))
+    return false;
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  const FakeStoreIndex::Entry* found(index_.Find(name));
+  if (found)
+    entry = *found;
+  return found != nullptr;
+}
+
+void FakeStore::PutEntry(const std::string& name, const FakeStoreIndex::Entry& entry) {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  const FakeStoreIndex::Entry* old_entry(index_.Find(name));
+  const bool added(old_entry == nullptr);
+  const uint64_t old_size(added ? 0 : old_entry->size);
+  index_.Put(name, entry);
+  if (sharded_backend_)
+    sharded_backend_->Account(EntryDevice(name), old_size, entry.size);
+  if (added) {
+    name_filter_.Add(name);
+    if (name_filter_.overfull())
+      RebuildNameFilter();
   }
-  fs::rename(old_path, new_path, error_code);
-  if (error_code) {
-    LOG(kError) << "Error renaming file " << old_path << ": " << error_code.message();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+void FakeStore::EraseEntry(const std::string& name) {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  const FakeStoreIndex::Entry* old_entry(index_.Find(name));
+  if (!old_entry)
+    return;
+  const uint64_t old_size(old_entry->size);
+  index_.Erase(name);
+  if (sharded_backend_)
+    sharded_backend_->Account(EntryDevice(name), old_size, 0);
+  name_filter_.Remove(name);
+}
+
+void FakeStore::SyncIndex() {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  index_.Sync();
+}
+
+void FakeStore::SyncIndexIfDurable() {
+  if (kDurability_ == Durability::kBatched || kDurability_ == Durability::kPerOperation)
+    SyncIndex();
+}
+
+void FakeStore::RebuildNameFilter() {
+  name_filter_.Rebuild(index_.size(), [this](const std::function<void(const std::string&)>& add) {
+    index_.ForEach([&](const std::string& name, const FakeStoreIndex::Entry&) { add(name); });
+  });
+}
+
+size_t FakeStore::EntryDevice(const std::string& name) const {
+  // Version trees live beside the index, on the first device.
+  return IsVersionsName(name) ? 0 : sharded_backend_->DeviceOf(name);
+}
+
+fs::path FakeStore::KeyToFilePath(const KeyType& key, bool create_if_missing) const {
+  return detail::NameToPath(kDiskPath_, IndexName(key), kDepth_, create_if_missing);
+}
+
+std::string FakeStore::IndexName(const KeyType& key) const {
+  // Just the file name, without building the path under the store's root.
+  return detail::GetFileName(key).string();
+}
+
+std::string FakeStore::VersionsIndexName(const KeyType& key) const {
+  return IndexName(key) + kVersionsExtension;
+}
+
+void FakeStore::RebuildIndex(FakeStoreIndex& index) {
+  backend_->Rebuild(index);
+  detail::ForEachFile(kDiskPath_, [&](const fs::path& path, const std::string& name,
+                                      uint64_t size) {
+    if (path.extension() != kVersionsExtension && path.extension() != kVersionLogExtension)
+      return;
+    const std::string versions_name(name + kVersionsExtension);
+    const FakeStoreIndex::Entry* entry(index.Find(versions_name));
+    index.Put(versions_name, FakeStoreIndex::Entry(1, size + (entry ? entry->size : 0)));
+  });
+}
+
+std::unique_ptr<FakeStoreBackend> FakeStore::MakeBackend(const std::vector<fs::path>& disk_paths,
+                                                         Layout layout, Durability durability,
+                                                         IoEngine io_engine) {
+  if (in_memory())
+    return maidsafe::make_unique<FakeStoreMemoryBackend>();
+  std::unique_ptr<FakeStoreBackend> backend;
+  // Once sharded, a store has a manifest, and stays sharded even if reopened with one path (which
+  // the sharded backend then refuses).
+  if (disk_paths.size() > 1 || fs::exists(FakeStoreShardedBackend::ManifestPath(kDiskPath_))) {
+    auto sharded_backend(maidsafe::make_unique<FakeStoreShardedBackend>(
+        disk_paths, [=](const fs::path& root, BoostAsioService& io_queue) {
+          return MakeDeviceBackend(root, layout, io_engine, io_queue);
+        }));
+    sharded_backend_ = sharded_backend.get();
+    backend = std::move(sharded_backend);
+  } else {
+    backend = MakeDeviceBackend(kDiskPath_, layout, io_engine, asio_service_);
   }
-  return file_size;
+  if (durability == Durability::kUnsynced)
+    return backend;
+  return maidsafe::make_unique<FakeStoreWriteBehind>(
+      std::move(backend), durability, asio_service_, FakeStoreWriteBehind::kDefaultMaxBufferedBytes,
+      [this] { SyncIndex(); });
 }
 
-std::unique_ptr<StructuredDataVersions> FakeStore::ReadVersions(const KeyType& key) const {
-  fs::path file_path(KeyToFilePath(key, false));
-  file_path.replace_extension(".ver");
-  boost::system::error_code ec;
-  return fs::exists(file_path, ec) ?
-      std::move(maidsafe::make_unique<StructuredDataVersions>(
-          StructuredDataVersions::serialised_type(ReadFile(file_path)))) :
-      std::move(std::unique_ptr<StructuredDataVersions>());
+std::unique_ptr<FakeStoreBackend> FakeStore::MakeDeviceBackend(const fs::path& root,
+                                                               Layout layout, IoEngine io_engine,
+                                                               BoostAsioService& io_queue) {
+  if (layout == Layout::kSegments)
+    return maidsafe::make_unique<FakeStoreSegmentBackend>(root / kSegmentDirectoryName, io_queue);
+  if (io_engine == IoEngine::kIoUring && FakeStoreUringBackend::Available())
+    return maidsafe::make_unique<FakeStoreUringBackend>(root, kDepth_);
+  if (io_engine == IoEngine::kIoUring)
+    LOG(kWarning) << "io_uring isn't available; using blocking IO for " << root;
+  return maidsafe::make_unique<FakeStoreFileBackend>(root, kDepth_);
 }
 
-void FakeStore::WriteVersions(const KeyType& key, const StructuredDataVersions& versions) {
-  if (!fs::exists(kDiskPath_))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+std::shared_ptr<const StructuredDataVersions> FakeStore::ReadVersions(
+    const KeyType& key) const {
+  FakeStoreIndex::Entry entry;
+  if (!FindEntry(VersionsIndexName(key), entry))
+    return nullptr;
+  return versions_.Get(IndexName(key));
+}
 
-  fs::path file_path(KeyToFilePath(key, true));
-  file_path.replace_extension(".ver");
+void FakeStore::WriteVersions(const KeyType& key, const StructuredDataVersions& versions) {
+  CheckDiskRoot();
+  PutEntry(VersionsIndexName(key),
+           FakeStoreIndex::Entry(1, versions_.Create(IndexName(key), versions)));
+}
 
-  boost::system::error_code ec;
-  if (fs::exists(file_path, ec))
-    current_disk_usage_.data -= fs::file_size(file_path, ec);
+void FakeStore::DoPutVersion(const KeyType& key,
+                             const StructuredDataVersions::VersionName& old_version_name,
+                             const StructuredDataVersions::VersionName& new_version_name) {
+  PutEntry(VersionsIndexName(key),
+           FakeStoreIndex::Entry(1, versions_.Put(IndexName(key), old_version_name,
+                                                  new_version_name)));
+}
 
-  auto serialised_versions(versions.Serialise().data);
-  uint32_t value_size(static_cast<uint32_t>(serialised_versions.string().size()));
-  Write(file_path, serialised_versions, value_size);
-  current_disk_usage_.data += value_size;
+void FakeStore::DoDeleteBranchUntilFork(const KeyType& key,
+                                        const StructuredDataVersions::VersionName& branch_tip) {
+  PutEntry(VersionsIndexName(key),
+           FakeStoreIndex::Entry(1, versions_.DeleteBranchUntilFork(IndexName(key), branch_tip)));
 }
 
 }  // namespace nfs
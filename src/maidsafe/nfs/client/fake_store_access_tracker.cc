@@ -0,0 +1,97 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_access_tracker.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <utility>
+
+namespace maidsafe {
+
+namespace nfs {
+
+const size_t FakeStoreAccessTracker::kShardCount;
+const uint32_t FakeStoreAccessTracker::kMaxFrequency(1 << 16);
+
+FakeStoreAccessTracker::FakeStoreAccessTracker(Policy policy)
+    : kPolicy_(policy), clock_(0), shards_() {}
+
+void FakeStoreAccessTracker::Add(const std::string& name) {
+  Shard& shard(GetShard(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Use(shard.accesses[name]);
+}
+
+void FakeStoreAccessTracker::Touch(const std::string& name) {
+  Shard& shard(GetShard(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto itr(shard.accesses.find(name));
+  if (itr != std::end(shard.accesses))
+    Use(itr->second);
+}
+
+void FakeStoreAccessTracker::Remove(const std::string& name) {
+  Shard& shard(GetShard(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.accesses.erase(name);
+}
+
+std::vector<std::string> FakeStoreAccessTracker::Candidates() {
+  // (frequency, last use, name), with frequency zero throughout for LRU.
+  std::vector<std::tuple<uint32_t, uint64_t, std::string>> scored;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto& name_and_access : shard.accesses) {
+      Access& access(name_and_access.second);
+      scored.emplace_back(kPolicy_ == Policy::kLeastFrequentlyUsed ? access.frequency : 0,
+                          access.last_use, name_and_access.first);
+      access.frequency /= 2;
+    }
+  }
+  std::sort(std::begin(scored), std::end(scored));
+  std::vector<std::string> candidates;
+  candidates.reserve(scored.size());
+  for (auto& score : scored)
+    candidates.push_back(std::move(std::get<2>(score)));
+  return candidates;
+}
+
+size_t FakeStoreAccessTracker::size() const {
+  size_t count(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.accesses.size();
+  }
+  return count;
+}
+
+FakeStoreAccessTracker::Shard& FakeStoreAccessTracker::GetShard(const std::string& name) {
+  return shards_[std::hash<std::string>()(name) % kShardCount];
+}
+
+void FakeStoreAccessTracker::Use(Access& access) {
+  access.last_use = ++clock_;
+  if (access.frequency < kMaxFrequency)
+    ++access.frequency;
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
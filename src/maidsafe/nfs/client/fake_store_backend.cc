@@ -0,0 +1,279 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <future>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+// Chunks were once stored with their reference count as the file extension, renamed on every
+// change of count.  They now have this extension, with the count kept in the index.
+const char kChunkExtension[] = ".data";
+
+}  // unnamed namespace
+
+void FakeStoreBackend::WriteMany(
+    const std::vector<std::pair<std::string, NonEmptyString>>& chunks) {
+  for (const auto& chunk : chunks)
+    Write(chunk.first, chunk.second);
+}
+
+void FakeStoreBackend::ForEachName(const std::function<void(const std::string& name)>& functor) {
+  FakeStoreIndex index((fs::path()));
+  Rebuild(index);
+  index.ForEach([&](const std::string& name, const FakeStoreIndex::Entry&) { functor(name); });
+}
+
+namespace detail {
+
+fs::path NameToPath(const fs::path& root, const std::string& name, uint32_t depth,
+                    bool create_if_missing) {
+  uint32_t directory_depth = depth;
+  if (name.length() < directory_depth)
+    directory_depth = static_cast<uint32_t>(name.length() - 1);
+
+  fs::path disk_path(root);
+  for (uint32_t i = 0; i < directory_depth; ++i)
+    disk_path /= name.substr(i, 1);
+
+  if (create_if_missing) {
+    boost::system::error_code ec;
+    fs::create_directories(disk_path, ec);
+  }
+
+  return fs::path(disk_path / name.substr(directory_depth));
+}
+
+void ForEachFile(const fs::path& root, const FileFunctor& functor) {
+  std::mutex mutex;
+  // 'prefix' is the part of the name spread over the directories above 'directory'.
+  auto walk([&](const fs::path& directory, const std::string& prefix) {
+    for (fs::recursive_directory_iterator itr(directory), end; itr != end; ++itr) {
+      if (!fs::is_regular_file(itr->status()))
+        continue;
+      const fs::path& path(itr->path());
+      const uint64_t size(fs::file_size(path));
+      std::string name(path.stem().string());
+      fs::path parent(path.parent_path());
+      for (int level(itr.level()); level > 0; --level) {
+        name = parent.filename().string() + name;
+        parent = parent.parent_path();
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      functor(path, prefix + name, size);
+    }
+  });
+
+  std::vector<std::future<void>> futures;
+  for (fs::directory_iterator itr(root), end; itr != end; ++itr) {
+    const fs::path path(itr->path());
+    if (fs::is_directory(itr->status())) {
+      futures.push_back(std::async(std::launch::async, [=] {
+        walk(path, path.filename().string());
+      }));
+    } else if (fs::is_regular_file(itr->status())) {
+      const uint64_t size(fs::file_size(path));
+      std::lock_guard<std::mutex> lock(mutex);
+      functor(path, path.stem().string(), size);
+    }
+  }
+  for (auto& future : futures)
+    future.get();
+}
+
+void SyncFile(const fs::path& path) {
+  bool synced(false);
+#ifdef _WIN32
+  // Windows has no way to flush a directory's entries; they're journalled by NTFS anyway.
+  if (fs::is_directory(path))
+    return;
+  HANDLE file(CreateFileW(path.c_str(), GENERIC_WRITE,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+  if (file != INVALID_HANDLE_VALUE) {
+    synced = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+  }
+#else
+  int file(::open(path.c_str(), O_RDONLY));
+  if (file != -1) {
+    synced = ::fsync(file) == 0;
+    ::close(file);
+  }
+#endif
+  if (!synced) {
+    LOG(kError) << "Failed to sync " << path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+}  // namespace detail
+
+FakeStoreFileBackend::FakeStoreFileBackend(fs::path root, uint32_t depth)
+    : kRoot_(std::move(root)), kDepth_(depth) {}
+
+NonEmptyString FakeStoreFileBackend::Read(const std::string& name) const {
+  return ReadFile(ChunkPath(name, false));
+}
+
+void FakeStoreFileBackend::Write(const std::string& name, const NonEmptyString& value) {
+  const fs::path path(ChunkPath(name, true));
+  if (!WriteFile(path, value.string())) {
+    LOG(kError) << "Write failed.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+void FakeStoreFileBackend::Remove(const std::string& name) {
+  fs::path path(ChunkPath(name, false));
+  boost::system::error_code error_code;
+  if (!fs::remove(path, error_code)) {
+    if (error_code) {
+      LOG(kError) << "Error removing file " << path << ": " << error_code.message();
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+    LOG(kWarning) << path << " doesn't exist.";
+  }
+}
+
+void FakeStoreFileBackend::Sync(const std::vector<std::string>& names) {
+  for (const auto& path : SyncPaths(names))
+    detail::SyncFile(path);
+}
+
+void FakeStoreFileBackend::Rebuild(FakeStoreIndex& index) {
+  LOG(kInfo) << "Building index of " << kRoot_;
+  // Renamed once the scan is done, so the scan doesn't come across them a second time.
+  std::vector<std::pair<fs::path, fs::path>> renames;
+  try {
+    detail::ForEachFile(kRoot_, [&](const fs::path& path, const std::string& name,
+                                    uint64_t size) {
+      const std::string extension(path.extension().string());
+      FakeStoreIndex::Entry entry(1, size);
+      if (extension == kChunkExtension) {
+        LOG(kWarning) << "Reference count of " << path << " lost; assuming 1.";
+      } else if (extension.size() > 1 &&
+                 extension.find_first_not_of("0123456789", 1) == std::string::npos) {
+        entry.reference_count = static_cast<uint32_t>(std::stoul(extension.substr(1)));
+        fs::path new_path(path);
+        renames.emplace_back(path, new_path.replace_extension(kChunkExtension));
+      } else {
+        return;  // Versions, or the journal itself.
+      }
+      index.Put(name, entry);
+    });
+    for (const auto& rename : renames)
+      fs::rename(rename.first, rename.second);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to build index: " << boost::diagnostic_information(e);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+void FakeStoreFileBackend::ForEachName(
+    const std::function<void(const std::string& name)>& functor) {
+  detail::ForEachFile(kRoot_, [&](const fs::path& path, const std::string& name, uint64_t) {
+    if (path.extension() == kChunkExtension)
+      functor(name);
+  });
+}
+
+fs::path FakeStoreFileBackend::ChunkPath(const std::string& name, bool create_if_missing) const {
+  return detail::NameToPath(kRoot_, name, kDepth_, create_if_missing)
+      .replace_extension(kChunkExtension);
+}
+
+std::vector<fs::path> FakeStoreFileBackend::SyncPaths(const std::vector<std::string>& names) const {
+  // Any of the directories may have been created for the chunk, so each needs its own entry in its
+  // parent synced.
+  std::vector<fs::path> paths;
+  std::set<fs::path> directories;
+  boost::system::error_code error_code;
+  for (const auto& name : names) {
+    const fs::path path(ChunkPath(name, false));
+    // A removed chunk has only its directory entry to sync.
+    if (fs::exists(path, error_code))
+      paths.push_back(path);
+    for (fs::path directory(path.parent_path()); !directory.empty();
+         directory = directory.parent_path()) {
+      if (!directories.insert(directory).second || directory == kRoot_)
+        break;
+    }
+  }
+  for (const auto& directory : directories) {
+    if (fs::exists(directory, error_code))
+      paths.push_back(directory);
+  }
+  return paths;
+}
+
+FakeStoreMemoryBackend::FakeStoreMemoryBackend() : mutex_(), chunks_() {}
+
+NonEmptyString FakeStoreMemoryBackend::Read(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(chunks_.find(name));
+  if (itr == std::end(chunks_))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  return itr->second;
+}
+
+void FakeStoreMemoryBackend::Write(const std::string& name, const NonEmptyString& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  chunks_[name] = value;
+}
+
+void FakeStoreMemoryBackend::Remove(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (chunks_.erase(name) == 0)
+    LOG(kWarning) << name << " isn't held.";
+}
+
+void FakeStoreMemoryBackend::Rebuild(FakeStoreIndex& index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& chunk : chunks_)
+    index.Put(chunk.first, FakeStoreIndex::Entry(1, chunk.second.string().size()));
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
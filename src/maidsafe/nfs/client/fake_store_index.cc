@@ -0,0 +1,214 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+// Each record is the operation, the length of the name, the name, the reference count and the
+// size, the integers in host byte order.
+template <typename T>
+void WriteValue(std::ostream& stream, const T& value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadValue(std::istream& stream, T& value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+}  // unnamed namespace
+
+const size_t FakeStoreIndex::kCompactionFactor(4);
+const size_t FakeStoreIndex::kMinCompactionSize_(256);
+
+FakeStoreIndex::FakeStoreIndex(fs::path journal_path)
+    : kJournalPath_(std::move(journal_path)),
+      entries_(),
+      total_size_(0),
+      journal_(),
+      journal_records_(0),
+      loaded_(false) {
+  Load();
+}
+
+const FakeStoreIndex::Entry* FakeStoreIndex::Find(const std::string& name) const {
+  auto itr(entries_.find(name));
+  return itr == std::end(entries_) ? nullptr : &itr->second;
+}
+
+void FakeStoreIndex::Put(const std::string& name, const Entry& entry) {
+  // Journalled before it's applied, so that a failed append leaves the index as it was.
+  Append(Operation::kPut, name, entry);
+  Apply(Operation::kPut, name, entry);
+  CompactIfDue();
+}
+
+void FakeStoreIndex::Erase(const std::string& name) {
+  Append(Operation::kErase, name, Entry());
+  Apply(Operation::kErase, name, Entry());
+  CompactIfDue();
+}
+
+void FakeStoreIndex::Compact() {
+  if (kJournalPath_.empty())
+    return;
+  fs::path temp_path(kJournalPath_);
+  temp_path += ".tmp";
+  {
+    std::ofstream snapshot(temp_path.string(), std::ios::binary | std::ios::trunc);
+    for (const auto& name_and_entry : entries_) {
+      snapshot.put(static_cast<char>(Operation::kPut));
+      WriteValue(snapshot, static_cast<uint16_t>(name_and_entry.first.size()));
+      snapshot.write(name_and_entry.first.data(), name_and_entry.first.size());
+      WriteValue(snapshot, name_and_entry.second.reference_count);
+      WriteValue(snapshot, name_and_entry.second.size);
+    }
+    snapshot.flush();
+    if (!snapshot) {
+      LOG(kError) << "Failed to write index snapshot " << temp_path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+  }
+  // Otherwise a crash soon after the rename could leave less than the journal it replaced.
+  detail::SyncFile(temp_path);
+  if (journal_.is_open())
+    journal_.close();
+  boost::system::error_code error_code;
+  fs::rename(temp_path, kJournalPath_, error_code);
+  const bool renamed(!error_code);
+  if (!renamed) {
+    LOG(kError) << "Failed to replace index journal " << kJournalPath_ << ": "
+                << error_code.message();
+  }
+  // Reopened either way, so that if the rename failed changes are still journalled to the old one.
+  journal_.clear();
+  journal_.open(kJournalPath_.string(), std::ios::binary | std::ios::app);
+  if (!journal_) {
+    LOG(kError) << "Failed to open index journal " << kJournalPath_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (!renamed)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  journal_records_ = entries_.size();
+  // Otherwise a crash could undo the rename, leaving the old journal without the changes since.
+  detail::SyncFile(kJournalPath_.has_parent_path() ? kJournalPath_.parent_path() : fs::path("."));
+}
+
+void FakeStoreIndex::Sync() {
+  if (journal_.is_open())
+    detail::SyncFile(kJournalPath_);
+}
+
+void FakeStoreIndex::Load() {
+  boost::system::error_code error_code;
+  if (kJournalPath_.empty() || !fs::exists(kJournalPath_, error_code))
+    return;
+  std::ifstream journal(kJournalPath_.string(), std::ios::binary);
+  for (;;) {
+    char operation(0);
+    uint16_t name_size(0);
+    Entry entry;
+    if (!journal.get(operation) || !ReadValue(journal, name_size))
+      break;
+    std::string name(name_size, '\0');
+    if (!journal.read(&name[0], name_size) || !ReadValue(journal, entry.reference_count) ||
+        !ReadValue(journal, entry.size)) {
+      LOG(kWarning) << "Index journal " << kJournalPath_ << " ends with an incomplete record";
+      break;
+    }
+    if (operation == static_cast<char>(Operation::kPut) ||
+        operation == static_cast<char>(Operation::kErase)) {
+      Apply(static_cast<Operation>(operation), name, entry);
+    } else {
+      LOG(kError) << "Index journal " << kJournalPath_ << " is corrupt";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  loaded_ = true;
+}
+
+void FakeStoreIndex::Apply(Operation operation, const std::string& name, const Entry& entry) {
+  auto itr(entries_.find(name));
+  if (itr != std::end(entries_)) {
+    total_size_ -= itr->second.size;
+    if (operation == Operation::kErase) {
+      entries_.erase(itr);
+      return;
+    }
+    itr->second = entry;
+  } else if (operation == Operation::kErase) {
+    return;
+  } else {
+    entries_.insert(std::make_pair(name, entry));
+  }
+  total_size_ += entry.size;
+}
+
+void FakeStoreIndex::Append(Operation operation, const std::string& name, const Entry& entry) {
+  if (!journal_.is_open())
+    return;
+  journal_.put(static_cast<char>(operation));
+  WriteValue(journal_, static_cast<uint16_t>(name.size()));
+  journal_.write(name.data(), name.size());
+  WriteValue(journal_, entry.reference_count);
+  WriteValue(journal_, entry.size);
+  // Flushed to the OS, so the record survives the process crashing; Sync makes it survive the
+  // machine crashing too.
+  journal_.flush();
+  if (!journal_) {
+    LOG(kError) << "Failed to append to index journal " << kJournalPath_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  ++journal_records_;
+}
+
+void FakeStoreIndex::CompactIfDue() {
+  if (!journal_.is_open() ||
+      journal_records_ <= kCompactionFactor * std::max(entries_.size(), kMinCompactionSize_)) {
+    return;
+  }
+  // The change is journalled and applied by now, so this failing is no failure of the change.
+  try {
+    Compact();
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to compact index journal " << kJournalPath_ << ": "
+                  << boost::diagnostic_information(e);
+  }
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,108 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_name_filter.h"
+
+#include <utility>
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+// The counters for a name are found by double hashing: the i-th is at first + i * second.  The
+// second hash is derived from the first (MurmurHash3's finaliser) and made odd, so with a table
+// size that's a power of two every step visits a different counter.
+struct Probe {
+  explicit Probe(const std::string& name) : first(std::hash<std::string>()(name)), second(first) {
+    second ^= second >> 33;
+    second *= 0xff51afd7ed558ccdULL;
+    second ^= second >> 33;
+    second |= 1;
+  }
+  size_t Counter(int index, size_t mask) const {
+    return static_cast<size_t>(first + static_cast<uint64_t>(index) * second) & mask;
+  }
+  uint64_t first, second;
+};
+
+const uint8_t kSaturated(255);
+
+}  // unnamed namespace
+
+const size_t FakeStoreNameFilter::kCountersPerName(10);
+const int FakeStoreNameFilter::kHashCount(7);
+const size_t FakeStoreNameFilter::kMinCapacity(1024);
+
+FakeStoreNameFilter::FakeStoreNameFilter() : table_(nullptr), tables_(), capacity_(0), count_(0) {
+  Rebuild(0, [](const std::function<void(const std::string&)>&) {});
+}
+
+bool FakeStoreNameFilter::MayContain(const std::string& name) const {
+  const Table& table(*table_.load(std::memory_order_acquire));
+  const Probe probe(name);
+  const size_t mask(table.size() - 1);
+  for (int index(0); index < kHashCount; ++index) {
+    if (table[probe.Counter(index, mask)].load(std::memory_order_relaxed) == 0)
+      return false;
+  }
+  return true;
+}
+
+void FakeStoreNameFilter::Add(const std::string& name) {
+  Insert(*tables_.back(), name);
+  ++count_;
+}
+
+void FakeStoreNameFilter::Remove(const std::string& name) {
+  Table& table(*tables_.back());
+  const Probe probe(name);
+  const size_t mask(table.size() - 1);
+  for (int index(0); index < kHashCount; ++index) {
+    std::atomic<uint8_t>& counter(table[probe.Counter(index, mask)]);
+    const uint8_t value(counter.load(std::memory_order_relaxed));
+    if (value != 0 && value != kSaturated)
+      counter.store(static_cast<uint8_t>(value - 1), std::memory_order_relaxed);
+  }
+  if (count_ != 0)
+    --count_;
+}
+
+void FakeStoreNameFilter::Insert(Table& table, const std::string& name) const {
+  const Probe probe(name);
+  const size_t mask(table.size() - 1);
+  // Only one writer at a time, so a load and store will do; lookups see either value.
+  for (int index(0); index < kHashCount; ++index) {
+    std::atomic<uint8_t>& counter(table[probe.Counter(index, mask)]);
+    const uint8_t value(counter.load(std::memory_order_relaxed));
+    if (value != kSaturated)
+      counter.store(static_cast<uint8_t>(value + 1), std::memory_order_relaxed);
+  }
+}
+
+void FakeStoreNameFilter::Publish(std::unique_ptr<Table> table, size_t capacity, size_t count) {
+  table_.store(table.get(), std::memory_order_release);
+  tables_.push_back(std::move(table));
+  capacity_ = capacity;
+  count_ = count;
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
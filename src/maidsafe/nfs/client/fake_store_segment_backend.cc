@@ -0,0 +1,401 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_segment_backend.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+const char kSegmentExtension[] = ".seg";
+
+// Each record is the record type, the length of the name, the length of the value, the name and the
+// value, the integers in host byte order.
+const uint64_t kHeaderSize(sizeof(char) + sizeof(uint16_t) + sizeof(uint32_t));
+
+template <typename T>
+void WriteValue(std::ostream& stream, const T& value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadValue(std::istream& stream, T& value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+}  // unnamed namespace
+
+const uint64_t FakeStoreSegmentBackend::kDefaultSegmentSize(64 * 1024 * 1024);
+const double FakeStoreSegmentBackend::kCompactionThreshold(0.5);
+
+FakeStoreSegmentBackend::FakeStoreSegmentBackend(fs::path directory,
+                                                 BoostAsioService& asio_service,
+                                                 uint64_t segment_size)
+    : kDirectory_(std::move(directory)),
+      kSegmentSize_(segment_size),
+      asio_service_(asio_service),
+      mutex_(),
+      compaction_mutex_(),
+      sync_mutex_(),
+      locations_(),
+      segments_(),
+      active_segment_(0),
+      active_(),
+      compaction_pending_(false),
+      unsynced_segments_(),
+      directory_unsynced_(false) {
+  Load();
+}
+
+NonEmptyString FakeStoreSegmentBackend::Read(const std::string& name) const {
+  // A compaction between the lookup and the read can delete the segment, in which case the chunk
+  // has since moved and a second lookup finds it.
+  for (int attempt(0); attempt != 2; ++attempt) {
+    Location location;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(locations_.find(name));
+      if (itr == std::end(locations_))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      location = itr->second;
+    }
+    std::ifstream stream(SegmentPath(location.segment).string(), std::ios::binary);
+    std::string value(location.size, '\0');
+    if (stream.seekg(location.offset) && stream.read(&value[0], location.size))
+      return NonEmptyString(value);
+  }
+  LOG(kError) << "Failed to read " << name << " from " << kDirectory_;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+void FakeStoreSegmentBackend::Write(const std::string& name, const NonEmptyString& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Location location(Append(RecordType::kPut, name, value.string()));
+  segments_[location.segment].live += RecordSize(name, location.size);
+  auto itr(locations_.find(name));
+  if (itr == std::end(locations_)) {
+    locations_.insert(std::make_pair(name, location));
+  } else {
+    Location old_location(itr->second);
+    itr->second = location;
+    Release(name, old_location);
+    ScheduleCompaction(old_location.segment);
+  }
+}
+
+void FakeStoreSegmentBackend::Remove(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(locations_.find(name));
+  if (itr == std::end(locations_)) {
+    LOG(kWarning) << name << " isn't held in " << kDirectory_;
+    return;
+  }
+  Append(RecordType::kRemove, name, std::string());
+  Location old_location(itr->second);
+  locations_.erase(itr);
+  Release(name, old_location);
+  ScheduleCompaction(old_location.segment);
+}
+
+void FakeStoreSegmentBackend::Sync(const std::vector<std::string>& /*names*/) {
+  std::lock_guard<std::mutex> sync_lock(sync_mutex_);
+  std::set<uint32_t> unsynced_segments;
+  bool directory_unsynced(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsynced_segments.swap(unsynced_segments_);
+    std::swap(directory_unsynced, directory_unsynced_);
+  }
+  try {
+    for (uint32_t segment : unsynced_segments) {
+      try {
+        detail::SyncFile(SegmentPath(segment));
+      }
+      catch (const std::exception&) {
+        // Compaction may have deleted the segment since; that's no failure to sync.
+        boost::system::error_code error_code;
+        if (fs::exists(SegmentPath(segment), error_code))
+          throw;
+      }
+    }
+    if (directory_unsynced)
+      detail::SyncFile(kDirectory_);
+  }
+  catch (const std::exception&) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsynced_segments_.insert(std::begin(unsynced_segments), std::end(unsynced_segments));
+    directory_unsynced_ = directory_unsynced_ || directory_unsynced;
+    throw;
+  }
+}
+
+void FakeStoreSegmentBackend::Rebuild(FakeStoreIndex& index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& name_and_location : locations_)
+    index.Put(name_and_location.first, FakeStoreIndex::Entry(1, name_and_location.second.size));
+}
+
+void FakeStoreSegmentBackend::Compact() {
+  std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+  std::vector<uint32_t> compactable;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compaction_pending_ = false;
+    for (const auto& segment : segments_) {
+      if (Compactable(segment.first))
+        compactable.push_back(segment.first);
+    }
+  }
+  for (auto segment : compactable)
+    CompactSegment(segment);
+}
+
+size_t FakeStoreSegmentBackend::segment_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segments_.size();
+}
+
+uint64_t FakeStoreSegmentBackend::SegmentBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t bytes(0);
+  for (const auto& segment : segments_)
+    bytes += segment.second.size;
+  return bytes;
+}
+
+uint64_t FakeStoreSegmentBackend::RecordSize(const std::string& name, uint32_t value_size) {
+  return kHeaderSize + name.size() + value_size;
+}
+
+void FakeStoreSegmentBackend::Load() {
+  boost::system::error_code error_code;
+  if (!fs::exists(kDirectory_, error_code) && !fs::create_directories(kDirectory_, error_code)) {
+    LOG(kError) << "Can't create segment directory " << kDirectory_ << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+
+  std::vector<uint32_t> ids;
+  for (fs::directory_iterator itr(kDirectory_), end; itr != end; ++itr) {
+    const std::string stem(itr->path().stem().string());
+    if (itr->path().extension() == kSegmentExtension && !stem.empty() &&
+        stem.find_first_not_of("0123456789") == std::string::npos) {
+      ids.push_back(static_cast<uint32_t>(std::stoul(stem)));
+    }
+  }
+  std::sort(std::begin(ids), std::end(ids));
+
+  // Later records override earlier ones, so replaying the segments in order leaves each chunk at
+  // its most recent location.
+  for (auto id : ids) {
+    auto& segment(segments_[id]);
+    segment.size = Scan(id, [&](RecordType type, const std::string& name,
+                                const Location& location, std::istream&) {
+      auto itr(locations_.find(name));
+      if (itr != std::end(locations_)) {
+        Release(name, itr->second);
+        locations_.erase(itr);
+      }
+      if (type == RecordType::kPut) {
+        locations_.insert(std::make_pair(name, location));
+        segment.live += RecordSize(name, location.size);
+      }
+    });
+    if (segment.size != fs::file_size(SegmentPath(id))) {
+      LOG(kWarning) << "Segment " << SegmentPath(id) << " ends with an incomplete record";
+      fs::resize_file(SegmentPath(id), segment.size);
+    }
+  }
+
+  active_segment_ = ids.empty() ? 0 : ids.back();
+  segments_[active_segment_];
+  OpenActive();
+  for (const auto& segment : segments_)
+    ScheduleCompaction(segment.first);
+}
+
+uint64_t FakeStoreSegmentBackend::Scan(uint32_t segment, const RecordFunctor& functor) const {
+  const fs::path path(SegmentPath(segment));
+  const uint64_t file_size(fs::file_size(path));
+  std::ifstream stream(path.string(), std::ios::binary);
+  if (!stream) {
+    LOG(kError) << "Failed to open segment " << path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  uint64_t offset(0);
+  for (;;) {
+    char type(0);
+    uint16_t name_size(0);
+    uint32_t value_size(0);
+    if (!stream.get(type) || !ReadValue(stream, name_size) || !ReadValue(stream, value_size))
+      break;
+    std::string name(name_size, '\0');
+    if (!stream.read(&name[0], name_size))
+      break;
+    Location location(segment, offset + kHeaderSize + name_size, value_size);
+    if (location.offset + value_size > file_size)
+      break;
+    if (type != static_cast<char>(RecordType::kPut) &&
+        type != static_cast<char>(RecordType::kRemove)) {
+      LOG(kError) << "Segment " << path << " is corrupt";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    functor(static_cast<RecordType>(type), name, location, stream);
+    offset = location.offset + value_size;
+    stream.clear();
+    stream.seekg(offset);
+  }
+  return offset;
+}
+
+fs::path FakeStoreSegmentBackend::SegmentPath(uint32_t segment) const {
+  std::ostringstream file_name;
+  file_name << std::setw(8) << std::setfill('0') << segment << kSegmentExtension;
+  return kDirectory_ / file_name.str();
+}
+
+void FakeStoreSegmentBackend::OpenActive() {
+  if (active_.is_open())
+    active_.close();
+  active_.clear();
+  active_.open(SegmentPath(active_segment_).string(), std::ios::binary | std::ios::app);
+  directory_unsynced_ = true;
+  if (!active_) {
+    LOG(kError) << "Failed to open segment " << SegmentPath(active_segment_);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+FakeStoreSegmentBackend::Location FakeStoreSegmentBackend::Append(RecordType type,
+                                                                  const std::string& name,
+                                                                  const std::string& value) {
+  if (segments_[active_segment_].size >= kSegmentSize_) {
+    uint32_t sealed_segment(active_segment_++);
+    segments_[active_segment_];
+    OpenActive();
+    ScheduleCompaction(sealed_segment);
+  }
+  auto& segment(segments_[active_segment_]);
+  Location location(active_segment_, segment.size + kHeaderSize + name.size(),
+                    static_cast<uint32_t>(value.size()));
+  active_.put(static_cast<char>(type));
+  WriteValue(active_, static_cast<uint16_t>(name.size()));
+  WriteValue(active_, location.size);
+  active_.write(name.data(), name.size());
+  active_.write(value.data(), value.size());
+  // Flushed to the OS, but only synced by Sync.
+  active_.flush();
+  if (!active_) {
+    LOG(kError) << "Failed to append to segment " << SegmentPath(active_segment_);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  segment.size = location.offset + location.size;
+  unsynced_segments_.insert(active_segment_);
+  return location;
+}
+
+void FakeStoreSegmentBackend::Release(const std::string& name, const Location& location) {
+  auto itr(segments_.find(location.segment));
+  if (itr != std::end(segments_))
+    itr->second.live -= RecordSize(name, location.size);
+}
+
+bool FakeStoreSegmentBackend::Compactable(uint32_t segment) const {
+  auto itr(segments_.find(segment));
+  return segment != active_segment_ && itr != std::end(segments_) &&
+         itr->second.live < itr->second.size * kCompactionThreshold;
+}
+
+void FakeStoreSegmentBackend::ScheduleCompaction(uint32_t segment) {
+  if (compaction_pending_ || !Compactable(segment))
+    return;
+  compaction_pending_ = true;
+  asio_service_.service().post([this] {
+    try {
+      Compact();
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Segment compaction failed: " << boost::diagnostic_information(e);
+    }
+  });
+}
+
+void FakeStoreSegmentBackend::CompactSegment(uint32_t segment) {
+  LOG(kInfo) << "Compacting segment " << SegmentPath(segment);
+  // The segment is no longer appended to, so it can be read without holding mutex_.  Each record is
+  // checked again once its value has been read, as a Write or Remove may have overtaken it.
+  Scan(segment, [&](RecordType type, const std::string& name, const Location& location,
+                    std::istream& stream) {
+    if (type == RecordType::kRemove) {
+      // A tombstone is only needed while an older segment may still hold a record it hides.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (locations_.count(name) == 0 && std::begin(segments_)->first < segment)
+        Append(RecordType::kRemove, name, std::string());
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(locations_.find(name));
+      if (itr == std::end(locations_) || !(itr->second == location))
+        return;
+    }
+    std::string value(location.size, '\0');
+    if (!stream.read(&value[0], location.size)) {
+      LOG(kError) << "Failed to read " << name << " from " << SegmentPath(segment);
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(locations_.find(name));
+    if (itr == std::end(locations_) || !(itr->second == location))
+      return;
+    itr->second = Append(RecordType::kPut, name, value);
+    segments_[itr->second.segment].live += RecordSize(name, location.size);
+  });
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.erase(segment);
+    directory_unsynced_ = true;
+  }
+  // The copies must be durable before the originals go.
+  Sync(std::vector<std::string>());
+  boost::system::error_code error_code;
+  fs::remove(SegmentPath(segment), error_code);
+  if (error_code) {
+    LOG(kWarning) << "Failed to remove compacted segment " << SegmentPath(segment) << ": "
+                  << error_code.message();
+  }
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
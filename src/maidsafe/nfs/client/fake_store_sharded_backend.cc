@@ -0,0 +1,498 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_sharded_backend.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <unordered_set>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+const char kManifestName[] = "devices";
+const char kMigratingState[] = "migrating";
+const char kPlacedState[] = "placed";
+
+// Placement must be the same from one run (and build) to the next, so std::hash won't do: FNV-1a,
+// then MurmurHash3's finaliser to spread similar strings (like virtual node names) over the ring.
+uint64_t RingPosition(const std::string& value) {
+  uint64_t hash(14695981039346656037ULL);
+  for (unsigned char byte : value) {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+fs::path InitialiseDeviceRoot(const fs::path& root) {
+  boost::system::error_code error_code;
+  if (!fs::exists(root, error_code) && !fs::create_directories(root, error_code)) {
+    LOG(kError) << "Can't create device root at " << root << ": " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+  // So the same directory is recognised in the manifest however it's named.
+  return fs::canonical(root);
+}
+
+// Whether 'inner' is 'outer' or somewhere beneath it.
+bool Contains(const fs::path& outer, const fs::path& inner) {
+  auto outer_itr(std::begin(outer)), inner_itr(std::begin(inner));
+  for (; outer_itr != std::end(outer); ++outer_itr, ++inner_itr) {
+    if (inner_itr == std::end(inner) || *outer_itr != *inner_itr)
+      return false;
+  }
+  return true;
+}
+
+}  // unnamed namespace
+
+const int FakeStoreShardedBackend::kVirtualNodes(128);
+const int FakeStoreShardedBackend::kThreadsPerDevice(2);
+const size_t FakeStoreShardedBackend::kMigrationBatch(64);
+
+FakeStoreShardedBackend::Device::Device(fs::path root_in)
+    : root(std::move(root_in)), io_queue(kThreadsPerDevice), backend(), used_bytes(0) {}
+
+fs::path FakeStoreShardedBackend::ManifestPath(const fs::path& first_root) {
+  return first_root / kManifestName;
+}
+
+FakeStoreShardedBackend::FakeStoreShardedBackend(const std::vector<fs::path>& roots,
+                                                 const MakeDevice& make_device)
+    : devices_(),
+      ring_(),
+      migration_needed_(false),
+      migrating_(false),
+      name_mutexes_(),
+      pending_mutex_(),
+      pending_() {
+  // A device's rebuild would take chunks in a directory nested inside it for its own.
+  std::vector<fs::path> given;
+  for (const auto& root : roots) {
+    const fs::path device_root(InitialiseDeviceRoot(root));
+    for (const auto& other : given) {
+      if (Contains(other, device_root) || Contains(device_root, other)) {
+        LOG(kError) << "Devices " << other << " and " << device_root << " overlap.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      }
+    }
+    given.push_back(device_root);
+  }
+  if (given.empty())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+
+  // The manifest lives on the store's first device, which must be given first, since the store
+  // keeps its index there too.  Any other device holding one is the first of some store, either
+  // this one given out of order or another altogether.
+  for (auto itr(std::next(std::begin(given))); itr != std::end(given); ++itr) {
+    if (fs::exists(ManifestPath(*itr))) {
+      LOG(kError) << "Device " << *itr << " holds a manifest, but wasn't given first.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+
+  // Devices already in the store keep their places, and new ones follow.  A store without a
+  // manifest has only ever had its first device.
+  std::vector<fs::path> ordered;
+  const fs::path manifest_path(ManifestPath(given.front()));
+  if (fs::exists(manifest_path)) {
+    std::ifstream manifest(manifest_path.string());
+    std::string state, line;
+    std::getline(manifest, state);
+    if (state != kMigratingState && state != kPlacedState) {
+      LOG(kError) << "Failed to parse " << manifest_path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    migration_needed_ = (state == kMigratingState);
+    while (std::getline(manifest, line)) {
+      if (!line.empty())
+        ordered.emplace_back(line);
+    }
+  } else {
+    ordered.push_back(given.front());
+  }
+  for (const auto& root : ordered) {
+    if (std::find(std::begin(given), std::end(given), root) == std::end(given)) {
+      LOG(kError) << "Device " << root << " belongs to the store, but wasn't given.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+  for (const auto& root : given) {
+    if (std::find(std::begin(ordered), std::end(ordered), root) == std::end(ordered)) {
+      LOG(kInfo) << "Adding device " << root;
+      ordered.push_back(root);
+      migration_needed_ = true;
+    }
+  }
+
+  for (size_t index(0); index < ordered.size(); ++index) {
+    devices_.push_back(maidsafe::make_unique<Device>(ordered[index]));
+    devices_.back()->backend = make_device(ordered[index], devices_.back()->io_queue);
+    for (int node(0); node < kVirtualNodes; ++node)
+      ring_[RingPosition(std::to_string(index) + '/' + std::to_string(node))] = index;
+  }
+  pending_.resize(devices_.size());
+  WriteManifest(migration_needed_);
+}
+
+FakeStoreShardedBackend::~FakeStoreShardedBackend() {
+  // Abandons any migration under way; the next open resumes it.
+  for (auto& device : devices_)
+    device->io_queue.Stop();
+}
+
+NonEmptyString FakeStoreShardedBackend::Read(const std::string& name) const {
+  const size_t owner(DeviceOf(name));
+  if (migrating_.load()) {
+    std::lock_guard<std::mutex> lock(NameMutex(name));
+    Pending pending;
+    if (FindPending(owner, name, pending))
+      return devices_[pending.source]->backend->Read(name);
+  }
+  return devices_[owner]->backend->Read(name);
+}
+
+void FakeStoreShardedBackend::Write(const std::string& name, const NonEmptyString& value) {
+  const size_t owner(DeviceOf(name));
+  if (!migrating_.load()) {
+    devices_[owner]->backend->Write(name, value);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(NameMutex(name));
+  devices_[owner]->backend->Write(name, value);
+  // The copy still to be moved is out of date now.
+  Pending pending;
+  if (TakePending(owner, name, pending))
+    devices_[pending.source]->backend->Remove(name);
+}
+
+void FakeStoreShardedBackend::WriteMany(
+    const std::vector<std::pair<std::string, NonEmptyString>>& chunks) {
+  if (migrating_.load()) {
+    FakeStoreBackend::WriteMany(chunks);
+    return;
+  }
+  std::vector<std::vector<std::pair<std::string, NonEmptyString>>> by_device(devices_.size());
+  for (const auto& chunk : chunks)
+    by_device[DeviceOf(chunk.first)].push_back(chunk);
+  std::vector<size_t> devices;
+  for (size_t device(0); device < by_device.size(); ++device) {
+    if (!by_device[device].empty())
+      devices.push_back(device);
+  }
+  OnDevices(devices,
+            [&](size_t device) { devices_[device]->backend->WriteMany(by_device[device]); });
+}
+
+void FakeStoreShardedBackend::Remove(const std::string& name) {
+  const size_t owner(DeviceOf(name));
+  if (!migrating_.load()) {
+    devices_[owner]->backend->Remove(name);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(NameMutex(name));
+  Pending pending;
+  if (TakePending(owner, name, pending)) {
+    devices_[pending.source]->backend->Remove(name);
+    if (pending.copied)
+      devices_[owner]->backend->Remove(name);
+  } else {
+    devices_[owner]->backend->Remove(name);
+  }
+}
+
+void FakeStoreShardedBackend::Sync(const std::vector<std::string>& names) {
+  // During migration a change can land on a chunk's old device too, so every device syncs them all.
+  std::vector<std::vector<std::string>> by_device(devices_.size());
+  if (migrating_.load()) {
+    for (auto& device_names : by_device)
+      device_names = names;
+  } else {
+    for (const auto& name : names)
+      by_device[DeviceOf(name)].push_back(name);
+  }
+  std::vector<size_t> devices;
+  for (size_t device(0); device < by_device.size(); ++device) {
+    if (!by_device[device].empty())
+      devices.push_back(device);
+  }
+  OnDevices(devices, [&](size_t device) { devices_[device]->backend->Sync(by_device[device]); });
+}
+
+void FakeStoreShardedBackend::Rebuild(FakeStoreIndex& index) {
+  std::vector<std::unique_ptr<FakeStoreIndex>> held;
+  std::vector<size_t> devices;
+  for (size_t device(0); device < devices_.size(); ++device) {
+    held.push_back(maidsafe::make_unique<FakeStoreIndex>(fs::path()));
+    devices.push_back(device);
+  }
+  OnDevices(devices, [&](size_t device) { devices_[device]->backend->Rebuild(*held[device]); });
+  // A chunk part way through migration is on two devices; the one it belongs on has it right.
+  for (size_t device(0); device < held.size(); ++device) {
+    held[device]->ForEach([&](const std::string& name, const FakeStoreIndex::Entry& entry) {
+      if (!index.Find(name) || DeviceOf(name) == device)
+        index.Put(name, entry);
+    });
+  }
+}
+
+void FakeStoreShardedBackend::StartMigration() {
+  if (!migration_needed_)
+    return;
+  LOG(kInfo) << "Finding chunks to migrate across " << devices_.size() << " devices.";
+  std::vector<std::unordered_set<std::string>> held(devices_.size());
+  std::vector<size_t> devices;
+  for (size_t device(0); device < devices_.size(); ++device)
+    devices.push_back(device);
+  OnDevices(devices, [&](size_t device) {
+    devices_[device]->backend->ForEachName(
+        [&](const std::string& name) { held[device].insert(name); });
+  });
+
+  size_t pending_count(0);
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    for (size_t device(0); device < held.size(); ++device) {
+      for (const auto& name : held[device]) {
+        const size_t owner(DeviceOf(name));
+        if (owner == device)
+          continue;
+        // Copied before the last run was interrupted: the copy where it belongs is the current one.
+        if (held[owner].count(name) != 0) {
+          devices_[device]->backend->Remove(name);
+          continue;
+        }
+        pending_[owner][name] = Pending(device);
+        ++pending_count;
+      }
+    }
+  }
+  if (pending_count == 0) {
+    WriteManifest(false);
+    migration_needed_ = false;
+    return;
+  }
+
+  LOG(kInfo) << "Migrating " << pending_count << " chunks.";
+  migrating_ = true;
+  for (size_t target(0); target < devices_.size(); ++target) {
+    if (!pending_[target].empty())
+      devices_[target]->io_queue.service().post([this, target] { MigrateBatch(target); });
+  }
+}
+
+size_t FakeStoreShardedBackend::pending_migrations() const {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  size_t count(0);
+  for (const auto& pending : pending_)
+    count += pending.size();
+  return count;
+}
+
+size_t FakeStoreShardedBackend::DeviceOf(const std::string& name) const {
+  auto itr(ring_.lower_bound(RingPosition(name)));
+  if (itr == std::end(ring_))
+    itr = std::begin(ring_);
+  return itr->second;
+}
+
+void FakeStoreShardedBackend::Account(size_t device, uint64_t old_size, uint64_t new_size) {
+  devices_[device]->used_bytes += new_size;
+  devices_[device]->used_bytes -= old_size;
+}
+
+std::vector<uint64_t> FakeStoreShardedBackend::DeviceUsage() const {
+  std::vector<uint64_t> usage;
+  for (const auto& device : devices_)
+    usage.push_back(device->used_bytes.load());
+  return usage;
+}
+
+void FakeStoreShardedBackend::OnDevices(const std::vector<size_t>& devices,
+                                        const std::function<void(size_t device)>& operation) const {
+  if (devices.size() == 1) {
+    operation(devices.front());
+    return;
+  }
+  std::vector<std::future<void>> futures;
+  for (size_t device : devices) {
+    auto task(std::make_shared<std::packaged_task<void()>>([&operation, device] {
+      operation(device);
+    }));
+    futures.push_back(task->get_future());
+    devices_[device]->io_queue.service().post([task] { (*task)(); });
+  }
+  std::exception_ptr first_error;
+  for (auto& future : futures) {
+    try {
+      future.get();
+    }
+    catch (...) {
+      if (!first_error)
+        first_error = std::current_exception();
+    }
+  }
+  if (first_error)
+    std::rethrow_exception(first_error);
+}
+
+std::mutex& FakeStoreShardedBackend::NameMutex(const std::string& name) const {
+  return name_mutexes_[std::hash<std::string>()(name) % name_mutexes_.size()];
+}
+
+bool FakeStoreShardedBackend::TakePending(size_t owner, const std::string& name,
+                                          Pending& pending) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  auto itr(pending_[owner].find(name));
+  if (itr == std::end(pending_[owner]))
+    return false;
+  pending = itr->second;
+  pending_[owner].erase(itr);
+  return true;
+}
+
+bool FakeStoreShardedBackend::FindPending(size_t owner, const std::string& name,
+                                          Pending& pending) const {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  auto itr(pending_[owner].find(name));
+  if (itr == std::end(pending_[owner]))
+    return false;
+  pending = itr->second;
+  return true;
+}
+
+void FakeStoreShardedBackend::MigrateBatch(size_t target) {
+  std::vector<std::pair<std::string, size_t>> batch;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    for (auto itr(std::begin(pending_[target]));
+         itr != std::end(pending_[target]) && batch.size() < kMigrationBatch; ++itr) {
+      batch.emplace_back(itr->first, itr->second.source);
+    }
+  }
+
+  // Each chunk is copied, the copies synced, and only then the originals removed.  A failure stops
+  // this device's migration; its chunks are still read from where they are, and the next open
+  // tries again.
+  FakeStoreBackend& target_backend(*devices_[target]->backend);
+  try {
+    std::vector<std::string> copied;
+    for (const auto& name_and_source : batch) {
+      const std::string& name(name_and_source.first);
+      std::lock_guard<std::mutex> lock(NameMutex(name));
+      Pending pending;
+      // Otherwise rewritten or removed meanwhile.
+      if (!FindPending(target, name, pending) || pending.source != name_and_source.second)
+        continue;
+      target_backend.Write(name, devices_[pending.source]->backend->Read(name));
+      {
+        std::lock_guard<std::mutex> pending_lock(pending_mutex_);
+        pending_[target][name].copied = true;
+      }
+      copied.push_back(name);
+    }
+    target_backend.Sync(copied);
+    for (const auto& name : copied) {
+      std::lock_guard<std::mutex> lock(NameMutex(name));
+      Pending pending;
+      if (TakePending(target, name, pending))
+        devices_[pending.source]->backend->Remove(name);
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Migration to " << devices_[target]->root
+                << " stopped: " << boost::diagnostic_information(e);
+    return;
+  }
+
+  bool finished(false);
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    if (!pending_[target].empty()) {
+      devices_[target]->io_queue.service().post([this, target] { MigrateBatch(target); });
+      return;
+    }
+    finished = migrating_.load() &&
+               std::all_of(std::begin(pending_), std::end(pending_),
+                           [](const std::map<std::string, Pending>& pending) {
+                             return pending.empty();
+                           });
+    if (finished)
+      migrating_ = false;
+  }
+  if (!finished)
+    return;
+  LOG(kInfo) << "Migration finished.";
+  try {
+    WriteManifest(false);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to record finished migration: " << boost::diagnostic_information(e);
+  }
+}
+
+void FakeStoreShardedBackend::WriteManifest(bool migrating) const {
+  const fs::path path(ManifestPath(devices_.front()->root));
+  fs::path new_path(path);
+  new_path += ".new";
+  {
+    std::ofstream manifest(new_path.string(), std::ios::trunc);
+    manifest << (migrating ? kMigratingState : kPlacedState) << '\n';
+    for (const auto& device : devices_)
+      manifest << device->root.string() << '\n';
+    manifest.flush();
+    if (!manifest) {
+      LOG(kError) << "Failed to write " << new_path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+  }
+  // Synced before the rename, so a crash can't leave the manifest empty, and the directory after,
+  // so it can't bring back the old one once migration has gone ahead on the strength of the new.
+  detail::SyncFile(new_path);
+  boost::system::error_code error_code;
+  fs::rename(new_path, path, error_code);
+  if (error_code) {
+    LOG(kError) << "Failed to replace " << path << ": " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  detail::SyncFile(devices_.front()->root);
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,409 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_uring_backend.h"
+
+// The ring is driven through the raw system calls, so needs only the kernel's header.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MAIDSAFE_NFS_IO_URING
+#endif
+#endif
+
+#ifdef MAIDSAFE_NFS_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+#ifdef MAIDSAFE_NFS_IO_URING
+
+namespace {
+
+struct RingOperation {
+  RingOperation(uint8_t opcode_in, int fd_in) : opcode(opcode_in), fd(fd_in), iov(), result(0) {}
+  uint8_t opcode;
+  int fd;
+  // The data for a write; it must outlive the operation.
+  iovec iov;
+  // As the equivalent system call would return, but a failure is the negated errno.
+  int result;
+};
+
+// Closes each operation's file once the operations are done with.
+class OperationFiles {
+ public:
+  OperationFiles() : operations() {}
+  ~OperationFiles() {
+    for (const auto& operation : operations)
+      ::close(operation.fd);
+  }
+  std::vector<RingOperation> operations;
+
+ private:
+  OperationFiles(const OperationFiles&);
+  OperationFiles& operator=(const OperationFiles&);
+};
+
+}  // unnamed namespace
+
+// A submission and a completion queue shared with the kernel.  Run submits a batch and waits for
+// all of it, one batch at a time.
+class FakeStoreUringBackend::Ring {
+ public:
+  explicit Ring(unsigned entries);
+  ~Ring() { Release(); }
+
+  // Submits 'operations', up to the ring's size at a time, and waits for all of them to complete.
+  // If the kernel refuses part of a batch, throws once the part it took has completed, and every
+  // later call throws too.
+  void Run(std::vector<RingOperation>& operations);
+
+ private:
+  Ring(const Ring&);
+  Ring& operator=(const Ring&);
+
+  void* Map(size_t size, uint64_t offset);
+  void Release();
+  // Records the results of the completions posted so far, counting them in 'completed'.
+  void Reap(std::vector<RingOperation>& operations, unsigned& completed);
+  // Returns io_uring_enter's result, or throws on an error other than an interruption.
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+  int fd_;
+  unsigned entries_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  io_uring_cqe* cqes_;
+  bool broken_;
+  std::mutex mutex_;
+};
+
+FakeStoreUringBackend::Ring::Ring(unsigned entries)
+    : fd_(-1),
+      entries_(0),
+      sq_ring_(nullptr),
+      sq_ring_size_(0),
+      cq_ring_(nullptr),
+      cq_ring_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      sq_tail_(nullptr),
+      sq_mask_(nullptr),
+      sq_array_(nullptr),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(nullptr),
+      cqes_(nullptr),
+      broken_(false),
+      mutex_() {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+  if (fd_ < 0) {
+    LOG(kInfo) << "io_uring unavailable: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+  try {
+    entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+    if (single_mmap)
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+  }
+  catch (const std::exception&) {
+    Release();
+    throw;
+  }
+  char* sq_ring(static_cast<char*>(sq_ring_));
+  sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+  char* cq_ring(static_cast<char*>(cq_ring_));
+  cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+}
+
+void FakeStoreUringBackend::Ring::Run(std::vector<RingOperation>& operations) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (broken_) {
+    LOG(kError) << "io_uring unusable after an earlier failed submission";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  for (size_t first(0); first < operations.size(); first += entries_) {
+    const unsigned count(
+        static_cast<unsigned>(std::min<size_t>(entries_, operations.size() - first)));
+    // Only this thread (holding mutex_) moves the submission tail, and the kernel only reads it.
+    unsigned tail(*sq_tail_);
+    for (unsigned i(0); i < count; ++i, ++tail) {
+      RingOperation& operation(operations[first + i]);
+      const unsigned index(tail & *sq_mask_);
+      io_uring_sqe& sqe(sqes_[index]);
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = operation.opcode;
+      sqe.fd = operation.fd;
+      if (operation.opcode == IORING_OP_WRITEV) {
+        sqe.addr = reinterpret_cast<uint64_t>(&operation.iov);
+        sqe.len = 1;
+      }
+      sqe.user_data = first + i;
+      sq_array_[index] = index;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    unsigned submitted(0), completed(0);
+    try {
+      while (submitted < count)
+        submitted += static_cast<unsigned>(std::max(0, Enter(count - submitted, 0, 0)));
+      for (;;) {
+        Reap(operations, completed);
+        if (completed == count)
+          break;
+        Enter(0, 1, IORING_ENTER_GETEVENTS);
+      }
+    }
+    catch (const std::exception&) {
+      // The kernel may still be using the files and buffers of what it took, and they're freed as
+      // this unwinds, so wait that out first - watching the completion queue directly, since
+      // entering the ring is what failed.  What it didn't take is still queued behind the tail,
+      // where any later enter would submit it, so the ring mustn't be used again.
+      if (submitted < count)
+        broken_ = true;
+      for (;;) {
+        Reap(operations, completed);
+        if (completed >= submitted)
+          break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      throw;
+    }
+  }
+}
+
+void FakeStoreUringBackend::Ring::Reap(std::vector<RingOperation>& operations,
+                                       unsigned& completed) {
+  unsigned head(*cq_head_);
+  const unsigned cq_tail(__atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE));
+  for (; head != cq_tail; ++head, ++completed) {
+    const io_uring_cqe& cqe(cqes_[head & *cq_mask_]);
+    operations[static_cast<size_t>(cqe.user_data)].result = cqe.res;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void* FakeStoreUringBackend::Ring::Map(size_t size, uint64_t offset) {
+  void* address(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       static_cast<off_t>(offset)));
+  if (address == MAP_FAILED) {
+    LOG(kError) << "Failed to map io_uring: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+  return address;
+}
+
+void FakeStoreUringBackend::Ring::Release() {
+  if (sqes_)
+    ::munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_)
+    ::munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_)
+    ::munmap(sq_ring_, sq_ring_size_);
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+int FakeStoreUringBackend::Ring::Enter(unsigned to_submit, unsigned min_complete,
+                                       unsigned flags) {
+  int result(static_cast<int>(
+      ::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0)));
+  if (result < 0) {
+    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+      return 0;
+    LOG(kError) << "io_uring_enter failed: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  return result;
+}
+
+#else
+
+class FakeStoreUringBackend::Ring {
+ public:
+  explicit Ring(unsigned /*entries*/) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+};
+
+#endif
+
+const unsigned FakeStoreUringBackend::kRingEntries(256);
+
+bool FakeStoreUringBackend::Available() {
+  static const bool available([] {
+    try {
+      Ring ring(1);
+      return true;
+    }
+    catch (const std::exception&) {
+      return false;
+    }
+  }());
+  return available;
+}
+
+FakeStoreUringBackend::FakeStoreUringBackend(fs::path root, uint32_t depth)
+    : FakeStoreFileBackend(std::move(root), depth),
+      ring_(maidsafe::make_unique<Ring>(kRingEntries)) {}
+
+FakeStoreUringBackend::~FakeStoreUringBackend() {}
+
+#ifdef MAIDSAFE_NFS_IO_URING
+
+void FakeStoreUringBackend::WriteMany(
+    const std::vector<std::pair<std::string, NonEmptyString>>& chunks) {
+  // A ring's worth at a time, to bound the files open at once.
+  for (size_t first(0); first < chunks.size(); first += kRingEntries) {
+    const size_t last(std::min<size_t>(first + kRingEntries, chunks.size()));
+    OperationFiles files;
+    // Nothing is truncated until every file in the batch is open, so a failure to open one leaves
+    // the chunks already stored as they were, and the files created for new ones are removed.
+    std::vector<fs::path> created;
+    on_scope_exit remove_created([&] {
+      boost::system::error_code ignored;
+      for (const auto& path : created)
+        fs::remove(path, ignored);
+    });
+    for (size_t index(first); index < last; ++index) {
+      const fs::path path(ChunkPath(chunks[index].first, true));
+      int fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666));
+      if (fd != -1)
+        created.push_back(path);
+      else if (errno == EEXIST)
+        fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+      if (fd == -1) {
+        LOG(kError) << "Failed to open " << path << ": " << std::strerror(errno);
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      }
+      files.operations.emplace_back(static_cast<uint8_t>(IORING_OP_WRITEV), fd);
+      const std::string& value(chunks[index].second.string());
+      files.operations.back().iov.iov_base = const_cast<char*>(value.data());
+      files.operations.back().iov.iov_len = value.size();
+    }
+    for (size_t index(first); index < last; ++index) {
+      if (::ftruncate(files.operations[index - first].fd, 0) != 0) {
+        LOG(kError) << "Failed to truncate " << chunks[index].first << ": "
+                    << std::strerror(errno);
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      }
+    }
+    remove_created.Release();
+    ring_->Run(files.operations);
+    for (size_t index(first); index < last; ++index) {
+      const RingOperation& operation(files.operations[index - first]);
+      if (operation.result < 0 ||
+          static_cast<size_t>(operation.result) != operation.iov.iov_len) {
+        LOG(kError) << "Write of " << chunks[index].first << " failed: "
+                    << (operation.result < 0 ? std::strerror(-operation.result) : "short write");
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      }
+    }
+  }
+}
+
+void FakeStoreUringBackend::Sync(const std::vector<std::string>& names) {
+  const std::vector<fs::path> paths(SyncPaths(names));
+  for (size_t first(0); first < paths.size(); first += kRingEntries) {
+    const size_t last(std::min<size_t>(first + kRingEntries, paths.size()));
+    OperationFiles files;
+    for (size_t index(first); index < last; ++index) {
+      const int fd(::open(paths[index].c_str(), O_RDONLY | O_CLOEXEC));
+      if (fd == -1) {
+        LOG(kError) << "Failed to open " << paths[index] << ": " << std::strerror(errno);
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      }
+      files.operations.emplace_back(static_cast<uint8_t>(IORING_OP_FSYNC), fd);
+    }
+    ring_->Run(files.operations);
+    for (size_t index(first); index < last; ++index) {
+      const RingOperation& operation(files.operations[index - first]);
+      if (operation.result < 0) {
+        LOG(kError) << "Failed to sync " << paths[index] << ": "
+                    << std::strerror(-operation.result);
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      }
+    }
+  }
+}
+
+#else
+
+void FakeStoreUringBackend::WriteMany(
+    const std::vector<std::pair<std::string, NonEmptyString>>& chunks) {
+  FakeStoreFileBackend::WriteMany(chunks);
+}
+
+void FakeStoreUringBackend::Sync(const std::vector<std::string>& names) {
+  FakeStoreFileBackend::Sync(names);
+}
+
+#endif
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,264 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_versions.h"
+
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+#include "maidsafe/nfs/client/fake_store_backend.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+const char kSnapshotExtension[] = ".ver";
+const char kLogExtension[] = ".vlog";
+// Logs smaller than this aren't worth folding into a snapshot, however small the snapshot.
+const uint64_t kMinSnapshotLogSize(4096);
+
+// Each log record is the record type followed by its fields, each field a length (in host byte
+// order) and that many bytes: the old version (empty for none) and new version of a Put, or the
+// branch tip of a DeleteBranchUntilFork.
+void AppendField(std::string& record, const std::string& field) {
+  const uint32_t size(static_cast<uint32_t>(field.size()));
+  record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  record.append(field);
+}
+
+bool ReadField(std::istream& stream, std::string& field) {
+  uint32_t size(0);
+  if (!stream.read(reinterpret_cast<char*>(&size), sizeof(size)))
+    return false;
+  field.assign(size, '\0');
+  return size == 0 || static_cast<bool>(stream.read(&field[0], size));
+}
+
+}  // unnamed namespace
+
+const size_t FakeStoreVersions::kMaxCachedTrees(1024);
+
+FakeStoreVersions::FakeStoreVersions(fs::path root, uint32_t depth, ReplaceFunctor replace)
+    : kRoot_(std::move(root)), kDepth_(depth), replace_(std::move(replace)), mutex_(), cache_() {}
+
+std::shared_ptr<const StructuredDataVersions> FakeStoreVersions::Get(const std::string& name) {
+  auto tree(Load(name));
+  return tree ? tree->versions : nullptr;
+}
+
+uint64_t FakeStoreVersions::Create(const std::string& name,
+                                   const StructuredDataVersions& versions) {
+  auto tree(std::make_shared<Tree>());
+  auto existing(Load(name));
+  if (existing) {
+    tree->snapshot_size = existing->snapshot_size;
+    tree->log_size = existing->log_size;
+  }
+  tree->versions = std::make_shared<StructuredDataVersions>(versions.Serialise());
+  WriteSnapshot(name, *tree);
+  Cache(name, tree);
+  return tree->snapshot_size;
+}
+
+uint64_t FakeStoreVersions::Put(const std::string& name, const VersionName& old_version_name,
+                                const VersionName& new_version_name) {
+  auto tree(Load(name));
+  if (!tree)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  std::string record(1, static_cast<char>(RecordType::kPut));
+  AppendField(record, old_version_name.id.value.IsInitialised() ?
+                          ConvertToString(old_version_name) : std::string());
+  AppendField(record, ConvertToString(new_version_name));
+  try {
+    return Append(name, *tree, record,
+                  [&] { tree->versions->Put(old_version_name, new_version_name); });
+  }
+  catch (const std::exception&) {
+    // The cached tree may now be ahead of the one on disk.
+    Uncache(name);
+    throw;
+  }
+}
+
+uint64_t FakeStoreVersions::DeleteBranchUntilFork(const std::string& name,
+                                                  const VersionName& branch_tip) {
+  auto tree(Load(name));
+  if (!tree)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  std::string record(1, static_cast<char>(RecordType::kDeleteBranchUntilFork));
+  AppendField(record, ConvertToString(branch_tip));
+  try {
+    return Append(name, *tree, record,
+                  [&] { tree->versions->DeleteBranchUntilFork(branch_tip); });
+  }
+  catch (const std::exception&) {
+    Uncache(name);
+    throw;
+  }
+}
+
+fs::path FakeStoreVersions::SnapshotPath(const std::string& name, bool create_if_missing) const {
+  return detail::NameToPath(kRoot_, name, kDepth_, create_if_missing)
+      .replace_extension(kSnapshotExtension);
+}
+
+fs::path FakeStoreVersions::LogPath(const std::string& name) const {
+  return SnapshotPath(name, false).replace_extension(kLogExtension);
+}
+
+std::shared_ptr<FakeStoreVersions::Tree> FakeStoreVersions::Load(const std::string& name) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(cache_.find(name));
+    if (itr != std::end(cache_))
+      return itr->second;
+  }
+  if (kRoot_.empty())
+    return nullptr;
+
+  const fs::path snapshot_path(SnapshotPath(name, false));
+  boost::system::error_code error_code;
+  if (!fs::exists(snapshot_path, error_code))
+    return nullptr;
+  auto tree(std::make_shared<Tree>());
+  tree->versions = std::make_shared<StructuredDataVersions>(
+      StructuredDataVersions::serialised_type(ReadFile(snapshot_path)));
+  tree->snapshot_size = fs::file_size(snapshot_path);
+
+  const fs::path log_path(LogPath(name));
+  if (fs::exists(log_path, error_code)) {
+    std::ifstream log(log_path.string(), std::ios::binary);
+    for (;;) {
+      char type(0);
+      std::string first, second;
+      if (!log.get(type))
+        break;
+      if (type == static_cast<char>(RecordType::kPut)) {
+        if (!ReadField(log, first) || !ReadField(log, second))
+          break;
+      } else if (type != static_cast<char>(RecordType::kDeleteBranchUntilFork) ||
+                 !ReadField(log, first)) {
+        break;
+      }
+      // A crash between writing a snapshot and removing the log leaves records the snapshot
+      // already holds; these fail to apply a second time and are skipped.
+      try {
+        if (type == static_cast<char>(RecordType::kPut)) {
+          tree->versions->Put(
+              first.empty() ? VersionName() : ConvertFromString<VersionName>(first),
+              ConvertFromString<VersionName>(second));
+        } else {
+          tree->versions->DeleteBranchUntilFork(ConvertFromString<VersionName>(first));
+        }
+      }
+      catch (const std::exception& e) {
+        LOG(kWarning) << "Skipping version log record for " << name << ": "
+                      << boost::diagnostic_information(e);
+      }
+      tree->log_size = static_cast<uint64_t>(log.tellg());
+    }
+    log.close();
+    if (tree->log_size != fs::file_size(log_path)) {
+      LOG(kWarning) << "Version log " << log_path << " ends with an incomplete record";
+      fs::resize_file(log_path, tree->log_size);
+    }
+  }
+  Cache(name, tree);
+  return tree;
+}
+
+void FakeStoreVersions::Cache(const std::string& name, const std::shared_ptr<Tree>& tree) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Evicting an arbitrary tree is harmless: everything cached is also on disk.  In memory, the
+  // cache is all there is.
+  if (!kRoot_.empty() && cache_.size() >= kMaxCachedTrees && cache_.count(name) == 0)
+    cache_.erase(std::begin(cache_));
+  cache_[name] = tree;
+}
+
+void FakeStoreVersions::Uncache(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!kRoot_.empty())
+    cache_.erase(name);
+}
+
+uint64_t FakeStoreVersions::Append(const std::string& name, Tree& tree,
+                                   const std::string& record, const std::function<void()>& apply) {
+  const uint64_t size(tree.snapshot_size + tree.log_size);
+  replace_(size, size + record.size(), [&] {
+    apply();
+    if (kRoot_.empty())
+      return;
+    std::ofstream log(LogPath(name).string(), std::ios::binary | std::ios::app);
+    log.write(record.data(), record.size());
+    log.flush();
+    if (!log) {
+      LOG(kError) << "Failed to append to version log " << LogPath(name);
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+  });
+  tree.log_size += record.size();
+  if (tree.log_size >= std::max(tree.snapshot_size, kMinSnapshotLogSize)) {
+    // The change is already safely logged, so a failure here only defers the snapshot.
+    try {
+      WriteSnapshot(name, tree);
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Failed to snapshot versions of " << name << ": "
+                    << boost::diagnostic_information(e);
+    }
+  }
+  return tree.snapshot_size + tree.log_size;
+}
+
+void FakeStoreVersions::WriteSnapshot(const std::string& name, Tree& tree) {
+  const auto serialised(tree.versions->Serialise().data);
+  const uint64_t snapshot_size(serialised.string().size());
+  replace_(tree.snapshot_size + tree.log_size, snapshot_size, [&] {
+    if (kRoot_.empty())
+      return;
+    const fs::path snapshot_path(SnapshotPath(name, true));
+    fs::path temp_path(snapshot_path);
+    temp_path += ".tmp";
+    if (!WriteFile(temp_path, serialised.string())) {
+      LOG(kError) << "Failed to write version snapshot " << temp_path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+    fs::rename(temp_path, snapshot_path);
+    boost::system::error_code error_code;
+    fs::remove(LogPath(name), error_code);
+  });
+  tree.snapshot_size = snapshot_size;
+  tree.log_size = 0;
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
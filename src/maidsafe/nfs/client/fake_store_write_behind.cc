@@ -0,0 +1,253 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/fake_store_write_behind.h"
+
+#include <cassert>
+#include <exception>
+#include <initializer_list>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+const uint64_t FakeStoreWriteBehind::kDefaultMaxBufferedBytes(64 * 1024 * 1024);
+
+FakeStoreWriteBehind::FakeStoreWriteBehind(std::unique_ptr<FakeStoreBackend> backend,
+                                           Durability durability, BoostAsioService& asio_service,
+                                           uint64_t max_buffered_bytes,
+                                           std::function<void()> on_synced)
+    : backend_(std::move(backend)),
+      kDurability_(durability),
+      kMaxBufferedBytes_(max_buffered_bytes),
+      asio_service_(asio_service),
+      kOnSynced_(std::move(on_synced)),
+      mutex_(),
+      flushed_condition_(),
+      buffered_(),
+      flushing_(),
+      buffered_bytes_(0),
+      batch_count_(0),
+      flush_error_(),
+      flush_running_(false),
+      flush_posted_(false) {
+  assert(kDurability_ != Durability::kUnsynced);
+}
+
+FakeStoreWriteBehind::~FakeStoreWriteBehind() {
+  try {
+    Sync(std::vector<std::string>());
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to flush buffered changes: " << boost::diagnostic_information(e);
+  }
+}
+
+NonEmptyString FakeStoreWriteBehind::Read(const std::string& name) const {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The buffered change is the more recent, if both batches hold one.
+    for (const Batch* batch : {&buffered_, &flushing_}) {
+      auto itr(batch->find(name));
+      if (itr == std::end(*batch))
+        continue;
+      if (!itr->second.value.IsInitialised())
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      return itr->second.value;
+    }
+  }
+  return backend_->Read(name);
+}
+
+void FakeStoreWriteBehind::Write(const std::string& name, const NonEmptyString& value) {
+  Buffer(name, value);
+}
+
+void FakeStoreWriteBehind::Remove(const std::string& name) { Buffer(name, NonEmptyString()); }
+
+void FakeStoreWriteBehind::Sync(const std::vector<std::string>& /*names*/) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Whatever an earlier failed flush left buffered is retried here, and only a new failure thrown.
+  flush_error_ = nullptr;
+  while (flush_running_ || !buffered_.empty()) {
+    if (flush_running_) {
+      flushed_condition_.wait(lock);
+    } else {
+      lock.unlock();
+      Flush();
+      lock.lock();
+      ThrowFlushError(lock);
+    }
+  }
+}
+
+void FakeStoreWriteBehind::Rebuild(FakeStoreIndex& index) {
+  Sync(std::vector<std::string>());
+  backend_->Rebuild(index);
+}
+
+uint64_t FakeStoreWriteBehind::batch_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return batch_count_;
+}
+
+void FakeStoreWriteBehind::Buffer(const std::string& name, const NonEmptyString& value) {
+  if (kDurability_ == Durability::kPerOperation) {
+    if (value.IsInitialised())
+      backend_->Write(name, value);
+    else
+      backend_->Remove(name);
+    backend_->Sync(std::vector<std::string>(1, name));
+    if (kOnSynced_)
+      kOnSynced_();
+    return;
+  }
+
+  const uint64_t size(value.IsInitialised() ? value.string().size() : 0);
+  std::shared_ptr<std::promise<void>> waiter;
+  bool post_flush(false);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (flush_error_) {
+      // The failed batch is retried in the background, so later calls succeed once the fault has
+      // cleared.
+      if (!flush_running_ && !flush_posted_) {
+        flush_posted_ = true;
+        asio_service_.service().post([this] { Flush(); });
+      }
+      ThrowFlushError(lock);
+    }
+    // A single change larger than the whole buffer is let in once the buffer is empty.
+    while (buffered_bytes_ != 0 && buffered_bytes_ + size > kMaxBufferedBytes_) {
+      if (flush_running_) {
+        flushed_condition_.wait(lock);
+      } else {
+        lock.unlock();
+        Flush();
+        lock.lock();
+        ThrowFlushError(lock);
+      }
+    }
+    Change& change(buffered_[name]);
+    if (change.value.IsInitialised())
+      buffered_bytes_ -= change.value.string().size();
+    change.value = value;
+    buffered_bytes_ += size;
+    if (kDurability_ == Durability::kBatched) {
+      waiter = std::make_shared<std::promise<void>>();
+      change.waiters.push_back(waiter);
+    } else if (!flush_running_ && !flush_posted_) {
+      flush_posted_ = post_flush = true;
+    }
+  }
+
+  if (post_flush)
+    asio_service_.service().post([this] { Flush(); });
+  if (waiter) {
+    // Either this thread flushes the batch, taking in whatever else has been buffered meanwhile,
+    // or it waits for the thread already flushing to get to it.
+    auto synced(waiter->get_future());
+    Flush();
+    synced.get();
+  }
+}
+
+void FakeStoreWriteBehind::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  flush_posted_ = false;
+  if (flush_running_)
+    return;
+  flush_running_ = true;
+  while (!buffered_.empty() && !flush_error_) {
+    flushing_.swap(buffered_);
+    lock.unlock();
+
+    std::vector<std::string> names, removals;
+    std::vector<std::pair<std::string, NonEmptyString>> writes;
+    uint64_t batch_bytes(0);
+    for (const auto& change : flushing_) {
+      names.push_back(change.first);
+      if (change.second.value.IsInitialised()) {
+        writes.emplace_back(change.first, change.second.value);
+        batch_bytes += change.second.value.string().size();
+      } else {
+        removals.push_back(change.first);
+      }
+    }
+    std::exception_ptr error;
+    try {
+      backend_->WriteMany(writes);
+      for (const auto& name : removals)
+        backend_->Remove(name);
+      backend_->Sync(names);
+      if (kOnSynced_)
+        kOnSynced_();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to flush " << names.size()
+                  << " buffered changes: " << boost::diagnostic_information(e);
+      error = std::current_exception();
+    }
+    for (const auto& change : flushing_) {
+      for (const auto& waiter : change.second.waiters) {
+        if (error)
+          waiter->set_exception(error);
+        else
+          waiter->set_value();
+      }
+    }
+
+    lock.lock();
+    if (error && kDurability_ == Durability::kAsynchronous) {
+      // Nobody was waiting to hear of the failure, and FakeStore already counts these changes, so
+      // they're kept for the next flush, unless superseded meanwhile.
+      for (auto& change : flushing_) {
+        if (buffered_.count(change.first) == 0)
+          buffered_.emplace(change.first, std::move(change.second));
+        else if (change.second.value.IsInitialised())
+          buffered_bytes_ -= change.second.value.string().size();
+      }
+      flush_error_ = error;
+    } else {
+      buffered_bytes_ -= batch_bytes;
+    }
+    flushing_.clear();
+    if (!error)
+      ++batch_count_;
+    flushed_condition_.notify_all();
+  }
+  flush_running_ = false;
+  flushed_condition_.notify_all();
+}
+
+void FakeStoreWriteBehind::ThrowFlushError(std::unique_lock<std::mutex>& lock) {
+  if (!flush_error_)
+    return;
+  std::exception_ptr error(flush_error_);
+  flush_error_ = nullptr;
+  lock.unlock();
+  std::rethrow_exception(error);
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -18,6 +18,9 @@
 
 #include "maidsafe/nfs/client/maid_client.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
@@ -33,6 +36,9 @@ namespace nfs_client {
 
 namespace {
 
+// Routing reports a health below this once it has given up trying to join.
+const int kJoinFailedNetworkHealth(-300000);
+
 // NOTE: methods - MakeSharedZeroState() GivePublicPmidKey() & UpdateRequestPublicKeyFunctor()
 // are used for ZeroState network setup only.
 // This allows a client to lookup *only* in a provided public pmid list, when it is
@@ -67,15 +73,68 @@ void UpdateRequestPublicKeyFunctor(routing::RequestPublicKeyFunctor& request_pub
 }  // anonymous namespace
 
 
-std::shared_ptr<MaidClient> MaidClient::MakeShared(const passport::Maid& maid) {
-  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid } };
+std::shared_ptr<MaidClient> MaidClient::MakeShared(
+    const passport::Maid& maid, std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid, asio_service,
+                                                             completion_service } };
   maid_node_ptr->Init();
   return maid_node_ptr;
 }
 
 std::shared_ptr<MaidClient> MaidClient::MakeShared(
-    const passport::MaidAndSigner& maid_and_signer) {
-  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first } };
+    const passport::MaidAndSigner& maid_and_signer,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first,
+                                                             asio_service, completion_service } };
+  maid_node_ptr->Init(maid_and_signer);
+  return maid_node_ptr;
+}
+
+std::pair<std::shared_ptr<MaidClient>, boost::future<void>> MaidClient::MakeSharedAsync(
+    const passport::Maid& maid, int ready_health, std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid, asio_service,
+                                                             completion_service } };
+  auto ready_future(maid_node_ptr->InitAsync(ready_health));
+  return std::make_pair(maid_node_ptr, std::move(ready_future));
+}
+
+std::pair<std::shared_ptr<MaidClient>, boost::future<void>> MaidClient::MakeSharedAsync(
+    const passport::MaidAndSigner& maid_and_signer, int ready_health,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first,
+                                                             asio_service, completion_service } };
+  maid_node_ptr->InitAsync(ready_health);
+  // Held until the client is ready, then sent ahead of anything requested after this returns.  If
+  // joining fails, the request is cancelled, so this future carries that failure too.
+  nfs_vault::MaidAccountCreation account_creation{
+      passport::PublicMaid{ maid_and_signer.first },
+      passport::PublicAnmaid{ maid_and_signer.second } };
+  auto ready_future(maid_node_ptr->CreateAccount(account_creation));
+  return std::make_pair(maid_node_ptr, std::move(ready_future));
+}
+
+std::shared_ptr<MaidClient> MaidClient::MakeSharedWithRouting(
+    const passport::Maid& maid, std::unique_ptr<ClientRouting> routing,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid, asio_service,
+                                                             completion_service,
+                                                             std::move(routing) } };
+  maid_node_ptr->Init();
+  return maid_node_ptr;
+}
+
+std::shared_ptr<MaidClient> MaidClient::MakeSharedWithRouting(
+    const passport::MaidAndSigner& maid_and_signer, std::unique_ptr<ClientRouting> routing,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first,
+                                                             asio_service, completion_service,
+                                                             std::move(routing) } };
   maid_node_ptr->Init(maid_and_signer);
   return maid_node_ptr;
 }
@@ -83,7 +142,8 @@ std::shared_ptr<MaidClient> MaidClient::MakeShared(
 std::shared_ptr<MaidClient> MaidClient::MakeSharedZeroState(
     const passport::MaidAndSigner& maid_and_signer,
     const std::vector<passport::PublicPmid>& public_pmids) {
-  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first } };
+  std::shared_ptr<MaidClient> maid_node_ptr{ new MaidClient{ maid_and_signer.first, nullptr,
+                                                             nullptr } };
   maid_node_ptr->InitZeroState(maid_and_signer, public_pmids);
   return maid_node_ptr;
 }
@@ -120,42 +180,98 @@ void MaidClient::Init() {
   cleanup_on_error.Release();
 }
 
-MaidClient::MaidClient(const passport::Maid& maid)
+boost::future<void> MaidClient::InitAsync(int ready_health) {
+  on_scope_exit cleanup_on_error([&] { Stop(); });
+  {
+    std::lock_guard<std::mutex> lock{ network_health_mutex_ };
+    ready_health_ = ready_health;
+  }
+  auto ready_future(ready_promise_.get_future());
+  JoinRouting(std::vector<passport::PublicPmid>());
+  cleanup_on_error.Release();
+  return ready_future;
+}
+
+MaidClient::MaidClient(const passport::Maid& maid,
+                       std::shared_ptr<BoostAsioService> asio_service,
+                       std::shared_ptr<BoostAsioService> completion_service,
+                       std::unique_ptr<ClientRouting> routing)
     : kMaid_(maid),
-      asio_service_(2),
-      rpc_timers_(asio_service_),
+      kOwnsAsioService_(!asio_service),
+      kOwnsCompletionService_(!completion_service),
+      asio_service_(asio_service ? asio_service
+                                 : std::make_shared<BoostAsioService>(kDefaultClientThreadCount)),
+      completion_service_(
+          completion_service ? completion_service
+                             : std::make_shared<BoostAsioService>(kDefaultCompletionThreadCount)),
+      return_code_slab_(),
+      version_names_slab_(),
+      rpc_timers_(*asio_service_),
+      congestion_control_(*asio_service_),
       network_health_mutex_(),
       network_health_condition_variable_(),
       network_health_(-1),
+      ready_health_(100),
+      ready_promise_(),
+      readiness_gate_(),
       network_health_change_signal_(),
-      routing_(maidsafe::make_unique<routing::Routing>(kMaid_)),
-      data_getter_(asio_service_, *routing_),
+      routing_(routing ? std::move(routing) : maidsafe::make_unique<NetworkRouting>(kMaid_)),
+      data_getter_(*asio_service_, *routing_, completion_service_, &congestion_control_),
       public_pmid_helper_(),
-      dispatcher_(*routing_),
+      dispatcher_(*routing_, congestion_control_, readiness_gate_),
       service_([&]()->std::unique_ptr<MaidNodeService> {
-        std::unique_ptr<MaidNodeService> service(
-            new MaidNodeService(routing::SingleId(routing_->kNodeId()), rpc_timers_));
+        std::unique_ptr<MaidNodeService> service(new MaidNodeService(
+            routing::SingleId(routing_->kNodeId()), rpc_timers_, congestion_control_));
         return std::move(service);
       }()) {
 }
 
 void MaidClient::Stop() {
   LOG(kVerbose) << "MaidClient::Stop()";
+  readiness_gate_.Close();
   dispatcher_.Stop();
   LOG(kVerbose) << "MaidClient::Stop() : dispatcher_";
+  congestion_control_.Stop();
+  LOG(kVerbose) << "MaidClient::Stop() : congestion_control_";
   routing_.reset();
   LOG(kVerbose) << "MaidClient::Stop() : routing_";
   rpc_timers_.CancellAll();
+  // The slabs' operations were waiting on the tasks just dropped.
+  return_code_slab_.CancelAll();
+  version_names_slab_.CancelAll();
   LOG(kVerbose) << "MaidClient::Stop() : rpc_timers_";
-  asio_service_.Stop();
-  LOG(kVerbose) << "MaidClient::Stop() : asio_service_";
+  // A shared service keeps running for the other clients using it.
+  if (kOwnsAsioService_) {
+    asio_service_->Stop();
+    LOG(kVerbose) << "MaidClient::Stop() : asio_service_";
+  }
+  // Stopped last, so results of the requests cancelled above are still delivered.
+  if (kOwnsCompletionService_) {
+    completion_service_->Stop();
+    LOG(kVerbose) << "MaidClient::Stop() : completion_service_";
+  }
 }
 
 MaidClient::OnNetworkHealthChange& MaidClient::network_health_change_signal() {
   return network_health_change_signal_;
 }
 
+std::map<NodeId, CongestionControl::Metrics> MaidClient::congestion_metrics() const {
+  return congestion_control_.GetMetrics();
+}
+
 void MaidClient::InitRouting(std::vector<passport::PublicPmid> public_pmids) {
+  JoinRouting(public_pmids);
+  // FIXME BEFORE_RELEASE discuss: parallel attempts, max no. of endpoints to try,
+  // prioritise live ports. To reduce the blocking duration in case of no network connectivity
+  std::unique_lock<std::mutex> lock{ network_health_mutex_ };
+  network_health_condition_variable_.wait(lock, [this] {
+    return (network_health_ == 100) || (network_health_ < kJoinFailedNetworkHealth); });
+  if (network_health_ < 0)
+    BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_connected));
+}
+
+void MaidClient::JoinRouting(const std::vector<passport::PublicPmid>& public_pmids) {
   routing::Functors functors(InitialiseRoutingCallbacks());
   if (!public_pmids.empty()) {
     UpdateRequestPublicKeyFunctor(functors.request_public_key, public_pmids);
@@ -164,13 +280,6 @@ void MaidClient::InitRouting(std::vector<passport::PublicPmid> public_pmids) {
   LOG(kInfo) << "after  InitialiseRoutingCallbacks";
   routing_->Join(functors);
   LOG(kInfo) << "after  routing_.Join()";
-  // FIXME BEFORE_RELEASE discuss: parallel attempts, max no. of endpoints to try,
-  // prioritise live ports. To reduce the blocking duration in case of no network connectivity
-  std::unique_lock<std::mutex> lock{ network_health_mutex_ };
-  network_health_condition_variable_.wait(lock, [this] {
-    return (network_health_ == 100) || (network_health_ < -300000); });
-  if (network_health_ < 0)
-    BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_connected));
 }
 
 routing::Functors MaidClient::InitialiseRoutingCallbacks() {
@@ -190,8 +299,9 @@ routing::Functors MaidClient::InitialiseRoutingCallbacks() {
   functors.close_nodes_change = [](std::shared_ptr<routing::CloseNodesChange> /*close_change*/) {};
   functors.request_public_key = [this_ptr](const NodeId& node_id,
                                        const routing::GivePublicKeyFunctor& give_key) {
-    auto future_key(this_ptr->Get(passport::PublicPmid::Name{ Identity{ node_id.string() } },
-                                        std::chrono::seconds(10)));
+    // Straight to data_getter_, since joining may depend on this before the client is ready.
+    auto future_key(this_ptr->data_getter_.Get(
+        passport::PublicPmid::Name{ Identity{ node_id.string() } }, std::chrono::seconds(10)));
     this_ptr->public_pmid_helper_.AddEntry(std::move(future_key), give_key);
   };
 
@@ -214,13 +324,38 @@ routing::Functors MaidClient::InitialiseRoutingCallbacks() {
 
 void MaidClient::OnNetworkStatusChange(int updated_network_health) {
   std::shared_ptr<MaidClient> this_ptr(shared_from_this());
-  asio_service_.service().post([this_ptr, updated_network_health] {
+  asio_service_->service().post([this_ptr, updated_network_health] {
     routing::UpdateNetworkHealth(updated_network_health, this_ptr->network_health_,
         this_ptr->network_health_mutex_, this_ptr->network_health_condition_variable_,
         NodeId(this_ptr->kMaid_.name()->string()));
+    this_ptr->UpdateReadiness();
   });
 }
 
+void MaidClient::UpdateReadiness() {
+  int network_health(0), ready_health(0);
+  {
+    std::lock_guard<std::mutex> lock{ network_health_mutex_ };
+    network_health = network_health_;
+    ready_health = ready_health_;
+  }
+  if (network_health >= ready_health) {
+    if (readiness_gate_.Open()) {
+      LOG(kInfo) << "MaidClient ready at network health " << network_health;
+      ready_promise_.set_value();
+    }
+  } else if (network_health < kJoinFailedNetworkHealth) {
+    if (readiness_gate_.CloseIfHolding()) {
+      LOG(kError) << "MaidClient failed to join the network";
+      // Nothing has been sent yet, so every outstanding task is a held request.
+      rpc_timers_.CancellAll();
+      return_code_slab_.CancelAll();
+      version_names_slab_.CancelAll();
+      ready_promise_.set_exception(MakeError(RoutingErrors::not_connected));
+    }
+  }
+}
+
 boost::future<void> MaidClient::CreateAccount(
     const nfs_vault::MaidAccountCreation& account_creation,
     const std::chrono::steady_clock::duration& timeout) {
@@ -230,7 +365,8 @@ boost::future<void> MaidClient::CreateAccount(
       HandleCreateAccountResult(result, promise);
   });
   auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
-      routing::Parameters::group_size - 1, response_functor));
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.create_account_timer.NewTaskId());
   rpc_timers_.create_account_timer.AddTask(
       timeout, [op_data](ResponseContents create_account_response) {
@@ -238,10 +374,98 @@ boost::future<void> MaidClient::CreateAccount(
                },
       // TODO(Fraser#5#): 2013-08-18 - Confirm expected count
       routing::Parameters::group_size - 1, task_id);
-  dispatcher_.SendCreateAccountRequest(task_id, account_creation);
+  dispatcher_.SendCreateAccountRequest(task_id, account_creation, timeout);
+  return promise->get_future();
+}
+
+MaidClient::ReturnCodesFuture MaidClient::IncrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names,
+    const std::chrono::steady_clock::duration& timeout) {
+  LOG(kVerbose) << "MaidClient IncrementReferenceCount for " << data_names.size() << " chunks";
+  auto promise(std::make_shared<boost::promise<std::vector<ReturnCode>>>());
+  DoIncrementReferenceCount(data_names, timeout,
+                            [promise, data_names](const DataNamesAndReturnCodes& result) {
+                              HandleReferenceCountsResult(result, data_names, promise);
+                            });
+  return promise->get_future();
+}
+
+MaidClient::ReturnCodesFuture MaidClient::DecrementReferenceCount(
+    const std::vector<ImmutableData::Name>& data_names,
+    const std::chrono::steady_clock::duration& timeout) {
+  LOG(kVerbose) << "MaidClient DecrementReferenceCount for " << data_names.size() << " chunks";
+  auto promise(std::make_shared<boost::promise<std::vector<ReturnCode>>>());
+  DoDecrementReferenceCount(data_names, timeout,
+                            [promise, data_names](const DataNamesAndReturnCodes& result) {
+                              HandleReferenceCountsResult(result, data_names, promise);
+                            });
+  return promise->get_future();
+}
+
+MaidClient::ReturnCodesFuture MaidClient::DeleteBatch(
+    const std::vector<nfs_vault::DataName>& data_names,
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
+  LOG(kVerbose) << "MaidClient Delete for " << data_names.size() << " names";
+  typedef MaidNodeService::DeleteBatchResponse::Contents ResponseContents;
+  auto promise(std::make_shared<boost::promise<std::vector<ReturnCode>>>());
+  const size_t part_count((data_names.size() + kMaxNamesPerDeleteRequest - 1) /
+                          kMaxNamesPerDeleteRequest);
+  auto handler(std::make_shared<HandleDeleteBatchResult>(promise, data_names, part_count));
+  for (size_t first_index(0); first_index < data_names.size();
+       first_index += kMaxNamesPerDeleteRequest) {
+    auto last_index(std::min(first_index + kMaxNamesPerDeleteRequest, data_names.size()));
+    std::vector<nfs_vault::DataName> part(std::begin(data_names) + first_index,
+                                          std::begin(data_names) + last_index);
+    auto response_functor([handler, first_index, last_index](
+        const DataNamesAndReturnCodes& result) { (*handler)(first_index, last_index, result); });
+    auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+        routing::Parameters::group_size - 1,
+        OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+    auto task_id(rpc_timers_.delete_batch_timer.NewTaskId());
+    rpc_timers_.delete_batch_timer.AddTask(
+        timeout, [op_data](ResponseContents delete_response) {
+                   op_data->HandleResponseContents(std::move(delete_response));
+                 },
+        routing::Parameters::group_size - 1, task_id);
+    dispatcher_.SendDeleteBatchRequest(task_id, nfs_vault::DataNames(part), timeout, priority);
+  }
   return promise->get_future();
 }
 
+void MaidClient::DoIncrementReferenceCount(const std::vector<ImmutableData::Name>& data_names,
+                                           const std::chrono::steady_clock::duration& timeout,
+                                           const ReferenceCountsFunctor& response_functor) {
+  typedef MaidNodeService::IncrementReferenceCountsResponse::Contents ResponseContents;
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+  auto task_id(rpc_timers_.increment_reference_counts_timer.NewTaskId());
+  rpc_timers_.increment_reference_counts_timer.AddTask(
+      timeout, [op_data](ResponseContents increment_response) {
+                 op_data->HandleResponseContents(std::move(increment_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendIncrementReferenceCountsRequest(task_id, nfs_vault::DataNames(data_names),
+                                               timeout);
+}
+
+void MaidClient::DoDecrementReferenceCount(const std::vector<ImmutableData::Name>& data_names,
+                                           const std::chrono::steady_clock::duration& timeout,
+                                           const ReferenceCountsFunctor& response_functor) {
+  typedef MaidNodeService::DecrementReferenceCountsResponse::Contents ResponseContents;
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
+  auto task_id(rpc_timers_.decrement_reference_counts_timer.NewTaskId());
+  rpc_timers_.decrement_reference_counts_timer.AddTask(
+      timeout, [op_data](ResponseContents decrement_response) {
+                 op_data->HandleResponseContents(std::move(decrement_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendDecrementReferenceCountsRequest(task_id, nfs_vault::DataNames(data_names),
+                                               timeout);
+}
+
 void MaidClient::RemoveAccount(const nfs_vault::MaidAccountRemoval& account_removal) {
   dispatcher_.SendRemoveAccountRequest(account_removal);
 }
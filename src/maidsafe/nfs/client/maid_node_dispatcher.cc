@@ -22,28 +22,81 @@ namespace maidsafe {
 
 namespace nfs_client {
 
-MaidNodeDispatcher::MaidNodeDispatcher(routing::Routing& routing)
-    : running_(true),
-      running_mutex_(),
+MaidNodeDispatcher::MaidNodeDispatcher(ClientRouting& routing,
+                                       CongestionControl& congestion_control,
+                                       ReadinessGate& readiness_gate)
+    : send_gate_(),
+      owned_routing_(),
       routing_(routing),
+      congestion_control_(congestion_control),
+      readiness_gate_(readiness_gate),
+      kThisNodeAsSender_(routing_.kNodeId()),
+      kMaidManagerReceiver_(routing_.kNodeId()) {}
+
+MaidNodeDispatcher::MaidNodeDispatcher(routing::Routing& routing,
+                                       CongestionControl& congestion_control,
+                                       ReadinessGate& readiness_gate)
+    : send_gate_(),
+      owned_routing_(maidsafe::make_unique<NetworkRouting>(routing)),
+      routing_(*owned_routing_),
+      congestion_control_(congestion_control),
+      readiness_gate_(readiness_gate),
       kThisNodeAsSender_(routing_.kNodeId()),
       kMaidManagerReceiver_(routing_.kNodeId()) {}
 
 
 void MaidNodeDispatcher::Stop() {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  send_gate_.Close();
   LOG(kWarning) << " MaidNodeDispatcher::Stop() !";
 }
 
+void MaidNodeDispatcher::SendDeleteBatchRequest(routing::TaskId task_id,
+                                                const nfs_vault::DataNames& data_names,
+                                                const std::chrono::steady_clock::duration& timeout,
+                                                Priority priority) {
+  typedef nfs::DeleteBatchRequestFromMaidNodeToMaidManager NfsMessage;
+  CheckSourcePersonaType<NfsMessage>();
+  NfsMessage nfs_message(nfs::MessageId(task_id), data_names);
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, priority);
+}
+
+void MaidNodeDispatcher::SendGetVersionsBatchRequest(
+    routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+    const std::chrono::steady_clock::duration& timeout, Priority priority) {
+  typedef nfs::GetVersionsBatchRequestFromMaidNodeToVersionHandler NfsMessage;
+  CheckSourcePersonaType<NfsMessage>();
+  NfsMessage nfs_message(nfs::MessageId(task_id), data_names);
+  NfsMessage::Receiver receiver(
+      routing::GroupId(NodeId(data_names.data_names_.front().raw_name.string())));
+  RoutingSend(nfs_message, receiver, timeout, priority);
+}
+
+void MaidNodeDispatcher::SendIncrementReferenceCountsRequest(
+    routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+    const std::chrono::steady_clock::duration& timeout) {
+  typedef nfs::IncrementReferenceCountsRequestFromMaidNodeToMaidManager NfsMessage;
+  CheckSourcePersonaType<NfsMessage>();
+  NfsMessage nfs_message(nfs::MessageId(task_id), data_names);
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, Priority::kNormal);
+}
+
+void MaidNodeDispatcher::SendDecrementReferenceCountsRequest(
+    routing::TaskId task_id, const nfs_vault::DataNames& data_names,
+    const std::chrono::steady_clock::duration& timeout) {
+  typedef nfs::DecrementReferenceCountsRequestFromMaidNodeToMaidManager NfsMessage;
+  CheckSourcePersonaType<NfsMessage>();
+  NfsMessage nfs_message(nfs::MessageId(task_id), data_names);
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, Priority::kNormal);
+}
+
 void MaidNodeDispatcher::SendCreateAccountRequest(
     routing::TaskId task_id,
-    const nfs_vault::MaidAccountCreation& maid_account_creation) {
+    const nfs_vault::MaidAccountCreation& maid_account_creation,
+    const std::chrono::steady_clock::duration& timeout) {
   typedef nfs::CreateAccountRequestFromMaidNodeToMaidManager NfsMessage;
   CheckSourcePersonaType<NfsMessage>();
-  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
   NfsMessage nfs_message(nfs::MessageId(task_id), maid_account_creation);
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  RoutingSend(nfs_message, kMaidManagerReceiver_, timeout, Priority::kNormal);
 }
 
 void MaidNodeDispatcher::SendRemoveAccountRequest(
@@ -52,7 +105,9 @@ void MaidNodeDispatcher::SendRemoveAccountRequest(
   CheckSourcePersonaType<NfsMessage>();
   typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
   NfsMessage nfs_message(maid_account_removal);
-  RoutingSend(RoutingMessage(nfs_message.Serialise(), kThisNodeAsSender_, kMaidManagerReceiver_));
+  RoutingMessage routing_message(nfs_message.Serialise(), kThisNodeAsSender_,
+                                 kMaidManagerReceiver_);
+  readiness_gate_.Run([this, routing_message] { RoutingSend(routing_message); });
 }
 
 }  // namespace nfs_client
@@ -37,30 +37,43 @@ std::error_code NoSuchElement() {
 MaidNodeService::RpcTimers::RpcTimers(BoostAsioService& asio_service_)
     : put_timer(asio_service_),
       get_versions_timer(asio_service_),
+      get_versions_batch_timer(asio_service_),
       get_branch_timer(asio_service_),
       create_account_timer(asio_service_),
       create_version_tree_timer(asio_service_),
-      put_version_timer(asio_service_) {}
+      put_version_timer(asio_service_),
+      delete_timer(asio_service_),
+      delete_branch_until_fork_timer(asio_service_),
+      delete_batch_timer(asio_service_),
+      increment_reference_counts_timer(asio_service_),
+      decrement_reference_counts_timer(asio_service_) {}
 
 void MaidNodeService::RpcTimers::CancellAll() {
   put_timer.CancelAll();
   get_versions_timer.CancelAll();
+  get_versions_batch_timer.CancelAll();
   get_branch_timer.CancelAll();
   create_account_timer.CancelAll();
   create_version_tree_timer.CancelAll();
   put_version_timer.CancelAll();
+  delete_timer.CancelAll();
+  delete_branch_until_fork_timer.CancelAll();
+  delete_batch_timer.CancelAll();
+  increment_reference_counts_timer.CancelAll();
+  decrement_reference_counts_timer.CancelAll();
 }
 
-MaidNodeService::MaidNodeService(const routing::SingleId& receiver,
-                                 RpcTimers& rpc_timers)
-    : kReceiver_(receiver), rpc_timers_(rpc_timers) {}
+MaidNodeService::MaidNodeService(const routing::SingleId& receiver, RpcTimers& rpc_timers,
+                                 CongestionControl& congestion_control)
+    : kReceiver_(receiver), rpc_timers_(rpc_timers), congestion_control_(congestion_control) {}
 
 void MaidNodeService::HandleMessage(const PutResponse& message,
-                                    const PutResponse::Sender& /*sender*/,
+                                    const PutResponse::Sender& sender,
                                     const PutResponse::Receiver& receiver) {
   LOG(kVerbose) << "MaidNodeService::HandleMessage PutResponse " << message.id;
   assert(receiver == kReceiver_);
   static_cast<void>(receiver);
+  congestion_control_.OnResponse(sender.group_id.data, nfs::MessageAction::kPutRequest, message.id);
   try {
     rpc_timers_.put_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -72,19 +85,23 @@ void MaidNodeService::HandleMessage(const PutResponse& message,
   }
 }
 
-void MaidNodeService::HandleMessage(const PutFailure& /*message*/,
-                                    const PutFailure::Sender& /*sender*/,
+void MaidNodeService::HandleMessage(const PutFailure& message,
+                                    const PutFailure::Sender& sender,
                                     const PutFailure::Receiver& /*receiver*/) {
   LOG(kInfo) << "Get response from PutFailure";
+  // A failure still answers the Put, so frees its place in the window.
+  congestion_control_.OnResponse(sender.group_id.data, nfs::MessageAction::kPutRequest, message.id);
   // TODO(Fraser#5#): 2013-08-24 - Decide on how this is to be handled, and implement.
   assert(0);
 }
 
 void MaidNodeService::HandleMessage(const GetVersionsResponse& message,
-                                    const GetVersionsResponse::Sender& /*sender*/,
+                                    const GetVersionsResponse::Sender& sender,
                                     const GetVersionsResponse::Receiver& receiver) {
   assert(receiver == kReceiver_);
   static_cast<void>(receiver);
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kGetVersionsRequest, message.id);
   try {
     rpc_timers_.get_versions_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -96,10 +113,30 @@ void MaidNodeService::HandleMessage(const GetVersionsResponse& message,
   }
 }
 
+void MaidNodeService::HandleMessage(const GetVersionsBatchResponse& message,
+                                    const GetVersionsBatchResponse::Sender& sender,
+                                    const GetVersionsBatchResponse::Receiver& receiver) {
+  assert(receiver == kReceiver_);
+  static_cast<void>(receiver);
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kGetVersionsBatchRequest, message.id);
+  try {
+    rpc_timers_.get_versions_batch_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
 void MaidNodeService::HandleMessage(const PutVersionResponse& message,
-                                    const PutVersionResponse::Sender& /*sender*/,
+                                    const PutVersionResponse::Sender& sender,
                                     const PutVersionResponse::Receiver& /*receiver*/) {
   LOG(kInfo) << "Get response for PutVersion";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kPutVersionRequest, message.id);
   try {
     rpc_timers_.put_version_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -112,10 +149,12 @@ void MaidNodeService::HandleMessage(const PutVersionResponse& message,
 }
 
 void MaidNodeService::HandleMessage(const GetBranchResponse& message,
-                                    const GetBranchResponse::Sender& /*sender*/,
+                                    const GetBranchResponse::Sender& sender,
                                     const GetBranchResponse::Receiver& receiver) {
   assert(receiver == kReceiver_);
   static_cast<void>(receiver);
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kGetBranchRequest, message.id);
   try {
     rpc_timers_.get_branch_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -128,9 +167,11 @@ void MaidNodeService::HandleMessage(const GetBranchResponse& message,
 }
 
 void MaidNodeService::HandleMessage(const CreateAccountResponse& message,
-                                    const CreateAccountResponse::Sender& /*sender*/,
+                                    const CreateAccountResponse::Sender& sender,
                                     const CreateAccountResponse::Receiver& /*receiver*/) {
   LOG(kInfo) << "Get response for CreateAccount";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kCreateAccountRequest, message.id);
   try {
     rpc_timers_.create_account_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -143,9 +184,11 @@ void MaidNodeService::HandleMessage(const CreateAccountResponse& message,
 }
 
 void MaidNodeService::HandleMessage(const CreateVersionTreeResponse& message,
-                                    const CreateVersionTreeResponse::Sender& /*sender*/,
+                                    const CreateVersionTreeResponse::Sender& sender,
                                     const CreateVersionTreeResponse::Receiver& /*receiver*/) {
   LOG(kInfo) << "Get response for CreateVersionTree";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kCreateVersionTreeRequest, message.id);
   try {
     rpc_timers_.create_version_tree_timer.AddResponse(message.id.data, *message.contents);
   }
@@ -157,6 +200,93 @@ void MaidNodeService::HandleMessage(const CreateVersionTreeResponse& message,
   }
 }
 
+void MaidNodeService::HandleMessage(const DeleteResponse& message,
+                                    const DeleteResponse::Sender& sender,
+                                    const DeleteResponse::Receiver& /*receiver*/) {
+  LOG(kInfo) << "Get response for Delete";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kDeleteRequest, message.id);
+  try {
+    rpc_timers_.delete_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
+void MaidNodeService::HandleMessage(const DeleteBranchUntilForkResponse& message,
+                                    const DeleteBranchUntilForkResponse::Sender& sender,
+                                    const DeleteBranchUntilForkResponse::Receiver& /*receiver*/) {
+  LOG(kInfo) << "Get response for DeleteBranchUntilFork";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kDeleteBranchUntilForkRequest, message.id);
+  try {
+    rpc_timers_.delete_branch_until_fork_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
+void MaidNodeService::HandleMessage(const DeleteBatchResponse& message,
+                                    const DeleteBatchResponse::Sender& sender,
+                                    const DeleteBatchResponse::Receiver& /*receiver*/) {
+  LOG(kInfo) << "Get response for DeleteBatch";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kDeleteBatchRequest, message.id);
+  try {
+    rpc_timers_.delete_batch_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
+void MaidNodeService::HandleMessage(
+    const IncrementReferenceCountsResponse& message,
+    const IncrementReferenceCountsResponse::Sender& sender,
+    const IncrementReferenceCountsResponse::Receiver& /*receiver*/) {
+  LOG(kInfo) << "Get response for IncrementReferenceCounts";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kIncrementReferenceCountsRequest, message.id);
+  try {
+    rpc_timers_.increment_reference_counts_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
+void MaidNodeService::HandleMessage(
+    const DecrementReferenceCountsResponse& message,
+    const DecrementReferenceCountsResponse::Sender& sender,
+    const DecrementReferenceCountsResponse::Receiver& /*receiver*/) {
+  LOG(kInfo) << "Get response for DecrementReferenceCounts";
+  congestion_control_.OnResponse(sender.group_id.data,
+                                 nfs::MessageAction::kDecrementReferenceCountsRequest, message.id);
+  try {
+    rpc_timers_.decrement_reference_counts_timer.AddResponse(message.id.data, *message.contents);
+  }
+  catch (const maidsafe_error& error) {
+    if (error.code() != NoSuchElement())
+      throw;
+    else
+      LOG(kWarning) << "Timer does not expect:" << message.id.data;
+  }
+}
+
 }  // namespace nfs_client
 
 }  // namespace maidsafe
@@ -286,6 +286,57 @@ void swap(DataNamesAndReturnCode& lhs, DataNamesAndReturnCode& rhs) MAIDSAFE_NOE
   swap(lhs.names, rhs.names);
 }
 
+// ==================== DataNamesAndReturnCodes ====================================================
+DataNamesAndReturnCodes::DataNamesAndReturnCodes() : results(), return_code() {}
+
+DataNamesAndReturnCodes::DataNamesAndReturnCodes(const ReturnCode& code)
+    : results(), return_code(code) {}
+
+DataNamesAndReturnCodes::DataNamesAndReturnCodes(std::vector<DataNameAndReturnCode> results_in,
+                                                 const ReturnCode& code)
+    : results(std::move(results_in)), return_code(code) {}
+
+DataNamesAndReturnCodes::DataNamesAndReturnCodes(const DataNamesAndReturnCodes& other)
+    : results(other.results), return_code(other.return_code) {}
+
+DataNamesAndReturnCodes::DataNamesAndReturnCodes(DataNamesAndReturnCodes&& other)
+    : results(std::move(other.results)), return_code(std::move(other.return_code)) {}
+
+DataNamesAndReturnCodes& DataNamesAndReturnCodes::operator=(DataNamesAndReturnCodes other) {
+  swap(*this, other);
+  return *this;
+}
+
+DataNamesAndReturnCodes::DataNamesAndReturnCodes(const std::string& serialised_copy)
+    : results(), return_code() {
+  protobuf::DataNamesAndReturnCodes proto_copy;
+  if (!proto_copy.ParseFromString(serialised_copy))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  for (int index(0); index < proto_copy.serialised_data_name_and_return_code_size(); ++index) {
+    results.emplace_back(
+        DataNameAndReturnCode(proto_copy.serialised_data_name_and_return_code(index)));
+  }
+  return_code = ReturnCode(proto_copy.serialised_return_code());
+}
+
+std::string DataNamesAndReturnCodes::Serialise() const {
+  protobuf::DataNamesAndReturnCodes proto_copy;
+  for (const auto& result : results)
+    proto_copy.add_serialised_data_name_and_return_code(result.Serialise());
+  proto_copy.set_serialised_return_code(return_code.Serialise());
+  return proto_copy.SerializeAsString();
+}
+
+bool operator==(const DataNamesAndReturnCodes& lhs, const DataNamesAndReturnCodes& rhs) {
+  return lhs.return_code == rhs.return_code && lhs.results == rhs.results;
+}
+
+void swap(DataNamesAndReturnCodes& lhs, DataNamesAndReturnCodes& rhs) MAIDSAFE_NOEXCEPT {
+  using std::swap;
+  swap(lhs.results, rhs.results);
+  swap(lhs.return_code, rhs.return_code);
+}
+
 // ==================== DataNameVersionAndReturnCode ===============================================
 DataNameVersionAndReturnCode::DataNameVersionAndReturnCode()
     : data_name_and_version(), return_code() {}
@@ -569,6 +620,72 @@ void swap(StructuredDataNameAndContentOrReturnCode& lhs,
   swap(lhs.data_name_and_return_code, rhs.data_name_and_return_code);
 }
 
+// ==================== StructuredDataNamesAndContentsOrReturnCodes ================================
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes()
+    : results(), return_code() {}
+
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes(
+    const ReturnCode& code)
+    : results(), return_code(code) {}
+
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes(
+    std::vector<Result> results_in, const ReturnCode& code)
+    : results(std::move(results_in)), return_code(code) {}
+
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes(
+    const StructuredDataNamesAndContentsOrReturnCodes& other)
+    : results(other.results), return_code(other.return_code) {}
+
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes(
+    StructuredDataNamesAndContentsOrReturnCodes&& other)
+    : results(std::move(other.results)), return_code(std::move(other.return_code)) {}
+
+StructuredDataNamesAndContentsOrReturnCodes&
+    StructuredDataNamesAndContentsOrReturnCodes::operator=(
+        StructuredDataNamesAndContentsOrReturnCodes other) {
+  swap(*this, other);
+  return *this;
+}
+
+StructuredDataNamesAndContentsOrReturnCodes::StructuredDataNamesAndContentsOrReturnCodes(
+    const std::string& serialised_copy)
+    : results(), return_code() {
+  protobuf::StructuredDataNamesAndContentsOrReturnCodes proto_copy;
+  if (!proto_copy.ParseFromString(serialised_copy) ||
+      proto_copy.serialised_name_size() != proto_copy.serialised_content_or_return_code_size()) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  for (int index(0); index < proto_copy.serialised_name_size(); ++index) {
+    results.emplace_back(
+        nfs_vault::DataName(proto_copy.serialised_name(index)),
+        StructuredDataNameAndContentOrReturnCode(
+            proto_copy.serialised_content_or_return_code(index)));
+  }
+  return_code = ReturnCode(proto_copy.serialised_return_code());
+}
+
+std::string StructuredDataNamesAndContentsOrReturnCodes::Serialise() const {
+  protobuf::StructuredDataNamesAndContentsOrReturnCodes proto_copy;
+  for (const auto& result : results) {
+    proto_copy.add_serialised_name(result.first.Serialise());
+    proto_copy.add_serialised_content_or_return_code(result.second.Serialise());
+  }
+  proto_copy.set_serialised_return_code(return_code.Serialise());
+  return proto_copy.SerializeAsString();
+}
+
+bool operator==(const StructuredDataNamesAndContentsOrReturnCodes& lhs,
+                const StructuredDataNamesAndContentsOrReturnCodes& rhs) {
+  return lhs.return_code == rhs.return_code && lhs.results == rhs.results;
+}
+
+void swap(StructuredDataNamesAndContentsOrReturnCodes& lhs,
+          StructuredDataNamesAndContentsOrReturnCodes& rhs) MAIDSAFE_NOEXCEPT {
+  using std::swap;
+  swap(lhs.results, rhs.results);
+  swap(lhs.return_code, rhs.return_code);
+}
+
 // ========================== TipOfTreeAndReturnCode ===================================
 TipOfTreeAndReturnCode::TipOfTreeAndReturnCode() : tip_of_tree(), return_code() {}
 
@@ -27,31 +27,103 @@ namespace maidsafe {
 
 namespace nfs_client {
 
-std::shared_ptr<MpidClient> MpidClient::MakeShared(const passport::Mpid& mpid) {
-  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid } };
+namespace {
+
+// Routing reports a health below this once it has given up trying to join.
+const int kJoinFailedNetworkHealth(-300000);
+
+}  // unnamed namespace
+
+std::shared_ptr<MpidClient> MpidClient::MakeShared(
+    const passport::Mpid& mpid, std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid, asio_service,
+                                                             completion_service } };
   mpid_node_ptr->Init();
   return mpid_node_ptr;
 }
 
 std::shared_ptr<MpidClient> MpidClient::MakeShared(
-    const passport::MpidAndSigner& mpid_and_signer) {
-  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid_and_signer.first } };
+    const passport::MpidAndSigner& mpid_and_signer,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid_and_signer.first,
+                                                             asio_service, completion_service } };
   mpid_node_ptr->Init(mpid_and_signer);
   return mpid_node_ptr;
 }
 
-MpidClient::MpidClient(const passport::Mpid& mpid)
+std::pair<std::shared_ptr<MpidClient>, boost::future<void>> MpidClient::MakeSharedAsync(
+    const passport::Mpid& mpid, int ready_health, std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid, asio_service,
+                                                             completion_service } };
+  auto ready_future(mpid_node_ptr->InitAsync(ready_health));
+  return std::make_pair(mpid_node_ptr, std::move(ready_future));
+}
+
+std::pair<std::shared_ptr<MpidClient>, boost::future<void>> MpidClient::MakeSharedAsync(
+    const passport::MpidAndSigner& mpid_and_signer, int ready_health,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid_and_signer.first,
+                                                             asio_service, completion_service } };
+  mpid_node_ptr->InitAsync(ready_health);
+  // Held until the client is ready, so this future also carries a failure to join.
+  nfs_vault::MpidAccountCreation account_creation{
+      passport::PublicMpid{ mpid_and_signer.first },
+      passport::PublicAnmpid{ mpid_and_signer.second } };
+  auto ready_future(mpid_node_ptr->CreateAccount(account_creation));
+  return std::make_pair(mpid_node_ptr, std::move(ready_future));
+}
+
+std::shared_ptr<MpidClient> MpidClient::MakeSharedWithRouting(
+    const passport::Mpid& mpid, std::unique_ptr<ClientRouting> routing,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid, asio_service,
+                                                             completion_service,
+                                                             std::move(routing) } };
+  mpid_node_ptr->Init();
+  return mpid_node_ptr;
+}
+
+std::shared_ptr<MpidClient> MpidClient::MakeSharedWithRouting(
+    const passport::MpidAndSigner& mpid_and_signer, std::unique_ptr<ClientRouting> routing,
+    std::shared_ptr<BoostAsioService> asio_service,
+    std::shared_ptr<BoostAsioService> completion_service) {
+  std::shared_ptr<MpidClient> mpid_node_ptr{ new MpidClient{ mpid_and_signer.first,
+                                                             asio_service, completion_service,
+                                                             std::move(routing) } };
+  mpid_node_ptr->Init(mpid_and_signer);
+  return mpid_node_ptr;
+}
+
+MpidClient::MpidClient(const passport::Mpid& mpid,
+                       std::shared_ptr<BoostAsioService> asio_service,
+                       std::shared_ptr<BoostAsioService> completion_service,
+                       std::unique_ptr<ClientRouting> routing)
     : kMpid_(mpid),
-      asio_service_(2),
-      rpc_timers_(asio_service_),
+      kOwnsAsioService_(!asio_service),
+      kOwnsCompletionService_(!completion_service),
+      asio_service_(asio_service ? asio_service
+                                 : std::make_shared<BoostAsioService>(kDefaultClientThreadCount)),
+      completion_service_(
+          completion_service ? completion_service
+                             : std::make_shared<BoostAsioService>(kDefaultCompletionThreadCount)),
+      return_code_slab_(),
+      rpc_timers_(*asio_service_),
       network_health_mutex_(),
       network_health_condition_variable_(),
       network_health_(-1),
+      ready_health_(100),
+      ready_promise_(),
+      readiness_gate_(),
       network_health_change_signal_(),
-      routing_(maidsafe::make_unique<routing::Routing>(kMpid_)),
+      routing_(routing ? std::move(routing) : maidsafe::make_unique<NetworkRouting>(kMpid_)),
       public_pmid_helper_(),
-      dispatcher_(*routing_),
-      get_handler_(rpc_timers_.get_timer, dispatcher_),
+      dispatcher_(*routing_, readiness_gate_),
+      get_handler_(rpc_timers_.get_timer, dispatcher_, completion_service_),
       service_([&]()->std::unique_ptr<MpidNodeService> {
         std::unique_ptr<MpidNodeService> service(
           new MpidNodeService(routing::SingleId(routing_->kNodeId()), rpc_timers_, get_handler_));
@@ -59,10 +131,18 @@ MpidClient::MpidClient(const passport::Mpid& mpid)
       }()) {}
 
 void MpidClient::Stop() {
+  readiness_gate_.Close();
   dispatcher_.Stop();
   routing_.reset();
   rpc_timers_.CancellAll();
-  asio_service_.Stop();
+  // The slab's operations were waiting on the tasks just dropped.
+  return_code_slab_.CancelAll();
+  // A shared service keeps running for the other clients using it.
+  if (kOwnsAsioService_)
+    asio_service_->Stop();
+  // Stopped last, so results of the requests cancelled above are still delivered.
+  if (kOwnsCompletionService_)
+    completion_service_->Stop();
 }
 
 MpidClient::OnNetworkHealthChange& MpidClient::network_health_change_signal() {
@@ -78,8 +158,9 @@ boost::future<void> MpidClient::SendMessage(const nfs_vault::MpidMessage& mpid_m
   auto response_functor([promise](const nfs_client::ReturnCode& result) {
                            HandleSendMessageResponseResult(result, promise);
                         });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(routing::Parameters::group_size - 1,
-                                                               response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.send_message_timer.NewTaskId());
   rpc_timers_.send_message_timer.AddTask(
       timeout,
@@ -87,11 +168,29 @@ boost::future<void> MpidClient::SendMessage(const nfs_vault::MpidMessage& mpid_m
         op_data->HandleResponseContents(std::move(send_message_response));
       },
       routing::Parameters::group_size - 1, task_id);
-  rpc_timers_.send_message_timer.PrintTaskIds();
+  if (nfs::VerboseHotPathLogging())
+    rpc_timers_.send_message_timer.PrintTaskIds();
   dispatcher_.SendMessageRequest(task_id, mpid_message);
   return promise->get_future();
 }
 
+SlabFuture<void> MpidClient::SendMessage(const nfs_vault::MpidMessage& mpid_message,
+                                         SlabFutureTag,
+                                         const std::chrono::steady_clock::duration& timeout) {
+  typedef MpidNodeService::SendMessageResponse::Contents ResponseContents;
+  ReturnCodeSlab::Handle handle;
+  auto future(return_code_slab_.Acquire(routing::Parameters::group_size - 1, &GetSuccessOrError,
+                                        handle));
+  auto task_id(rpc_timers_.send_message_timer.NewTaskId());
+  rpc_timers_.send_message_timer.AddTask(
+      timeout, [handle](ResponseContents send_message_response) {
+                 ReturnCodeSlab::HandleResponseContents(handle, std::move(send_message_response));
+               },
+      routing::Parameters::group_size - 1, task_id);
+  dispatcher_.SendMessageRequest(task_id, mpid_message);
+  return future;
+}
+
 void MpidClient::DeleteMessage(const nfs_vault::MpidMessageAlert& mpid_message_alert) {
   dispatcher_.DeleteMessageRequest(mpid_message_alert);
 }
@@ -106,8 +205,9 @@ boost::future<typename nfs_vault::MpidMessage> MpidClient::GetMessage(
   auto response_functor([promise](const MpidMessageOrReturnCode& result) {
                            HandleGetMessageResponseResult(result, promise);
                         });
-  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(routing::Parameters::group_size - 1,
-                                                               response_functor));
+  auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.get_message_timer.NewTaskId());
   rpc_timers_.get_message_timer.AddTask(
       timeout,
@@ -115,7 +215,8 @@ boost::future<typename nfs_vault::MpidMessage> MpidClient::GetMessage(
         op_data->HandleResponseContents(std::move(get_message_response));
       },
       routing::Parameters::group_size - 1, task_id);
-  rpc_timers_.get_message_timer.PrintTaskIds();
+  if (nfs::VerboseHotPathLogging())
+    rpc_timers_.get_message_timer.PrintTaskIds();
   dispatcher_.GetMessageRequest(task_id, mpid_message_alert);
   return promise->get_future();
 }
@@ -129,7 +230,8 @@ boost::future<void> MpidClient::CreateAccount(
       HandleCreateAccountResult(result, promise);
   });
   auto op_data(std::make_shared<nfs::OpData<ResponseContents>>(
-      routing::Parameters::group_size - 1, response_functor));
+      routing::Parameters::group_size - 1,
+      OnCompletionService<ResponseContents>(completion_service_, response_functor)));
   auto task_id(rpc_timers_.create_account_timer.NewTaskId());
   rpc_timers_.create_account_timer.AddTask(
       timeout, [op_data](ResponseContents create_account_response) {
@@ -165,18 +267,34 @@ void MpidClient::Init() {
   cleanup_on_error.Release();
 }
 
+boost::future<void> MpidClient::InitAsync(int ready_health) {
+  on_scope_exit cleanup_on_error([&] { Stop(); });
+  {
+    std::lock_guard<std::mutex> lock{ network_health_mutex_ };
+    ready_health_ = ready_health;
+  }
+  auto ready_future(ready_promise_.get_future());
+  JoinRouting();
+  cleanup_on_error.Release();
+  return ready_future;
+}
+
 void MpidClient::InitRouting() {
-  routing::Functors functors(InitialiseRoutingCallbacks());
-  routing_->Join(functors);
+  JoinRouting();
   // FIXME BEFORE_RELEASE discuss: parallel attempts, max no. of endpoints to try,
   // prioritise live ports. To reduce the blocking duration in case of no network connectivity
   std::unique_lock<std::mutex> lock{ network_health_mutex_ };
   network_health_condition_variable_.wait(lock, [this] {
-    return (network_health_ == 100) || (network_health_ < -300000); });
+    return (network_health_ == 100) || (network_health_ < kJoinFailedNetworkHealth); });
   if (network_health_ < 0)
     BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_connected));
 }
 
+void MpidClient::JoinRouting() {
+  routing::Functors functors(InitialiseRoutingCallbacks());
+  routing_->Join(functors);
+}
+
 routing::Functors MpidClient::InitialiseRoutingCallbacks() {
   routing::Functors functors;
   std::shared_ptr<MpidClient> this_ptr(shared_from_this());
@@ -194,8 +312,11 @@ routing::Functors MpidClient::InitialiseRoutingCallbacks() {
   functors.close_nodes_change = [](std::shared_ptr<routing::CloseNodesChange> /*close_change*/) {};
   functors.request_public_key = [this_ptr](const NodeId& node_id,
                                        const routing::GivePublicKeyFunctor& give_key) {
-    auto future_key(this_ptr->Get(passport::PublicPmid::Name{ Identity{ node_id.string() } },
-                                        std::chrono::seconds(10)));
+    // Straight to get_handler_, since joining may depend on this before the client is ready.
+    auto promise(std::make_shared<boost::promise<passport::PublicPmid>>());
+    this_ptr->get_handler_.Get(passport::PublicPmid::Name{ Identity{ node_id.string() } },
+                               promise, std::chrono::seconds(10));
+    auto future_key(promise->get_future());
     this_ptr->public_pmid_helper_.AddEntry(std::move(future_key), give_key);
   };
 
@@ -216,13 +337,37 @@ routing::Functors MpidClient::InitialiseRoutingCallbacks() {
 
 void MpidClient::OnNetworkStatusChange(int updated_network_health) {
   std::shared_ptr<MpidClient> this_ptr(shared_from_this());
-  asio_service_.service().post([this_ptr, updated_network_health] {
+  asio_service_->service().post([this_ptr, updated_network_health] {
     routing::UpdateNetworkHealth(updated_network_health, this_ptr->network_health_,
         this_ptr->network_health_mutex_, this_ptr->network_health_condition_variable_,
         NodeId(this_ptr->kMpid_.name()->string()));
+    this_ptr->UpdateReadiness();
   });
 }
 
+void MpidClient::UpdateReadiness() {
+  int network_health(0), ready_health(0);
+  {
+    std::lock_guard<std::mutex> lock{ network_health_mutex_ };
+    network_health = network_health_;
+    ready_health = ready_health_;
+  }
+  if (network_health >= ready_health) {
+    if (readiness_gate_.Open()) {
+      LOG(kInfo) << "MpidClient ready at network health " << network_health;
+      ready_promise_.set_value();
+    }
+  } else if (network_health < kJoinFailedNetworkHealth) {
+    if (readiness_gate_.CloseIfHolding()) {
+      LOG(kError) << "MpidClient failed to join the network";
+      // Only public key lookups for joining have been sent, so every outstanding task can go.
+      rpc_timers_.CancellAll();
+      return_code_slab_.CancelAll();
+      ready_promise_.set_exception(MakeError(RoutingErrors::not_connected));
+    }
+  }
+}
+
 }  // namespace nfs_client
 
 }  // namespace maidsafe
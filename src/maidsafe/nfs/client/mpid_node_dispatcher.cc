@@ -22,17 +22,25 @@ namespace maidsafe {
 
 namespace nfs_client {
 
-MpidNodeDispatcher::MpidNodeDispatcher(routing::Routing& routing)
-    : running_(true),
-      running_mutex_(),
+MpidNodeDispatcher::MpidNodeDispatcher(ClientRouting& routing, ReadinessGate& readiness_gate)
+    : send_gate_(),
+      owned_routing_(),
       routing_(routing),
+      readiness_gate_(readiness_gate),
+      kThisNodeAsSender_(routing_.kNodeId()),
+      kMpidManagerReceiver_(routing_.kNodeId()) {}
+
+MpidNodeDispatcher::MpidNodeDispatcher(routing::Routing& routing, ReadinessGate& readiness_gate)
+    : send_gate_(),
+      owned_routing_(maidsafe::make_unique<NetworkRouting>(routing)),
+      routing_(*owned_routing_),
+      readiness_gate_(readiness_gate),
       kThisNodeAsSender_(routing_.kNodeId()),
       kMpidManagerReceiver_(routing_.kNodeId()) {}
 
 
 void MpidNodeDispatcher::Stop() {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  send_gate_.Close();
   LOG(kWarning) << " MpidNodeDispatcher::Stop() !";
 }
 
@@ -0,0 +1,91 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/readiness_gate.h"
+
+#include <utility>
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+ReadinessGate::ReadinessGate() : state_(State::kHolding), mutex_(), held_() {}
+
+bool ReadinessGate::Hold(Functor functor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (state_.load()) {
+    case State::kHolding:
+    case State::kDraining:
+      // While draining, later functors still queue up behind the held ones to keep them in order.
+      held_.push_back(std::move(functor));
+      return true;
+    case State::kClosed:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ReadinessGate::Open() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_.load() != State::kHolding)
+      return false;
+    state_.store(State::kDraining);
+  }
+  // The functors are run without the lock held, since they may well call Run themselves.
+  for (;;) {
+    std::deque<Functor> held;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (state_.load() == State::kClosed)
+        return true;
+      if (held_.empty()) {
+        state_.store(State::kOpen);
+        return true;
+      }
+      held.swap(held_);
+    }
+    for (const auto& functor : held)
+      functor();
+  }
+}
+
+bool ReadinessGate::Close() {
+  std::deque<Functor> dropped;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto previous_state(state_.exchange(State::kClosed));
+  dropped.swap(held_);
+  return previous_state == State::kHolding;
+}
+
+bool ReadinessGate::CloseIfHolding() {
+  std::deque<Functor> dropped;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto expected(State::kHolding);
+  if (!state_.compare_exchange_strong(expected, State::kClosed))
+    return false;
+  dropped.swap(held_);
+  return true;
+}
+
+bool ReadinessGate::IsOpen() const { return state_.load() == State::kOpen; }
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
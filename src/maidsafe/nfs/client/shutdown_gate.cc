@@ -0,0 +1,52 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/shutdown_gate.h"
+
+namespace maidsafe {
+
+namespace nfs_client {
+
+const uint32_t ShutdownGate::kClosed_(1U << 31);
+
+ShutdownGate::ShutdownGate() : state_(0), mutex_(), drained_() {}
+
+bool ShutdownGate::Enter() {
+  if ((state_.fetch_add(1) & kClosed_) == 0)
+    return true;
+  Leave();
+  return false;
+}
+
+void ShutdownGate::Leave() {
+  if (state_.fetch_sub(1) == (kClosed_ | 1U)) {
+    // Taking the lock orders this notification after Close's check of the predicate.
+    std::lock_guard<std::mutex> lock(mutex_);
+    drained_.notify_all();
+  }
+}
+
+void ShutdownGate::Close() {
+  state_.fetch_or(kClosed_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  drained_.wait(lock, [this] { return (state_.load() & ~kClosed_) == 0; });
+}
+
+}  // namespace nfs_client
+
+}  // namespace maidsafe
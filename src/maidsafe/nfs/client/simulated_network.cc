@@ -0,0 +1,737 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/simulated_network.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <tuple>
+
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/nfs/message_types.h"
+#include "maidsafe/nfs/client/structured_data.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace {
+
+typedef std::vector<StructuredDataVersions::VersionName> VersionNames;
+
+nfs_client::ReturnCode Success() { return nfs_client::ReturnCode(CommonErrors::success); }
+
+// Parses 'wrapper' as a Request, and serialises a Response to it holding 'answer' to its contents.
+template <typename Request, typename Response>
+std::string Answer(
+    const TypeErasedMessageWrapper& wrapper,
+    const std::function<typename Response::Contents(const typename Request::Contents&)>& answer) {
+  const Request request(wrapper);
+  return Response(request.id, answer(*request.contents)).Serialise();
+}
+
+const nfs_vault::DataName& NameOf(const nfs_vault::DataName& data_name) { return data_name; }
+
+const nfs_vault::DataName& NameOf(const nfs_vault::DataNameAndVersion& data_name_and_version) {
+  return data_name_and_version.data_name;
+}
+
+// As Answer, for requests for a version tree's tips or one of its branches.
+template <typename Request, typename Response>
+std::string AnswerGetVersions(
+    const TypeErasedMessageWrapper& wrapper,
+    const std::function<nfs_client::ReturnCode(const typename Request::Contents&,
+                                               VersionNames&)>& get) {
+  return Answer<Request, Response>(wrapper, [&](const typename Request::Contents& contents) {
+    VersionNames versions;
+    auto return_code(get(contents, versions));
+    nfs_client::StructuredDataNameAndContentOrReturnCode result;
+    if (IsSuccess(return_code)) {
+      result.structured_data = nfs_client::StructuredData(versions);
+    } else {
+      result.data_name_and_return_code =
+          nfs_client::DataNameAndReturnCode(NameOf(contents), return_code);
+    }
+    return result;
+  });
+}
+
+// As AnswerGetVersions, for a batch of names.
+template <typename Request, typename Response>
+std::string AnswerGetVersionsBatch(
+    const TypeErasedMessageWrapper& wrapper,
+    const std::function<nfs_client::ReturnCode(const nfs_vault::DataName&, VersionNames&)>& get) {
+  return Answer<Request, Response>(wrapper, [&](const nfs_vault::DataNames& names) {
+    std::vector<nfs_client::StructuredDataNamesAndContentsOrReturnCodes::Result> results;
+    for (const auto& name : names.data_names_) {
+      VersionNames versions;
+      auto return_code(get(name, versions));
+      nfs_client::StructuredDataNameAndContentOrReturnCode result;
+      if (IsSuccess(return_code))
+        result.structured_data = nfs_client::StructuredData(versions);
+      else
+        result.data_name_and_return_code = nfs_client::DataNameAndReturnCode(name, return_code);
+      results.emplace_back(name, std::move(result));
+    }
+    return nfs_client::StructuredDataNamesAndContentsOrReturnCodes(std::move(results), Success());
+  });
+}
+
+}  // unnamed namespace
+
+class SimulatedNetwork::Endpoint : public nfs_client::ClientRouting {
+ public:
+  Endpoint(SimulatedNetwork& network, const NodeId& node_id)
+      : network_(network), kNodeId_(node_id) {}
+  virtual ~Endpoint() { network_.Unregister(kNodeId_); }
+
+  virtual NodeId kNodeId() const { return kNodeId_; }
+  virtual void Join(const routing::Functors& functors) { network_.Join(kNodeId_, functors); }
+  virtual void Send(const routing::SingleToGroupMessage& message) { network_.Send(message); }
+  virtual std::vector<NodeId> CloseGroup(const NodeId& group_id) const {
+    return network_.CloseGroup(group_id);
+  }
+
+ private:
+  Endpoint();
+  Endpoint(const Endpoint&);
+  Endpoint(Endpoint&&);
+  Endpoint& operator=(Endpoint);
+
+  SimulatedNetwork& network_;
+  const NodeId kNodeId_;
+};
+
+const size_t SimulatedNetwork::kChunkShardCount;
+
+SimulatedNetwork::Config::Config()
+    : vault_count(64),
+      min_latency(std::chrono::milliseconds(1)),
+      max_latency(std::chrono::milliseconds(20)),
+      loss_rate(0.0),
+      churn_interval(std::chrono::steady_clock::duration::zero()),
+      churn_fraction(0.1),
+      thread_count(4),
+      seed(0) {}
+
+nfs_vault::MpidMessageAlert SimulatedNetwork::AlertFor(const nfs_vault::MpidMessage& mpid_message) {
+  return nfs_vault::MpidMessageAlert(
+      mpid_message.base,
+      nfs_vault::MessageIdType(crypto::Hash<crypto::SHA512>(mpid_message.Serialise()).string()));
+}
+
+SimulatedNetwork::SimulatedNetwork(const Config& config)
+    : kConfig_(config),
+      random_mutex_(),
+      random_(config.seed),
+      vaults_mutex_(),
+      vaults_(),
+      endpoints_mutex_(),
+      endpoints_(),
+      accounts_mutex_(),
+      maid_accounts_(),
+      mpid_accounts_(),
+      chunk_shards_(),
+      versions_mutex_(),
+      versions_(),
+      mpid_messages_mutex_(),
+      mpid_messages_(),
+      requests_(0),
+      responses_(0),
+      lost_(0),
+      lost_to_churn_(0),
+      undeliverable_(0),
+      churn_events_(0),
+      running_(true),
+      churn_timer_mutex_(),
+      asio_service_(std::max<uint32_t>(config.thread_count, 1)),
+      churn_timer_(asio_service_.service()) {
+  if (config.vault_count < static_cast<size_t>(routing::Parameters::group_size) ||
+      config.min_latency < std::chrono::steady_clock::duration::zero() ||
+      config.max_latency < config.min_latency || config.loss_rate < 0.0 ||
+      config.loss_rate > 1.0 || config.churn_fraction < 0.0 || config.churn_fraction > 1.0 ||
+      config.churn_interval < std::chrono::steady_clock::duration::zero()) {
+    LOG(kError) << "Invalid SimulatedNetwork configuration";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  while (vaults_.size() < config.vault_count)
+    vaults_.insert(NewVaultId());
+  if (config.churn_interval != std::chrono::steady_clock::duration::zero())
+    ArmChurnTimer();
+}
+
+SimulatedNetwork::~SimulatedNetwork() { Stop(); }
+
+std::unique_ptr<nfs_client::ClientRouting> SimulatedNetwork::MakeRouting(const NodeId& node_id) {
+  Register(node_id);
+  return maidsafe::make_unique<Endpoint>(*this, node_id);
+}
+
+void SimulatedNetwork::Churn(size_t count) {
+  std::lock_guard<std::mutex> lock(vaults_mutex_);
+  count = std::min(count, vaults_.size());
+  for (size_t leaving(0); leaving < count; ++leaving) {
+    auto itr(std::begin(vaults_));
+    {
+      std::lock_guard<std::mutex> random_lock(random_mutex_);
+      std::advance(itr, std::uniform_int_distribution<size_t>(0, vaults_.size() - 1)(random_));
+    }
+    vaults_.erase(itr);
+  }
+  while (vaults_.size() < kConfig_.vault_count)
+    vaults_.insert(NewVaultId());
+  ++churn_events_;
+  LOG(kVerbose) << "SimulatedNetwork replaced " << count << " vaults";
+}
+
+void SimulatedNetwork::Stop() {
+  if (!running_.exchange(false))
+    return;
+  {
+    std::lock_guard<std::mutex> lock(churn_timer_mutex_);
+    boost::system::error_code ignored;
+    churn_timer_.cancel(ignored);
+  }
+  asio_service_.Stop();
+}
+
+void SimulatedNetwork::ReportNetworkHealth(const NodeId& node_id, int network_health) {
+  std::shared_ptr<const routing::Functors> joined;
+  {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    auto itr(endpoints_.find(node_id));
+    if (itr != std::end(endpoints_))
+      joined = itr->second;
+  }
+  if (joined)
+    joined->network_status(network_health);
+}
+
+SimulatedNetwork::Stats SimulatedNetwork::GetStats() const {
+  Stats stats;
+  stats.requests = requests_;
+  stats.responses = responses_;
+  stats.lost = lost_;
+  stats.lost_to_churn = lost_to_churn_;
+  stats.undeliverable = undeliverable_;
+  stats.churn_events = churn_events_;
+  return stats;
+}
+
+size_t SimulatedNetwork::connected_clients() const {
+  std::lock_guard<std::mutex> lock(endpoints_mutex_);
+  return endpoints_.size();
+}
+
+void SimulatedNetwork::Register(const NodeId& node_id) {
+  std::lock_guard<std::mutex> lock(endpoints_mutex_);
+  if (!endpoints_.emplace(node_id, nullptr).second) {
+    LOG(kError) << "A client with ID " << DebugId(node_id) << " is already connected";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+void SimulatedNetwork::Unregister(const NodeId& node_id) {
+  std::lock_guard<std::mutex> lock(endpoints_mutex_);
+  endpoints_.erase(node_id);
+}
+
+void SimulatedNetwork::Join(const NodeId& node_id, const routing::Functors& functors) {
+  auto joined(std::make_shared<const routing::Functors>(functors));
+  {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    endpoints_[node_id] = joined;
+  }
+  After([joined] { joined->network_status(100); });
+}
+
+void SimulatedNetwork::Send(const routing::SingleToGroupMessage& message) {
+  ++requests_;
+  if (!running_)
+    return;
+  if (Lost()) {
+    ++lost_;
+    return;
+  }
+  After([this, message] { HandleRequest(message); });
+}
+
+void SimulatedNetwork::HandleRequest(const routing::SingleToGroupMessage& message) {
+  std::vector<Reply> replies;
+  try {
+    auto wrapper(ParseMessageWrapper(message.contents));
+    switch (std::get<2>(wrapper).data) {
+      case Persona::kMaidManager:
+        replies = HandleMaidManager(wrapper, message);
+        break;
+      case Persona::kDataManager:
+        replies = HandleDataManager(wrapper, message);
+        break;
+      case Persona::kVersionHandler:
+        replies = HandleVersionHandler(wrapper, message);
+        break;
+      case Persona::kMpidManager:
+        replies = HandleMpidManager(wrapper, message);
+        break;
+      default:
+        LOG(kError) << "SimulatedNetwork doesn't simulate " << std::get<2>(wrapper).data;
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "SimulatedNetwork failed handling a request: "
+                << boost::diagnostic_information(e);
+  }
+  for (const auto& reply : replies)
+    Respond(reply);
+}
+
+std::vector<SimulatedNetwork::Reply> SimulatedNetwork::HandleMaidManager(
+    const TypeErasedMessageWrapper& wrapper, const routing::SingleToGroupMessage& message) {
+  const NodeId maid(message.sender.data);
+  std::vector<Reply> replies;
+  auto reply([&](std::string contents) {
+    replies.emplace_back(message.receiver, routing::SingleId(maid), std::move(contents));
+  });
+  // Only account creation and removal are allowed without an account.
+  auto action(std::get<0>(wrapper));
+  if (action != MessageAction::kCreateAccountRequest &&
+      action != MessageAction::kRemoveAccountRequest && !HasMaidAccount(maid)) {
+    LOG(kWarning) << "SimulatedNetwork: no account for " << DebugId(maid) << " to " << action;
+    if (action == MessageAction::kPutRequest) {
+      reply(Answer<PutRequestFromMaidNodeToMaidManager, PutResponseFromMaidManagerToMaidNode>(
+          wrapper, [](const nfs_vault::DataNameAndContent&) {
+            return nfs_client::ReturnCode(CommonErrors::no_such_element);
+          }));
+    }
+    return replies;
+  }
+
+  switch (action) {
+    case MessageAction::kCreateAccountRequest: {
+      {
+        std::lock_guard<std::mutex> lock(accounts_mutex_);
+        maid_accounts_.insert(maid);
+      }
+      reply(Answer<CreateAccountRequestFromMaidNodeToMaidManager,
+                   CreateAccountResponseFromMaidManagerToMaidNode>(
+          wrapper, [](const nfs_vault::MaidAccountCreation&) { return Success(); }));
+      break;
+    }
+    case MessageAction::kRemoveAccountRequest: {
+      std::lock_guard<std::mutex> lock(accounts_mutex_);
+      maid_accounts_.erase(maid);
+      break;
+    }
+    case MessageAction::kPutRequest:
+      reply(Answer<PutRequestFromMaidNodeToMaidManager, PutResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNameAndContent& data) { return PutChunk(data); }));
+      break;
+    case MessageAction::kDeleteRequest:
+      reply(Answer<DeleteRequestFromMaidNodeToMaidManager,
+                   DeleteResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataName& name) {
+                     return ChangeReferenceCount(name, -1);
+                   }));
+      break;
+    case MessageAction::kDeleteBatchRequest:
+      reply(Answer<DeleteBatchRequestFromMaidNodeToMaidManager,
+                   DeleteBatchResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNames& names) {
+                     return ChangeReferenceCounts(names, -1);
+                   }));
+      break;
+    case MessageAction::kIncrementReferenceCountsRequest:
+      reply(Answer<IncrementReferenceCountsRequestFromMaidNodeToMaidManager,
+                   IncrementReferenceCountsResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNames& names) {
+                     return ChangeReferenceCounts(names, 1);
+                   }));
+      break;
+    case MessageAction::kDecrementReferenceCountsRequest:
+      reply(Answer<DecrementReferenceCountsRequestFromMaidNodeToMaidManager,
+                   DecrementReferenceCountsResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNames& names) {
+                     return ChangeReferenceCounts(names, -1);
+                   }));
+      break;
+    case MessageAction::kCreateVersionTreeRequest:
+      reply(Answer<CreateVersionTreeRequestFromMaidNodeToMaidManager,
+                   CreateVersionTreeResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::VersionTreeCreation& creation) {
+        try {
+          auto versions(maidsafe::make_unique<StructuredDataVersions>(creation.max_versions,
+                                                                      creation.max_branches));
+          versions->Put(StructuredDataVersions::VersionName(), creation.version_name);
+          std::lock_guard<std::mutex> lock(versions_mutex_);
+          versions_[creation.data_name] = std::move(versions);
+        }
+        catch (const maidsafe_error& error) {
+          return nfs_client::ReturnCode(error);
+        }
+        return Success();
+      }));
+      break;
+    case MessageAction::kPutVersionRequest:
+      reply(Answer<PutVersionRequestFromMaidNodeToMaidManager,
+                   PutVersionResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNameOldNewVersion& put) {
+        return nfs_client::TipOfTreeAndReturnCode(OnVersions(
+            put.data_name, [&](StructuredDataVersions& versions) {
+              versions.Put(put.old_version_name, put.new_version_name);
+            }));
+      }));
+      break;
+    case MessageAction::kDeleteBranchUntilForkRequest:
+      reply(Answer<DeleteBranchUntilForkRequestFromMaidNodeToMaidManager,
+                   DeleteBranchUntilForkResponseFromMaidManagerToMaidNode>(
+          wrapper, [this](const nfs_vault::DataNameAndVersion& branch) {
+        return OnVersions(branch.data_name, [&](StructuredDataVersions& versions) {
+          versions.DeleteBranchUntilFork(branch.version_name);
+        });
+      }));
+      break;
+    default:
+      LOG(kError) << "SimulatedNetwork: unexpected " << action << " for MaidManager";
+  }
+  return replies;
+}
+
+std::vector<SimulatedNetwork::Reply> SimulatedNetwork::HandleDataManager(
+    const TypeErasedMessageWrapper& wrapper, const routing::SingleToGroupMessage& message) {
+  std::vector<Reply> replies;
+  if (std::get<0>(wrapper) != MessageAction::kGetRequest) {
+    LOG(kError) << "SimulatedNetwork: unexpected " << std::get<0>(wrapper) << " for DataManager";
+    return replies;
+  }
+  auto get([this](const nfs_vault::DataName& name) { return GetChunk(name); });
+  std::string contents;
+  if (std::get<1>(wrapper).data == Persona::kMpidNode) {
+    contents = Answer<GetRequestFromMpidNodeToDataManager, GetResponseFromDataManagerToMpidNode>(
+        wrapper, get);
+  } else {
+    contents = Answer<GetRequestFromDataGetterToDataManager,
+                      GetResponseFromDataManagerToDataGetter>(wrapper, get);
+  }
+  replies.emplace_back(message.receiver, routing::SingleId(message.sender.data),
+                       std::move(contents));
+  return replies;
+}
+
+std::vector<SimulatedNetwork::Reply> SimulatedNetwork::HandleVersionHandler(
+    const TypeErasedMessageWrapper& wrapper, const routing::SingleToGroupMessage& message) {
+  auto get_versions([this](const nfs_vault::DataName& name,
+                           VersionNames& result) {
+    return OnVersions(name, [&](StructuredDataVersions& versions) { result = versions.Get(); });
+  });
+  auto get_branch([this](const nfs_vault::DataNameAndVersion& branch,
+                         VersionNames& result) {
+    return OnVersions(branch.data_name, [&](StructuredDataVersions& versions) {
+      result = versions.GetBranch(branch.version_name);
+    });
+  });
+  const bool from_maid_node(std::get<1>(wrapper).data == Persona::kMaidNode);
+  std::vector<Reply> replies;
+  std::string contents;
+  switch (std::get<0>(wrapper)) {
+    case MessageAction::kGetVersionsRequest:
+      contents = from_maid_node ?
+          AnswerGetVersions<GetVersionsRequestFromMaidNodeToVersionHandler,
+                            GetVersionsResponseFromVersionHandlerToMaidNode>(wrapper,
+                                                                             get_versions) :
+          AnswerGetVersions<GetVersionsRequestFromDataGetterToVersionHandler,
+                            GetVersionsResponseFromVersionHandlerToDataGetter>(wrapper,
+                                                                               get_versions);
+      break;
+    case MessageAction::kGetBranchRequest:
+      contents = from_maid_node ?
+          AnswerGetVersions<GetBranchRequestFromMaidNodeToVersionHandler,
+                            GetBranchResponseFromVersionHandlerToMaidNode>(wrapper, get_branch) :
+          AnswerGetVersions<GetBranchRequestFromDataGetterToVersionHandler,
+                            GetBranchResponseFromVersionHandlerToDataGetter>(wrapper, get_branch);
+      break;
+    case MessageAction::kGetVersionsBatchRequest:
+      contents = from_maid_node ?
+          AnswerGetVersionsBatch<GetVersionsBatchRequestFromMaidNodeToVersionHandler,
+                                 GetVersionsBatchResponseFromVersionHandlerToMaidNode>(
+              wrapper, get_versions) :
+          AnswerGetVersionsBatch<GetVersionsBatchRequestFromDataGetterToVersionHandler,
+                                 GetVersionsBatchResponseFromVersionHandlerToDataGetter>(
+              wrapper, get_versions);
+      break;
+    default:
+      LOG(kError) << "SimulatedNetwork: unexpected " << std::get<0>(wrapper)
+                  << " for VersionHandler";
+      return replies;
+  }
+  replies.emplace_back(message.receiver, routing::SingleId(message.sender.data),
+                       std::move(contents));
+  return replies;
+}
+
+std::vector<SimulatedNetwork::Reply> SimulatedNetwork::HandleMpidManager(
+    const TypeErasedMessageWrapper& wrapper, const routing::SingleToGroupMessage& message) {
+  const NodeId mpid(message.sender.data);
+  std::vector<Reply> replies;
+  auto reply([&](std::string contents) {
+    replies.emplace_back(message.receiver, routing::SingleId(mpid), std::move(contents));
+  });
+  auto has_account([this](const NodeId& node_id) {
+    std::lock_guard<std::mutex> lock(accounts_mutex_);
+    return mpid_accounts_.count(node_id) != 0;
+  });
+
+  switch (std::get<0>(wrapper)) {
+    case MessageAction::kCreateAccountRequest: {
+      {
+        std::lock_guard<std::mutex> lock(accounts_mutex_);
+        mpid_accounts_.insert(mpid);
+      }
+      reply(Answer<CreateAccountRequestFromMpidNodeToMpidManager,
+                   CreateAccountResponseFromMpidManagerToMpidNode>(
+          wrapper, [](const nfs_vault::MpidAccountCreation&) { return Success(); }));
+      break;
+    }
+    case MessageAction::kRemoveAccountRequest: {
+      std::lock_guard<std::mutex> lock(accounts_mutex_);
+      mpid_accounts_.erase(mpid);
+      break;
+    }
+    case MessageAction::kSendMessageRequest: {
+      const SendMessageRequestFromMpidNodeToMpidManager request(wrapper);
+      const nfs_vault::MpidMessage& mpid_message(*request.contents);
+      if (!has_account(mpid)) {
+        reply(SendMessageResponseFromMpidManagerToMpidNode(
+            request.id, nfs_client::ReturnCode(CommonErrors::no_such_element)).Serialise());
+        break;
+      }
+      auto alert(AlertFor(mpid_message));
+      {
+        std::lock_guard<std::mutex> lock(mpid_messages_mutex_);
+        mpid_messages_[alert.Serialise()] = mpid_message;
+      }
+      reply(SendMessageResponseFromMpidManagerToMpidNode(request.id, Success()).Serialise());
+      // The receiver is alerted by its own MpidManagers.
+      const NodeId receiver(mpid_message.base.receiver->string());
+      replies.emplace_back(routing::GroupId(receiver), routing::SingleId(receiver),
+                           SendAlertFromMpidManagerToMpidNode(request.id, alert).Serialise());
+      break;
+    }
+    case MessageAction::kGetMessageRequest:
+      reply(Answer<GetMessageRequestFromMpidNodeToMpidManager,
+                   GetMessageResponseFromMpidManagerToMpidNode>(
+          wrapper, [this](const nfs_vault::MpidMessageAlert& alert) {
+        std::lock_guard<std::mutex> lock(mpid_messages_mutex_);
+        auto itr(mpid_messages_.find(alert.Serialise()));
+        if (itr == std::end(mpid_messages_)) {
+          return nfs_client::MpidMessageOrReturnCode(
+              boost::make_unexpected(MakeError(CommonErrors::no_such_element)));
+        }
+        return nfs_client::MpidMessageOrReturnCode(itr->second);
+      }));
+      break;
+    case MessageAction::kDeleteRequest: {
+      const DeleteRequestFromMpidNodeToMpidManager request(wrapper);
+      std::lock_guard<std::mutex> lock(mpid_messages_mutex_);
+      mpid_messages_.erase(request.contents->Serialise());
+      break;
+    }
+    default:
+      LOG(kError) << "SimulatedNetwork: unexpected " << std::get<0>(wrapper)
+                  << " for MpidManager";
+  }
+  return replies;
+}
+
+void SimulatedNetwork::Respond(const Reply& reply) {
+  auto shared_reply(std::make_shared<const Reply>(reply));
+  for (const auto& vault : CloseGroup(reply.group.data)) {
+    ++responses_;
+    if (Lost()) {
+      ++lost_;
+      continue;
+    }
+    After([this, vault, shared_reply] { Deliver(vault, *shared_reply); });
+  }
+}
+
+void SimulatedNetwork::Deliver(const NodeId& vault, const Reply& reply) {
+  if (!IsVault(vault)) {
+    ++lost_to_churn_;
+    return;
+  }
+  std::shared_ptr<const routing::Functors> functors;
+  {
+    std::lock_guard<std::mutex> lock(endpoints_mutex_);
+    auto itr(endpoints_.find(reply.receiver.data));
+    if (itr != std::end(endpoints_))
+      functors = itr->second;
+  }
+  if (!functors) {
+    ++undeliverable_;
+    return;
+  }
+  functors->typed_message_and_caching.group_to_single.message_received(
+      routing::GroupToSingleMessage(reply.contents,
+                                    routing::GroupSource(reply.group, routing::SingleId(vault)),
+                                    reply.receiver));
+}
+
+std::vector<NodeId> SimulatedNetwork::CloseGroup(const NodeId& target) const {
+  std::lock_guard<std::mutex> lock(vaults_mutex_);
+  std::vector<NodeId> group(
+      std::min(static_cast<size_t>(routing::Parameters::group_size), vaults_.size()));
+  std::partial_sort_copy(std::begin(vaults_), std::end(vaults_), std::begin(group),
+                         std::end(group), [&target](const NodeId& lhs, const NodeId& rhs) {
+                           return NodeId::CloserToTarget(lhs, rhs, target);
+                         });
+  return group;
+}
+
+bool SimulatedNetwork::IsVault(const NodeId& vault) const {
+  std::lock_guard<std::mutex> lock(vaults_mutex_);
+  return vaults_.count(vault) != 0;
+}
+
+NodeId SimulatedNetwork::NewVaultId() {
+  std::string id(NodeId::kSize, 0);
+  std::lock_guard<std::mutex> lock(random_mutex_);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (auto& c : id)
+    c = static_cast<char>(byte(random_));
+  return NodeId(id);
+}
+
+void SimulatedNetwork::After(const std::function<void()>& functor) {
+  std::chrono::steady_clock::duration latency;
+  {
+    std::lock_guard<std::mutex> lock(random_mutex_);
+    latency = std::chrono::steady_clock::duration(
+        std::uniform_int_distribution<std::chrono::steady_clock::rep>(
+            kConfig_.min_latency.count(), kConfig_.max_latency.count())(random_));
+  }
+  auto timer(std::make_shared<boost::asio::steady_timer>(asio_service_.service(), latency));
+  timer->async_wait([this, timer, functor](const boost::system::error_code& error) {
+    if (!error && running_)
+      functor();
+  });
+}
+
+bool SimulatedNetwork::Lost() {
+  if (kConfig_.loss_rate == 0.0)
+    return false;
+  std::lock_guard<std::mutex> lock(random_mutex_);
+  return std::bernoulli_distribution(kConfig_.loss_rate)(random_);
+}
+
+void SimulatedNetwork::ArmChurnTimer() {
+  std::lock_guard<std::mutex> lock(churn_timer_mutex_);
+  if (!running_)
+    return;
+  churn_timer_.expires_from_now(kConfig_.churn_interval);
+  churn_timer_.async_wait([this](const boost::system::error_code& error) {
+    if (error || !running_)
+      return;
+    Churn(static_cast<size_t>(
+        std::lround(kConfig_.churn_fraction * static_cast<double>(kConfig_.vault_count))));
+    ArmChurnTimer();
+  });
+}
+
+bool SimulatedNetwork::HasMaidAccount(const NodeId& maid) const {
+  std::lock_guard<std::mutex> lock(accounts_mutex_);
+  return maid_accounts_.count(maid) != 0;
+}
+
+SimulatedNetwork::ChunkShard& SimulatedNetwork::GetChunkShard(const nfs_vault::DataName& name) {
+  return chunk_shards_[std::hash<std::string>()(name.raw_name.string()) % kChunkShardCount];
+}
+
+nfs_client::ReturnCode SimulatedNetwork::PutChunk(const nfs_vault::DataNameAndContent& data) {
+  ChunkShard& shard(GetChunkShard(data.name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Chunk& chunk(shard.chunks[data.name]);
+  if (chunk.reference_count == 0)
+    chunk.content = data.content;
+  ++chunk.reference_count;
+  return Success();
+}
+
+nfs_client::ReturnCode SimulatedNetwork::ChangeReferenceCount(const nfs_vault::DataName& name,
+                                                              int change) {
+  ChunkShard& shard(GetChunkShard(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto itr(shard.chunks.find(name));
+  if (itr == std::end(shard.chunks))
+    return nfs_client::ReturnCode(CommonErrors::no_such_element);
+  itr->second.reference_count += change;
+  if (itr->second.reference_count <= 0)
+    shard.chunks.erase(itr);
+  return Success();
+}
+
+nfs_client::DataNamesAndReturnCodes SimulatedNetwork::ChangeReferenceCounts(
+    const nfs_vault::DataNames& names, int change) {
+  std::vector<nfs_client::DataNameAndReturnCode> results;
+  results.reserve(names.data_names_.size());
+  for (const auto& name : names.data_names_)
+    results.emplace_back(name, ChangeReferenceCount(name, change));
+  return nfs_client::DataNamesAndReturnCodes(std::move(results), Success());
+}
+
+nfs_client::DataNameAndContentOrReturnCode SimulatedNetwork::GetChunk(
+    const nfs_vault::DataName& name) {
+  ChunkShard& shard(GetChunkShard(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto itr(shard.chunks.find(name));
+  if (itr == std::end(shard.chunks)) {
+    return nfs_client::DataNameAndContentOrReturnCode(
+        name, nfs_client::ReturnCode(CommonErrors::no_such_element));
+  }
+  nfs_client::DataNameAndContentOrReturnCode result;
+  result.name = name;
+  result.content = nfs_vault::Content(itr->second.content.string());
+  return result;
+}
+
+nfs_client::ReturnCode SimulatedNetwork::OnVersions(
+    const nfs_vault::DataName& name,
+    const std::function<void(StructuredDataVersions& versions)>& operation) {
+  try {
+    std::lock_guard<std::mutex> lock(versions_mutex_);
+    auto itr(versions_.find(name));
+    if (itr == std::end(versions_))
+      return nfs_client::ReturnCode(CommonErrors::no_such_element);
+    operation(*itr->second);
+  }
+  catch (const maidsafe_error& error) {
+    return nfs_client::ReturnCode(error);
+  }
+  return Success();
+}
+
+}  // namespace nfs
+
+}  // namespace maidsafe
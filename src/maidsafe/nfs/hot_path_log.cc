@@ -0,0 +1,72 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/hot_path_log.h"
+
+#include <atomic>
+#include <iterator>
+
+namespace maidsafe {
+
+namespace nfs {
+
+#if defined(USE_LOGGING) && !defined(MAIDSAFE_NFS_NO_VERBOSE_LOGGING)
+
+namespace {
+
+const int kUnknown(-1), kOff(0), kOn(1);
+
+std::atomic<int> verbose_hot_path_logging(kUnknown);
+
+bool VerboseConfigured() {
+  const log::FilterMap filter(log::Logging::Instance().Filter());
+  auto itr(filter.find("nfs"));
+  if (itr == std::end(filter))
+    itr = filter.find("*");
+  return itr != std::end(filter) && itr->second <= log::kVerbose;
+}
+
+}  // unnamed namespace
+
+bool VerboseHotPathLogging() {
+  int enabled(verbose_hot_path_logging.load(std::memory_order_relaxed));
+  if (enabled == kUnknown) {
+    enabled = VerboseConfigured() ? kOn : kOff;
+    // Unless an override has been set meanwhile.
+    int expected(kUnknown);
+    if (!verbose_hot_path_logging.compare_exchange_strong(expected, enabled,
+                                                          std::memory_order_relaxed)) {
+      enabled = expected;
+    }
+  }
+  return enabled == kOn;
+}
+
+void SetVerboseHotPathLogging(bool enabled) {
+  verbose_hot_path_logging.store(enabled ? kOn : kOff, std::memory_order_relaxed);
+}
+
+void ResetVerboseHotPathLogging() {
+  verbose_hot_path_logging.store(kUnknown, std::memory_order_relaxed);
+}
+
+#endif
+
+}  // namespace nfs
+
+}  // namespace maidsafe
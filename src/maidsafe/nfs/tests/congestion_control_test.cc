@@ -0,0 +1,226 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/congestion_control.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+class CongestionControlTest : public testing::Test {
+ protected:
+  CongestionControlTest()
+      : asio_service_(1),
+        congestion_control_(asio_service_),
+        group_(RandomString(NodeId::kSize)),
+        sent_count_(0),
+        mutex_(),
+        sent_ids_(),
+        sent_priorities_() {}
+
+  ~CongestionControlTest() {
+    congestion_control_.Stop();
+    asio_service_.Stop();
+  }
+
+  void Send(int32_t message_id,
+            nfs_client::Priority priority = nfs_client::Priority::kNormal,
+            const std::chrono::steady_clock::duration& timeout = std::chrono::milliseconds(100)) {
+    congestion_control_.Send(group_, MessageAction::kPutRequest, MessageId(message_id), priority,
+                             timeout, [this, message_id, priority] {
+                               std::lock_guard<std::mutex> lock(mutex_);
+                               sent_ids_.push_back(message_id);
+                               sent_priorities_.push_back(priority);
+                               ++sent_count_;
+                             });
+  }
+
+  nfs_client::CongestionControl::Metrics GroupMetrics() const {
+    return congestion_control_.GetMetrics()[group_];
+  }
+
+  BoostAsioService asio_service_;
+  nfs_client::CongestionControl congestion_control_;
+  const NodeId group_;
+  std::atomic<int> sent_count_;
+  std::mutex mutex_;
+  std::vector<int32_t> sent_ids_;
+  std::vector<nfs_client::Priority> sent_priorities_;
+};
+
+TEST_F(CongestionControlTest, BEH_WindowLimitsOutstandingRequests) {
+  const int kWindowSize(static_cast<int>(nfs_client::CongestionControl::kInitialWindowSize));
+  const int kExtraRequests(3);
+  for (int32_t index(0); index < kWindowSize + kExtraRequests; ++index)
+    Send(index);
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+  auto metrics(GroupMetrics());
+  EXPECT_EQ(kWindowSize, static_cast<int>(metrics.window_size));
+  EXPECT_EQ(kWindowSize, static_cast<int>(metrics.in_flight));
+  EXPECT_EQ(kExtraRequests, static_cast<int>(metrics.queue_depth));
+
+  // Unknown and repeated responses are ignored.
+  congestion_control_.OnResponse(group_, MessageAction::kGetVersionsRequest, MessageId(0));
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+  congestion_control_.OnResponse(group_, MessageAction::kPutRequest, MessageId(0));
+  congestion_control_.OnResponse(group_, MessageAction::kPutRequest, MessageId(0));
+  EXPECT_EQ(kWindowSize + 1, sent_count_.load());
+  EXPECT_EQ(kExtraRequests - 1, static_cast<int>(GroupMetrics().queue_depth));
+
+  for (int32_t index(1); index < kWindowSize + kExtraRequests; ++index)
+    congestion_control_.OnResponse(group_, MessageAction::kPutRequest, MessageId(index));
+  EXPECT_EQ(kWindowSize + kExtraRequests, sent_count_.load());
+  metrics = GroupMetrics();
+  EXPECT_EQ(0U, metrics.in_flight);
+  EXPECT_EQ(0U, metrics.queue_depth);
+}
+
+TEST_F(CongestionControlTest, BEH_TimeoutShrinksWindow) {
+  const int kWindowSize(static_cast<int>(nfs_client::CongestionControl::kInitialWindowSize));
+  for (int32_t index(0); index < kWindowSize * 2; ++index)
+    Send(index);
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+
+  // Nothing is answered, so once the sweep runs every outstanding request counts as lost.
+  auto timeout(std::chrono::steady_clock::now() + std::chrono::seconds(5));
+  while (sent_count_ < kWindowSize + kWindowSize / 2 &&
+         std::chrono::steady_clock::now() < timeout) {
+    Sleep(std::chrono::milliseconds(10));
+  }
+  auto metrics(GroupMetrics());
+  EXPECT_EQ(static_cast<size_t>(kWindowSize / 2), metrics.window_size);
+  EXPECT_EQ(kWindowSize + kWindowSize / 2, sent_count_.load());
+  EXPECT_EQ(static_cast<size_t>(kWindowSize / 2), metrics.in_flight);
+  EXPECT_EQ(static_cast<size_t>(kWindowSize / 2), metrics.queue_depth);
+}
+
+TEST_F(CongestionControlTest, BEH_LossFollowsEachRequestsTimeout) {
+  // Requests with a long timeout, like a Put's, aren't counted lost by the sweep while they wait.
+  const int kWindowSize(static_cast<int>(nfs_client::CongestionControl::kInitialWindowSize));
+  for (int32_t index(0); index < kWindowSize * 2; ++index)
+    Send(index, nfs_client::Priority::kNormal, std::chrono::seconds(360));
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+  // Longer than the sweep interval.
+  Sleep(std::chrono::milliseconds(1500));
+  auto metrics(GroupMetrics());
+  EXPECT_EQ(static_cast<size_t>(kWindowSize), metrics.window_size);
+  EXPECT_EQ(static_cast<size_t>(kWindowSize), metrics.in_flight);
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+}
+
+TEST_F(CongestionControlTest, BEH_PriorityClassesAreWeighted) {
+  const int kWindowSize(static_cast<int>(nfs_client::CongestionControl::kInitialWindowSize));
+  const int kBulkCount(20), kInteractiveCount(4);
+  int32_t message_id(0);
+  for (; message_id < kWindowSize; ++message_id)
+    Send(message_id, nfs_client::Priority::kBulk);
+  for (int index(0); index < kBulkCount; ++index)
+    Send(message_id++, nfs_client::Priority::kBulk);
+  for (int index(0); index < kInteractiveCount; ++index)
+    Send(message_id++, nfs_client::Priority::kInteractive);
+  ASSERT_EQ(kWindowSize, sent_count_.load());
+
+  // Answer the requests one at a time in the order they were sent, so each response frees a single
+  // slot for the scheduler to fill.
+  for (int32_t index(0); index < message_id; ++index) {
+    int32_t sent_id(0);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ASSERT_LT(index, static_cast<int32_t>(sent_ids_.size()));
+      sent_id = sent_ids_[index];
+    }
+    congestion_control_.OnResponse(group_, MessageAction::kPutRequest, MessageId(sent_id));
+  }
+  ASSERT_EQ(message_id, sent_count_.load());
+
+  // Despite being queued last, the interactive requests go out before all but a few bulk ones.
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto last_interactive(std::find(sent_priorities_.rbegin(), sent_priorities_.rend(),
+                                  nfs_client::Priority::kInteractive));
+  ASSERT_NE(sent_priorities_.rend(), last_interactive);
+  auto bulk_before(std::count(last_interactive, sent_priorities_.rend(),
+                              nfs_client::Priority::kBulk) - kWindowSize);
+  EXPECT_GE(2, bulk_before);
+}
+
+TEST_F(CongestionControlTest, BEH_InteractiveRequestsOvertakeBulkAcrossGroups) {
+  // Bulk Puts go to the MaidManager group while interactive requests go to VersionHandler groups,
+  // so only the client-wide budget puts them in competition.
+  const int kBudget(4), kBulkCount(12);
+  nfs_client::CongestionControl congestion_control(asio_service_, kBudget);
+  const NodeId maid_manager_group(RandomString(NodeId::kSize));
+  const NodeId version_handler_group(RandomString(NodeId::kSize));
+  std::vector<int32_t> sent_ids;
+  auto send([&](const NodeId& group, MessageAction action, int32_t message_id,
+                nfs_client::Priority priority) {
+    congestion_control.Send(group, action, MessageId(message_id), priority,
+                            std::chrono::seconds(10),
+                            [&sent_ids, message_id] { sent_ids.push_back(message_id); });
+  });
+
+  for (int32_t index(0); index < kBulkCount; ++index)
+    send(maid_manager_group, MessageAction::kPutRequest, index, nfs_client::Priority::kBulk);
+  ASSERT_EQ(kBudget, static_cast<int>(sent_ids.size()));
+  auto metrics(congestion_control.GetMetrics()[maid_manager_group]);
+  EXPECT_EQ(static_cast<size_t>(kBudget), metrics.in_flight);
+  EXPECT_EQ(static_cast<size_t>(kBulkCount - kBudget), metrics.queue_depth);
+
+  // The interactive request's own window is empty, but the budget is spent, so it waits...
+  const int32_t kInteractiveId(kBulkCount);
+  send(version_handler_group, MessageAction::kGetVersionsRequest, kInteractiveId,
+       nfs_client::Priority::kInteractive);
+  ASSERT_EQ(kBudget, static_cast<int>(sent_ids.size()));
+
+  // ...then takes the first slot freed, ahead of the bulk Puts queued before it.
+  congestion_control.OnResponse(maid_manager_group, MessageAction::kPutRequest, MessageId(0));
+  ASSERT_EQ(kBudget + 1, static_cast<int>(sent_ids.size()));
+  EXPECT_EQ(kInteractiveId, sent_ids.back());
+
+  // The bulk Puts carry on once it is out of the way.
+  congestion_control.OnResponse(maid_manager_group, MessageAction::kPutRequest, MessageId(1));
+  ASSERT_EQ(kBudget + 2, static_cast<int>(sent_ids.size()));
+  EXPECT_EQ(kBudget, sent_ids.back());
+  congestion_control.Stop();
+}
+
+TEST_F(CongestionControlTest, BEH_StopDropsQueuedRequests) {
+  const int kWindowSize(static_cast<int>(nfs_client::CongestionControl::kInitialWindowSize));
+  for (int32_t index(0); index < kWindowSize * 2; ++index)
+    Send(index);
+  congestion_control_.Stop();
+  EXPECT_TRUE(congestion_control_.GetMetrics().empty());
+  Send(kWindowSize * 2);
+  congestion_control_.OnResponse(group_, MessageAction::kPutRequest, MessageId(0));
+  EXPECT_EQ(kWindowSize, sent_count_.load());
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,274 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Throughput benchmarks for FakeStore.  They only report figures, so are built into benchmark_nfs
+// rather than test_nfs, and aren't run as tests.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+
+#include "maidsafe/nfs/hot_path_log.h"
+#include "maidsafe/nfs/client/fake_store.h"
+#include "maidsafe/nfs/client/fake_store_uring_backend.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+// Waits for 'futures' and returns how many completed per second since 'start'.
+template <typename Future>
+double PerSecond(std::vector<Future>& futures,
+                 const std::chrono::steady_clock::time_point& start) {
+  for (auto& future : futures)
+    EXPECT_NO_THROW(future.get());
+  std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+  return futures.size() / elapsed.count();
+}
+
+// Reports Put, Get and Delete throughput of each layout, for many small chunks and for fewer large
+// ones.
+TEST(FakeStoreBenchmarkTest, BEH_LayoutThroughput) {
+  const std::vector<std::pair<size_t, size_t>> kCountsAndSizes{std::make_pair(2000, 1024),
+                                                               std::make_pair(32, 1024 * 1024)};
+  for (const auto& count_and_size : kCountsAndSizes) {
+    std::vector<ImmutableData> chunks;
+    for (size_t index(0); index < count_and_size.first; ++index)
+      chunks.emplace_back(NonEmptyString(RandomString(count_and_size.second)));
+    for (auto layout : {FakeStore::Layout::kFilePerChunk, FakeStore::Layout::kSegments}) {
+      maidsafe::test::TestPath store_path(
+          maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+      FakeStore::Options options;
+      options.layout = layout;
+      FakeStore fake_store(*store_path, DiskUsage(count_and_size.first * count_and_size.second),
+                           options);
+      auto start(std::chrono::steady_clock::now());
+      std::vector<boost::future<void>> put_futures;
+      for (const auto& chunk : chunks)
+        put_futures.push_back(fake_store.Put(chunk));
+      auto puts(PerSecond(put_futures, start));
+      start = std::chrono::steady_clock::now();
+      std::vector<boost::future<ImmutableData>> get_futures;
+      for (const auto& chunk : chunks)
+        get_futures.push_back(fake_store.Get(chunk.name()));
+      auto gets(PerSecond(get_futures, start));
+      start = std::chrono::steady_clock::now();
+      std::vector<boost::future<void>> delete_futures;
+      for (const auto& chunk : chunks)
+        delete_futures.push_back(fake_store.Delete(chunk.name()));
+      auto deletes(PerSecond(delete_futures, start));
+      std::cout << "FakeStore "
+                << (layout == FakeStore::Layout::kSegments ? "segment" : "file-per-chunk")
+                << " layout, " << chunks.size() << " chunks of " << count_and_size.second
+                << " bytes, per second - Puts: " << puts << ", Gets: " << gets
+                << ", Deletes: " << deletes << '\n';
+      EXPECT_EQ(DiskUsage(0), fake_store.GetCurrentDiskUsage());
+    }
+  }
+}
+
+// Reports Put throughput of each durability level, for each layout.  The Puts are all issued at
+// once, so while one batch is synced the next gathers.
+TEST(FakeStoreBenchmarkTest, BEH_DurabilityThroughput) {
+  const size_t kPutCount(500), kDataSize(4096);
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < kPutCount; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(kDataSize)));
+  const std::vector<std::pair<FakeStore::Durability, std::string>> kDurabilities{
+      std::make_pair(FakeStore::Durability::kUnsynced, "unsynced"),
+      std::make_pair(FakeStore::Durability::kAsynchronous, "asynchronous"),
+      std::make_pair(FakeStore::Durability::kBatched, "batched"),
+      std::make_pair(FakeStore::Durability::kPerOperation, "per-operation")};
+  for (auto layout : {FakeStore::Layout::kFilePerChunk, FakeStore::Layout::kSegments}) {
+    for (const auto& durability : kDurabilities) {
+      maidsafe::test::TestPath store_path(
+          maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+      FakeStore::Options options;
+      options.layout = layout;
+      options.durability = durability.first;
+      FakeStore fake_store(*store_path, DiskUsage(kPutCount * kDataSize), options);
+      auto start(std::chrono::steady_clock::now());
+      std::vector<boost::future<void>> put_futures;
+      for (const auto& chunk : chunks)
+        put_futures.push_back(fake_store.Put(chunk));
+      auto puts(PerSecond(put_futures, start));
+      std::cout << "FakeStore "
+                << (layout == FakeStore::Layout::kSegments ? "segment" : "file-per-chunk")
+                << " layout, " << durability.second << ", Puts per second of " << kDataSize
+                << " byte chunks: " << puts << '\n';
+      EXPECT_EQ(DiskUsage(kPutCount * kDataSize), fake_store.GetCurrentDiskUsage());
+    }
+  }
+}
+
+// Reports Put throughput of the file-per-chunk layout with blocking IO and with io_uring, with each
+// batch of Puts synced before they complete.
+TEST(FakeStoreBenchmarkTest, BEH_IoEngineThroughput) {
+  const size_t kPutCount(2000), kDataSize(4096);
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < kPutCount; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(kDataSize)));
+  for (auto io_engine : {FakeStore::IoEngine::kBlocking, FakeStore::IoEngine::kIoUring}) {
+    if (io_engine == FakeStore::IoEngine::kIoUring && !FakeStoreUringBackend::Available()) {
+      std::cout << "io_uring isn't available here; no comparison.\n";
+      continue;
+    }
+    maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+    FakeStore::Options options;
+    options.durability = FakeStore::Durability::kBatched;
+    options.io_engine = io_engine;
+    FakeStore fake_store(*store_path, DiskUsage(kPutCount * kDataSize), options);
+    auto start(std::chrono::steady_clock::now());
+    std::vector<boost::future<void>> put_futures;
+    for (const auto& chunk : chunks)
+      put_futures.push_back(fake_store.Put(chunk));
+    auto puts(PerSecond(put_futures, start));
+    std::cout << "FakeStore file-per-chunk layout, batched durability, "
+              << (io_engine == FakeStore::IoEngine::kIoUring ? "io_uring" : "blocking IO")
+              << ", Puts per second of " << kDataSize << " byte chunks: " << puts << '\n';
+    for (size_t index(0); index < kPutCount; index += 100)
+      EXPECT_EQ(chunks[index].data(), fake_store.Get(chunks[index].name()).get().data());
+  }
+}
+
+// Reports Put and Get throughput spread over one, two and four devices.  Here the devices are
+// directories on the same disk, so this shows the sharding's overhead; on separate drives
+// throughput scales with their number.
+TEST(FakeStoreBenchmarkTest, BEH_DeviceThroughput) {
+  const size_t kPutCount(2000), kDataSize(4096);
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < kPutCount; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(kDataSize)));
+  for (size_t device_count : {1U, 2U, 4U}) {
+    maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+    std::vector<boost::filesystem::path> disk_paths;
+    for (size_t device(0); device < device_count; ++device)
+      disk_paths.push_back(*store_path / std::to_string(device));
+    FakeStore fake_store(disk_paths, DiskUsage(kPutCount * kDataSize));
+    auto start(std::chrono::steady_clock::now());
+    std::vector<boost::future<void>> put_futures;
+    for (const auto& chunk : chunks)
+      put_futures.push_back(fake_store.Put(chunk));
+    auto puts(PerSecond(put_futures, start));
+    start = std::chrono::steady_clock::now();
+    std::vector<boost::future<ImmutableData>> get_futures;
+    for (const auto& chunk : chunks)
+      get_futures.push_back(fake_store.Get(chunk.name()));
+    auto gets(PerSecond(get_futures, start));
+    std::cout << "FakeStore over " << device_count << " device(s), per second of " << kDataSize
+              << " byte chunks - Puts: " << puts << ", Gets: " << gets << '\n';
+  }
+}
+
+// Reports Gets per second of chunks the store doesn't hold, as a cache in front of the network sees
+// on every miss.
+TEST(FakeStoreBenchmarkTest, BEH_MissThroughput) {
+  const size_t kChunkCount(2000), kGetCount(20000);
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  FakeStore fake_store(*store_path, DiskUsage(kChunkCount * 1024));
+  for (size_t index(0); index < kChunkCount; ++index)
+    EXPECT_NO_THROW(fake_store.Put(ImmutableData(NonEmptyString(RandomString(1024)))).get());
+  std::vector<ImmutableData::Name> missing;
+  for (size_t index(0); index < kGetCount; ++index)
+    missing.emplace_back(Identity(RandomString(64)));
+  auto start(std::chrono::steady_clock::now());
+  std::vector<boost::future<ImmutableData>> get_futures;
+  for (const auto& name : missing)
+    get_futures.push_back(fake_store.Get(name));
+  for (auto& future : get_futures)
+    EXPECT_THROW(future.get(), std::exception);
+  std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+  std::cout << "FakeStore Gets per second of missing chunks: " << kGetCount / elapsed.count()
+            << '\n';
+}
+
+// Reports Put throughput with and without verbose request-path logging.  For the figure with that
+// logging compiled out, build with NFS_VERBOSE_LOGGING=OFF.
+TEST(FakeStoreBenchmarkTest, BEH_PutThroughput) {
+  const size_t kPutCount(200), kDataSize(16 * 1024);
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  FakeStore fake_store(*store_path, DiskUsage(2 * kPutCount * kDataSize));
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < 2 * kPutCount; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(kDataSize)));
+
+  auto put_per_second([&](size_t first_index) -> double {
+    auto start(std::chrono::steady_clock::now());
+    std::vector<boost::future<void>> futures;
+    for (size_t index(first_index); index < first_index + kPutCount; ++index)
+      futures.push_back(fake_store.Put(chunks[index]));
+    for (auto& future : futures)
+      EXPECT_NO_THROW(future.get());
+    std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+    return kPutCount / elapsed.count();
+  });
+
+  SetVerboseHotPathLogging(true);
+  const bool with_logging_enabled(VerboseHotPathLogging());
+  auto with_logging(put_per_second(0));
+  SetVerboseHotPathLogging(false);
+  auto without_logging(put_per_second(kPutCount));
+  std::cout << "FakeStore Puts per second of " << kDataSize << " byte chunks - verbose logging "
+            << (with_logging_enabled ? "on: " : "compiled out: ") << with_logging
+            << ", off: " << without_logging << '\n';
+  EXPECT_EQ(DiskUsage(2 * kPutCount * kDataSize), fake_store.GetCurrentDiskUsage());
+}
+
+// Reports how Put and Get throughput scale with the number of threads FakeStore runs them on.
+TEST(FakeStoreBenchmarkTest, BEH_ConcurrentThroughput) {
+  const size_t kChunkCount(1000), kDataSize(4 * 1024);
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < kChunkCount; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(kDataSize)));
+  for (int thread_count(1); thread_count <= 8; thread_count *= 2) {
+    maidsafe::test::TestPath store_path(
+        maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+    FakeStore::Options options;
+    options.thread_count = thread_count;
+    FakeStore fake_store(*store_path, DiskUsage(kChunkCount * kDataSize), options);
+    auto start(std::chrono::steady_clock::now());
+    std::vector<boost::future<void>> put_futures;
+    for (const auto& chunk : chunks)
+      put_futures.push_back(fake_store.Put(chunk));
+    auto puts(PerSecond(put_futures, start));
+    start = std::chrono::steady_clock::now();
+    std::vector<boost::future<ImmutableData>> get_futures;
+    for (const auto& chunk : chunks)
+      get_futures.push_back(fake_store.Get(chunk.name()));
+    auto gets(PerSecond(get_futures, start));
+    std::cout << "FakeStore with " << thread_count << " thread(s), " << kDataSize
+              << " byte chunks, per second - Puts: " << puts << ", Gets: " << gets << '\n';
+    EXPECT_EQ(DiskUsage(kChunkCount * kDataSize), fake_store.GetCurrentDiskUsage());
+  }
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
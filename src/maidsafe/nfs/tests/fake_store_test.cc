@@ -17,12 +17,33 @@
     use of the MaidSafe Software.                                                                 */
 
 #include "maidsafe/nfs/client/fake_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/data_types/data_type_values.h"
 #include "maidsafe/common/data_types/immutable_data.h"
 #include "maidsafe/common/data_types/mutable_data.h"
 
+#include "maidsafe/nfs/client/fake_store_name_filter.h"
+#include "maidsafe/nfs/client/fake_store_segment_backend.h"
+#include "maidsafe/nfs/client/fake_store_uring_backend.h"
+#include "maidsafe/nfs/client/fake_store_write_behind.h"
+
 namespace maidsafe {
 
 namespace nfs {
@@ -41,33 +62,19 @@ class FakeStoreTest : public testing::Test {
   FakeStore fake_store_;
 };
 
-TEST_F(FakeStoreTest, BEH_SuccessfulStore) {
+void CheckSuccessfulStore(FakeStore& fake_store) {
   const size_t kDataSize(100);
   ImmutableData data(NonEmptyString(RandomString(kDataSize)));
-  fake_store_.Put(data);
-  auto put_timeout(std::chrono::system_clock::now() + std::chrono::milliseconds(100));
-  while (std::chrono::system_clock::now() < put_timeout) {
-    if (fake_store_.GetCurrentDiskUsage() != DiskUsage(kDataSize))
-      Sleep(std::chrono::milliseconds(1));
-    else
-      break;
-  }
-  ASSERT_TRUE(DiskUsage(kDataSize) == fake_store_.GetCurrentDiskUsage());
+  ASSERT_NO_THROW(fake_store.Put(data).get());
+  ASSERT_TRUE(DiskUsage(kDataSize) == fake_store.GetCurrentDiskUsage());
 
-  auto retrieved_data(fake_store_.Get(data.name()).get());
+  auto retrieved_data(fake_store.Get(data.name()).get());
   ASSERT_TRUE(data.name() == retrieved_data.name());
   ASSERT_TRUE(data.data() == retrieved_data.data());
-  ASSERT_TRUE(DiskUsage(kDataSize) == fake_store_.GetCurrentDiskUsage());
+  ASSERT_TRUE(DiskUsage(kDataSize) == fake_store.GetCurrentDiskUsage());
 
-  fake_store_.Delete(data.name());
-  auto delete_timeout(std::chrono::system_clock::now() + std::chrono::milliseconds(100));
-  while (std::chrono::system_clock::now() < delete_timeout) {
-    if (fake_store_.GetCurrentDiskUsage() != DiskUsage(0))
-      Sleep(std::chrono::milliseconds(1));
-    else
-      break;
-  }
-  ASSERT_TRUE(DiskUsage(0) == fake_store_.GetCurrentDiskUsage());
+  ASSERT_NO_THROW(fake_store.Delete(data.name()).get());
+  ASSERT_TRUE(DiskUsage(0) == fake_store.GetCurrentDiskUsage());
 
   StructuredDataVersions::VersionName default_version;
   StructuredDataVersions::VersionName version0(0, ImmutableData::Name(Identity(RandomString(64))));
@@ -75,27 +82,654 @@ TEST_F(FakeStoreTest, BEH_SuccessfulStore) {
   StructuredDataVersions::VersionName version2(2, ImmutableData::Name(Identity(RandomString(64))));
   MutableData::Name dir_name(Identity(RandomString(64)));
 
-  fake_store_.PutVersion(dir_name, default_version, version0);  // Silently fails
-  fake_store_.CreateVersionTree(dir_name, version0, 20, 5);
-  fake_store_.PutVersion(dir_name, version0, version1);
-  fake_store_.PutVersion(dir_name, version1, version2);
+  // Each operation runs on the store's own threads, so is waited for before the next is started.
+  EXPECT_THROW(fake_store.PutVersion(dir_name, default_version, version0).get(), std::exception);
+  ASSERT_NO_THROW(fake_store.CreateVersionTree(dir_name, version0, 20, 5).get());
+  ASSERT_NO_THROW(fake_store.PutVersion(dir_name, version0, version1).get());
+  ASSERT_NO_THROW(fake_store.PutVersion(dir_name, version1, version2).get());
 
-  auto retrieved_versions(fake_store_.GetVersions(dir_name).get());
+  auto retrieved_versions(fake_store.GetVersions(dir_name).get());
   ASSERT_TRUE(1U == retrieved_versions.size());
   ASSERT_TRUE(version2 == retrieved_versions.front());
 
-  retrieved_versions = fake_store_.GetBranch(dir_name, version2).get();
+  retrieved_versions = fake_store.GetBranch(dir_name, version2).get();
   ASSERT_TRUE(3U == retrieved_versions.size());
   auto itr(std::begin(retrieved_versions));
   ASSERT_TRUE(version2 == *itr++);
   ASSERT_TRUE(version1 == *itr++);
   ASSERT_TRUE(version0 == *itr);
 
-  fake_store_.DeleteBranchUntilFork(dir_name, version2);
-  retrieved_versions = fake_store_.GetVersions(dir_name).get();
+  ASSERT_NO_THROW(fake_store.DeleteBranchUntilFork(dir_name, version2).get());
+  retrieved_versions = fake_store.GetVersions(dir_name).get();
   ASSERT_TRUE(retrieved_versions.empty());
 }
 
+TEST_F(FakeStoreTest, BEH_SuccessfulStore) { CheckSuccessfulStore(fake_store_); }
+
+TEST(FakeStoreMemoryTest, BEH_SuccessfulStore) {
+  FakeStore fake_store(kDefaultMaxDiskUsage);
+  CheckSuccessfulStore(fake_store);
+}
+
+TEST(FakeStoreMemoryTest, BEH_QuotaAndReferenceCounts) {
+  FakeStore fake_store(DiskUsage(250));
+  ImmutableData data(NonEmptyString(RandomString(100)));
+  EXPECT_NO_THROW(fake_store.Put(data).get());
+  EXPECT_NO_THROW(fake_store.Put(data).get());
+  EXPECT_EQ(DiskUsage(100), fake_store.GetCurrentDiskUsage());
+  EXPECT_THROW(fake_store.Put(ImmutableData(NonEmptyString(RandomString(200)))).get(),
+               std::exception);
+  EXPECT_EQ(DiskUsage(100), fake_store.GetCurrentDiskUsage());
+
+  EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+  EXPECT_NO_THROW(fake_store.Get(data.name()).get());
+  EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+  EXPECT_THROW(fake_store.Get(data.name()).get(), std::exception);
+  EXPECT_EQ(DiskUsage(0), fake_store.GetCurrentDiskUsage());
+  EXPECT_EQ(DiskUsage(0), fake_store.RescanDiskUsage().get());
+
+  // Version trees are charged their serialised size, so a tree can exhaust the quota too.
+  MutableData::Name dir_name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName version(0, ImmutableData::Name(Identity(RandomString(64))));
+  EXPECT_NO_THROW(fake_store.CreateVersionTree(dir_name, version, 100, 1).get());
+  EXPECT_LT(DiskUsage(0), fake_store.GetCurrentDiskUsage());
+  bool out_of_space(false);
+  for (uint32_t index(1); index < 100 && !out_of_space; ++index) {
+    StructuredDataVersions::VersionName next(index,
+                                             ImmutableData::Name(Identity(RandomString(64))));
+    try {
+      fake_store.PutVersion(dir_name, version, next).get();
+      version = next;
+    }
+    catch (const std::exception&) {
+      out_of_space = true;
+    }
+  }
+  EXPECT_TRUE(out_of_space);
+  EXPECT_GE(DiskUsage(250), fake_store.GetCurrentDiskUsage());
+  auto versions(fake_store.GetVersions(dir_name).get());
+  ASSERT_EQ(1U, versions.size());
+  EXPECT_EQ(version, versions.front());
+}
+
+TEST(FakeStoreMemoryTest, BEH_NameFilterGrows) {
+  // Enough chunks that the name filter is rebuilt larger, more than once.
+  FakeStore fake_store(DiskUsage(100000));
+  std::vector<ImmutableData> chunks;
+  for (size_t index(0); index < 4 * FakeStoreNameFilter::kMinCapacity; ++index) {
+    chunks.emplace_back(NonEmptyString(RandomString(10)));
+    EXPECT_NO_THROW(fake_store.Put(chunks.back()).get());
+  }
+  for (const auto& chunk : chunks)
+    EXPECT_EQ(chunk.data(), fake_store.Get(chunk.name()).get().data());
+  EXPECT_THROW(fake_store.Get(ImmutableData::Name(Identity(RandomString(64)))).get(),
+               std::exception);
+  EXPECT_NO_THROW(fake_store.Delete(ImmutableData::Name(Identity(RandomString(64)))).get());
+  for (const auto& chunk : chunks)
+    EXPECT_NO_THROW(fake_store.Delete(chunk.name()).get());
+  for (size_t index(0); index < chunks.size(); index += 100)
+    EXPECT_THROW(fake_store.Get(chunks[index].name()).get(), std::exception);
+  EXPECT_EQ(DiskUsage(0), fake_store.GetCurrentDiskUsage());
+}
+
+TEST(FakeStoreNameFilterTest, BEH_NoFalseNegatives) {
+  FakeStoreNameFilter filter;
+  std::vector<std::string> names;
+  for (int index(0); index < 5000; ++index) {
+    names.push_back(RandomAlphaNumericString(20));
+    filter.Add(names.back());
+    if (filter.overfull()) {
+      filter.Rebuild(names.size(), [&](const std::function<void(const std::string&)>& add) {
+        for (const auto& name : names)
+          add(name);
+      });
+    }
+  }
+  for (const auto& name : names)
+    EXPECT_TRUE(filter.MayContain(name));
+
+  for (size_t index(0); index < names.size() / 2; ++index)
+    filter.Remove(names[index]);
+  for (size_t index(names.size() / 2); index < names.size(); ++index)
+    EXPECT_TRUE(filter.MayContain(names[index]));
+  const int kLookups(10000);
+  int false_positives(0);
+  for (int index(0); index < kLookups; ++index) {
+    if (filter.MayContain(RandomAlphaNumericString(21)))
+      ++false_positives;
+  }
+  EXPECT_GT(kLookups / 20, false_positives);
+}
+
+TEST(FakeStoreEvictionTest, BEH_LeastRecentlyUsed) {
+  FakeStore::Options options;
+  options.eviction = FakeStore::Eviction::kLeastRecentlyUsed;
+  FakeStore fake_store(DiskUsage(1000), options);
+  std::vector<ImmutableData> chunks;
+  for (int i(0); i != 10; ++i) {
+    chunks.emplace_back(NonEmptyString(RandomString(100)));
+    EXPECT_NO_THROW(fake_store.Put(chunks.back()).get());
+    // Referenced twice, so not evictable even though it's among the least recently used.
+    if (i == 3)
+      EXPECT_NO_THROW(fake_store.Put(chunks.back()).get());
+  }
+  EXPECT_NO_THROW(fake_store.Get(chunks[0].name()).get());
+  EXPECT_NO_THROW(fake_store.Get(chunks[1].name()).get());
+  EXPECT_EQ(DiskUsage(1000), fake_store.GetCurrentDiskUsage());
+
+  // Room for the new chunk plus the headroom means evicting two.
+  ImmutableData extra(NonEmptyString(RandomString(100)));
+  EXPECT_NO_THROW(fake_store.Put(extra).get());
+  EXPECT_EQ(DiskUsage(900), fake_store.GetCurrentDiskUsage());
+  for (int i(0); i != 10; ++i) {
+    if (i == 2 || i == 4)
+      EXPECT_THROW(fake_store.Get(chunks[i].name()).get(), std::exception) << i;
+    else
+      EXPECT_NO_THROW(fake_store.Get(chunks[i].name()).get()) << i;
+  }
+  EXPECT_NO_THROW(fake_store.Get(extra.name()).get());
+  auto stats(fake_store.GetEvictionStats());
+  EXPECT_EQ(1U, stats.passes);
+  EXPECT_EQ(2U, stats.evicted_chunks);
+  EXPECT_EQ(200U, stats.evicted_bytes);
+  EXPECT_EQ(0U, stats.refused_puts);
+
+  // Nothing can make room for a chunk larger than the store.
+  EXPECT_THROW(fake_store.Put(ImmutableData(NonEmptyString(RandomString(1001)))).get(),
+               std::exception);
+  EXPECT_EQ(DiskUsage(900), fake_store.GetCurrentDiskUsage());
+  EXPECT_EQ(1U, fake_store.GetEvictionStats().refused_puts);
+
+  // A store without eviction still refuses.
+  FakeStore bounded_store(DiskUsage(100));
+  EXPECT_NO_THROW(bounded_store.Put(chunks[0]).get());
+  EXPECT_THROW(bounded_store.Put(chunks[1]).get(), std::exception);
+  EXPECT_EQ(0U, bounded_store.GetEvictionStats().refused_puts);
+}
+
+TEST(FakeStoreEvictionTest, BEH_LeastFrequentlyUsed) {
+  FakeStore::Options options;
+  options.eviction = FakeStore::Eviction::kLeastFrequentlyUsed;
+  FakeStore fake_store(DiskUsage(500), options);
+  std::vector<ImmutableData> chunks;
+  for (int i(0); i != 5; ++i) {
+    chunks.emplace_back(NonEmptyString(RandomString(100)));
+    EXPECT_NO_THROW(fake_store.Put(chunks.back()).get());
+  }
+  // Chunk 0 is the least recently used, but the most frequently; chunk 4 is used least.
+  for (int i(0); i != 3; ++i)
+    EXPECT_NO_THROW(fake_store.Get(chunks[0].name()).get());
+  for (int i(1); i != 4; ++i)
+    EXPECT_NO_THROW(fake_store.Get(chunks[i].name()).get());
+
+  EXPECT_NO_THROW(fake_store.Put(ImmutableData(NonEmptyString(RandomString(100)))).get());
+  EXPECT_NO_THROW(fake_store.Get(chunks[0].name()).get());
+  EXPECT_THROW(fake_store.Get(chunks[1].name()).get(), std::exception);
+  EXPECT_NO_THROW(fake_store.Get(chunks[2].name()).get());
+  EXPECT_NO_THROW(fake_store.Get(chunks[3].name()).get());
+  EXPECT_THROW(fake_store.Get(chunks[4].name()).get(), std::exception);
+  EXPECT_EQ(2U, fake_store.GetEvictionStats().evicted_chunks);
+  EXPECT_EQ(DiskUsage(400), fake_store.GetCurrentDiskUsage());
+}
+
+TEST(FakeStoreIndexTest, BEH_ReferenceCountsSurviveRestart) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  ImmutableData data(NonEmptyString(RandomString(100)));
+  {
+    FakeStore fake_store(*store_path, kDefaultMaxDiskUsage);
+    for (int index(0); index < 3; ++index)
+      EXPECT_NO_THROW(fake_store.Put(data).get());
+    EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+  }
+  // Reloaded from the journal: two references are left.
+  {
+    FakeStore fake_store(*store_path, kDefaultMaxDiskUsage);
+    EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+    EXPECT_EQ(data.data(), fake_store.Get(data.name()).get().data());
+  }
+  {
+    FakeStore fake_store(*store_path, kDefaultMaxDiskUsage);
+    EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+    EXPECT_THROW(fake_store.Get(data.name()).get(), std::exception);
+  }
+}
+
+TEST(FakeStoreIndexTest, BEH_DiskUsageSurvivesRestart) {
+  for (auto layout : {FakeStore::Layout::kFilePerChunk, FakeStore::Layout::kSegments}) {
+    maidsafe::test::TestPath store_path(
+        maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+    MutableData::Name dir_name(Identity(RandomString(64)));
+    StructuredDataVersions::VersionName version0(
+        0, ImmutableData::Name(Identity(RandomString(64))));
+    DiskUsage disk_usage(0);
+    FakeStore::Options options;
+    options.thread_count = 1;
+    options.layout = layout;
+    {
+      FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+      for (int index(0); index < 5; ++index)
+        EXPECT_NO_THROW(fake_store.Put(ImmutableData(NonEmptyString(RandomString(100)))).get());
+      EXPECT_NO_THROW(fake_store.CreateVersionTree(dir_name, version0, 20, 5).get());
+      disk_usage = fake_store.GetCurrentDiskUsage();
+      EXPECT_LT(DiskUsage(500), disk_usage);
+      EXPECT_EQ(disk_usage, fake_store.RescanDiskUsage().get());
+    }
+    {
+      FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+      EXPECT_EQ(disk_usage, fake_store.GetCurrentDiskUsage());
+      EXPECT_EQ(disk_usage, fake_store.RescanDiskUsage().get());
+      // Still enforced against the recovered usage.
+      EXPECT_THROW(fake_store.SetMaxDiskUsage(DiskUsage(disk_usage.data - 1)), std::exception);
+    }
+    // Without the journal, usage is measured from the files.
+    boost::filesystem::remove(*store_path / "index.journal");
+    FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+    EXPECT_EQ(disk_usage, fake_store.GetCurrentDiskUsage());
+    EXPECT_EQ(1U, fake_store.GetVersions(dir_name).get().size());
+  }
+}
+
+TEST(FakeStoreIndexTest, BEH_ConcurrentReferenceCounting) {
+  const int kPutCount(50);
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  FakeStore::Options options;
+  options.thread_count = 8;
+  FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+  ImmutableData shared(NonEmptyString(RandomString(100)));
+  std::vector<ImmutableData> distinct;
+  std::vector<boost::future<void>> futures;
+  for (int index(0); index < kPutCount; ++index) {
+    distinct.emplace_back(NonEmptyString(RandomString(10)));
+    futures.push_back(fake_store.Put(shared));
+    futures.push_back(fake_store.Put(distinct.back()));
+  }
+  for (auto& future : futures)
+    EXPECT_NO_THROW(future.get());
+  EXPECT_EQ(DiskUsage(100 + 10 * kPutCount), fake_store.GetCurrentDiskUsage());
+
+  futures.clear();
+  for (int index(0); index < kPutCount - 1; ++index) {
+    futures.push_back(fake_store.Delete(shared.name()));
+    futures.push_back(fake_store.Delete(distinct[index].name()));
+  }
+  for (auto& future : futures)
+    EXPECT_NO_THROW(future.get());
+  EXPECT_EQ(DiskUsage(100 + 10), fake_store.GetCurrentDiskUsage());
+  EXPECT_EQ(shared.data(), fake_store.Get(shared.name()).get().data());
+}
+
+TEST(FakeStoreIndexTest, BEH_VersionLogSurvivesRestart) {
+  const uint32_t kVersionCount(100);
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  MutableData::Name dir_name(Identity(RandomString(64)));
+  std::vector<StructuredDataVersions::VersionName> versions;
+  for (uint32_t index(0); index < kVersionCount; ++index)
+    versions.emplace_back(index, ImmutableData::Name(Identity(RandomString(64))));
+  DiskUsage disk_usage(0);
+  {
+    FakeStore fake_store(*store_path, DiskUsage(1 << 20));
+    EXPECT_NO_THROW(fake_store.CreateVersionTree(dir_name, versions.front(), kVersionCount, 5)
+                        .get());
+    // Enough changes for the log to be folded into a snapshot at least once, with some left over.
+    for (uint32_t index(1); index < kVersionCount; ++index)
+      EXPECT_NO_THROW(fake_store.PutVersion(dir_name, versions[index - 1], versions[index]).get());
+    auto tips(fake_store.GetVersions(dir_name).get());
+    ASSERT_EQ(1U, tips.size());
+    EXPECT_EQ(versions.back(), tips.front());
+    disk_usage = fake_store.GetCurrentDiskUsage();
+    EXPECT_EQ(disk_usage, fake_store.RescanDiskUsage().get());
+  }
+  FakeStore fake_store(*store_path, DiskUsage(1 << 20));
+  EXPECT_EQ(disk_usage, fake_store.GetCurrentDiskUsage());
+  auto branch(fake_store.GetBranch(dir_name, versions.back()).get());
+  ASSERT_EQ(kVersionCount, branch.size());
+  EXPECT_EQ(versions.front(), branch.back());
+}
+
+TEST(FakeStoreSegmentBackendTest, BEH_CompactionReclaimsSpace) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  const uint64_t kSegmentSize(4096);
+  std::vector<std::pair<std::string, NonEmptyString>> chunks;
+  for (int index(0); index < 100; ++index)
+    chunks.emplace_back(RandomAlphaNumericString(20), NonEmptyString(RandomString(256)));
+
+  {
+    BoostAsioService asio_service(1);
+    FakeStoreSegmentBackend backend(*store_path, asio_service, kSegmentSize);
+    for (const auto& chunk : chunks)
+      backend.Write(chunk.first, chunk.second);
+    const uint64_t bytes_written(backend.SegmentBytes());
+    // Remove half the chunks and overwrite half of the rest, leaving most records dead.
+    for (size_t index(0); index < chunks.size(); ++index) {
+      if (index % 2 == 0) {
+        backend.Remove(chunks[index].first);
+      } else if (index % 4 == 1) {
+        chunks[index].second = NonEmptyString(RandomString(256));
+        backend.Write(chunks[index].first, chunks[index].second);
+      }
+    }
+    backend.Compact();
+    EXPECT_LT(backend.SegmentBytes(), bytes_written);
+    for (size_t index(0); index < chunks.size(); ++index) {
+      if (index % 2 == 0)
+        EXPECT_THROW(backend.Read(chunks[index].first), std::exception);
+      else
+        EXPECT_EQ(chunks[index].second, backend.Read(chunks[index].first));
+    }
+    asio_service.Stop();
+  }
+
+  // Rebuilt from the segments: removed chunks stay removed and the rest are at their last value.
+  BoostAsioService asio_service(1);
+  FakeStoreSegmentBackend backend(*store_path, asio_service, kSegmentSize);
+  FakeStoreIndex index(*store_path / "index.journal");
+  backend.Rebuild(index);
+  EXPECT_EQ(chunks.size() / 2, index.size());
+  for (size_t index(1); index < chunks.size(); index += 2)
+    EXPECT_EQ(chunks[index].second, backend.Read(chunks[index].first));
+  asio_service.Stop();
+}
+
+TEST(FakeStoreSegmentBackendTest, BEH_FakeStoreWithSegments) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  ImmutableData data(NonEmptyString(RandomString(100)));
+  FakeStore::Options options;
+  options.thread_count = 1;
+  options.layout = FakeStore::Layout::kSegments;
+  {
+    FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+    EXPECT_NO_THROW(fake_store.Put(data).get());
+    EXPECT_NO_THROW(fake_store.Put(data).get());
+    EXPECT_EQ(data.data(), fake_store.Get(data.name()).get().data());
+    EXPECT_EQ(DiskUsage(100), fake_store.GetCurrentDiskUsage());
+  }
+  FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+  EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+  EXPECT_EQ(data.data(), fake_store.Get(data.name()).get().data());
+  EXPECT_NO_THROW(fake_store.Delete(data.name()).get());
+  EXPECT_THROW(fake_store.Get(data.name()).get(), std::exception);
+}
+
+TEST(FakeStoreWriteBehindTest, BEH_BufferedChanges) {
+  BoostAsioService asio_service(1);
+  FakeStoreWriteBehind backend(maidsafe::make_unique<FakeStoreMemoryBackend>(),
+                               FakeStoreWriteBehind::Durability::kAsynchronous, asio_service, 1024);
+  std::vector<std::pair<std::string, NonEmptyString>> chunks;
+  for (int index(0); index < 20; ++index)
+    chunks.emplace_back(RandomAlphaNumericString(10), NonEmptyString(RandomString(200)));
+  // Overwrites and removals are seen at once, whether or not they've been flushed.
+  for (const auto& chunk : chunks)
+    backend.Write(chunk.first, chunk.second);
+  for (size_t index(0); index < chunks.size(); index += 2)
+    backend.Remove(chunks[index].first);
+  chunks[1].second = NonEmptyString(RandomString(300));
+  backend.Write(chunks[1].first, chunks[1].second);
+  for (size_t index(0); index < chunks.size(); ++index) {
+    if (index % 2 == 0)
+      EXPECT_THROW(backend.Read(chunks[index].first), std::exception);
+    else
+      EXPECT_EQ(chunks[index].second, backend.Read(chunks[index].first));
+  }
+  backend.Sync(std::vector<std::string>());
+  EXPECT_LT(0U, backend.batch_count());
+  FakeStoreIndex index((boost::filesystem::path()));
+  backend.Rebuild(index);
+  EXPECT_EQ(chunks.size() / 2, index.size());
+  asio_service.Stop();
+}
+
+// Fails every Sync while 'fail' is set.
+class FailingSyncBackend : public FakeStoreMemoryBackend {
+ public:
+  explicit FailingSyncBackend(std::shared_ptr<std::atomic<bool>> fail) : fail_(std::move(fail)) {}
+  virtual void Sync(const std::vector<std::string>& /*names*/) {
+    if (*fail_)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> fail_;
+};
+
+TEST(FakeStoreWriteBehindTest, BEH_SyncedBeforeCompletion) {
+  for (auto durability : {FakeStoreWriteBehind::Durability::kBatched,
+                          FakeStoreWriteBehind::Durability::kPerOperation}) {
+    BoostAsioService asio_service(1);
+    std::atomic<int> synced_count(0);
+    FakeStoreWriteBehind backend(maidsafe::make_unique<FakeStoreMemoryBackend>(), durability,
+                                 asio_service, FakeStoreWriteBehind::kDefaultMaxBufferedBytes,
+                                 [&synced_count] { ++synced_count; });
+    // The index journal recording a change is synced before the change is reported done.
+    backend.Write(RandomAlphaNumericString(10), NonEmptyString(RandomString(100)));
+    EXPECT_EQ(1, synced_count.load());
+    backend.Remove(RandomAlphaNumericString(10));
+    EXPECT_EQ(2, synced_count.load());
+    asio_service.Stop();
+  }
+}
+
+TEST(FakeStoreWriteBehindTest, BEH_FailedFlushIsRetried) {
+  BoostAsioService asio_service(1);
+  auto fail(std::make_shared<std::atomic<bool>>(true));
+  std::atomic<int> synced_count(0);
+  FakeStoreWriteBehind backend(maidsafe::make_unique<FailingSyncBackend>(fail),
+                               FakeStoreWriteBehind::Durability::kAsynchronous, asio_service,
+                               FakeStoreWriteBehind::kDefaultMaxBufferedBytes,
+                               [&synced_count] { ++synced_count; });
+  std::vector<std::pair<std::string, NonEmptyString>> written;
+  written.emplace_back(RandomAlphaNumericString(10), NonEmptyString(RandomString(100)));
+  EXPECT_NO_THROW(backend.Write(written.back().first, written.back().second));
+
+  // The failure is thrown by a later call, while what failed stays buffered.
+  bool thrown(false);
+  auto timeout(std::chrono::steady_clock::now() + std::chrono::seconds(5));
+  while (!thrown && std::chrono::steady_clock::now() < timeout) {
+    std::pair<std::string, NonEmptyString> chunk(RandomAlphaNumericString(10),
+                                                 NonEmptyString(RandomString(100)));
+    try {
+      backend.Write(chunk.first, chunk.second);
+      written.push_back(chunk);
+      Sleep(std::chrono::milliseconds(10));
+    }
+    catch (const std::exception&) {
+      thrown = true;
+    }
+  }
+  EXPECT_TRUE(thrown);
+  EXPECT_THROW(backend.Sync(std::vector<std::string>()), std::exception);
+  for (const auto& chunk : written)
+    EXPECT_EQ(chunk.second, backend.Read(chunk.first));
+  EXPECT_EQ(0U, backend.batch_count());
+  EXPECT_EQ(0, synced_count.load());
+
+  // Once the fault clears, nothing which was accepted has been lost.
+  *fail = false;
+  EXPECT_NO_THROW(backend.Sync(std::vector<std::string>()));
+  EXPECT_LT(0, synced_count.load());
+  FakeStoreIndex index((boost::filesystem::path()));
+  backend.Rebuild(index);
+  EXPECT_EQ(written.size(), index.size());
+  asio_service.Stop();
+}
+
+TEST(FakeStoreWriteBehindTest, BEH_BufferedPutsSurviveRestart) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  std::vector<ImmutableData> chunks;
+  for (int index(0); index < 50; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(100)));
+  FakeStore::Options options;
+  options.thread_count = 2;
+  options.layout = FakeStore::Layout::kSegments;
+  options.durability = FakeStore::Durability::kAsynchronous;
+  {
+    FakeStore fake_store(*store_path, DiskUsage(20000), options);
+    for (const auto& chunk : chunks)
+      EXPECT_NO_THROW(fake_store.Put(chunk).get());
+    EXPECT_NO_THROW(fake_store.Delete(chunks.front().name()).get());
+  }
+  // Anything still buffered was flushed as the store closed.
+  options.durability = FakeStore::Durability::kUnsynced;
+  FakeStore fake_store(*store_path, DiskUsage(20000), options);
+  EXPECT_THROW(fake_store.Get(chunks.front().name()).get(), std::exception);
+  for (size_t index(1); index < chunks.size(); ++index)
+    EXPECT_EQ(chunks[index].data(), fake_store.Get(chunks[index].name()).get().data());
+}
+
+// The sum of 'device_usage'.
+uint64_t TotalUsage(const std::vector<DiskUsage>& device_usage) {
+  uint64_t total(0);
+  for (const auto& usage : device_usage)
+    total += usage.data;
+  return total;
+}
+
+TEST(FakeStoreShardingTest, BEH_SpreadsAcrossDevices) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  const std::vector<boost::filesystem::path> disk_paths{*store_path / "0", *store_path / "1",
+                                                        *store_path / "2"};
+  std::vector<ImmutableData> chunks;
+  for (int index(0); index < 300; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(100)));
+  {
+    FakeStore fake_store(disk_paths, DiskUsage(100000));
+    for (const auto& chunk : chunks)
+      EXPECT_NO_THROW(fake_store.Put(chunk).get());
+    auto device_usage(fake_store.GetDeviceUsage());
+    ASSERT_EQ(3U, device_usage.size());
+    for (const auto& usage : device_usage)
+      EXPECT_LT(DiskUsage(0), usage);
+    EXPECT_EQ(fake_store.GetCurrentDiskUsage().data, TotalUsage(device_usage));
+    EXPECT_EQ(0U, fake_store.GetPendingMigrations());
+  }
+  // The devices keep their places however they're listed.
+  {
+    const std::vector<boost::filesystem::path> reordered{disk_paths[0], disk_paths[2],
+                                                         disk_paths[1]};
+    FakeStore fake_store(reordered, DiskUsage(100000));
+    EXPECT_EQ(0U, fake_store.GetPendingMigrations());
+    for (const auto& chunk : chunks)
+      EXPECT_EQ(chunk.data(), fake_store.Get(chunk.name()).get().data());
+  }
+  // Every device must be given.
+  EXPECT_THROW(FakeStore fake_store(disk_paths[0], DiskUsage(100000)), std::exception);
+  const std::vector<boost::filesystem::path> missing_one{disk_paths[0], disk_paths[1]};
+  EXPECT_THROW(FakeStore fake_store(missing_one, DiskUsage(100000)), std::exception);
+  // The first device, which holds the manifest, must stay first.
+  const std::vector<boost::filesystem::path> first_moved{disk_paths[1], disk_paths[0],
+                                                         disk_paths[2]};
+  EXPECT_THROW(FakeStore fake_store(first_moved, DiskUsage(100000)), std::exception);
+}
+
+TEST(FakeStoreShardingTest, BEH_AddedDeviceIsFilled) {
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  std::vector<boost::filesystem::path> disk_paths{*store_path / "0", *store_path / "1"};
+  std::vector<ImmutableData> chunks;
+  for (int index(0); index < 500; ++index)
+    chunks.emplace_back(NonEmptyString(RandomString(100)));
+  {
+    FakeStore fake_store(disk_paths, DiskUsage(100000));
+    for (const auto& chunk : chunks)
+      EXPECT_NO_THROW(fake_store.Put(chunk).get());
+    EXPECT_NO_THROW(fake_store.Put(chunks.front()).get());
+  }
+
+  disk_paths.push_back(*store_path / "2");
+  {
+    FakeStore fake_store(disk_paths, DiskUsage(100000));
+    // Usable while the new device is filled.
+    EXPECT_NO_THROW(fake_store.Delete(chunks.front().name()).get());
+    EXPECT_NO_THROW(fake_store.Delete(chunks.back().name()).get());
+    for (size_t index(0); index + 1 < chunks.size(); ++index)
+      EXPECT_EQ(chunks[index].data(), fake_store.Get(chunks[index].name()).get().data());
+    EXPECT_THROW(fake_store.Get(chunks.back().name()).get(), std::exception);
+
+    for (int attempt(0); attempt < 1000 && fake_store.GetPendingMigrations() != 0; ++attempt)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(0U, fake_store.GetPendingMigrations());
+    auto device_usage(fake_store.GetDeviceUsage());
+    ASSERT_EQ(3U, device_usage.size());
+    EXPECT_LT(DiskUsage(0), device_usage[2]);
+    EXPECT_EQ(fake_store.GetCurrentDiskUsage().data, TotalUsage(device_usage));
+  }
+
+  // Nothing left to move, and the reference counts intact.
+  FakeStore fake_store(disk_paths, DiskUsage(100000));
+  EXPECT_EQ(0U, fake_store.GetPendingMigrations());
+  for (size_t index(0); index + 1 < chunks.size(); ++index)
+    EXPECT_EQ(chunks[index].data(), fake_store.Get(chunks[index].name()).get().data());
+  EXPECT_NO_THROW(fake_store.Delete(chunks.front().name()).get());
+  EXPECT_THROW(fake_store.Get(chunks.front().name()).get(), std::exception);
+}
+
+TEST(FakeStoreUringBackendTest, BEH_WriteManyAndSync) {
+  if (!FakeStoreUringBackend::Available()) {
+    std::cout << "io_uring isn't available here; skipping.\n";
+    return;
+  }
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  // More than a ring's worth, so the batch is submitted in parts.
+  std::vector<std::pair<std::string, NonEmptyString>> chunks;
+  std::vector<std::string> names;
+  for (unsigned index(0); index < FakeStoreUringBackend::kRingEntries + 10; ++index) {
+    chunks.emplace_back(RandomAlphaNumericString(20), NonEmptyString(RandomString(1000 + index)));
+    names.push_back(chunks.back().first);
+  }
+  {
+    FakeStoreUringBackend backend(*store_path, 5);
+    EXPECT_NO_THROW(backend.WriteMany(chunks));
+    EXPECT_NO_THROW(backend.Sync(names));
+    for (const auto& chunk : chunks)
+      EXPECT_EQ(chunk.second, backend.Read(chunk.first));
+  }
+  // Written in the file-per-chunk layout, so readable without io_uring.
+  FakeStoreFileBackend backend(*store_path, 5);
+  for (const auto& chunk : chunks)
+    EXPECT_EQ(chunk.second, backend.Read(chunk.first));
+}
+
+// Threads in this process, where that can be counted.
+size_t ThreadCount() {
+#ifdef __linux__
+  boost::system::error_code error_code;
+  return static_cast<size_t>(
+      std::distance(boost::filesystem::directory_iterator("/proc/self/task", error_code),
+                    boost::filesystem::directory_iterator()));
+#else
+  return 0;
+#endif
+}
+
+// A burst of Gets far beyond the queue limit is served by the store's own threads, with the caller
+// held back rather than the queue (or the number of threads) growing without bound.
+TEST(FakeStoreThreadingTest, BEH_GetBurst) {
+  const size_t kGetCount(10000);
+  const int kThreadCount(4);
+  maidsafe::test::TestPath store_path(maidsafe::test::CreateTestPath("MaidSafe_Test_FakeStore"));
+  FakeStore::Options options;
+  options.thread_count = kThreadCount;
+  FakeStore fake_store(*store_path, kDefaultMaxDiskUsage, options);
+  ImmutableData data(NonEmptyString(RandomString(100)));
+  ASSERT_NO_THROW(fake_store.Put(data).get());
+
+  const size_t threads_before(ThreadCount());
+  size_t peak_threads(threads_before);
+  auto start(std::chrono::steady_clock::now());
+  std::vector<boost::future<ImmutableData>> futures;
+  for (size_t index(0); index < kGetCount; ++index) {
+    futures.push_back(fake_store.Get(data.name()));
+    if (index % 500 == 0)
+      peak_threads = std::max(peak_threads, ThreadCount());
+  }
+  for (auto& future : futures)
+    EXPECT_EQ(data.data(), future.get().data());
+  std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+  RecordProperty("gets_per_second", static_cast<int>(kGetCount / elapsed.count()));
+  RecordProperty("threads_before", static_cast<int>(threads_before));
+  RecordProperty("peak_threads", static_cast<int>(peak_threads));
+  // Threads started elsewhere in the process may come and go, but nothing like one per Get.
+  EXPECT_LE(peak_threads, threads_before + static_cast<size_t>(kThreadCount));
+}
+
 }  // namespace test
 }  // namespace nfs
 
@@ -0,0 +1,55 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/hot_path_log.h"
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+TEST(HotPathLogTest, BEH_ArgumentsOnlyEvaluatedWhenEnabled) {
+  int evaluated(0);
+  auto count([&evaluated]() -> int { return ++evaluated; });
+  SetVerboseHotPathLogging(false);
+  EXPECT_FALSE(VerboseHotPathLogging());
+  NFS_VERBOSE_LOG << "Evaluated " << count();
+  EXPECT_EQ(0, evaluated);
+
+  // Always false where the logging is compiled out.
+  SetVerboseHotPathLogging(true);
+  const bool enabled(VerboseHotPathLogging());
+  NFS_VERBOSE_LOG << "Evaluated " << count();
+  EXPECT_EQ(enabled ? 1 : 0, evaluated);
+
+  SetVerboseHotPathLogging(false);
+  NFS_VERBOSE_LOG << "Evaluated " << count();
+  EXPECT_EQ(enabled ? 1 : 0, evaluated);
+
+  // Back to whatever the log filter says.
+  ResetVerboseHotPathLogging();
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
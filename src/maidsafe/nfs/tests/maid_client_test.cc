@@ -18,6 +18,9 @@
 
 #include "maidsafe/nfs/tests/maid_client_test.h"
 
+#include <algorithm>
+#include <future>
+
 namespace maidsafe {
 
 namespace nfs {
@@ -33,6 +36,25 @@ TEST_F(MaidClientTest, FUNC_Constructor) {
   auto nfs_existing_account = nfs_client::MaidClient::MakeShared(maid_and_signer.first);
 }
 
+TEST_F(MaidClientTest, FUNC_MakeSharedAsync) {
+  auto maid_and_signer(passport::CreateMaidAndSigner());
+  auto client_and_ready(nfs_client::MaidClient::MakeSharedAsync(maid_and_signer));
+  auto client(client_and_ready.first);
+  // Requested before the client is ready, so held until it is.
+  ImmutableData data(NonEmptyString(RandomString(kTestChunkSize)));
+  auto put_future(client->Put(data));
+  auto get_future(client->Get(data.name(), std::chrono::seconds(120)));
+  EXPECT_NO_THROW(client_and_ready.second.get());
+  EXPECT_NO_THROW(put_future.get());
+  // The Get may have reached the network before the Put.
+  try {
+    EXPECT_EQ(data.data(), get_future.get().data());
+  } catch (const std::exception&) {
+    EXPECT_EQ(data.data(), client->Get(data.name()).get().data());
+  }
+  client->Stop();
+}
+
 TEST_F(MaidClientTest, FUNC_FailingGet) {
   ImmutableData data(NonEmptyString(RandomString(kTestChunkSize)));
   AddClient();
@@ -101,6 +123,187 @@ TEST_F(MaidClientTest, FUNC_DataFlooding) {
   LOG(kVerbose) << "Data flooding test has finished successfully";
 }
 
+TEST_F(MaidClientTest, FUNC_SharedAsioService) {
+  const size_t kClientCount(3), kIterations(6);
+  auto asio_service(std::make_shared<BoostAsioService>(Concurrency()));
+  std::vector<std::shared_ptr<nfs_client::MaidClient>> clients;
+  for (size_t index(0); index < kClientCount; ++index) {
+    clients.emplace_back(
+        nfs_client::MaidClient::MakeShared(passport::CreateMaidAndSigner(), asio_service));
+  }
+  GenerateChunks(kIterations);
+  std::vector<boost::future<void>> put_futures;
+  for (size_t index(0); index < kIterations; ++index)
+    put_futures.emplace_back(clients[index % kClientCount]->Put(chunks_[index]));
+  for (auto& future : put_futures)
+    EXPECT_NO_THROW(future.get());
+
+  // Stopping one client must leave the shared service running for the others.
+  clients.front()->Stop();
+  std::vector<boost::future<ImmutableData>> get_futures;
+  for (size_t index(0); index < kIterations; ++index) {
+    get_futures.emplace_back(clients[1 + index % (kClientCount - 1)]->Get<ImmutableData::Name>(
+        chunks_[index].name(), std::chrono::seconds(kIterations * 36)));
+  }
+  CompareGetResult(chunks_, get_futures);
+  for (size_t index(1); index < kClientCount; ++index)
+    clients[index]->Stop();
+  asio_service->Stop();
+}
+
+TEST_F(MaidClientTest, FUNC_CompletionService) {
+  auto completion_service(std::make_shared<BoostAsioService>(1));
+  auto client(nfs_client::MaidClient::MakeShared(passport::CreateMaidAndSigner(), nullptr,
+                                                 completion_service));
+  GenerateChunks(1);
+
+  // Tie up the only completion thread, as a slow continuation would.
+  std::promise<void> release;
+  auto released(release.get_future().share());
+  completion_service->service().post([released] { released.wait(); });
+
+  auto put_future(client->Put(chunks_.front()));
+  // Responses are still handled meanwhile; only resolving the future has to wait.
+  auto timeout(std::chrono::steady_clock::now() + std::chrono::seconds(60));
+  auto responded([&] {
+    auto metrics(client->congestion_metrics());
+    return !metrics.empty() &&
+           std::all_of(std::begin(metrics), std::end(metrics),
+                       [](const std::pair<NodeId, nfs_client::CongestionControl::Metrics>& entry) {
+                         return entry.second.in_flight == 0;
+                       });
+  });
+  while (!responded() && std::chrono::steady_clock::now() < timeout)
+    Sleep(std::chrono::milliseconds(100));
+  EXPECT_TRUE(responded());
+  EXPECT_FALSE(put_future.is_ready());
+
+  release.set_value();
+  EXPECT_NO_THROW(put_future.get());
+  client->Stop();
+  completion_service->Stop();
+}
+
+TEST_F(MaidClientTest, FUNC_SlabFuture) {
+  const size_t kIterations(5);
+  GenerateChunks(kIterations);
+  AddClient();
+  std::vector<nfs_client::SlabFuture<void>> put_futures;
+  for (const auto& chunk : chunks_)
+    put_futures.push_back(clients_.back()->Put(chunk, nfs_client::use_slab_future));
+  for (auto& future : put_futures)
+    EXPECT_NO_THROW(future.get());
+
+  std::vector<boost::future<ImmutableData>> get_futures;
+  for (const auto& chunk : chunks_) {
+    get_futures.emplace_back(clients_.back()->Get<ImmutableData::Name>(
+        chunk.name(), std::chrono::seconds(kIterations * 36)));
+  }
+  CompareGetResult(chunks_, get_futures);
+
+  for (const auto& chunk : chunks_) {
+    auto future(clients_.back()->Delete(chunk.name(), nfs_client::use_slab_future));
+    EXPECT_NO_THROW(future.get());
+  }
+}
+
+TEST_F(MaidClientTest, FUNC_CompletionToken) {
+  const size_t kIterations(5);
+  GenerateChunks(kIterations);
+  AddClient();
+  std::vector<std::future<nfs_client::AsyncExpected<void>>> put_results;
+  for (const auto& chunk : chunks_) {
+    auto promise(std::make_shared<std::promise<nfs_client::AsyncExpected<void>>>());
+    put_results.push_back(promise->get_future());
+    clients_.back()->Put(chunk, [promise](nfs_client::AsyncExpected<void> result) {
+                                  promise->set_value(std::move(result));
+                                });
+  }
+  for (auto& put_result : put_results)
+    EXPECT_TRUE(put_result.get().valid());
+
+  for (const auto& chunk : chunks_) {
+    std::promise<nfs_client::AsyncExpected<ImmutableData>> promise;
+    clients_.back()->Get(chunk.name(),
+                         [&promise](nfs_client::AsyncExpected<ImmutableData> result) {
+                           promise.set_value(std::move(result));
+                         },
+                         std::chrono::seconds(kIterations * 36));
+    auto result(promise.get_future().get());
+    ASSERT_TRUE(result.valid());
+    EXPECT_EQ(chunk.data(), result->data());
+  }
+
+  ImmutableData missing(NonEmptyString(RandomString(kTestChunkSize)));
+  std::promise<nfs_client::AsyncExpected<ImmutableData>> promise;
+  clients_.back()->Get(missing.name(),
+                       [&promise](nfs_client::AsyncExpected<ImmutableData> result) {
+                         promise.set_value(std::move(result));
+                       },
+                       std::chrono::seconds(10));
+  EXPECT_FALSE(promise.get_future().get().valid());
+}
+
+TEST_F(MaidClientTest, FUNC_ReferenceCounts) {
+  const size_t kIterations(5);
+  GenerateChunks(kIterations);
+  AddClient();
+  std::vector<ImmutableData::Name> chunk_names;
+  for (const auto& chunk : chunks_) {
+    auto future(clients_.back()->Put(chunk));
+    EXPECT_NO_THROW(future.get()) << "Store failure " << DebugId(NodeId(chunk.name()->string()));
+    chunk_names.push_back(chunk.name());
+  }
+
+  auto increment_future(clients_.back()->IncrementReferenceCount(chunk_names));
+  try {
+    auto return_codes(increment_future.get());
+    ASSERT_EQ(chunk_names.size(), return_codes.size());
+    for (const auto& return_code : return_codes)
+      EXPECT_TRUE(nfs::IsSuccess(return_code)) << return_code.value.what();
+  } catch (const std::exception& error) {
+    GTEST_FAIL() << "Failed to increment: " << boost::diagnostic_information(error);
+  }
+
+  auto decrement_future(clients_.back()->DecrementReferenceCount(chunk_names.front()));
+  EXPECT_NO_THROW(decrement_future.get());
+
+  std::vector<boost::future<ImmutableData>> get_futures;
+  for (const auto& chunk : chunks_) {
+    get_futures.emplace_back(clients_.back()->Get<ImmutableData::Name>(
+        chunk.name(), std::chrono::seconds(kIterations * 36)));
+  }
+  CompareGetResult(chunks_, get_futures);
+}
+
+TEST_F(MaidClientTest, FUNC_ConfirmedDelete) {
+  const size_t kIterations(5);
+  GenerateChunks(kIterations);
+  AddClient();
+  std::vector<ImmutableData::Name> chunk_names;
+  for (const auto& chunk : chunks_) {
+    auto future(clients_.back()->Put(chunk));
+    EXPECT_NO_THROW(future.get()) << "Store failure " << DebugId(NodeId(chunk.name()->string()));
+    chunk_names.push_back(chunk.name());
+  }
+
+  auto delete_future(clients_.back()->Delete(chunk_names.front()));
+  EXPECT_NO_THROW(delete_future.get());
+
+  std::vector<ImmutableData::Name> remaining_names(chunk_names.begin() + 1, chunk_names.end());
+  try {
+    auto return_codes(clients_.back()->Delete(remaining_names).get());
+    ASSERT_EQ(remaining_names.size(), return_codes.size());
+    for (const auto& return_code : return_codes)
+      EXPECT_TRUE(nfs::IsSuccess(return_code)) << return_code.value.what();
+  } catch (const std::exception& error) {
+    GTEST_FAIL() << "Failed to delete: " << boost::diagnostic_information(error);
+  }
+
+  auto empty_future(clients_.back()->Delete(std::vector<ImmutableData::Name>()));
+  EXPECT_TRUE(empty_future.get().empty());
+}
+
 /*
 // The test below is disbaled as its proper operation assumes a delete funcion is in place
 TEST_F(MaidClientTest, DISABLED_FUNC_PutMultipleCopies) {
@@ -190,6 +393,33 @@ TEST_F(MaidClientTest, FUNC_PopulateSingleBranchTree) {
   }
 }
 
+TEST_F(MaidClientTest, FUNC_GetVersionsBatch) {
+  const size_t kTreeCount(5);
+  GenerateChunks(kTreeCount, 1024);
+  AddClient();
+  std::vector<ImmutableData::Name> tree_names;
+  for (const auto& chunk : chunks_) {
+    StructuredDataVersions::VersionName v_ori(0, chunk.name());
+    ImmutableData tree(NonEmptyString(RandomAlphaNumericString(1024)));
+    auto create_version_future(clients_.back()->CreateVersionTree(tree.name(), v_ori, 10, 1));
+    EXPECT_NO_THROW(create_version_future.get()) << "failure to create version";
+    tree_names.push_back(tree.name());
+  }
+  ImmutableData missing_tree(NonEmptyString(RandomAlphaNumericString(1024)));
+  tree_names.push_back(missing_tree.name());
+  tree_names.push_back(tree_names.front());
+
+  auto versions_by_name(clients_.back()->GetVersionsBatch(tree_names).get());
+  ASSERT_EQ(kTreeCount + 1, versions_by_name.size());
+  for (size_t index(0); index < kTreeCount; ++index) {
+    const auto& versions(versions_by_name.at(tree_names[index]));
+    ASSERT_TRUE(versions.valid());
+    ASSERT_EQ(1U, versions->size());
+    EXPECT_EQ(chunks_[index].name(), versions->front().id);
+  }
+  EXPECT_FALSE(versions_by_name.at(missing_tree.name()).valid());
+}
+
 TEST_F(MaidClientTest, FUNC_PopulateMultipleBranchTree) {
   VersionTreeTest(5, 4, 20);
   VersionTreeTest(100, 10, 60);
@@ -32,6 +32,14 @@ TEST_F(MpidClientTest, FUNC_Constructor) {
   auto existing_account = nfs_client::MpidClient::MakeShared(mpid_and_signer.first);
 }
 
+TEST_F(MpidClientTest, FUNC_MakeSharedAsync) {
+  auto mpid_and_signer(passport::CreateMpidAndSigner());
+  // The account creation is held until the client is ready, and the returned future waits for it.
+  auto client_and_ready(nfs_client::MpidClient::MakeSharedAsync(mpid_and_signer));
+  EXPECT_NO_THROW(client_and_ready.second.get());
+  client_and_ready.first->Stop();
+}
+
 }  // namespace test
 
 }  // namespace nfs
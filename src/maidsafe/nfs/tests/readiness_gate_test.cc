@@ -0,0 +1,94 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/readiness_gate.h"
+
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+TEST(ReadinessGateTest, BEH_HeldUntilOpenInOrder) {
+  nfs_client::ReadinessGate gate;
+  std::vector<int> run;
+  EXPECT_FALSE(gate.IsOpen());
+  gate.Run([&] { run.push_back(0); });
+  // A held functor making a further request while the gate drains goes behind those already held.
+  gate.Run([&] {
+    run.push_back(1);
+    gate.Run([&] { run.push_back(3); });
+  });
+  gate.Run([&] { run.push_back(2); });
+  EXPECT_TRUE(run.empty());
+
+  EXPECT_TRUE(gate.Open());
+  EXPECT_TRUE(gate.IsOpen());
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), run);
+  gate.Run([&] { run.push_back(4); });
+  EXPECT_EQ(5U, run.size());
+  EXPECT_FALSE(gate.Open());
+
+  // Closing an opened gate drops later functors, but isn't a failure to become ready.
+  EXPECT_FALSE(gate.Close());
+  gate.Run([&] { run.push_back(5); });
+  EXPECT_EQ(5U, run.size());
+}
+
+TEST(ReadinessGateTest, BEH_CloseIfHoldingLeavesOpenGateOpen) {
+  nfs_client::ReadinessGate gate;
+  int run_count(0);
+  gate.Run([&] { ++run_count; });
+  EXPECT_TRUE(gate.Open());
+  EXPECT_EQ(1, run_count);
+
+  // A health drop after the client became ready mustn't stop its later requests.
+  EXPECT_FALSE(gate.CloseIfHolding());
+  EXPECT_TRUE(gate.IsOpen());
+  gate.Run([&] { ++run_count; });
+  EXPECT_EQ(2, run_count);
+
+  // Whereas a gate still holding is closed, dropping what it held.
+  nfs_client::ReadinessGate joining_gate;
+  joining_gate.Run([&] { ++run_count; });
+  EXPECT_TRUE(joining_gate.CloseIfHolding());
+  EXPECT_FALSE(joining_gate.CloseIfHolding());
+  EXPECT_FALSE(joining_gate.Open());
+  EXPECT_EQ(2, run_count);
+}
+
+TEST(ReadinessGateTest, BEH_CloseDropsHeld) {
+  nfs_client::ReadinessGate gate;
+  int run_count(0);
+  gate.Run([&] { ++run_count; });
+  EXPECT_TRUE(gate.Close());
+  EXPECT_FALSE(gate.Open());
+  gate.Run([&] { ++run_count; });
+  EXPECT_EQ(0, run_count);
+  EXPECT_FALSE(gate.IsOpen());
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/shutdown_gate.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+TEST(ShutdownGateTest, BEH_CallersInsideRunConcurrently) {
+  const int kThreadCount(8);
+  nfs_client::ShutdownGate gate;
+  std::mutex mutex;
+  std::condition_variable all_inside;
+  int inside(0);
+  std::vector<std::thread> threads;
+  for (int index(0); index < kThreadCount; ++index) {
+    threads.emplace_back([&] {
+      ASSERT_TRUE(gate.Enter());
+      {
+        // Only returns once every thread is inside the gate at the same time.
+        std::unique_lock<std::mutex> lock(mutex);
+        ++inside;
+        all_inside.notify_all();
+        EXPECT_TRUE(all_inside.wait_for(lock, std::chrono::seconds(10),
+                                        [&] { return inside == kThreadCount; }));
+      }
+      gate.Leave();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  gate.Close();
+  EXPECT_FALSE(gate.Enter());
+}
+
+TEST(ShutdownGateTest, BEH_CloseWaitsForCallersInside) {
+  nfs_client::ShutdownGate gate;
+  std::atomic<bool> closed(false);
+  ASSERT_TRUE(gate.Enter());
+  std::thread closer([&] {
+    gate.Close();
+    closed = true;
+  });
+  // Once closing has begun no one else gets in, but the caller already inside holds Close up.
+  while (gate.Enter()) {
+    gate.Leave();
+    std::this_thread::yield();
+  }
+  Sleep(std::chrono::milliseconds(100));
+  EXPECT_FALSE(closed.load());
+  gate.Leave();
+  closer.join();
+  EXPECT_TRUE(closed.load());
+  EXPECT_FALSE(gate.Enter());
+  // Closing again returns immediately.
+  gate.Close();
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
@@ -0,0 +1,356 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/simulated_network.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/data_types/immutable_data.h"
+#include "maidsafe/passport/passport.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/nfs/client/maid_client.h"
+#include "maidsafe/nfs/client/mpid_client.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+class SimulatedNetworkTest : public testing::Test {
+ protected:
+  SimulatedNetworkTest()
+      : network_(maidsafe::make_unique<SimulatedNetwork>()), maid_clients_(), mpid_clients_() {}
+
+  ~SimulatedNetworkTest() {
+    for (auto& client : maid_clients_)
+      client->Stop();
+    for (auto& client : mpid_clients_)
+      client->Stop();
+  }
+
+  std::shared_ptr<nfs_client::MaidClient> AddMaidClient(
+      std::shared_ptr<BoostAsioService> asio_service = nullptr,
+      std::shared_ptr<BoostAsioService> completion_service = nullptr) {
+    auto maid_and_signer(passport::CreateMaidAndSigner());
+    maid_clients_.push_back(nfs_client::MaidClient::MakeSharedWithRouting(
+        maid_and_signer, network_->MakeRouting(maid_and_signer.first), asio_service,
+        completion_service));
+    return maid_clients_.back();
+  }
+
+  std::shared_ptr<nfs_client::MpidClient> AddMpidClient(const passport::MpidAndSigner& keys) {
+    mpid_clients_.push_back(
+        nfs_client::MpidClient::MakeSharedWithRouting(keys, network_->MakeRouting(keys.first)));
+    return mpid_clients_.back();
+  }
+
+  // For tests where messages are lost: runs 'operation' until it succeeds, a few times at most.
+  template <typename Operation>
+  bool Retry(Operation operation) {
+    for (int attempt(0); attempt < 5; ++attempt) {
+      try {
+        operation();
+        return true;
+      }
+      catch (const std::exception& e) {
+        LOG(kInfo) << "Attempt " << attempt << " failed: " << e.what();
+      }
+    }
+    return false;
+  }
+
+  std::unique_ptr<SimulatedNetwork> network_;
+  std::vector<std::shared_ptr<nfs_client::MaidClient>> maid_clients_;
+  std::vector<std::shared_ptr<nfs_client::MpidClient>> mpid_clients_;
+};
+
+TEST_F(SimulatedNetworkTest, BEH_InvalidConfig) {
+  SimulatedNetwork::Config config;
+  config.vault_count = routing::Parameters::group_size - 1;
+  EXPECT_THROW(SimulatedNetwork{ config }, maidsafe_error);
+  config = SimulatedNetwork::Config();
+  config.max_latency = config.min_latency - std::chrono::milliseconds(1);
+  EXPECT_THROW(SimulatedNetwork{ config }, maidsafe_error);
+  config = SimulatedNetwork::Config();
+  config.loss_rate = 1.5;
+  EXPECT_THROW(SimulatedNetwork{ config }, maidsafe_error);
+}
+
+TEST_F(SimulatedNetworkTest, BEH_OneConnectionPerClient) {
+  NodeId node_id(RandomString(NodeId::kSize));
+  {
+    auto routing(network_->MakeRouting(node_id));
+    EXPECT_EQ(node_id, routing->kNodeId());
+    EXPECT_THROW(network_->MakeRouting(node_id), maidsafe_error);
+    EXPECT_EQ(1U, network_->connected_clients());
+  }
+  EXPECT_EQ(0U, network_->connected_clients());
+  EXPECT_NO_THROW(network_->MakeRouting(node_id));
+}
+
+TEST_F(SimulatedNetworkTest, BEH_PutGetDelete) {
+  auto client(AddMaidClient());
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  EXPECT_NO_THROW(client->Put(data).get());
+  EXPECT_EQ(data.data(), client->Get(data.name(), std::chrono::seconds(10)).get().data());
+  // Stored twice, so must be deleted twice.
+  EXPECT_NO_THROW(client->Put(data).get());
+  EXPECT_NO_THROW(client->Delete(data.name()).get());
+  EXPECT_EQ(data.data(), client->Get(data.name(), std::chrono::seconds(10)).get().data());
+  EXPECT_NO_THROW(client->Delete(data.name()).get());
+  EXPECT_THROW(client->Get(data.name(), std::chrono::seconds(10)).get(), std::exception);
+
+  // The client has its answer once enough of the group have responded, so the rest of the
+  // responses may still be on their way.
+  const uint64_t kGroupSize(routing::Parameters::group_size);
+  auto stats(network_->GetStats());
+  auto timeout(std::chrono::steady_clock::now() + std::chrono::seconds(5));
+  while (stats.responses < stats.requests * kGroupSize &&
+         std::chrono::steady_clock::now() < timeout) {
+    Sleep(std::chrono::milliseconds(10));
+    stats = network_->GetStats();
+  }
+  EXPECT_GT(stats.requests, 0U);
+  EXPECT_EQ(stats.requests * kGroupSize, stats.responses);
+  EXPECT_EQ(0U, stats.lost);
+}
+
+TEST_F(SimulatedNetworkTest, BEH_HealthDropAfterReady) {
+  auto maid_and_signer(passport::CreateMaidAndSigner());
+  const NodeId node_id(maid_and_signer.first.name()->string());
+  // A single thread, so the client handles everything on it in order.
+  auto asio_service(std::make_shared<BoostAsioService>(1));
+  maid_clients_.push_back(nfs_client::MaidClient::MakeSharedWithRouting(
+      maid_and_signer, network_->MakeRouting(node_id), asio_service));
+  auto client(maid_clients_.back());
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  // Once this succeeds the client is ready.
+  EXPECT_NO_THROW(client->Put(data).get());
+
+  // Low enough to count as a failure to join, had it come while joining.  The client handles it on
+  // asio_service's thread, so has done so once a task posted after it has run.
+  network_->ReportNetworkHealth(node_id, -1000000);
+  boost::promise<void> health_handled;
+  asio_service->service().post([&health_handled] { health_handled.set_value(); });
+  health_handled.get_future().get();
+
+  ImmutableData later_data(NonEmptyString(RandomString(1024)));
+  EXPECT_NO_THROW(client->Put(later_data).get());
+  EXPECT_EQ(later_data.data(),
+            client->Get(later_data.name(), std::chrono::seconds(10)).get().data());
+}
+
+TEST_F(SimulatedNetworkTest, BEH_PutWithoutAccount) {
+  auto maid_and_signer(passport::CreateMaidAndSigner());
+  maid_clients_.push_back(nfs_client::MaidClient::MakeSharedWithRouting(
+      maid_and_signer.first, network_->MakeRouting(maid_and_signer.first)));
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  EXPECT_THROW(maid_clients_.back()->Put(data).get(), std::exception);
+}
+
+TEST_F(SimulatedNetworkTest, BEH_Versions) {
+  auto client(AddMaidClient());
+  ImmutableData::Name name(Identity(RandomString(64)));
+  StructuredDataVersions::VersionName v0(0, ImmutableData::Name(Identity(RandomString(64))));
+  StructuredDataVersions::VersionName v1(1, ImmutableData::Name(Identity(RandomString(64))));
+  EXPECT_NO_THROW(client->CreateVersionTree(name, v0, 10, 1).get());
+  EXPECT_NO_THROW(client->PutVersion(name, v0, v1).get());
+
+  auto tips(client->GetVersions(name).get());
+  ASSERT_EQ(1U, tips.size());
+  EXPECT_EQ(v1.id, tips.front().id);
+  auto branch(client->GetBranch(name, v1).get());
+  ASSERT_EQ(2U, branch.size());
+  EXPECT_EQ(v1.id, branch[0].id);
+  EXPECT_EQ(v0.id, branch[1].id);
+
+  ImmutableData::Name missing(Identity(RandomString(64)));
+  EXPECT_THROW(client->GetVersions(missing).get(), std::exception);
+}
+
+TEST_F(SimulatedNetworkTest, BEH_GetVersionsBatch) {
+  // Few enough vaults that many names share a close group.
+  SimulatedNetwork::Config config;
+  config.vault_count = routing::Parameters::group_size + 1;
+  network_ = maidsafe::make_unique<SimulatedNetwork>(config);
+  auto client(AddMaidClient());
+  const size_t kTreeCount(20);
+  std::vector<ImmutableData::Name> names;
+  StructuredDataVersions::VersionName v0(0, ImmutableData::Name(Identity(RandomString(64))));
+  for (size_t index(0); index < kTreeCount; ++index) {
+    names.emplace_back(Identity(RandomString(64)));
+    EXPECT_NO_THROW(client->CreateVersionTree(names.back(), v0, 10, 1).get());
+  }
+  ImmutableData::Name missing(Identity(RandomString(64)));
+  names.push_back(missing);
+
+  auto probe(network_->MakeRouting(NodeId(RandomString(NodeId::kSize))));
+  std::set<std::vector<NodeId>> close_groups;
+  for (const auto& name : names) {
+    auto close_group(probe->CloseGroup(NodeId(name->string())));
+    std::sort(std::begin(close_group), std::end(close_group));
+    close_groups.insert(close_group);
+  }
+
+  const auto requests_before(network_->GetStats().requests);
+  auto versions_by_name(client->GetVersionsBatch(names).get());
+  EXPECT_EQ(close_groups.size(), network_->GetStats().requests - requests_before);
+  EXPECT_LT(close_groups.size(), names.size());
+
+  ASSERT_EQ(names.size(), versions_by_name.size());
+  for (size_t index(0); index < kTreeCount; ++index) {
+    const auto& versions(versions_by_name.at(names[index]));
+    ASSERT_TRUE(versions.valid());
+    ASSERT_EQ(1U, versions->size());
+    EXPECT_EQ(v0.id, versions->front().id);
+  }
+  EXPECT_FALSE(versions_by_name.at(missing).valid());
+}
+
+TEST_F(SimulatedNetworkTest, BEH_MpidMessages) {
+  auto sender_keys(passport::CreateMpidAndSigner());
+  auto receiver_keys(passport::CreateMpidAndSigner());
+  auto sender(AddMpidClient(sender_keys));
+  auto receiver(AddMpidClient(receiver_keys));
+
+  nfs_vault::MpidMessage message(
+      nfs_vault::MpidMessageBase(
+          passport::PublicMpid::Name(Identity(sender_keys.first.name()->string())),
+          passport::PublicMpid::Name(Identity(receiver_keys.first.name()->string())), 0, 0,
+          nfs_vault::MessageHeaderType(RandomString(64))),
+      nfs_vault::MessageBodyType(RandomString(1024)));
+  EXPECT_NO_THROW(sender->SendMessage(message).get());
+  EXPECT_EQ(message, receiver->GetMessage(SimulatedNetwork::AlertFor(message)).get());
+
+  nfs_vault::MpidMessage unsent(message.base, nfs_vault::MessageBodyType(RandomString(1024)));
+  EXPECT_THROW(receiver->GetMessage(SimulatedNetwork::AlertFor(unsent)).get(), std::exception);
+}
+
+TEST_F(SimulatedNetworkTest, FUNC_LossAndChurn) {
+  SimulatedNetwork::Config config;
+  config.max_latency = std::chrono::milliseconds(5);
+  config.loss_rate = 0.02;
+  config.churn_interval = std::chrono::milliseconds(20);
+  config.churn_fraction = 0.1;
+  network_ = maidsafe::make_unique<SimulatedNetwork>(config);
+
+  auto maid_and_signer(passport::CreateMaidAndSigner());
+  maid_clients_.push_back(nfs_client::MaidClient::MakeSharedWithRouting(
+      maid_and_signer.first, network_->MakeRouting(maid_and_signer.first)));
+  auto client(maid_clients_.back());
+  const nfs_vault::MaidAccountCreation account_creation(
+      passport::PublicMaid(maid_and_signer.first), passport::PublicAnmaid(maid_and_signer.second));
+  const std::chrono::seconds kTimeout(1);
+  ASSERT_TRUE(Retry([&] { client->CreateAccount(account_creation, kTimeout).get(); }));
+
+  std::vector<ImmutableData> chunks;
+  for (int index(0); index < 20; ++index) {
+    chunks.emplace_back(NonEmptyString(RandomString(1024)));
+    const ImmutableData& chunk(chunks.back());
+    EXPECT_TRUE(Retry([&] { client->Put(chunk, kTimeout).get(); }));
+  }
+  for (const auto& chunk : chunks) {
+    EXPECT_TRUE(Retry([&] {
+      if (client->Get(chunk.name(), kTimeout).get().data() != chunk.data())
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }));
+  }
+
+  auto stats(network_->GetStats());
+  EXPECT_GT(stats.lost, 0U);
+  EXPECT_GT(stats.churn_events, 0U);
+}
+
+TEST_F(SimulatedNetworkTest, FUNC_ManyClients) {
+  const size_t kClientCount(1000), kChunksPerClient(4);
+  SimulatedNetwork::Config config;
+  config.vault_count = 256;
+  config.min_latency = std::chrono::steady_clock::duration::zero();
+  config.max_latency = std::chrono::milliseconds(2);
+  network_ = maidsafe::make_unique<SimulatedNetwork>(config);
+  // Shared, so that the clients don't each need threads of their own.
+  auto asio_service(std::make_shared<BoostAsioService>(4));
+  auto completion_service(std::make_shared<BoostAsioService>(2));
+  on_scope_exit stop_services([&] {
+    for (auto& client : maid_clients_)
+      client->Stop();
+    maid_clients_.clear();
+    asio_service->Stop();
+    completion_service->Stop();
+  });
+
+  auto start(std::chrono::steady_clock::now());
+  for (size_t index(0); index < kClientCount; ++index)
+    AddMaidClient(asio_service, completion_service);
+  auto joined(std::chrono::steady_clock::now());
+
+  std::vector<ImmutableData> chunks;
+  std::vector<boost::future<void>> put_futures;
+  for (const auto& client : maid_clients_) {
+    for (size_t index(0); index < kChunksPerClient; ++index) {
+      chunks.emplace_back(NonEmptyString(RandomString(1024)));
+      put_futures.emplace_back(client->Put(chunks.back()));
+    }
+  }
+  for (auto& future : put_futures)
+    EXPECT_NO_THROW(future.get());
+  auto put(std::chrono::steady_clock::now());
+
+  std::vector<boost::future<ImmutableData>> get_futures;
+  for (size_t index(0); index < chunks.size(); ++index) {
+    get_futures.emplace_back(maid_clients_[index % kClientCount]->Get(
+        chunks[index].name(), std::chrono::seconds(60)));
+  }
+  for (size_t index(0); index < chunks.size(); ++index)
+    EXPECT_EQ(chunks[index].data(), get_futures[index].get().data());
+  auto got(std::chrono::steady_clock::now());
+
+  // Nothing is lost or churned, so each Put and Get was a request of its own, and every reply
+  // reached its client.
+  auto stats(network_->GetStats());
+  EXPECT_LE(2 * chunks.size(), stats.requests);
+  EXPECT_EQ(0U, stats.lost);
+  EXPECT_EQ(0U, stats.lost_to_churn);
+  EXPECT_EQ(0U, stats.undeliverable);
+
+  auto milliseconds([](std::chrono::steady_clock::duration duration) {
+    return static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+  });
+  RecordProperty("join_ms", milliseconds(joined - start));
+  RecordProperty("put_ms", milliseconds(put - joined));
+  RecordProperty("get_ms", milliseconds(got - put));
+  RecordProperty("requests", static_cast<int>(stats.requests));
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe
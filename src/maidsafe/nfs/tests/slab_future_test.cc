@@ -0,0 +1,144 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/nfs/client/slab_future.h"
+
+#include <thread>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/nfs/client/client_utils.h"
+#include "maidsafe/nfs/client/messages.h"
+
+namespace maidsafe {
+
+namespace nfs {
+
+namespace test {
+
+class SlabFutureTest : public testing::Test {
+ protected:
+  typedef nfs_client::OperationSlab<void, nfs_client::ReturnCode> ReturnCodeSlab;
+
+  SlabFutureTest() : kCapacity_(4), kSuccessesRequired_(routing::Parameters::group_size - 1),
+                     slab_(kCapacity_) {}
+
+  nfs_client::SlabFuture<void> Acquire(ReturnCodeSlab::Handle& handle) {
+    return slab_.Acquire(kSuccessesRequired_, &nfs_client::GetSuccessOrError, handle);
+  }
+
+  void Respond(const ReturnCodeSlab::Handle& handle, CommonErrors error, int count) {
+    for (int index(0); index < count; ++index)
+      ReturnCodeSlab::HandleResponseContents(handle, nfs_client::ReturnCode(error));
+  }
+
+  const size_t kCapacity_;
+  const int kSuccessesRequired_;
+  ReturnCodeSlab slab_;
+};
+
+TEST_F(SlabFutureTest, BEH_Success) {
+  ReturnCodeSlab::Handle handle;
+  auto future(Acquire(handle));
+  ASSERT_TRUE(future.valid());
+  Respond(handle, CommonErrors::success, kSuccessesRequired_ - 1);
+  EXPECT_FALSE(future.is_ready());
+  std::thread responder([&] { Respond(handle, CommonErrors::success, 1); });
+  EXPECT_NO_THROW(future.get());
+  responder.join();
+  EXPECT_FALSE(future.valid());
+}
+
+TEST_F(SlabFutureTest, BEH_FailureAndTimeout) {
+  ReturnCodeSlab::Handle handle;
+  auto failed_future(Acquire(handle));
+  Respond(handle, CommonErrors::invalid_parameter, routing::Parameters::group_size / 2 + 1);
+  ASSERT_TRUE(failed_future.is_ready());
+  EXPECT_THROW(failed_future.get(), maidsafe_error);
+
+  // The timer's default contents stand for a timeout and complete the operation at once.
+  auto timed_out_future(Acquire(handle));
+  ReturnCodeSlab::HandleResponseContents(handle, nfs_client::ReturnCode());
+  ASSERT_TRUE(timed_out_future.wait_for(std::chrono::seconds(0)));
+  try {
+    timed_out_future.get();
+    ADD_FAILURE() << "Should have thrown.";
+  } catch (const maidsafe_error& error) {
+    EXPECT_EQ(make_error_code(CommonErrors::defaulted), error.code());
+  }
+}
+
+TEST_F(SlabFutureTest, BEH_StatesAreReused) {
+  for (size_t iteration(0); iteration < kCapacity_ * 10; ++iteration) {
+    ReturnCodeSlab::Handle handle;
+    auto future(Acquire(handle));
+    Respond(handle, CommonErrors::success, kSuccessesRequired_);
+    EXPECT_NO_THROW(future.get());
+    // Late responses to a completed, and since reused, state are ignored.
+    Respond(handle, CommonErrors::invalid_parameter, routing::Parameters::group_size);
+  }
+  EXPECT_EQ(kCapacity_, slab_.size());
+
+  // A future dropped before its operation completes frees the state once the operation does.
+  {
+    ReturnCodeSlab::Handle handle;
+    Acquire(handle);
+    Respond(handle, CommonErrors::success, kSuccessesRequired_);
+  }
+
+  // Holding more futures than the capacity grows the slab.
+  std::vector<nfs_client::SlabFuture<void>> futures;
+  std::vector<ReturnCodeSlab::Handle> handles(kCapacity_ + 1);
+  for (auto& handle : handles)
+    futures.push_back(Acquire(handle));
+  EXPECT_EQ(kCapacity_ + 1, slab_.size());
+  for (const auto& handle : handles)
+    Respond(handle, CommonErrors::success, kSuccessesRequired_);
+  for (auto& future : futures)
+    EXPECT_NO_THROW(future.get());
+}
+
+TEST_F(SlabFutureTest, BEH_CancelAll) {
+  ReturnCodeSlab::Handle completed_handle, waited_handle, dropped_handle;
+  auto completed_future(Acquire(completed_handle));
+  Respond(completed_handle, CommonErrors::success, kSuccessesRequired_);
+  auto waited_future(Acquire(waited_handle));
+  Acquire(dropped_handle);
+
+  // A thread already waiting is woken with the failure.
+  std::thread waiter([&] { EXPECT_THROW(waited_future.get(), maidsafe_error); });
+  slab_.CancelAll();
+  waiter.join();
+  EXPECT_NO_THROW(completed_future.get());
+
+  // Responses arriving afterwards are ignored, and every state is free again.
+  Respond(waited_handle, CommonErrors::success, kSuccessesRequired_);
+  Respond(dropped_handle, CommonErrors::success, kSuccessesRequired_);
+  std::vector<nfs_client::SlabFuture<void>> futures;
+  std::vector<ReturnCodeSlab::Handle> handles(kCapacity_);
+  for (auto& handle : handles)
+    futures.push_back(Acquire(handle));
+  EXPECT_EQ(kCapacity_, slab_.size());
+}
+
+}  // namespace test
+
+}  // namespace nfs
+
+}  // namespace maidsafe